@@ -0,0 +1,159 @@
+/*
+ * Compare the hit ratio of A3_CACHE with that of its previous eviction policy, on Zipfian traces.
+ * The previous policy marked entries in an access bitmap, cleared a block of the bitmap whenever it
+ * filled, and cleared all of it after every eviction, since deletion moves entries between slots.
+ * It is reproduced here over a plain table, sized to exactly the capacity as the old cache was.
+ * Each request looks its key up, and inserts it on a miss.
+ *
+ * Usage: bench_cache [KEYS] [REQUESTS]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <a3/cache.h>
+#include <a3/ht.h>
+#include <a3/types.h>
+
+#define U64_HASH(TABLE, KEY) (((KEY) ^ (TABLE)->hash_key[0]) * 0x9E3779B97F4A7C15ULL)
+
+static int8_t u64_cmp(uint64_t lhs, uint64_t rhs) { return lhs < rhs ? -1 : lhs > rhs; }
+
+A3_CACHE_DEFINE_STRUCTS(uint64_t, uint64_t)
+A3_CACHE_DECLARE_METHODS(uint64_t, uint64_t)
+A3_CACHE_DEFINE_METHODS_HASHER(uint64_t, uint64_t, U64_HASH, u64_cmp)
+
+A3_HT_DEFINE_STRUCTS(uint64_t, uint64_t)
+A3_HT_DECLARE_METHODS(uint64_t, uint64_t)
+A3_HT_DEFINE_METHODS_HASHER(uint64_t, uint64_t, U64_HASH, u64_cmp)
+
+using Clock = std::chrono::steady_clock;
+
+// The previous policy.
+class BitmapCache {
+    static constexpr size_t BITS = sizeof(size_t) * 8;
+
+    size_t                    eviction_index { 0 };
+    std::vector<size_t>       accessed;
+    A3_HT(uint64_t, uint64_t) table {};
+
+    void access(size_t index) {
+        size_t* block = &accessed[index / BITS];
+        size_t  bit   = static_cast<size_t>(1) << (index % BITS);
+        if ((*block | bit) == SIZE_MAX)
+            *block = 0;
+        *block |= bit;
+    }
+
+    bool was_accessed(size_t index) const {
+        return accessed[index / BITS] & (static_cast<size_t>(1) << (index % BITS));
+    }
+
+    void evict() {
+        while (was_accessed(eviction_index) || !table.entries[eviction_index].hash)
+            eviction_index = (eviction_index + 1) % table.cap;
+        A3_HT_DELETE_INDEX(uint64_t, uint64_t)(&table, eviction_index);
+        std::fill(accessed.begin(), accessed.end(), 0);
+    }
+
+public:
+    explicit BitmapCache(size_t capacity) : accessed(capacity / BITS + 1) {
+        A3_HT_INIT_SLOTS(uint64_t, uint64_t)
+        (&table, A3_HT_NO_HASH_KEY, A3_HT_FORBID_GROWTH, capacity);
+    }
+    BitmapCache(BitmapCache const&)            = delete;
+    BitmapCache& operator=(BitmapCache const&) = delete;
+    ~BitmapCache() { A3_HT_DESTROY(uint64_t, uint64_t)(&table); }
+
+    bool request(uint64_t key) {
+        A3_SSIZE_T index = A3_HT_FIND_INDEX(uint64_t, uint64_t)(&table, key);
+        if (index >= 0) {
+            access(static_cast<size_t>(index));
+            return true;
+        }
+
+        if (!A3_HT_INSERT(uint64_t, uint64_t)(&table, key, key)) {
+            evict();
+            A3_HT_INSERT(uint64_t, uint64_t)(&table, key, key);
+        }
+        access(static_cast<size_t>(A3_HT_FIND_INDEX(uint64_t, uint64_t)(&table, key)));
+        return false;
+    }
+};
+
+class ClockCache {
+    A3_CACHE(uint64_t, uint64_t) cache {};
+
+public:
+    explicit ClockCache(size_t capacity) {
+        A3_CACHE_INIT(uint64_t, uint64_t)(&cache, capacity, nullptr);
+    }
+    ClockCache(ClockCache const&)            = delete;
+    ClockCache& operator=(ClockCache const&) = delete;
+    ~ClockCache() { A3_CACHE_DESTROY(uint64_t, uint64_t)(&cache); }
+
+    bool request(uint64_t key) {
+        if (A3_CACHE_FIND(uint64_t, uint64_t)(&cache, key))
+            return true;
+        A3_CACHE_INSERT(uint64_t, uint64_t)(&cache, key, key, nullptr);
+        return false;
+    }
+};
+
+// Draw REQUESTS keys from KEYS, where the key of rank r has weight 1 / r^s. Ranks are scattered
+// over the key space, so that popular keys do not share hash table neighbourhoods.
+static std::vector<uint64_t> zipf_trace(size_t keys, size_t requests, double s) {
+    std::vector<double> cdf(keys);
+    double              total = 0.0;
+    for (size_t r = 0; r < keys; r++) {
+        total += 1.0 / std::pow(static_cast<double>(r + 1), s);
+        cdf[r] = total;
+    }
+
+    std::mt19937_64                        rng(42);
+    std::uniform_real_distribution<double> uniform(0.0, total);
+    std::vector<uint64_t>                  trace(requests);
+    for (auto& key : trace) {
+        auto rank = static_cast<uint64_t>(std::lower_bound(cdf.begin(), cdf.end(), uniform(rng)) -
+                                          cdf.begin());
+        key       = (rank + 1) * 0xD6E8FEB86659FD93ULL;
+    }
+    return trace;
+}
+
+template <typename Cache>
+static void run(char const* name, size_t capacity, std::vector<uint64_t> const& trace) {
+    Cache  cache(capacity);
+    size_t hits  = 0;
+    auto   start = Clock::now();
+    for (uint64_t key : trace)
+        hits += cache.request(key);
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::printf("  %-6s hit ratio %6.2f%%, %7.1f ns/request\n", name,
+                100.0 * static_cast<double>(hits) / static_cast<double>(trace.size()),
+                elapsed * 1e9 / static_cast<double>(trace.size()));
+}
+
+int main(int argc, char** argv) {
+    size_t keys     = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    size_t requests = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+
+    for (double s : { 0.8, 1.0, 1.2 }) {
+        auto trace = zipf_trace(keys, requests, s);
+        for (size_t capacity : { keys / 1000, keys / 100, keys / 10 }) {
+            std::printf("zipf s=%.1f, %zu keys, capacity %zu:\n", s, keys, capacity);
+            run<BitmapCache>("bitmap", capacity, trace);
+            run<ClockCache>("clock", capacity, trace);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,129 @@
+/*
+ * Compare the hit ratio of A3_CACHE with and without its TinyLFU admission filter, on Zipfian
+ * traces polluted by scans. Every so often, a scan requests a run of keys which are never seen
+ * again, as a batch job or a crawler would. Plain CLOCK admits each of them, and they push out the
+ * popular keys which the rest of the trace needs. The hit ratio is reported over the Zipfian
+ * requests alone, since no cache can hit on a scan.
+ *
+ * Usage: bench_cache_admission [KEYS] [REQUESTS]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <a3/cache.h>
+#include <a3/ht.h>
+#include <a3/types.h>
+
+static int8_t u64_cmp(uint64_t lhs, uint64_t rhs) { return lhs < rhs ? -1 : lhs > rhs; }
+
+A3_CACHE_DEFINE_STRUCTS(uint64_t, uint64_t)
+A3_CACHE_DECLARE_METHODS(uint64_t, uint64_t)
+A3_CACHE_DEFINE_METHODS_HASHER(uint64_t, uint64_t, A3_HT_HASH_INT, u64_cmp)
+
+using Clock = std::chrono::steady_clock;
+
+class Cache {
+    A3_CACHE(uint64_t, uint64_t) cache {};
+
+public:
+    Cache(size_t capacity, bool admission) {
+        A3_CACHE_INIT(uint64_t, uint64_t)(&cache, capacity, nullptr);
+        if (admission)
+            A3_CACHE_ENABLE_ADMISSION(uint64_t, uint64_t)(&cache);
+    }
+    Cache(Cache const&)            = delete;
+    Cache& operator=(Cache const&) = delete;
+    ~Cache() { A3_CACHE_DESTROY(uint64_t, uint64_t)(&cache); }
+
+    bool request(uint64_t key) {
+        if (A3_CACHE_FIND(uint64_t, uint64_t)(&cache, key))
+            return true;
+        A3_CACHE_INSERT(uint64_t, uint64_t)(&cache, key, key, nullptr);
+        return false;
+    }
+};
+
+// A request, and whether it belongs to a scan.
+struct Request {
+    uint64_t key;
+    bool     scan;
+};
+
+// Draw REQUESTS keys from KEYS, where the key of rank r has weight 1 / r^s. Ranks are scattered
+// over the key space, so that popular keys do not share hash table neighbourhoods. After every
+// PERIOD of these, insert a scan of SCAN keys which appear nowhere else.
+static std::vector<Request> scan_trace(size_t keys, size_t requests, double s, size_t period,
+                                       size_t scan) {
+    std::vector<double> cdf(keys);
+    double              total = 0.0;
+    for (size_t r = 0; r < keys; r++) {
+        total += 1.0 / std::pow(static_cast<double>(r + 1), s);
+        cdf[r] = total;
+    }
+
+    std::mt19937_64                        rng(42);
+    std::uniform_real_distribution<double> uniform(0.0, total);
+    std::vector<Request>                   trace;
+    uint64_t                               scanned = keys;
+    for (size_t i = 0; i < requests; i++) {
+        auto rank = static_cast<uint64_t>(std::lower_bound(cdf.begin(), cdf.end(), uniform(rng)) -
+                                          cdf.begin());
+        trace.push_back({ (rank + 1) * 0xD6E8FEB86659FD93ULL, false });
+        if (scan && (i + 1) % period == 0) {
+            for (size_t j = 0; j < scan; j++)
+                trace.push_back({ ++scanned * 0xD6E8FEB86659FD93ULL, true });
+        }
+    }
+    return trace;
+}
+
+static void run(char const* name, size_t capacity, bool admission,
+                std::vector<Request> const& trace) {
+    Cache  cache(capacity, admission);
+    size_t hits     = 0;
+    size_t requests = 0;
+    auto   start    = Clock::now();
+    for (auto const& request : trace) {
+        bool hit = cache.request(request.key);
+        if (!request.scan) {
+            hits += hit;
+            requests++;
+        }
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::printf("  %-7s hit ratio %6.2f%%, %7.1f ns/request\n", name,
+                100.0 * static_cast<double>(hits) / static_cast<double>(requests),
+                elapsed * 1e9 / static_cast<double>(trace.size()));
+}
+
+int main(int argc, char** argv) {
+    size_t keys     = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    size_t requests = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+
+    for (double s : { 0.8, 1.0 }) {
+        for (size_t capacity : { keys / 100, keys / 10 }) {
+            // No scans, then scans of twice the capacity making up a third and two thirds of all
+            // requests.
+            for (size_t ratio : { 0, 1, 4 }) {
+                size_t scan   = ratio ? capacity * 2 : 0;
+                size_t period = ratio ? capacity * 4 / ratio : 0;
+                auto   trace  = scan_trace(keys, requests, s, period, scan);
+                std::printf("zipf s=%.1f, %zu keys, capacity %zu, %zu%% scans:\n", s, keys,
+                            capacity, ratio * 100 / (ratio + 2));
+                run("clock", capacity, false, trace);
+                run("tinylfu", capacity, true, trace);
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
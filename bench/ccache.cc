@@ -0,0 +1,142 @@
+/*
+ * Compare the throughput of A3_CCACHE with that of a single A3_CACHE behind a mutex, as a cache
+ * shared by worker threads would otherwise be used. Each thread replays its own part of a Zipfian
+ * trace, looking each key up and inserting it on a miss.
+ *
+ * Usage: bench_ccache [KEYS] [REQUESTS] [MAX_THREADS]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <a3/cache.h>
+#include <a3/ccache.h>
+#include <a3/ht.h>
+#include <a3/types.h>
+
+static int8_t u64_cmp(uint64_t lhs, uint64_t rhs) { return lhs < rhs ? -1 : lhs > rhs; }
+
+// Also instantiates A3_CACHE(uint64_t, uint64_t).
+A3_CCACHE_DEFINE_STRUCTS(uint64_t, uint64_t)
+A3_CCACHE_DECLARE_METHODS(uint64_t, uint64_t)
+A3_CCACHE_DEFINE_METHODS_HASHER(uint64_t, uint64_t, A3_HT_HASH_INT, u64_cmp)
+
+using Clock = std::chrono::steady_clock;
+
+class LockedCache {
+    std::mutex                   mutex;
+    A3_CACHE(uint64_t, uint64_t) cache {};
+
+public:
+    explicit LockedCache(size_t capacity) {
+        A3_CACHE_INIT(uint64_t, uint64_t)(&cache, capacity, nullptr);
+    }
+    LockedCache(LockedCache const&)            = delete;
+    LockedCache& operator=(LockedCache const&) = delete;
+    ~LockedCache() { A3_CACHE_DESTROY(uint64_t, uint64_t)(&cache); }
+
+    bool request(uint64_t key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (A3_CACHE_FIND(uint64_t, uint64_t)(&cache, key))
+            return true;
+        A3_CACHE_INSERT(uint64_t, uint64_t)(&cache, key, key, nullptr);
+        return false;
+    }
+};
+
+class ShardedCache {
+    A3_CCACHE(uint64_t, uint64_t) cache {};
+
+public:
+    explicit ShardedCache(size_t capacity) {
+        A3_CCACHE_INIT(uint64_t, uint64_t)(&cache, capacity, nullptr);
+    }
+    ShardedCache(ShardedCache const&)            = delete;
+    ShardedCache& operator=(ShardedCache const&) = delete;
+    ~ShardedCache() { A3_CCACHE_DESTROY(uint64_t, uint64_t)(&cache); }
+
+    bool request(uint64_t key) {
+        if (A3_CCACHE_FIND(uint64_t, uint64_t)(&cache, key, nullptr))
+            return true;
+        A3_CCACHE_INSERT(uint64_t, uint64_t)(&cache, key, key, nullptr);
+        return false;
+    }
+};
+
+// Draw REQUESTS keys from KEYS, where the key of rank r has weight 1 / r^s. Ranks are scattered
+// over the key space, so that popular keys do not share hash table neighbourhoods.
+static std::vector<uint64_t> zipf_trace(size_t keys, size_t requests, double s) {
+    std::vector<double> cdf(keys);
+    double              total = 0.0;
+    for (size_t r = 0; r < keys; r++) {
+        total += 1.0 / std::pow(static_cast<double>(r + 1), s);
+        cdf[r] = total;
+    }
+
+    std::mt19937_64                        rng(42);
+    std::uniform_real_distribution<double> uniform(0.0, total);
+    std::vector<uint64_t>                  trace(requests);
+    for (auto& key : trace) {
+        auto rank = static_cast<uint64_t>(std::lower_bound(cdf.begin(), cdf.end(), uniform(rng)) -
+                                          cdf.begin());
+        key       = (rank + 1) * 0xD6E8FEB86659FD93ULL;
+    }
+    return trace;
+}
+
+template <typename Cache>
+static void run(char const* name, size_t capacity, size_t threads,
+                std::vector<uint64_t> const& trace) {
+    Cache               cache(capacity);
+    std::vector<size_t> hits(threads);
+    size_t              per_thread = trace.size() / threads;
+
+    std::vector<std::thread> workers;
+    auto                     start = Clock::now();
+    for (size_t t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            size_t count = 0;
+            for (size_t i = t * per_thread; i < (t + 1) * per_thread; i++)
+                count += cache.request(trace[i]);
+            hits[t] = count;
+        });
+    }
+    for (auto& w : workers)
+        w.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    size_t total    = per_thread * threads;
+    size_t hits_sum = 0;
+    for (size_t h : hits)
+        hits_sum += h;
+    std::printf("  %-7s %2zu threads: %7.2f Mrequests/s, hit ratio %6.2f%%\n", name, threads,
+                static_cast<double>(total) / elapsed / 1e6,
+                100.0 * static_cast<double>(hits_sum) / static_cast<double>(total));
+}
+
+int main(int argc, char** argv) {
+    size_t keys        = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t requests    = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 8000000;
+    size_t max_threads = argc > 3 ? std::strtoull(argv[3], nullptr, 10)
+                                  : std::max(1U, std::thread::hardware_concurrency());
+
+    auto   trace    = zipf_trace(keys, requests, 1.0);
+    size_t capacity = keys / 10;
+    std::printf("zipf s=1.0, %zu keys, capacity %zu, %zu requests, %u hardware threads\n", keys,
+                capacity, requests, std::thread::hardware_concurrency());
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        run<LockedCache>("locked", capacity, threads, trace);
+        run<ShardedCache>("sharded", capacity, threads, trace);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,116 @@
+/*
+ * Compare scalar and batched hash table lookups on a table much larger than the last-level cache,
+ * where every lookup is a cache miss and prefetching has room to overlap them, and scalar lookups
+ * on the same table once frozen.
+ *
+ * Usage: bench_ht_batch [ENTRIES] [LOOKUPS]
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <a3/ht.h>
+#include <a3/types.h>
+
+// A cheap hash keeps the measurement about memory rather than hashing.
+#define U64_HASH(TABLE, KEY) (((KEY) ^ (TABLE)->hash_key[0]) * 0x9E3779B97F4A7C15ULL)
+
+static int8_t u64_cmp(uint64_t lhs, uint64_t rhs) { return lhs < rhs ? -1 : lhs > rhs; }
+
+A3_HT_DEFINE_STRUCTS(uint64_t, uint64_t)
+A3_HT_DECLARE_METHODS(uint64_t, uint64_t)
+A3_HT_DEFINE_METHODS_HASHER(uint64_t, uint64_t, U64_HASH, u64_cmp)
+A3_HT_DEFINE_STRUCTS_FROZEN(uint64_t, uint64_t)
+A3_HT_DECLARE_METHODS_FROZEN(uint64_t, uint64_t)
+A3_HT_DEFINE_METHODS_FROZEN(uint64_t, uint64_t, u64_cmp)
+
+using Clock = std::chrono::steady_clock;
+
+static uint64_t rng(uint64_t* state) {
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return *state >> 11;
+}
+
+static double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    size_t entries = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : (1ULL << 24);
+    size_t lookups = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : (1ULL << 23);
+
+    A3_HT(uint64_t, uint64_t) table;
+    A3_HT_INIT_WITH_CAPACITY(uint64_t, uint64_t)(&table, A3_HT_NO_HASH_KEY, true, entries);
+
+    std::vector<uint64_t> keys(lookups);
+    // Keys and values are both 0..entries.
+    std::vector<uint64_t> values(entries);
+    for (size_t i = 0; i < entries; i++)
+        values[i] = i;
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < entries; i++)
+        A3_HT_INSERT(uint64_t, uint64_t)(&table, values[i], values[i]);
+    double insert_scalar = seconds_since(start);
+
+    A3_HT_DESTROY(uint64_t, uint64_t)(&table);
+    A3_HT_INIT_WITH_CAPACITY(uint64_t, uint64_t)(&table, A3_HT_NO_HASH_KEY, true, entries);
+
+    start = Clock::now();
+    A3_HT_INSERT_BATCH(uint64_t, uint64_t)(&table, values.data(), values.data(), entries);
+    double insert_batch = seconds_since(start);
+
+    // Half of the lookups miss.
+    uint64_t state = 1;
+    for (auto& key : keys)
+        key = rng(&state) % (entries * 2);
+
+    uint64_t sum = 0;
+    start        = Clock::now();
+    for (auto key : keys) {
+        uint64_t* value = A3_HT_FIND(uint64_t, uint64_t)(&table, key);
+        sum += value ? *value : 0;
+    }
+    double find_scalar = seconds_since(start);
+
+    std::vector<uint64_t*> out(lookups);
+    uint64_t               batch_sum = 0;
+    start                            = Clock::now();
+    A3_HT_FIND_BATCH(uint64_t, uint64_t)(&table, keys.data(), lookups, out.data());
+    for (auto* value : out)
+        batch_sum += value ? *value : 0;
+    double find_batch = seconds_since(start);
+
+    A3_HT_FROZEN(uint64_t, uint64_t) frozen;
+    A3_HT_FREEZE(uint64_t, uint64_t)(&frozen, &table);
+    uint64_t frozen_sum = 0;
+    start               = Clock::now();
+    for (auto key : keys) {
+        uint64_t const* value = A3_HT_FROZEN_FIND(uint64_t, uint64_t)(&frozen, key);
+        frozen_sum += value ? *value : 0;
+    }
+    double find_frozen = seconds_since(start);
+
+    A3_HT_FROZEN_DESTROY(uint64_t, uint64_t)(&frozen);
+
+    if (sum != batch_sum || sum != frozen_sum) {
+        std::fprintf(stderr, "Batched or frozen lookups disagree with scalar lookups.\n");
+        return EXIT_FAILURE;
+    }
+
+    std::printf("%zu entries, %zu lookups\n", entries, lookups);
+    std::printf("insert: scalar %.1f ns/op, batch %.1f ns/op (%.2fx)\n",
+                insert_scalar * 1e9 / (double)entries, insert_batch * 1e9 / (double)entries,
+                insert_scalar / insert_batch);
+    std::printf("find:   scalar %.1f ns/op, batch %.1f ns/op (%.2fx)\n",
+                find_scalar * 1e9 / (double)lookups, find_batch * 1e9 / (double)lookups,
+                find_scalar / find_batch);
+    std::printf("find:   frozen %.1f ns/op (%.2fx)\n", find_frozen * 1e9 / (double)lookups,
+                find_scalar / find_frozen);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+/*
+ * Compare building a large hash table one insertion at a time against building it in parallel
+ * with increasing numbers of threads, and check that every build gives an equivalent table: the
+ * same entries, and the same home slot at every slot.
+ *
+ * Usage: bench_ht_build [ENTRIES] [MAX_THREADS]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <a3/ht.h>
+#include <a3/types.h>
+
+// Keys are hashed with HighwayHash, as they would be from an untrusted source, so that hashing is a
+// realistic share of the work.
+#define U64_BYTES(KEY) ((uint8_t const*)&(KEY))
+#define U64_SIZE(KEY)  sizeof(KEY)
+
+static int8_t u64_cmp(uint64_t lhs, uint64_t rhs) { return lhs < rhs ? -1 : lhs > rhs; }
+
+A3_HT_DEFINE_STRUCTS(uint64_t, uint64_t)
+A3_HT_DECLARE_METHODS(uint64_t, uint64_t)
+A3_HT_DEFINE_METHODS(uint64_t, uint64_t, U64_BYTES, U64_SIZE, u64_cmp)
+
+using Clock = std::chrono::steady_clock;
+
+static uint64_t rng(uint64_t* state) {
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return *state >> 11;
+}
+
+static bool same_table(A3_HT(uint64_t, uint64_t) * table, A3_HT(uint64_t, uint64_t) * expected,
+                       std::vector<uint64_t> const& keys) {
+    if (table->cap != expected->cap || table->size != expected->size)
+        return false;
+    for (size_t i = 0; i < table->cap; i++) {
+        if (table->entries[i].hash % table->cap != expected->entries[i].hash % expected->cap)
+            return false;
+    }
+    for (uint64_t key : keys) {
+        uint64_t* value = A3_HT_FIND(uint64_t, uint64_t)(table, key);
+        if (!value || *value != *A3_HT_FIND(uint64_t, uint64_t)(expected, key))
+            return false;
+    }
+    return true;
+}
+
+static double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    size_t entries     = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : (1ULL << 24);
+    size_t max_threads = argc > 2 ? std::strtoull(argv[2], nullptr, 10)
+                                  : std::max(1U, std::thread::hardware_concurrency());
+
+    std::vector<uint64_t> keys(entries);
+    std::vector<uint64_t> values(entries);
+    uint64_t              state = 1;
+    for (size_t i = 0; i < entries; i++) {
+        keys[i]   = rng(&state);
+        values[i] = i;
+    }
+
+    A3_HT(uint64_t, uint64_t) sequential;
+    A3_HT_INIT(uint64_t, uint64_t)(&sequential, A3_HT_NO_HASH_KEY, A3_HT_ALLOW_GROWTH);
+    auto start = Clock::now();
+    A3_HT_RESERVE(uint64_t, uint64_t)(&sequential, entries);
+    A3_HT_INSERT_BATCH(uint64_t, uint64_t)(&sequential, keys.data(), values.data(), entries);
+    double base = seconds_since(start);
+
+    std::printf("%zu entries\n", entries);
+    std::printf("sequential:  %.1f ns/op\n", base * 1e9 / (double)entries);
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        A3_HT(uint64_t, uint64_t) table;
+        A3_HT_INIT(uint64_t, uint64_t)(&table, A3_HT_HASH_KEY(&sequential), A3_HT_ALLOW_GROWTH);
+        start = Clock::now();
+        A3_HT_BUILD_PARALLEL(uint64_t, uint64_t)(&table, keys.data(), values.data(), entries,
+                                                 threads);
+        double elapsed = seconds_since(start);
+
+        bool same = same_table(&table, &sequential, keys);
+        A3_HT_DESTROY(uint64_t, uint64_t)(&table);
+        if (!same) {
+            std::fprintf(stderr, "The build with %zu threads differs from the sequential one.\n",
+                         threads);
+            return EXIT_FAILURE;
+        }
+
+        std::printf("%2zu threads:  %.1f ns/op (%.2fx)\n", threads,
+                    elapsed * 1e9 / (double)entries, base / elapsed);
+    }
+
+    A3_HT_DESTROY(uint64_t, uint64_t)(&sequential);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,158 @@
+/*
+ * Compare random lookups into a very large hash table backed by ordinary pages with the same
+ * lookups when the allocation policy maps the table with huge pages. Each lookup lands on an
+ * unrelated page, so with 4 KiB pages nearly every one misses the TLB. Where the kernel allows it,
+ * dTLB misses are counted with perf_event_open, and the amount of the process's memory backed by
+ * huge pages is read from /proc/self/smaps_rollup.
+ *
+ * Huge pages are only used for mapped tables when the kernel's transparent huge page setting
+ * (/sys/kernel/mm/transparent_hugepage/enabled) is `always` or `madvise`. With `always`, the heap
+ * may get huge pages too, which narrows the difference.
+ *
+ * Usage: bench_ht_hugepage [GIB] [LOOKUPS]
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <a3/alloc.h>
+#include <a3/ht.h>
+#include <a3/types.h>
+
+#define U64_HASH(TABLE, KEY) (((KEY) ^ (TABLE)->hash_key[0]) * 0x9E3779B97F4A7C15ULL)
+
+static int8_t u64_cmp(uint64_t lhs, uint64_t rhs) { return lhs < rhs ? -1 : lhs > rhs; }
+
+A3_HT_DEFINE_STRUCTS(uint64_t, uint64_t)
+A3_HT_DECLARE_METHODS(uint64_t, uint64_t)
+A3_HT_DEFINE_METHODS_HASHER(uint64_t, uint64_t, U64_HASH, u64_cmp)
+
+using Clock = std::chrono::steady_clock;
+
+// Counts dTLB load misses on this thread, or nothing if perf events are unavailable.
+class TlbCounter {
+    int fd;
+
+public:
+    TlbCounter() {
+        perf_event_attr attr {};
+        attr.type           = PERF_TYPE_HW_CACHE;
+        attr.size           = sizeof(attr);
+        attr.config         = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled       = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+    TlbCounter(TlbCounter const&)            = delete;
+    TlbCounter& operator=(TlbCounter const&) = delete;
+    ~TlbCounter() {
+        if (fd >= 0)
+            close(fd);
+    }
+
+    bool available() const { return fd >= 0; }
+
+    void start() {
+        if (fd < 0)
+            return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    uint64_t stop() {
+        uint64_t count = 0;
+        if (fd < 0)
+            return count;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &count, sizeof(count)) != sizeof(count))
+            count = 0;
+        return count;
+    }
+};
+
+// The amount of anonymous memory backed by huge pages, in MiB.
+static double huge_mib() {
+    FILE* file = std::fopen("/proc/self/smaps_rollup", "r");
+    if (!file)
+        return 0.0;
+
+    char   line[256];
+    size_t kib = 0;
+    while (std::fgets(line, sizeof(line), file)) {
+        if (std::sscanf(line, "AnonHugePages: %zu kB", &kib) == 1)
+            break;
+    }
+    std::fclose(file);
+    return static_cast<double>(kib) / 1024.0;
+}
+
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static void run(char const* name, size_t bytes, size_t lookups) {
+    size_t cap     = bytes / sizeof(A3_HT_ENTRY(uint64_t, uint64_t));
+    size_t entries = cap / 2;
+
+    A3_HT(uint64_t, uint64_t) table;
+    auto start = Clock::now();
+    A3_HT_INIT_WITH_CAPACITY(uint64_t, uint64_t)
+    (&table, A3_HT_NO_HASH_KEY, A3_HT_FORBID_GROWTH, cap);
+    for (uint64_t i = 0; i < entries; i++)
+        A3_HT_INSERT(uint64_t, uint64_t)(&table, i, i * 3);
+    double build = std::chrono::duration<double>(Clock::now() - start).count();
+
+    TlbCounter counter;
+    uint64_t   state = 0x2545F4914F6CDD1DULL;
+    uint64_t   sum   = 0;
+    counter.start();
+    start = Clock::now();
+    for (size_t i = 0; i < lookups; i++) {
+        uint64_t* value = A3_HT_FIND(uint64_t, uint64_t)(&table, next_random(&state) % entries);
+        sum += value ? *value : 0;
+    }
+    double   find   = std::chrono::duration<double>(Clock::now() - start).count();
+    uint64_t misses = counter.stop();
+
+    std::printf("%-8s build %6.2f s, lookup %6.1f ns", name, build, find * 1e9 / (double)lookups);
+    if (counter.available())
+        std::printf(", %5.2f dTLB misses/lookup", (double)misses / (double)lookups);
+    else
+        std::printf(", dTLB misses unavailable");
+    std::printf(", %7.0f MiB in huge pages (checksum %llu)\n", huge_mib(), (unsigned long long)sum);
+
+    A3_HT_DESTROY(uint64_t, uint64_t)(&table);
+}
+
+int main(int argc, char** argv) {
+    double gib     = argc > 1 ? std::strtod(argv[1], nullptr) : 4.0;
+    size_t lookups = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20000000;
+    auto   bytes   = static_cast<size_t>(gib * 1024.0 * 1024.0 * 1024.0);
+
+    std::printf("%.1f GiB table, %zu random lookups\n", gib, lookups);
+
+    // Each table is destroyed before the policy changes, as alloc.h requires.
+    run("heap", bytes, lookups);
+    a3_alloc_policy_set(
+        A3AllocPolicy { .map_threshold = 64 << 20, .huge_pages = true, .populate = false });
+    run("huge", bytes, lookups);
+    a3_alloc_policy_set(
+        A3AllocPolicy { .map_threshold = 64 << 20, .huge_pages = true, .populate = true });
+    run("populate", bytes, lookups);
+
+    return EXIT_SUCCESS;
+}
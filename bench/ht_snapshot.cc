@@ -0,0 +1,94 @@
+/*
+ * Compare rebuilding a hash table from its source data with opening a saved snapshot of it. The
+ * snapshot is mapped and then every entry is looked up once, so that the time includes faulting
+ * the table in from the page cache rather than only the mmap call.
+ *
+ * Usage: bench_ht_snapshot [ENTRIES] [PATH]
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <a3/ht.h>
+#include <a3/types.h>
+
+#define U64_HASH(TABLE, KEY) (((KEY) ^ (TABLE)->hash_key[0]) * 0x9E3779B97F4A7C15ULL)
+
+static int8_t u64_cmp(uint64_t lhs, uint64_t rhs) { return lhs < rhs ? -1 : lhs > rhs; }
+
+A3_HT_DEFINE_STRUCTS(uint64_t, uint64_t)
+A3_HT_DECLARE_METHODS(uint64_t, uint64_t)
+A3_HT_DEFINE_METHODS_HASHER(uint64_t, uint64_t, U64_HASH, u64_cmp)
+
+using Clock = std::chrono::steady_clock;
+
+static double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static uint64_t find_all(A3_HT(uint64_t, uint64_t) * table, size_t entries) {
+    uint64_t sum = 0;
+    for (uint64_t i = 0; i < entries; i++) {
+        uint64_t* value = A3_HT_FIND(uint64_t, uint64_t)(table, i);
+        sum += value ? *value : 0;
+    }
+    return sum;
+}
+
+int main(int argc, char** argv) {
+    size_t      entries = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : (1ULL << 24);
+    char const* path    = argc > 2 ? argv[2] : "bench_ht_snapshot.a3ht";
+
+    A3_HT(uint64_t, uint64_t) table;
+    auto start = Clock::now();
+    A3_HT_INIT(uint64_t, uint64_t)(&table, A3_HT_NO_HASH_KEY, A3_HT_ALLOW_GROWTH);
+    for (uint64_t i = 0; i < entries; i++)
+        A3_HT_INSERT(uint64_t, uint64_t)(&table, i, i * 3);
+    double   build     = seconds_since(start);
+    uint64_t built_sum = find_all(&table, entries);
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || !A3_HT_SAVE(uint64_t, uint64_t)(&table, fd)) {
+        std::perror("Failed to save snapshot");
+        return EXIT_FAILURE;
+    }
+    A3_HT_DESTROY(uint64_t, uint64_t)(&table);
+
+    struct stat st;
+    fstat(fd, &st);
+    size_t len = static_cast<size_t>(st.st_size);
+
+    start     = Clock::now();
+    void* ptr = mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED || !A3_HT_MAP(uint64_t, uint64_t)(&table, ptr, len)) {
+        std::fprintf(stderr, "Failed to map snapshot.\n");
+        return EXIT_FAILURE;
+    }
+    double   map        = seconds_since(start);
+    uint64_t mapped_sum = find_all(&table, entries);
+    double   load       = seconds_since(start);
+
+    munmap(ptr, len);
+    close(fd);
+    unlink(path);
+
+    if (built_sum != mapped_sum) {
+        std::fprintf(stderr, "Mapped table disagrees with the original.\n");
+        return EXIT_FAILURE;
+    }
+
+    std::printf("%zu entries, %.1f MiB snapshot\n", entries, (double)len / (1024.0 * 1024.0));
+    std::printf("rebuild:          %.3f s\n", build);
+    std::printf("map:              %.6f s\n", map);
+    std::printf("map and touch all: %.3f s (%.1fx faster than rebuild)\n", load, build / load);
+
+    return EXIT_SUCCESS;
+}
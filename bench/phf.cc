@@ -0,0 +1,98 @@
+/*
+ * Compare perfect hash lookups with hash table lookups in a small, fixed set of strings: the
+ * header names an HTTP server recognizes, looked up as they would be when parsing requests.
+ *
+ * Usage: bench_phf [LOOKUPS]
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+#include <vector>
+
+#include <a3/ht.h>
+#include <a3/phf.hh>
+#include <a3/str.h>
+
+using Index = size_t;
+
+A3_HT_DEFINE_STRUCTS(A3CString, Index)
+A3_HT_DECLARE_METHODS(A3CString, Index)
+A3_HT_DEFINE_METHODS(A3CString, Index, a3_string_cptr, a3_string_len, a3_string_cmp)
+
+static constexpr auto HEADERS = a3::make_perfect_hash({
+    "Accept", "Accept-Charset", "Accept-Encoding", "Accept-Language", "Authorization",
+    "Cache-Control", "Connection", "Content-Encoding", "Content-Length", "Content-Type", "Cookie",
+    "Date", "ETag", "Expect", "Host", "If-Match", "If-Modified-Since", "If-None-Match", "If-Range",
+    "If-Unmodified-Since", "Keep-Alive", "Last-Modified", "Location", "Origin", "Pragma", "Range",
+    "Referer", "Server", "Set-Cookie", "TE", "Trailer", "Transfer-Encoding", "Upgrade",
+    "User-Agent", "Vary", "Via", "WWW-Authenticate",
+});
+
+// Headers a server does not handle, which must be rejected as quickly.
+static constexpr std::string_view UNKNOWN[] = { "X-Forwarded-For", "X-Request-Id", "DNT",
+                                                "Sec-Fetch-Mode", "Priority" };
+
+using Clock = std::chrono::steady_clock;
+
+static A3CString cstring(std::string_view s) {
+    return { reinterpret_cast<uint8_t const*>(s.data()), s.size() };
+}
+
+static uint64_t rng(uint64_t* state) {
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return *state >> 11;
+}
+
+static double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    size_t lookups = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : (1ULL << 24);
+
+    A3_HT(A3CString, Index) table;
+    A3_HT_INIT(A3CString, Index)(&table, A3_HT_NO_HASH_KEY, A3_HT_ALLOW_GROWTH);
+    for (size_t i = 0; i < HEADERS.size(); i++)
+        A3_HT_INSERT(A3CString, Index)(&table, cstring(HEADERS.keys[i]), i);
+
+    // One in five lookups misses.
+    std::vector<A3CString> keys(lookups);
+    uint64_t               state = 1;
+    for (auto& key : keys) {
+        uint64_t r = rng(&state);
+        key = r % 5 ? cstring(HEADERS.keys[r % HEADERS.size()]) : cstring(UNKNOWN[r % 5]);
+    }
+
+    size_t sum   = 0;
+    auto   start = Clock::now();
+    for (auto key : keys) {
+        Index* index = A3_HT_FIND(A3CString, Index)(&table, key);
+        sum += index ? *index : 1000;
+    }
+    double ht = seconds_since(start);
+
+    size_t phf_sum = 0;
+    start          = Clock::now();
+    for (auto key : keys) {
+        A3_SSIZE_T index = HEADERS.find(key);
+        phf_sum += index >= 0 ? static_cast<size_t>(index) : 1000;
+    }
+    double phf = seconds_since(start);
+
+    A3_HT_DESTROY(A3CString, Index)(&table);
+
+    if (sum != phf_sum) {
+        std::fprintf(stderr, "Perfect hash lookups disagree with table lookups.\n");
+        return EXIT_FAILURE;
+    }
+
+    std::printf("%zu keys, %zu lookups\n", HEADERS.size(), lookups);
+    std::printf("find: table %.1f ns/op, perfect hash %.1f ns/op (%.2fx)\n",
+                ht * 1e9 / (double)lookups, phf * 1e9 / (double)lookups, ht / phf);
+
+    return EXIT_SUCCESS;
+}
@@ -4,17 +4,13 @@
   inputs = {
     nixpkgs.url = "nixpkgs/nixos-23.11";
     utils.url = "github:numtide/flake-utils";
-    highwayhash = {
-      url = "github:google/highwayhash";
-      flake = false;
-    };
     flake-compat = {
       url = "github:edolstra/flake-compat";
       flake = false;
     };
   };
 
-  outputs = { self, nixpkgs, utils, highwayhash, ... }:
+  outputs = { self, nixpkgs, utils, ... }:
     utils.lib.eachDefaultSystem (system:
       let
         pkgs = nixpkgs.legacyPackages.${system};
@@ -41,11 +37,6 @@
                   "-Db_lto=true ") + (pkgs.lib.optionalString san
                     "-Db_sanitize=address,undefined ") + extraMesonArgs;
 
-                patchPhase = ''
-                  cp -r ${self.inputs.highwayhash} subprojects/highwayhash
-                  chmod +w subprojects/highwayhash
-                  cp subprojects/packagefiles/highwayhash/meson.build subprojects/highwayhash/
-                '';
                 configurePhase = ''
                   meson setup ${mesonArgs} --prefix=$out --buildtype=${buildType} --wrap-mode=nodownload -Dcpp_std=c++20 build .
                 '';
@@ -0,0 +1,122 @@
+/*
+ * ALLOC -- Allocation of large arrays.
+ *
+ * Copyright (c) 2022, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in
+ * the project root for details.
+ */
+
+#include <a3/shim/aligned_alloc.h>
+#include <a3/shim/mmap.h>
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <a3/alloc.h>
+#include <a3/util.h>
+
+static A3AllocPolicy POLICY = { .map_threshold = A3_ALLOC_MAP_NEVER,
+                                .huge_pages    = false,
+                                .populate      = false };
+
+void a3_alloc_policy_set(A3AllocPolicy policy) { POLICY = policy; }
+
+A3AllocPolicy a3_alloc_policy(void) { return POLICY; }
+
+// Every block is preceded by a header recording how it was obtained, so that releasing it never
+// depends on the policy, which may have changed since, or on the size the caller passes back.
+typedef enum A3AllocKind { A3_ALLOC_HEAP, A3_ALLOC_ALIGNED, A3_ALLOC_MAPPED } A3AllocKind;
+
+typedef struct A3AllocHeader {
+    size_t      offset; // From the start of the underlying allocation to the block.
+    size_t      length; // Of the underlying allocation, header included.
+    A3AllocKind kind;
+} A3AllocHeader;
+
+// As much alignment as the heap gives, which the header must not take away.
+#define A3_ALLOC_MIN_ALIGN 16
+
+static bool a3_alloc_mapped(size_t size) { return size && size >= POLICY.map_threshold; }
+
+// The header is padded out to the block's alignment, so it sits directly before the block.
+static size_t a3_alloc_offset(size_t align) {
+    if (align < A3_ALLOC_MIN_ALIGN)
+        align = A3_ALLOC_MIN_ALIGN;
+    return (sizeof(A3AllocHeader) + align - 1) / align * align;
+}
+
+static A3AllocHeader* a3_alloc_header(void* ptr) { return (A3AllocHeader*)ptr - 1; }
+
+static void* a3_alloc_block(void* base, size_t offset, size_t length, A3AllocKind kind) {
+    if (!base)
+        return NULL;
+
+    uint8_t*       ret    = (uint8_t*)base + offset;
+    A3AllocHeader* header = a3_alloc_header(ret);
+    header->offset        = offset;
+    header->length        = length;
+    header->kind          = kind;
+    return ret;
+}
+
+static void a3_alloc_release(void* ptr, size_t size) {
+    A3AllocHeader header = *a3_alloc_header(ptr);
+    assert(header.length == header.offset + size);
+    (void)size;
+
+    void* base = (uint8_t*)ptr - header.offset;
+    switch (header.kind) {
+    case A3_ALLOC_HEAP:
+        free(base);
+        break;
+    case A3_ALLOC_ALIGNED:
+        a3_shim_aligned_free(base);
+        break;
+    case A3_ALLOC_MAPPED:
+        a3_shim_unmap(base, header.length);
+        break;
+    }
+}
+
+void* a3_large_calloc(size_t count, size_t size) {
+    size_t offset = a3_alloc_offset(A3_ALLOC_MIN_ALIGN);
+    if (size && count > (SIZE_MAX - offset) / size)
+        return NULL;
+
+    size_t length = offset + count * size;
+    if (a3_alloc_mapped(count * size))
+        return a3_alloc_block(a3_shim_map(length, POLICY.huge_pages, POLICY.populate), offset,
+                              length, A3_ALLOC_MAPPED);
+
+    return a3_alloc_block(calloc(1, length), offset, length, A3_ALLOC_HEAP);
+}
+
+void a3_large_free(void* ptr, size_t count, size_t size) {
+    if (!ptr)
+        return;
+    a3_alloc_release(ptr, count * size);
+}
+
+void* a3_large_aligned_alloc(size_t size, size_t align) {
+    assert(size > 0);
+    assert(align > 0);
+
+    size_t offset = a3_alloc_offset(align);
+    if (size > SIZE_MAX - offset)
+        return NULL;
+
+    // Mappings are page-aligned, which covers any alignment an element type can ask for.
+    size_t length = offset + size;
+    if (a3_alloc_mapped(size))
+        return a3_alloc_block(a3_shim_map(length, POLICY.huge_pages, POLICY.populate), offset,
+                              length, A3_ALLOC_MAPPED);
+
+    return a3_alloc_block(a3_shim_aligned_alloc(length, MAX(align, A3_ALLOC_MIN_ALIGN)), offset,
+                          length, A3_ALLOC_ALIGNED);
+}
+
+void a3_large_aligned_free(void* ptr, size_t size) {
+    assert(ptr);
+    a3_alloc_release(ptr, size);
+}
@@ -0,0 +1,75 @@
+/*
+ * HIGHWAYHASH (AVX2) -- HighwayHash64 with all four lanes of state in each vector.
+ *
+ * Copyright (c) 2020-2021, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in
+ * the project root for details.
+ */
+
+#include <immintrin.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "highwayhash.h"
+
+typedef struct A3HhAvx2 {
+    __m256i v0;
+    __m256i v1;
+    __m256i mul0;
+    __m256i mul1;
+} A3HhAvx2;
+
+static __m256i load(void const* p) { return _mm256_loadu_si256((__m256i const*)p); }
+
+static __m256i zipper_merge(__m256i v) {
+    __m128i mask = _mm_loadu_si128((__m128i const*)A3_HH_ZIPPER);
+    return _mm256_shuffle_epi8(v, _mm256_broadcastsi128_si256(mask));
+}
+
+static void update(A3HhAvx2* state, __m256i lanes) {
+    state->v1 = _mm256_add_epi64(state->v1, _mm256_add_epi64(state->mul0, lanes));
+    state->mul0 = _mm256_xor_si256(state->mul0,
+                                   _mm256_mul_epu32(state->v1, _mm256_srli_epi64(state->v0, 32)));
+    state->v0 = _mm256_add_epi64(state->v0, state->mul1);
+    state->mul1 = _mm256_xor_si256(state->mul1,
+                                   _mm256_mul_epu32(state->v0, _mm256_srli_epi64(state->v1, 32)));
+    state->v0 = _mm256_add_epi64(state->v0, zipper_merge(state->v1));
+    state->v1 = _mm256_add_epi64(state->v1, zipper_merge(state->v0));
+}
+
+uint64_t a3_hh_avx2(uint8_t const* data, size_t size, uint64_t const key[4]) {
+    A3HhAvx2 state;
+    __m256i  k = load(key);
+    state.mul0 = load(A3_HH_INIT0);
+    state.mul1 = load(A3_HH_INIT1);
+    state.v0   = _mm256_xor_si256(state.mul0, k);
+    state.v1   = _mm256_xor_si256(state.mul1, _mm256_shuffle_epi32(k, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    size_t i = 0;
+    for (; i + A3_HH_PACKET_SIZE <= size; i += A3_HH_PACKET_SIZE)
+        update(&state, load(data + i));
+
+    size_t size_mod32 = size & (A3_HH_PACKET_SIZE - 1);
+    if (size_mod32) {
+        __m128i count  = _mm_cvtsi32_si128((int)size_mod32);
+        __m128i rcount = _mm_cvtsi32_si128(32 - (int)size_mod32);
+        state.v0       = _mm256_add_epi64(state.v0, _mm256_set1_epi32((int)size_mod32));
+        state.v1 =
+            _mm256_or_si256(_mm256_sll_epi32(state.v1, count), _mm256_srl_epi32(state.v1, rcount));
+
+        uint8_t packet[A3_HH_PACKET_SIZE];
+        a3_hh_remainder(data + i, size_mod32, packet);
+        update(&state, load(packet));
+    }
+
+    __m256i permute = _mm256_setr_epi32(5, 4, 7, 6, 1, 0, 3, 2);
+    for (size_t round = 0; round < 4; round++)
+        update(&state, _mm256_permutevar8x32_epi32(state.v0, permute));
+
+    uint64_t result[4];
+    _mm256_storeu_si256((__m256i*)result,
+                        _mm256_add_epi64(_mm256_add_epi64(state.v0, state.v1),
+                                         _mm256_add_epi64(state.mul0, state.mul1)));
+    return result[0];
+}
@@ -0,0 +1,101 @@
+/*
+ * HIGHWAYHASH -- HighwayHash64, dispatched to the best implementation the CPU supports.
+ *
+ * Copyright (c) 2020-2021, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in
+ * the project root for details.
+ */
+
+#include <a3/shim/atomic.h>
+#include <a3/shim/likely.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_MSC_VER) && (defined(A3_HH_SSE41) || defined(A3_HH_AVX2))
+#include <intrin.h>
+#endif
+
+#include <a3/ht.h>
+
+#include "highwayhash.h"
+
+// Implementations, in increasing order of preference.
+static A3HhImpl const A3_HH_IMPLS[] = {
+    a3_hh_portable,
+#ifdef A3_HH_SSE41
+    a3_hh_sse41,
+#endif
+#ifdef A3_HH_AVX2
+    a3_hh_avx2,
+#endif
+#ifdef A3_HH_NEON
+    a3_hh_neon,
+#endif
+};
+
+// One more than the index of the selected implementation, or zero if none has been selected yet.
+static A3_ATOMIC(size_t) A3_HH_SELECTED;
+
+#if defined(A3_HH_SSE41) || defined(A3_HH_AVX2)
+#ifdef _MSC_VER
+static bool a3_hh_cpu_sse41(void) {
+    int info[4];
+    __cpuid(info, 1);
+    return info[2] & (1 << 19);
+}
+
+static bool a3_hh_cpu_avx2(void) {
+    int info[4];
+    __cpuid(info, 1);
+    // The OS must also save the upper halves of the vector registers.
+    if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)) || (_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return info[1] & (1 << 5);
+}
+#else
+static bool a3_hh_cpu_sse41(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.1");
+}
+
+static bool a3_hh_cpu_avx2(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+#endif
+
+bool a3_hh_supported(A3HhImpl impl) {
+#ifdef A3_HH_SSE41
+    if (impl == a3_hh_sse41)
+        return a3_hh_cpu_sse41();
+#endif
+#ifdef A3_HH_AVX2
+    if (impl == a3_hh_avx2)
+        return a3_hh_cpu_avx2();
+#endif
+    // The portable implementation always works, and NEON is mandatory wherever it is built.
+    (void)impl;
+    return true;
+}
+
+static size_t a3_hh_select(void) {
+    size_t ret = sizeof(A3_HH_IMPLS) / sizeof(A3_HH_IMPLS[0]);
+    while (ret > 1 && !a3_hh_supported(A3_HH_IMPLS[ret - 1]))
+        ret--;
+    return ret;
+}
+
+uint64_t HighwayHash64(const uint8_t* data, size_t size, const uint64_t key[4]) {
+    // Every thread selects the same implementation, so a race here is harmless.
+    size_t selected = A3_ATOMIC_LOAD(&A3_HH_SELECTED, A3_RELAXED);
+    if (A3_UNLIKELY(!selected)) {
+        selected = a3_hh_select();
+        A3_ATOMIC_STORE(&A3_HH_SELECTED, selected, A3_RELAXED);
+    }
+
+    return A3_HH_IMPLS[selected - 1](data, size, key);
+}
@@ -0,0 +1,72 @@
+/*
+ * HIGHWAYHASH (PRIVATE) -- Definitions shared by the HighwayHash implementations.
+ *
+ * Copyright (c) 2020-2021, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in
+ * the project root for details.
+ *
+ * Each implementation computes exactly the same function as the reference HighwayHash64 from
+ * https://github.com/google/highwayhash. They differ only in how many lanes of state they update
+ * per instruction.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <a3/cpp.h>
+
+#include "types.h"
+
+A3_H_BEGIN
+
+#define A3_HH_PACKET_SIZE 32ULL
+
+typedef uint64_t (*A3HhImpl)(uint8_t const* data, size_t size, uint64_t const key[4]);
+
+// The initial values of mul0 and mul1.
+extern uint64_t const A3_HH_INIT0[4];
+extern uint64_t const A3_HH_INIT1[4];
+
+// The byte permutation applied to each pair of lanes by the reference ZipperMerge.
+extern uint8_t const A3_HH_ZIPPER[16];
+
+// The implementations are exported, along with a3_hh_supported, only so that the tests can check
+// each one the CPU can run against the reference, whichever HighwayHash64 would pick.
+EXPORT uint64_t a3_hh_portable(uint8_t const* data, size_t size, uint64_t const key[4]);
+#ifdef A3_HH_SSE41
+EXPORT uint64_t a3_hh_sse41(uint8_t const* data, size_t size, uint64_t const key[4]);
+#endif
+#ifdef A3_HH_AVX2
+EXPORT uint64_t a3_hh_avx2(uint8_t const* data, size_t size, uint64_t const key[4]);
+#endif
+#ifdef A3_HH_NEON
+EXPORT uint64_t a3_hh_neon(uint8_t const* data, size_t size, uint64_t const key[4]);
+#endif
+
+// Whether the CPU can run the given implementation.
+EXPORT bool a3_hh_supported(A3HhImpl);
+
+// Gather the final size % 32 bytes of input into a packet, in the reference's peculiar order.
+ALWAYS_INLINE void a3_hh_remainder(uint8_t const* bytes, size_t size_mod32,
+                                   uint8_t packet[A3_HH_PACKET_SIZE]) {
+    size_t         size_mod4 = size_mod32 & 3;
+    uint8_t const* remainder = bytes + (size_mod32 & ~(size_t)3);
+
+    memset(packet, 0, A3_HH_PACKET_SIZE);
+    memcpy(packet, bytes, (size_t)(remainder - bytes));
+    if (size_mod32 & 16) {
+        for (size_t i = 0; i < 4; i++)
+            packet[28 + i] = remainder[i + size_mod4 - 4];
+    } else if (size_mod4) {
+        packet[16] = remainder[0];
+        packet[17] = remainder[size_mod4 >> 1];
+        packet[18] = remainder[size_mod4 - 1];
+    }
+}
+
+A3_H_END
@@ -0,0 +1,95 @@
+/*
+ * HIGHWAYHASH (NEON) -- HighwayHash64 with the state split into pairs of lanes.
+ *
+ * Copyright (c) 2020-2021, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in
+ * the project root for details.
+ */
+
+#include <arm_neon.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "highwayhash.h"
+
+// Each vector holds two lanes. Index 0 is lanes 0 and 1, and index 1 is lanes 2 and 3.
+typedef struct A3HhNeon {
+    uint64x2_t v0[2];
+    uint64x2_t v1[2];
+    uint64x2_t mul0[2];
+    uint64x2_t mul1[2];
+} A3HhNeon;
+
+static uint64x2_t load(void const* p) { return vreinterpretq_u64_u8(vld1q_u8((uint8_t const*)p)); }
+
+// The product of the low halves of the lanes of a and the high halves of the lanes of b.
+static uint64x2_t mul32(uint64x2_t a, uint64x2_t b) {
+    return vmull_u32(vmovn_u64(a), vshrn_n_u64(b, 32));
+}
+
+static uint64x2_t zipper_merge(uint64x2_t v, uint8x16_t mask) {
+    return vreinterpretq_u64_u8(vqtbl1q_u8(vreinterpretq_u8_u64(v), mask));
+}
+
+static uint64x2_t swap32(uint64x2_t v) {
+    return vreinterpretq_u64_u32(vrev64q_u32(vreinterpretq_u32_u64(v)));
+}
+
+static void update(A3HhNeon* state, uint64x2_t const lanes[2]) {
+    uint8x16_t mask = vld1q_u8(A3_HH_ZIPPER);
+    for (size_t i = 0; i < 2; i++) {
+        state->v1[i]   = vaddq_u64(state->v1[i], vaddq_u64(state->mul0[i], lanes[i]));
+        state->mul0[i] = veorq_u64(state->mul0[i], mul32(state->v1[i], state->v0[i]));
+        state->v0[i]   = vaddq_u64(state->v0[i], state->mul1[i]);
+        state->mul1[i] = veorq_u64(state->mul1[i], mul32(state->v0[i], state->v1[i]));
+        state->v0[i]   = vaddq_u64(state->v0[i], zipper_merge(state->v1[i], mask));
+        state->v1[i]   = vaddq_u64(state->v1[i], zipper_merge(state->v0[i], mask));
+    }
+}
+
+static void update_packet(A3HhNeon* state, uint8_t const* packet) {
+    uint64x2_t lanes[2] = { load(packet), load(packet + 16) };
+    update(state, lanes);
+}
+
+uint64_t a3_hh_neon(uint8_t const* data, size_t size, uint64_t const key[4]) {
+    A3HhNeon state;
+    for (size_t i = 0; i < 2; i++) {
+        uint64x2_t k  = load(key + i * 2);
+        state.mul0[i] = load(A3_HH_INIT0 + i * 2);
+        state.mul1[i] = load(A3_HH_INIT1 + i * 2);
+        state.v0[i]   = veorq_u64(state.mul0[i], k);
+        state.v1[i]   = veorq_u64(state.mul1[i], swap32(k));
+    }
+
+    size_t i = 0;
+    for (; i + A3_HH_PACKET_SIZE <= size; i += A3_HH_PACKET_SIZE)
+        update_packet(&state, data + i);
+
+    size_t size_mod32 = size & (A3_HH_PACKET_SIZE - 1);
+    if (size_mod32) {
+        int32x4_t  count  = vdupq_n_s32((int32_t)size_mod32);
+        int32x4_t  rcount = vdupq_n_s32((int32_t)size_mod32 - 32);
+        uint64x2_t add    = vreinterpretq_u64_u32(vdupq_n_u32((uint32_t)size_mod32));
+        for (size_t j = 0; j < 2; j++) {
+            uint32x4_t v1 = vreinterpretq_u32_u64(state.v1[j]);
+            state.v0[j]   = vaddq_u64(state.v0[j], add);
+            state.v1[j] =
+                vreinterpretq_u64_u32(vorrq_u32(vshlq_u32(v1, count), vshlq_u32(v1, rcount)));
+        }
+
+        uint8_t packet[A3_HH_PACKET_SIZE];
+        a3_hh_remainder(data + i, size_mod32, packet);
+        update_packet(&state, packet);
+    }
+
+    for (size_t round = 0; round < 4; round++) {
+        uint64x2_t permuted[2] = { swap32(state.v0[1]), swap32(state.v0[0]) };
+        update(&state, permuted);
+    }
+
+    uint64x2_t sum =
+        vaddq_u64(vaddq_u64(state.v0[0], state.v1[0]), vaddq_u64(state.mul0[0], state.mul1[0]));
+    return vgetq_lane_u64(sum, 0);
+}
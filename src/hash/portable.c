@@ -0,0 +1,112 @@
+/*
+ * HIGHWAYHASH (PORTABLE) -- HighwayHash64 in plain C, one lane at a time.
+ *
+ * Copyright (c) 2020-2021, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in
+ * the project root for details.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "highwayhash.h"
+
+uint64_t const A3_HH_INIT0[4] = { 0xDBE6D5D5FE4CCE2FULL, 0xA4093822299F31D0ULL,
+                                  0x13198A2E03707344ULL, 0x243F6A8885A308D3ULL };
+uint64_t const A3_HH_INIT1[4] = { 0x3BD39E10CB0EF593ULL, 0xC0ACF169B5F18A8CULL,
+                                  0xBE5466CF34E90C6CULL, 0x452821E638D01377ULL };
+
+uint8_t const A3_HH_ZIPPER[16] = { 3, 12, 2, 5, 14, 1, 15, 0, 11, 4, 10, 13, 9, 6, 8, 7 };
+
+typedef struct A3HhState {
+    uint64_t v0[4];
+    uint64_t v1[4];
+    uint64_t mul0[4];
+    uint64_t mul1[4];
+} A3HhState;
+
+static uint64_t swap32(uint64_t x) { return (x >> 32) | (x << 32); }
+
+static uint64_t read64(uint8_t const* p) {
+    uint64_t ret = 0;
+    for (size_t i = 8; i > 0; i--)
+        ret = (ret << 8) | p[i - 1];
+    return ret;
+}
+
+static void reset(A3HhState* state, uint64_t const key[4]) {
+    for (size_t i = 0; i < 4; i++) {
+        state->mul0[i] = A3_HH_INIT0[i];
+        state->mul1[i] = A3_HH_INIT1[i];
+        state->v0[i]   = state->mul0[i] ^ key[i];
+        state->v1[i]   = state->mul1[i] ^ swap32(key[i]);
+    }
+}
+
+// Equivalent to permuting the bytes of each pair of lanes by A3_HH_ZIPPER.
+static void zipper_merge(uint64_t v1, uint64_t v0, uint64_t* add1, uint64_t* add0) {
+    *add0 += (((v0 & 0xFF000000ULL) | (v1 & 0xFF00000000ULL)) >> 24) |
+             (((v0 & 0xFF0000000000ULL) | (v1 & 0xFF000000000000ULL)) >> 16) |
+             (v0 & 0xFF0000ULL) | ((v0 & 0xFF00ULL) << 32) | ((v1 & 0xFF00000000000000ULL) >> 8) |
+             (v0 << 56);
+    *add1 += (((v1 & 0xFF000000ULL) | (v0 & 0xFF00000000ULL)) >> 24) | (v1 & 0xFF0000ULL) |
+             ((v1 & 0xFF0000000000ULL) >> 16) | ((v1 & 0xFF00ULL) << 24) |
+             ((v0 & 0xFF000000000000ULL) >> 8) | ((v1 & 0xFFULL) << 48) |
+             (v0 & 0xFF00000000000000ULL);
+}
+
+static void update(A3HhState* state, uint64_t const lanes[4]) {
+    for (size_t i = 0; i < 4; i++) {
+        state->v1[i] += state->mul0[i] + lanes[i];
+        state->mul0[i] ^= (state->v1[i] & 0xFFFFFFFF) * (state->v0[i] >> 32);
+        state->v0[i] += state->mul1[i];
+        state->mul1[i] ^= (state->v0[i] & 0xFFFFFFFF) * (state->v1[i] >> 32);
+    }
+    zipper_merge(state->v1[1], state->v1[0], &state->v0[1], &state->v0[0]);
+    zipper_merge(state->v1[3], state->v1[2], &state->v0[3], &state->v0[2]);
+    zipper_merge(state->v0[1], state->v0[0], &state->v1[1], &state->v1[0]);
+    zipper_merge(state->v0[3], state->v0[2], &state->v1[3], &state->v1[2]);
+}
+
+static void update_packet(A3HhState* state, uint8_t const* packet) {
+    uint64_t lanes[4];
+    for (size_t i = 0; i < 4; i++)
+        lanes[i] = read64(packet + i * 8);
+    update(state, lanes);
+}
+
+static uint32_t rotate32(uint32_t x, size_t count) {
+    return (uint32_t)((x << count) | (x >> (32 - count)));
+}
+
+static void update_remainder(A3HhState* state, uint8_t const* bytes, size_t size_mod32) {
+    for (size_t i = 0; i < 4; i++) {
+        state->v0[i] += ((uint64_t)size_mod32 << 32) + size_mod32;
+        state->v1[i] = rotate32((uint32_t)state->v1[i], size_mod32) |
+                       (uint64_t)rotate32((uint32_t)(state->v1[i] >> 32), size_mod32) << 32;
+    }
+
+    uint8_t packet[A3_HH_PACKET_SIZE];
+    a3_hh_remainder(bytes, size_mod32, packet);
+    update_packet(state, packet);
+}
+
+uint64_t a3_hh_portable(uint8_t const* data, size_t size, uint64_t const key[4]) {
+    A3HhState state;
+    reset(&state, key);
+
+    size_t i = 0;
+    for (; i + A3_HH_PACKET_SIZE <= size; i += A3_HH_PACKET_SIZE)
+        update_packet(&state, data + i);
+    if (size & (A3_HH_PACKET_SIZE - 1))
+        update_remainder(&state, data + i, size & (A3_HH_PACKET_SIZE - 1));
+
+    for (size_t round = 0; round < 4; round++) {
+        uint64_t permuted[4] = { swap32(state.v0[2]), swap32(state.v0[3]), swap32(state.v0[0]),
+                                 swap32(state.v0[1]) };
+        update(&state, permuted);
+    }
+
+    return state.v0[0] + state.v1[0] + state.mul0[0] + state.mul1[0];
+}
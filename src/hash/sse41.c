@@ -0,0 +1,85 @@
+/*
+ * HIGHWAYHASH (SSE4.1) -- HighwayHash64 with the state split into pairs of lanes.
+ *
+ * Copyright (c) 2020-2021, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in
+ * the project root for details.
+ */
+
+#include <smmintrin.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "highwayhash.h"
+
+// Each vector holds two lanes. Index 0 is lanes 0 and 1, and index 1 is lanes 2 and 3.
+typedef struct A3HhSse41 {
+    __m128i v0[2];
+    __m128i v1[2];
+    __m128i mul0[2];
+    __m128i mul1[2];
+} A3HhSse41;
+
+static __m128i load(void const* p) { return _mm_loadu_si128((__m128i const*)p); }
+
+static void update(A3HhSse41* state, __m128i const lanes[2]) {
+    __m128i mask = load(A3_HH_ZIPPER);
+    for (size_t i = 0; i < 2; i++) {
+        state->v1[i] = _mm_add_epi64(state->v1[i], _mm_add_epi64(state->mul0[i], lanes[i]));
+        state->mul0[i] = _mm_xor_si128(
+            state->mul0[i], _mm_mul_epu32(state->v1[i], _mm_srli_epi64(state->v0[i], 32)));
+        state->v0[i] = _mm_add_epi64(state->v0[i], state->mul1[i]);
+        state->mul1[i] = _mm_xor_si128(
+            state->mul1[i], _mm_mul_epu32(state->v0[i], _mm_srli_epi64(state->v1[i], 32)));
+        state->v0[i] = _mm_add_epi64(state->v0[i], _mm_shuffle_epi8(state->v1[i], mask));
+        state->v1[i] = _mm_add_epi64(state->v1[i], _mm_shuffle_epi8(state->v0[i], mask));
+    }
+}
+
+static void update_packet(A3HhSse41* state, uint8_t const* packet) {
+    __m128i lanes[2] = { load(packet), load(packet + 16) };
+    update(state, lanes);
+}
+
+uint64_t a3_hh_sse41(uint8_t const* data, size_t size, uint64_t const key[4]) {
+    A3HhSse41 state;
+    for (size_t i = 0; i < 2; i++) {
+        __m128i k     = load(key + i * 2);
+        state.mul0[i] = load(A3_HH_INIT0 + i * 2);
+        state.mul1[i] = load(A3_HH_INIT1 + i * 2);
+        state.v0[i]   = _mm_xor_si128(state.mul0[i], k);
+        state.v1[i] = _mm_xor_si128(state.mul1[i], _mm_shuffle_epi32(k, _MM_SHUFFLE(2, 3, 0, 1)));
+    }
+
+    size_t i = 0;
+    for (; i + A3_HH_PACKET_SIZE <= size; i += A3_HH_PACKET_SIZE)
+        update_packet(&state, data + i);
+
+    size_t size_mod32 = size & (A3_HH_PACKET_SIZE - 1);
+    if (size_mod32) {
+        __m128i count  = _mm_cvtsi32_si128((int)size_mod32);
+        __m128i rcount = _mm_cvtsi32_si128(32 - (int)size_mod32);
+        for (size_t j = 0; j < 2; j++) {
+            state.v0[j] = _mm_add_epi64(state.v0[j], _mm_set1_epi32((int)size_mod32));
+            state.v1[j] =
+                _mm_or_si128(_mm_sll_epi32(state.v1[j], count), _mm_srl_epi32(state.v1[j], rcount));
+        }
+
+        uint8_t packet[A3_HH_PACKET_SIZE];
+        a3_hh_remainder(data + i, size_mod32, packet);
+        update_packet(&state, packet);
+    }
+
+    for (size_t round = 0; round < 4; round++) {
+        __m128i permuted[2] = { _mm_shuffle_epi32(state.v0[1], _MM_SHUFFLE(2, 3, 0, 1)),
+                                _mm_shuffle_epi32(state.v0[0], _MM_SHUFFLE(2, 3, 0, 1)) };
+        update(&state, permuted);
+    }
+
+    __m128i sum = _mm_add_epi64(_mm_add_epi64(state.v0[0], state.v1[0]),
+                                _mm_add_epi64(state.mul0[0], state.mul1[0]));
+    uint64_t result;
+    _mm_storel_epi64((__m128i*)&result, sum);
+    return result;
+}
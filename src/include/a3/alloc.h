@@ -0,0 +1,69 @@
+/*
+ * ALLOC -- Allocation of large arrays.
+ *
+ * Copyright (c) 2022, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in
+ * the project root for details.
+ */
+
+/// \file alloc.h
+/// # Large Allocations
+/// The backing arrays of hash tables (see ht.h) and vectors (see vec.h) are allocated here, so
+/// that very large ones can be placed differently to ordinary heap memory. Random lookups into a
+/// table of several gigabytes miss the TLB on almost every access when it is backed by 4 KiB pages.
+/// Backing it with huge pages instead lets the TLB cover far more of it.
+///
+/// By default, everything comes from the heap. After
+///
+///     a3_alloc_policy_set((A3AllocPolicy) { .map_threshold = 64 << 20, .huge_pages = true });
+///
+/// arrays of 64 MiB or more are mapped directly with `mmap`, advised with `MADV_HUGEPAGE`, and
+/// returned with `munmap`. Whether the kernel actually uses huge pages for them depends on its
+/// transparent huge page setting, which must be `always` or `madvise`.
+///
+/// Each block is preceded by a small header recording how it was obtained, and is released
+/// accordingly, so changing the policy only affects later allocations. Mapped arrays therefore
+/// start just past that header, rather than exactly on a page boundary.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <a3/cpp.h>
+#include <a3/types.h>
+
+A3_H_BEGIN
+
+/// The ::A3AllocPolicy::map_threshold which never maps allocations. This is the default.
+#define A3_ALLOC_MAP_NEVER SIZE_MAX
+
+/// How large arrays are allocated.
+typedef struct A3AllocPolicy {
+    size_t map_threshold; ///< The size, in bytes, from which arrays are mapped directly.
+    bool   huge_pages;    ///< Ask for mapped arrays to be backed by huge pages.
+    bool   populate;      ///< Fault in every page when mapping, rather than on first touch.
+} A3AllocPolicy;
+
+/// Set the allocation policy. This is not synchronized with allocation, so it should be called
+/// during startup.
+A3_EXPORT void a3_alloc_policy_set(A3AllocPolicy policy);
+
+/// Get the current allocation policy.
+A3_EXPORT A3AllocPolicy a3_alloc_policy(void);
+
+/// Allocate a zeroed array of `count` elements of `size` bytes each. Returns `NULL` on failure.
+A3_EXPORT void* a3_large_calloc(size_t count, size_t size);
+
+/// Free an array from ::a3_large_calloc, given the same `count` and `size`.
+A3_EXPORT void a3_large_free(void* ptr, size_t count, size_t size);
+
+/// Allocate `size` uninitialized bytes with the given alignment. Returns `NULL` on failure.
+A3_EXPORT void* a3_large_aligned_alloc(size_t size, size_t align);
+
+/// Free a block from ::a3_large_aligned_alloc, given the same `size`.
+A3_EXPORT void a3_large_aligned_free(void* ptr, size_t size);
+
+A3_H_END
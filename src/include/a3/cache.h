@@ -1,5 +1,5 @@
 /*
- * CACHE -- A simple pseudo-LRU cache backed by a hash table.
+ * CACHE -- A fixed-capacity CLOCK cache backed by a hash table.
  *
  * Copyright (c) 2020-2021, Alex O'Brien <3541@3541.website>
  *
@@ -10,76 +10,244 @@
 #pragma once
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 #include <a3/cpp.h>
 #include <a3/ht.h>
+#include <a3/sketch.h>
 #include <a3/util.h>
+#include <a3/wheel.h>
 
-#define A3_CACHE_ENTRY(K, V)    A3_HT_ENTRY(K, V)
+// Eviction follows CLOCK: a hand sweeps the slots of the table, and evicts the first entry whose
+// access count has fallen to zero, decrementing counts as it passes. Each entry's count lives next
+// to its value, so it moves with the entry when the table shifts entries on insertion or deletion.
+// Counts saturate at A3_CACHE_MAX_FREQ, so a frequently used entry survives several sweeps, and
+// new entries start at zero, so an entry which is never used again is the first to go.
+//
+// The hand does not visit slots in order, but steps by a large stride coprime to the capacity,
+// which still visits every slot once per sweep. Stepping in order would leave every free slot just
+// behind the hand, so each insertion elsewhere would shift entries all the way round to it.
+//
+// A cache may also be given a budget with A3_CACHE_INIT_WEIGHTED. Each entry inserted with
+// A3_CACHE_INSERT_WEIGHTED then carries a weight, such as the size in bytes of its value, and the
+// hand evicts entries until both the entry count and the total weight fit. The capacity still
+// bounds the number of entries, and sizes the table. The total weight is available for memory
+// accounting through A3_CACHE_WEIGHT. Entries inserted with A3_CACHE_INSERT weigh nothing.
+//
+// Entries inserted with A3_CACHE_INSERT_TTL expire a given number of ticks after insertion. Ticks
+// are of whatever length the caller chooses, and the caller passes the current tick to each call
+// which needs it. A3_CACHE_FIND_AT treats an expired entry as missing and removes it, so entries
+// never outlive their TTL as seen by lookups. A3_CACHE_ADVANCE runs a timer wheel (see wheel.h)
+// which removes entries as they expire, so that they do not hold space until the hand reaches
+// them. Both pass expired entries to the eviction callback. A3_CACHE_FIND does not know the time,
+// so it returns entries which have expired since the last A3_CACHE_ADVANCE. The wheel is only
+// created by the first A3_CACHE_INSERT_TTL.
+//
+// CLOCK admits every new entry at the cost of an old one, so a scan of keys which are each used
+// once flushes the cache. A3_CACHE_ENABLE_ADMISSION puts a W-TinyLFU admission filter in front of
+// it. A frequency sketch (see sketch.h) counts the recent hits and insertions of every key, cached
+// or not, in two to four bytes per entry. New entries go into a window of about one percent of the
+// capacity, which admits everything and which the hand passes over, so that a burst of new keys can
+// gather hits before they are judged. When the window is full, its oldest entry joins the rest of
+// the cache. If the cache is also full, that entry only displaces the hand's victim if the sketch
+// reckons it the more popular of the two, and is evicted otherwise. The window's order is kept as a
+// queue of hashes, since entries move. Admission does not change what A3_CACHE_INSERT and friends
+// return: an entry which the filter refuses is passed to the eviction callback like any other.
+
+#ifndef A3_CACHE_MAX_FREQ
+#define A3_CACHE_MAX_FREQ 3
+#endif
+
+#define A3_CACHE_SLOT(K, V)     K##V##A3CacheSlot
+#define A3_CACHE_ENTRY(K, V)    A3_CACHE_HT(A3_HT_ENTRY, K, V)
+#define A3_CACHE_TABLE(K, V)    A3_CACHE_HT(A3_HT, K, V)
 #define A3_CACHE(K, V)          struct K##V##A3Cache
 #define A3_CACHE_EVICT_CB(K, V) K##V##A3CacheEvictCallback
 
-#define A3_CACHE_BLOCK_FULL        SIZE_MAX
-#define A3_CACHE_ENTRIES_PER_BLOCK (sizeof(size_t) * 8)
+// Name a method or type of the underlying table, whose values are A3_CACHE_SLOT(K, V): for example,
+// A3_CACHE_HT(A3_HT_FIND_INDEX, K, V). The slot name is expanded before it reaches M, which pastes
+// its arguments.
+#define A3_CACHE_HT(M, K, V)       A3_CACHE_HT_SLOT_(M, K, A3_CACHE_SLOT(K, V))
+#define A3_CACHE_HT_SLOT_(M, K, S) M(K, S)
+
+// A stride for the hand of a table with the given capacity: close to its golden section, and
+// coprime to it.
+A3_ALWAYS_INLINE size_t a3_cache_stride(size_t cap) {
+    size_t stride = cap * 5 / 8 + 1;
+    for (;; stride++) {
+        size_t a = cap;
+        size_t b = stride;
+        while (b) {
+            size_t t = a % b;
+            a        = b;
+            b        = t;
+        }
+        if (a == 1)
+            return stride % cap;
+    }
+}
 
 #define A3_CACHE_DEFINE_STRUCTS(K, V)                                                              \
     A3_H_BEGIN                                                                                     \
                                                                                                    \
-    A3_HT_DEFINE_STRUCTS(K, V)                                                                     \
+    typedef struct A3_CACHE_SLOT(K, V) {                                                           \
+        V        value;                                                                            \
+        size_t   weight;                                                                           \
+        uint64_t expires; /* Zero for entries which never expire. */                               \
+        uint8_t  freq;                                                                             \
+        bool     window; /* Whether the entry is in the admission window. */                       \
+    } A3_CACHE_SLOT(K, V);                                                                         \
+                                                                                                   \
+    A3_CACHE_HT(A3_HT_DEFINE_STRUCTS, K, V)                                                        \
                                                                                                    \
     typedef void (*A3_CACHE_EVICT_CB(K, V))(void*, K*, V*);                                        \
                                                                                                    \
     A3_CACHE(K, V) {                                                                               \
+        size_t capacity;                                                                           \
+        size_t budget;                                                                             \
+        size_t weight;                                                                             \
         size_t eviction_index;                                                                     \
+        size_t eviction_stride;                                                                    \
         A3_CACHE_EVICT_CB(K, V) eviction_callback;                                                 \
-        size_t* accessed;                                                                          \
-        A3_HT(K, V) table;                                                                         \
+        A3TimerWheel* wheel;                                                                       \
+        A3Sketch*     sketch;                                                                      \
+        uint64_t*     window; /* A ring of the hashes of window entries, oldest first. */          \
+        size_t        window_capacity;                                                             \
+        size_t        window_head;                                                                 \
+        size_t        window_queued;                                                               \
+        size_t        window_size; /* The number of entries in the window. */                      \
+        A3_CACHE_TABLE(K, V) table;                                                                \
+    };                                                                                             \
+                                                                                                   \
+    /* The context of the wheel's callback. */                                                     \
+    A3_CACHE_EXPIRY(K, V) {                                                                        \
+        A3_CACHE(K, V) * cache;                                                                    \
+        void* callback_ctx;                                                                        \
     };                                                                                             \
                                                                                                    \
     A3_H_END
 
-#define A3_CACHE_INIT(K, V)    K##V##_a3_cache_init
-#define A3_CACHE_NEW(K, V)     K##V##_a3_cache_new
-#define A3_CACHE_DESTROY(K, V) K##V##_a3_cache_destroy
-#define A3_CACHE_FREE(K, V)    K##V##_a3_cache_free
+#define A3_CACHE_INIT(K, V)             K##V##_a3_cache_init
+#define A3_CACHE_INIT_KEYED(K, V)       K##V##_a3_cache_init_keyed
+#define A3_CACHE_INIT_WEIGHTED(K, V)    K##V##_a3_cache_init_weighted
+#define A3_CACHE_ENABLE_ADMISSION(K, V) K##V##_a3_cache_enable_admission
+#define A3_CACHE_NEW(K, V)              K##V##_a3_cache_new
+#define A3_CACHE_DESTROY(K, V)          K##V##_a3_cache_destroy
+#define A3_CACHE_FREE(K, V)             K##V##_a3_cache_free
+
+#define A3_CACHE_ACCESS(K, V)     K##V##_a3_cache_access
+#define A3_CACHE_ACCESSED(K, V)   K##V##_a3_cache_accessed
+#define A3_CACHE_REMOVE(K, V)     K##V##_a3_cache_remove
+#define A3_CACHE_VICTIM(K, V)     K##V##_a3_cache_victim
+#define A3_CACHE_EVICT(K, V)      K##V##_a3_cache_evict
+#define A3_CACHE_POP_WINDOW(K, V) K##V##_a3_cache_pop_window
+#define A3_CACHE_ADMIT(K, V)      K##V##_a3_cache_admit
+#define A3_CACHE_PLACE(K, V)      K##V##_a3_cache_place
+#define A3_CACHE_EXPIRE(K, V)     K##V##_a3_cache_expire
+#define A3_CACHE_EXPIRY(K, V)     struct K##V##A3CacheExpiry
 
-#define A3_CACHE_ACCESS(K, V)   K##V##_a3_cache_access
-#define A3_CACHE_ACCESSED(K, V) K##V##_a3_cache_accessed
-#define A3_CACHE_EVICT(K, V)    K##V##_a3_cache_evict
+#define A3_CACHE_FIND(K, V)            K##V##_a3_cache_find
+#define A3_CACHE_FIND_AT(K, V)         K##V##_a3_cache_find_at
+#define A3_CACHE_INSERT(K, V)          K##V##_a3_cache_insert
+#define A3_CACHE_INSERT_WEIGHTED(K, V) K##V##_a3_cache_insert_weighted
+#define A3_CACHE_INSERT_TTL(K, V)      K##V##_a3_cache_insert_ttl
+#define A3_CACHE_ADVANCE(K, V)         K##V##_a3_cache_advance
+#define A3_CACHE_INSERT_HASHED(K, V)   K##V##_a3_cache_insert_hashed
+#define A3_CACHE_CLEAR(K, V)           K##V##_a3_cache_clear
+#define A3_CACHE_WEIGHT(K, V)          K##V##_a3_cache_weight
 
-#define A3_CACHE_FIND(K, V)   K##V##_a3_cache_find
-#define A3_CACHE_INSERT(K, V) K##V##_a3_cache_insert
-#define A3_CACHE_CLEAR(K, V)  K##V##_a3_cache_clear
+// A3_CACHE_INIT_KEYED takes the hash key of the underlying table, as A3_HT_INIT does, so that
+// several caches can share one hash. A3_CACHE_INSERT_HASHED takes a hash previously computed with
+// A3_CACHE_HT(A3_HT_HASH, K, V), and a weight.
+//
+// A3_CACHE_INSERT_WEIGHTED and A3_CACHE_INSERT_HASHED return false, inserting nothing and evicting
+// nothing, if the weight alone exceeds the budget. The caller keeps ownership of the value. So does
+// A3_CACHE_INSERT_TTL, which takes a weight, the current tick, and a TTL of at least one tick.
+//
+// Inserting a key which is already cached replaces its entry, and passes the old key and value to
+// the eviction callback. Re-inserting with A3_CACHE_INSERT_TTL therefore refreshes an entry's TTL,
+// and re-inserting with any other function makes it permanent. A replacement is not counted as an
+// access, so only lookups keep an entry hot.
+//
+// A3_CACHE_ENABLE_ADMISSION must be called after initialization, before anything is inserted.
 
 #define A3_CACHE_DECLARE_METHODS(K, V)                                                             \
     A3_H_BEGIN                                                                                     \
                                                                                                    \
     void A3_CACHE_INIT(K, V)(A3_CACHE(K, V)*, size_t capacity, A3_CACHE_EVICT_CB(K, V));           \
+    void A3_CACHE_INIT_KEYED(K, V)(A3_CACHE(K, V)*, size_t capacity, A3_CACHE_EVICT_CB(K, V),      \
+                                   uint8_t* key);                                                  \
+    void A3_CACHE_INIT_WEIGHTED(K, V)(A3_CACHE(K, V)*, size_t capacity, size_t budget,             \
+                                      A3_CACHE_EVICT_CB(K, V));                                    \
+    void A3_CACHE_ENABLE_ADMISSION(K, V)(A3_CACHE(K, V)*);                                         \
     A3_CACHE(K, V) * A3_CACHE_NEW(K, V)(size_t capacity, A3_CACHE_EVICT_CB(K, V));                 \
     void A3_CACHE_DESTROY(K, V)(A3_CACHE(K, V)*);                                                  \
     void A3_CACHE_FREE(K, V)(A3_CACHE(K, V)*);                                                     \
                                                                                                    \
     V*   A3_CACHE_FIND(K, V)(A3_CACHE(K, V)*, K);                                                  \
+    V*   A3_CACHE_FIND_AT(K, V)(A3_CACHE(K, V)*, K, uint64_t now, void* callback_ctx);             \
     void A3_CACHE_INSERT(K, V)(A3_CACHE(K, V)*, K, V, void* callback_ctx);                         \
+    bool A3_CACHE_INSERT_WEIGHTED(K, V)(A3_CACHE(K, V)*, K, V, size_t weight, void* callback_ctx); \
+    bool A3_CACHE_INSERT_TTL(K, V)(A3_CACHE(K, V)*, K, V, size_t weight, uint64_t now,             \
+                                   uint64_t ttl, void* callback_ctx);                              \
+    bool A3_CACHE_INSERT_HASHED(K, V)(A3_CACHE(K, V)*, uint64_t hash, K, V, size_t weight,         \
+                                      void* callback_ctx);                                         \
     void A3_CACHE_CLEAR(K, V)(A3_CACHE(K, V)*, void* callback_ctx);                                \
+    void A3_CACHE_ADVANCE(K, V)(A3_CACHE(K, V)*, uint64_t now, void* callback_ctx);                \
+                                                                                                   \
+    A3_ALWAYS_INLINE size_t A3_CACHE_WEIGHT(K, V)(A3_CACHE(K, V) * cache) {                        \
+        assert(cache);                                                                             \
+        return cache->weight;                                                                      \
+    }                                                                                              \
                                                                                                    \
-    A3_HT_DECLARE_METHODS(K, V)                                                                    \
+    A3_CACHE_HT(A3_HT_DECLARE_METHODS, K, V)                                                       \
                                                                                                    \
     A3_H_END
 
 #define A3_CACHE_DEFINE_METHODS_NOHT(K, V)                                                         \
-    void A3_CACHE_INIT(K, V)(A3_CACHE(K, V) * cache, size_t capacity,                              \
-                             A3_CACHE_EVICT_CB(K, V) eviction_callback) {                          \
+    void A3_CACHE_INIT_KEYED(K, V)(A3_CACHE(K, V) * cache, size_t capacity,                        \
+                                   A3_CACHE_EVICT_CB(K, V) eviction_callback, uint8_t * key) {     \
         assert(cache);                                                                             \
         assert(capacity > 0);                                                                      \
                                                                                                    \
+        cache->capacity          = capacity;                                                       \
+        cache->budget            = SIZE_MAX;                                                       \
+        cache->weight            = 0;                                                              \
         cache->eviction_index    = 0;                                                              \
         cache->eviction_callback = eviction_callback;                                              \
-        A3_UNWRAPN(cache->accessed,                                                                \
-                   (size_t*)calloc(capacity / A3_CACHE_ENTRIES_PER_BLOCK, sizeof(size_t)));        \
-        A3_HT_INIT(K, V)(&cache->table, A3_HT_NO_HASH_KEY, A3_HT_FORBID_GROWTH);                   \
-        A3_HT_RESIZE(K, V)(&cache->table, capacity);                                               \
+        cache->wheel             = NULL;                                                           \
+        cache->sketch            = NULL;                                                           \
+        cache->window            = NULL;                                                           \
+        cache->window_capacity   = 0;                                                              \
+        cache->window_head       = 0;                                                              \
+        cache->window_queued     = 0;                                                              \
+        cache->window_size       = 0;                                                              \
+        /* The table never grows, but keeps its usual slack, so that runs of entries stay short    \
+         * and inserting into a full cache does not shift a large part of it. */                   \
+        A3_CACHE_HT(A3_HT_INIT_SLOTS, K, V)                                                        \
+        (&cache->table, key, A3_HT_FORBID_GROWTH, A3_HT_CAP_FOR(capacity));                        \
+        cache->eviction_stride = a3_cache_stride(cache->table.cap);                                \
+    }                                                                                              \
+                                                                                                   \
+    void A3_CACHE_INIT(K, V)(A3_CACHE(K, V) * cache, size_t capacity,                              \
+                             A3_CACHE_EVICT_CB(K, V) eviction_callback) {                          \
+        A3_CACHE_INIT_KEYED(K, V)(cache, capacity, eviction_callback, A3_HT_NO_HASH_KEY);          \
+    }                                                                                              \
+                                                                                                   \
+    void A3_CACHE_INIT_WEIGHTED(K, V)(A3_CACHE(K, V) * cache, size_t capacity, size_t budget,      \
+                                      A3_CACHE_EVICT_CB(K, V) eviction_callback) {                 \
+        A3_CACHE_INIT(K, V)(cache, capacity, eviction_callback);                                   \
+        cache->budget = budget;                                                                    \
+    }                                                                                              \
+                                                                                                   \
+    void A3_CACHE_ENABLE_ADMISSION(K, V)(A3_CACHE(K, V) * cache) {                                 \
+        assert(cache);                                                                             \
+        assert(!cache->table.size && !cache->sketch);                                              \
+                                                                                                   \
+        cache->sketch          = a3_sketch_new(cache->capacity);                                   \
+        cache->window_capacity = cache->capacity / 100 ? cache->capacity / 100 : 1;                \
+        A3_UNWRAPN(cache->window, (uint64_t*)calloc(cache->window_capacity, sizeof(uint64_t)));    \
     }                                                                                              \
                                                                                                    \
     A3_CACHE(K, V) *                                                                               \
@@ -96,8 +264,12 @@
     void A3_CACHE_DESTROY(K, V)(A3_CACHE(K, V) * cache) {                                          \
         assert(cache);                                                                             \
                                                                                                    \
-        free(cache->accessed);                                                                     \
-        A3_HT_DESTROY(K, V)(&cache->table);                                                        \
+        A3_CACHE_HT(A3_HT_DESTROY, K, V)(&cache->table);                                           \
+        if (cache->wheel)                                                                          \
+            a3_wheel_free(cache->wheel);                                                           \
+        if (cache->sketch)                                                                         \
+            a3_sketch_free(cache->sketch);                                                         \
+        free(cache->window);                                                                       \
     }                                                                                              \
                                                                                                    \
     void A3_CACHE_FREE(K, V)(A3_CACHE(K, V) * cache) {                                             \
@@ -109,84 +281,286 @@
                                                                                                    \
     static void A3_CACHE_ACCESS(K, V)(A3_CACHE(K, V) * cache, size_t index) {                      \
         assert(cache);                                                                             \
-        size_t* block = &cache->accessed[index / A3_CACHE_ENTRIES_PER_BLOCK];                      \
-        size_t  bit   = 1ULL << (index % A3_CACHE_ENTRIES_PER_BLOCK);                              \
-        if ((*block | bit) == A3_CACHE_BLOCK_FULL)                                                 \
-            *block = 0ULL;                                                                         \
-        *block |= bit;                                                                             \
+        uint8_t* freq = &cache->table.entries[index].value.freq;                                   \
+        if (*freq < A3_CACHE_MAX_FREQ)                                                             \
+            (*freq)++;                                                                             \
+        if (cache->sketch)                                                                         \
+            a3_sketch_increment(cache->sketch, cache->table.entries[index].hash);                  \
     }                                                                                              \
                                                                                                    \
     static bool A3_CACHE_ACCESSED(K, V)(A3_CACHE(K, V) * cache, size_t index) {                    \
         assert(cache);                                                                             \
-        return cache->accessed[index / A3_CACHE_ENTRIES_PER_BLOCK] &                               \
-               (1ULL << (index % A3_CACHE_ENTRIES_PER_BLOCK));                                     \
+        return cache->table.entries[index].value.freq > 0;                                         \
     }                                                                                              \
                                                                                                    \
     V* A3_CACHE_FIND(K, V)(A3_CACHE(K, V) * cache, K key) {                                        \
-        A3_SSIZE_T index = A3_HT_FIND_INDEX(K, V)(&cache->table, key);                             \
+        A3_SSIZE_T index = A3_CACHE_HT(A3_HT_FIND_INDEX, K, V)(&cache->table, key);                \
         if (index < 0)                                                                             \
             return NULL;                                                                           \
         size_t i = (size_t)index;                                                                  \
         assert(i < cache->table.cap);                                                              \
         A3_CACHE_ACCESS(K, V)(cache, i);                                                           \
                                                                                                    \
-        return &cache->table.entries[i].value;                                                     \
+        return &cache->table.entries[i].value.value;                                               \
     }                                                                                              \
                                                                                                    \
-    static void A3_CACHE_EVICT(K, V)(A3_CACHE(K, V) * cache, void* callback_ctx) {                 \
+    /* Pass the entry at the given index to the callback, and delete it. */                        \
+    static void A3_CACHE_REMOVE(K, V)(A3_CACHE(K, V) * cache, size_t index, void* callback_ctx) {  \
+        assert(cache);                                                                             \
+                                                                                                   \
+        A3_CACHE_ENTRY(K, V)* entry = &cache->table.entries[index];                                \
+        cache->weight -= entry->value.weight;                                                      \
+        /* The entry's hash stays in the window's queue, and is skipped when it comes up. */       \
+        if (entry->value.window)                                                                   \
+            cache->window_size--;                                                                  \
+        if (cache->eviction_callback)                                                              \
+            cache->eviction_callback(callback_ctx, &entry->key, &entry->value.value);              \
+        A3_CACHE_HT(A3_HT_DELETE_INDEX, K, V)(&cache->table, index);                               \
+    }                                                                                              \
+                                                                                                   \
+    V* A3_CACHE_FIND_AT(K, V)(A3_CACHE(K, V) * cache, K key, uint64_t now, void* callback_ctx) {   \
+        A3_SSIZE_T index = A3_CACHE_HT(A3_HT_FIND_INDEX, K, V)(&cache->table, key);                \
+        if (index < 0)                                                                             \
+            return NULL;                                                                           \
+        size_t i = (size_t)index;                                                                  \
+        assert(i < cache->table.cap);                                                              \
+                                                                                                   \
+        uint64_t expires = cache->table.entries[i].value.expires;                                  \
+        if (expires && expires <= now) {                                                           \
+            A3_CACHE_REMOVE(K, V)(cache, i, callback_ctx);                                         \
+            return NULL;                                                                           \
+        }                                                                                          \
+        A3_CACHE_ACCESS(K, V)(cache, i);                                                           \
+                                                                                                   \
+        return &cache->table.entries[i].value.value;                                               \
+    }                                                                                              \
+                                                                                                   \
+    /* Move the hand to the next entry outside the window which has not been accessed, and return  \
+     * its index. There must be such an entry. */                                                  \
+    static size_t A3_CACHE_VICTIM(K, V)(A3_CACHE(K, V) * cache) {                                  \
+        assert(cache);                                                                             \
+        assert(cache->table.size > cache->window_size);                                            \
+                                                                                                   \
+        /* Each step past an entry undoes one access, so the sweep is amortized over accesses. */  \
+        size_t cap    = cache->table.cap;                                                          \
+        size_t stride = cache->eviction_stride;                                                    \
+        for (;; cache->eviction_index = (cache->eviction_index + stride) % cap) {                  \
+            A3_CACHE_ENTRY(K, V)* entry = &cache->table.entries[cache->eviction_index];            \
+            if (!entry->hash || entry->value.window)                                               \
+                continue;                                                                          \
+            if (!A3_CACHE_ACCESSED(K, V)(cache, cache->eviction_index))                            \
+                return cache->eviction_index;                                                      \
+            entry->value.freq--;                                                                   \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    /* Take hashes off the front of the window's queue until one belongs to an entry still in the  \
+     * window, and return that entry's index, or -1 if the queue runs out. */                      \
+    static A3_SSIZE_T A3_CACHE_POP_WINDOW(K, V)(A3_CACHE(K, V) * cache) {                          \
         assert(cache);                                                                             \
                                                                                                    \
-        size_t start = cache->eviction_index;                                                      \
-        bool   found = false;                                                                      \
-        do {                                                                                       \
-            if (!A3_CACHE_ACCESSED(K, V)(cache, cache->eviction_index) &&                          \
-                cache->table.entries[cache->eviction_index].hash) {                                \
-                found = true;                                                                      \
-                break; /* Non-recent entry. Evict it. */                                           \
+        A3_CACHE_TABLE(K, V)* table = &cache->table;                                               \
+        while (cache->window_queued) {                                                             \
+            uint64_t hash      = cache->window[cache->window_head];                                \
+            cache->window_head = (cache->window_head + 1) % cache->window_capacity;                \
+            cache->window_queued--;                                                                \
+                                                                                                   \
+            for (size_t i = A3_HT_HOME_MOD(table->cap, hash); table->entries[i].hash;              \
+                 i         = A3_HT_NEXT_MOD(table->cap, i)) {                                      \
+                if (table->entries[i].hash == hash && table->entries[i].value.window)              \
+                    return (A3_SSIZE_T)i;                                                          \
             }                                                                                      \
-            cache->eviction_index = (cache->eviction_index + 1) % cache->table.cap;                \
-        } while (cache->eviction_index != start);                                                  \
+        }                                                                                          \
+        return -1;                                                                                 \
+    }                                                                                              \
+                                                                                                   \
+    static void A3_CACHE_EVICT(K, V)(A3_CACHE(K, V) * cache, void* callback_ctx) {                 \
+        assert(cache);                                                                             \
                                                                                                    \
-        if (cache->eviction_index == start && !found)                                              \
+        if (!cache->table.size)                                                                    \
             A3_PANIC("Unable to evict an entry. This shouldn't be possible.");                     \
-        if (cache->eviction_callback) {                                                            \
-            A3_HT_ENTRY(K, V)* entry = &cache->table.entries[cache->eviction_index];               \
-            cache->eviction_callback(callback_ctx, &entry->key, &entry->value);                    \
+                                                                                                   \
+        /* With a small enough capacity or a heavy enough entry, only the window may be left. */   \
+        if (cache->table.size == cache->window_size) {                                             \
+            A3_SSIZE_T oldest = A3_CACHE_POP_WINDOW(K, V)(cache);                                  \
+            if (oldest < 0)                                                                        \
+                A3_PANIC("Window entry missing from its queue.");                                  \
+            A3_CACHE_REMOVE(K, V)(cache, (size_t)oldest, callback_ctx);                            \
+            return;                                                                                \
         }                                                                                          \
-        A3_HT_DELETE_INDEX(K, V)(&cache->table, cache->eviction_index);                            \
-        /* The access map needs to be thrown away at this point, since                             \
-         * deletion likely caused elements to shift. */                                            \
-        memset(cache->accessed, 0,                                                                 \
-               cache->table.cap / A3_CACHE_ENTRIES_PER_BLOCK * sizeof(size_t));                    \
+                                                                                                   \
+        size_t victim = A3_CACHE_VICTIM(K, V)(cache);                                              \
+        A3_CACHE_REMOVE(K, V)(cache, victim, callback_ctx);                                        \
+        cache->eviction_index = (victim + cache->eviction_stride) % cache->table.cap;              \
     }                                                                                              \
                                                                                                    \
-    void A3_CACHE_INSERT(K, V)(A3_CACHE(K, V) * cache, K key, V value, void* callback_ctx) {       \
+    /* Make room in a full window for an entry of the given weight. The oldest entry in the window \
+     * leaves it. If the cache is full, that entry and the hand's victim compete for a place, and  \
+     * whichever the sketch estimates to be used less often is evicted. Ties go to the victim,     \
+     * since the newcomer has not yet shown itself any better. */                                  \
+    static void A3_CACHE_ADMIT(K, V)(A3_CACHE(K, V) * cache, size_t weight, void* callback_ctx) {  \
         assert(cache);                                                                             \
                                                                                                    \
-        if (!A3_HT_INSERT(K, V)(&cache->table, key, value)) {                                      \
+        if (cache->window_queued < cache->window_capacity)                                         \
+            return;                                                                                \
+        A3_SSIZE_T oldest = A3_CACHE_POP_WINDOW(K, V)(cache);                                      \
+        if (oldest < 0)                                                                            \
+            return;                                                                                \
+                                                                                                   \
+        size_t candidate                             = (size_t)oldest;                             \
+        cache->table.entries[candidate].value.window = false;                                      \
+        cache->window_size--;                                                                      \
+        if (cache->table.size < cache->capacity && cache->weight <= cache->budget - weight)        \
+            return;                                                                                \
+                                                                                                   \
+        /* Either way, the hand moves on. A victim which survives has earned the same reprieve as  \
+         * an accessed entry, and would otherwise turn away every candidate after this one. */     \
+        size_t victim         = A3_CACHE_VICTIM(K, V)(cache);                                      \
+        cache->eviction_index = (victim + cache->eviction_stride) % cache->table.cap;              \
+        if (victim != candidate &&                                                                 \
+            a3_sketch_estimate(cache->sketch, cache->table.entries[candidate].hash) <=             \
+                a3_sketch_estimate(cache->sketch, cache->table.entries[victim].hash))              \
+            victim = candidate;                                                                    \
+        A3_CACHE_REMOVE(K, V)(cache, victim, callback_ctx);                                        \
+    }                                                                                              \
+                                                                                                   \
+    static bool A3_CACHE_PLACE(K, V)(A3_CACHE(K, V) * cache, uint64_t hash, K key, V value,        \
+                                     size_t weight, uint64_t expires, void* callback_ctx) {        \
+        assert(cache);                                                                             \
+                                                                                                   \
+        if (weight > cache->budget)                                                                \
+            return false;                                                                          \
+                                                                                                   \
+        /* A key which is already cached is replaced, and the old entry passed to the callback,    \
+         * before anything else is evicted. A new entry no heavier than the old one takes over its \
+         * slot and its accesses, and the replacement is not itself counted as an access. A        \
+         * heavier one has to make room like any other. */                                         \
+        A3_SSIZE_T existing =                                                                      \
+            A3_CACHE_HT(A3_HT_FIND_INDEX_HASHED, K, V)(&cache->table, hash, key);                  \
+        if (existing >= 0 && weight > cache->table.entries[existing].value.weight) {               \
+            A3_CACHE_REMOVE(K, V)(cache, (size_t)existing, callback_ctx);                          \
+        } else if (existing >= 0) {                                                                \
+            A3_CACHE_ENTRY(K, V)* entry = &cache->table.entries[existing];                         \
+            if (cache->eviction_callback)                                                          \
+                cache->eviction_callback(callback_ctx, &entry->key, &entry->value.value);          \
+            cache->weight -= entry->value.weight - weight;                                         \
+            entry->key           = key;                                                            \
+            entry->value.value   = value;                                                          \
+            entry->value.weight  = weight;                                                         \
+            entry->value.expires = expires;                                                        \
+            if (expires)                                                                           \
+                a3_wheel_schedule(cache->wheel, hash, expires);                                    \
+            return true;                                                                           \
+        }                                                                                          \
+                                                                                                   \
+        if (cache->sketch) {                                                                       \
+            a3_sketch_increment(cache->sketch, hash);                                              \
+            A3_CACHE_ADMIT(K, V)(cache, weight, callback_ctx);                                     \
+        }                                                                                          \
+        /* Entries weigh nothing more than the budget, so evicting them all always makes room. */  \
+        while (cache->table.size >= cache->capacity || cache->weight > cache->budget - weight)     \
             A3_CACHE_EVICT(K, V)(cache, callback_ctx);                                             \
-            if (!A3_HT_INSERT(K, V)(&cache->table, key, value))                                    \
-                A3_PANIC("Unable to insert after eviction.");                                      \
+                                                                                                   \
+        A3_CACHE_SLOT(K, V) slot = { .value   = value,                                             \
+                                     .weight  = weight,                                            \
+                                     .expires = expires,                                           \
+                                     .freq    = 0,                                                 \
+                                     .window  = cache->sketch != NULL };                           \
+        if (!A3_CACHE_HT(A3_HT_INSERT_HASHED, K, V)(&cache->table, hash, key, slot))               \
+            A3_PANIC("Unable to insert after eviction.");                                          \
+        cache->weight += weight;                                                                   \
+        if (cache->sketch) {                                                                       \
+            size_t tail = (cache->window_head + cache->window_queued) % cache->window_capacity;    \
+            cache->window[tail] = hash;                                                            \
+            cache->window_queued++;                                                                \
+            cache->window_size++;                                                                  \
         }                                                                                          \
-        A3_CACHE_FIND(K, V)(cache, key);                                                           \
+        /* The timer refers to the entry by its hash, since entries move, and its key may be freed \
+         * by the time the timer fires. */                                                         \
+        if (expires)                                                                               \
+            a3_wheel_schedule(cache->wheel, hash, expires);                                        \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    bool A3_CACHE_INSERT_HASHED(K, V)(A3_CACHE(K, V) * cache, uint64_t hash, K key, V value,       \
+                                      size_t weight, void* callback_ctx) {                         \
+        return A3_CACHE_PLACE(K, V)(cache, hash, key, value, weight, 0, callback_ctx);             \
+    }                                                                                              \
+                                                                                                   \
+    bool A3_CACHE_INSERT_WEIGHTED(K, V)(A3_CACHE(K, V) * cache, K key, V value, size_t weight,     \
+                                        void* callback_ctx) {                                      \
+        assert(cache);                                                                             \
+        uint64_t hash = A3_CACHE_HT(A3_HT_HASH, K, V)(&cache->table, key);                         \
+        return A3_CACHE_INSERT_HASHED(K, V)(cache, hash, key, value, weight, callback_ctx);        \
+    }                                                                                              \
+                                                                                                   \
+    void A3_CACHE_INSERT(K, V)(A3_CACHE(K, V) * cache, K key, V value, void* callback_ctx) {       \
+        A3_CACHE_INSERT_WEIGHTED(K, V)(cache, key, value, 0, callback_ctx);                        \
+    }                                                                                              \
+                                                                                                   \
+    bool A3_CACHE_INSERT_TTL(K, V)(A3_CACHE(K, V) * cache, K key, V value, size_t weight,          \
+                                   uint64_t now, uint64_t ttl, void* callback_ctx) {               \
+        assert(cache);                                                                             \
+        assert(ttl > 0);                                                                           \
+                                                                                                   \
+        if (!cache->wheel)                                                                         \
+            cache->wheel = a3_wheel_new(now);                                                      \
+        uint64_t hash = A3_CACHE_HT(A3_HT_HASH, K, V)(&cache->table, key);                         \
+        return A3_CACHE_PLACE(K, V)(cache, hash, key, value, weight, now + ttl, callback_ctx);     \
+    }                                                                                              \
+                                                                                                   \
+    /* A timer has fired for the entries with the given hash. Any which have been evicted, or      \
+     * replaced with a later expiry, are left alone. The entries lie between their home slot and   \
+     * the next empty one, and their keys are not compared, so a freed key is never touched. */    \
+    static void A3_CACHE_EXPIRE(K, V)(void* ctx, A3Timer timer) {                                  \
+        A3_CACHE_EXPIRY(K, V)* expiry = (A3_CACHE_EXPIRY(K, V)*)ctx;                               \
+        A3_CACHE(K, V)* cache         = expiry->cache;                                             \
+        A3_CACHE_TABLE(K, V)* table   = &cache->table;                                             \
+        uint64_t now                  = a3_wheel_now(cache->wheel);                                \
+                                                                                                   \
+        size_t i = A3_HT_HOME_MOD(table->cap, timer.id);                                           \
+        while (table->entries[i].hash) {                                                           \
+            A3_CACHE_SLOT(K, V)* slot = &table->entries[i].value;                                  \
+            if (table->entries[i].hash == timer.id && slot->expires && slot->expires <= now)       \
+                /* Deletion shifts the next entry of the run into this slot. */                    \
+                A3_CACHE_REMOVE(K, V)(cache, i, expiry->callback_ctx);                             \
+            else                                                                                   \
+                i = A3_HT_NEXT_MOD(table->cap, i);                                                 \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    void A3_CACHE_ADVANCE(K, V)(A3_CACHE(K, V) * cache, uint64_t now, void* callback_ctx) {        \
+        assert(cache);                                                                             \
+                                                                                                   \
+        if (!cache->wheel)                                                                         \
+            return;                                                                                \
+        A3_CACHE_EXPIRY(K, V) expiry = { cache, callback_ctx };                                    \
+        a3_wheel_advance(cache->wheel, now, A3_CACHE_EXPIRE(K, V), &expiry);                       \
     }                                                                                              \
                                                                                                    \
     void A3_CACHE_CLEAR(K, V)(A3_CACHE(K, V) * cache, void* callback_ctx) {                        \
         assert(cache);                                                                             \
                                                                                                    \
-        for (size_t i = 0; i < cache->table.cap; i++) {                                            \
-            A3_HT_ENTRY(K, V)* entry = &cache->table.entries[i];                                   \
-            if (!entry->hash)                                                                      \
-                continue;                                                                          \
-            if (cache->eviction_callback)                                                          \
-                cache->eviction_callback(callback_ctx, &entry->key, &entry->value);                \
-            A3_HT_DELETE_INDEX(K, V)(&cache->table, i);                                            \
+        for (size_t i = 0; cache->eviction_callback && i < cache->table.cap; i++) {                \
+            A3_CACHE_ENTRY(K, V)* entry = &cache->table.entries[i];                                \
+            if (entry->hash)                                                                       \
+                cache->eviction_callback(callback_ctx, &entry->key, &entry->value.value);          \
         }                                                                                          \
-        memset(cache->accessed, 0,                                                                 \
-               cache->table.cap / A3_CACHE_ENTRIES_PER_BLOCK * sizeof(size_t));                    \
+        A3_CACHE_HT(A3_HT_CLEAR, K, V)(&cache->table);                                             \
+        if (cache->wheel)                                                                          \
+            a3_wheel_clear(cache->wheel);                                                          \
+        cache->weight         = 0;                                                                 \
+        cache->eviction_index = 0;                                                                 \
+        cache->window_queued  = 0;                                                                 \
+        cache->window_size    = 0;                                                                 \
     }
 
 // See HT.h for information on the latter arguments.
 #define A3_CACHE_DEFINE_METHODS(K, V, KEY_BYTES, KEY_SIZE, C)                                      \
-    A3_HT_DEFINE_METHODS(K, V, KEY_BYTES, KEY_SIZE, C)                                             \
+    A3_HT_DEFINE_METHODS(K, A3_CACHE_SLOT(K, V), KEY_BYTES, KEY_SIZE, C)                           \
+    A3_CACHE_DEFINE_METHODS_NOHT(K, V)
+
+// As above, with a custom hash function. See ::A3_HT_DEFINE_METHODS_HASHER.
+#define A3_CACHE_DEFINE_METHODS_HASHER(K, V, H, C)                                                 \
+    A3_HT_DEFINE_METHODS_HASHER(K, A3_CACHE_SLOT(K, V), H, C)                                      \
     A3_CACHE_DEFINE_METHODS_NOHT(K, V)
@@ -0,0 +1,330 @@
+/*
+ * CONCURRENT CACHE -- A type-generic thread-safe CLOCK cache. Uses sharded
+ * caches, with writers serialized per shard and readers protected by a
+ * seqlock.
+ *
+ * Copyright (c) 2022, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in
+ * the project root for details.
+ */
+
+/// \file ccache.h
+/// # Concurrent Cache
+/// A fixed-capacity cache which may be used from many threads at once. To instantiate a cache, use
+/// ::A3_CCACHE_DEFINE_STRUCTS, ::A3_CCACHE_DECLARE_METHODS, and ::A3_CCACHE_DEFINE_METHODS, in the
+/// same way as for a cache from cache.h. These also instantiate `A3_CACHE(K, V)`, which must not be
+/// instantiated separately.
+///
+/// The cache is split into ::A3_CCACHE_SHARDS shards, chosen by the high bits of each key's hash,
+/// and each shard is an `A3_CACHE(K, V)` holding an equal part of the capacity. Eviction is
+/// therefore per shard: the entry evicted to make room for a key is the CLOCK victim of that key's
+/// shard, rather than of the whole cache.
+///
+/// Writers lock only the shard they modify. Readers take no lock: as in cht.h, each shard carries a
+/// sequence number which writers make odd while they work, and a reader retries if it changed
+/// under it. Readers therefore copy values out rather than returning pointers into the cache.
+/// Recording an access also needs the shard, so a reader takes it only if the entry's count would
+/// change and no writer holds or has held the shard since the lookup. Otherwise the access is
+/// dropped rather than waited for. Frequently used entries saturate their counts quickly, so hits
+/// on them are plain reads. Threads which find a shard busy spin briefly, then yield (see
+/// ::A3_SPINS).
+///
+/// The eviction callback is called with the same arguments as for `A3_CACHE(K, V)`, while the
+/// shard's lock is held, so it must not use the cache. A reader may still hold a copy of an
+/// evicted value, so if values point to other memory, the callback should release a reference
+/// (see rc.h) rather than free it outright. The comparator has the same obligations as for cht.h.
+
+#pragma once
+
+#include <a3/shim/atomic.h>
+#include <a3/shim/thread.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <a3/cache.h>
+#include <a3/cpp.h>
+#include <a3/ht.h>
+#include <a3/types.h>
+#include <a3/util.h>
+
+#ifndef A3_CCACHE_SHARD_BITS
+/// The base-2 logarithm of the number of shards in a concurrent cache. Can be overridden.
+#define A3_CCACHE_SHARD_BITS 4
+#endif
+
+/// The number of shards in a concurrent cache.
+#define A3_CCACHE_SHARDS (1ULL << A3_CCACHE_SHARD_BITS)
+
+/// The concurrent cache type.
+#define A3_CCACHE(K, V) struct K##V##A3CCache
+
+#ifndef DOXYGEN
+#define A3_CCACHE_SHARD(K, V) struct K##V##A3CCacheShard
+
+#define A3_CCACHE_SHARD_INDEX(HASH) ((size_t)((HASH) >> (64 - A3_CCACHE_SHARD_BITS)))
+#endif
+
+/// Define all types required for the given concurrent cache.
+#define A3_CCACHE_DEFINE_STRUCTS(K, V)                                                             \
+    A3_CACHE_DEFINE_STRUCTS(K, V)                                                                  \
+                                                                                                   \
+    A3_H_BEGIN                                                                                     \
+                                                                                                   \
+    A3_CCACHE_SHARD(K, V) {                                                                        \
+        A3_ATOMIC(size_t) seq;                                                                     \
+        A3_CACHE(K, V) cache;                                                                      \
+        /* Keep the shards' sequence numbers and tables on separate cache lines. */                \
+        uint8_t pad[64];                                                                           \
+    };                                                                                             \
+                                                                                                   \
+    A3_CCACHE(K, V) {                                                                              \
+        size_t capacity;                                                                           \
+        A3_CCACHE_SHARD(K, V) shards[A3_CCACHE_SHARDS];                                            \
+    };                                                                                             \
+                                                                                                   \
+    A3_H_END
+
+#ifndef DOXYGEN
+#define A3_CCACHE_HASH(K, V)     K##V##_a3_ccache_hash
+#define A3_CCACHE_LOOKUP(K, V)   K##V##_a3_ccache_lookup
+#define A3_CCACHE_LOCK(K, V)     K##V##_a3_ccache_lock
+#define A3_CCACHE_TRY_LOCK(K, V) K##V##_a3_ccache_try_lock
+#define A3_CCACHE_UNLOCK(K, V)   K##V##_a3_ccache_unlock
+#endif
+
+///
+///     void A3_CCACHE_INIT(K, V)(A3_CCACHE(K, V)*, size_t capacity, A3_CACHE_EVICT_CB(K, V));
+///
+/// Initialize a new concurrent cache. The capacity is divided evenly between the shards, rounding
+/// up. NOT THREAD SAFE.
+#define A3_CCACHE_INIT(K, V) K##V##_a3_ccache_init
+
+///
+///     A3_CCACHE(K, V)* A3_CCACHE_NEW(K, V)(size_t capacity, A3_CACHE_EVICT_CB(K, V));
+///
+/// Allocate and initialize a new concurrent cache.
+#define A3_CCACHE_NEW(K, V) K##V##_a3_ccache_new
+
+///
+///     void A3_CCACHE_DESTROY(K, V)(A3_CCACHE(K, V)*);
+///
+/// Destroy a concurrent cache, deallocating all owned memory. The eviction callback is not called.
+/// NOT THREAD SAFE.
+#define A3_CCACHE_DESTROY(K, V) K##V##_a3_ccache_destroy
+
+///
+///     void A3_CCACHE_FREE(K, V)(A3_CCACHE(K, V)*);
+///
+/// Free a concurrent cache, deallocating it and all owned memory. NOT THREAD SAFE.
+#define A3_CCACHE_FREE(K, V) K##V##_a3_ccache_free
+
+///
+///     bool A3_CCACHE_FIND(K, V)(A3_CCACHE(K, V)*, K, V* out);
+///
+/// Find the entry (if any) with the given key, and record an access to it. If it exists, returns
+/// `true` and copies its value to `out` (which may be `NULL`). Never blocks.
+#define A3_CCACHE_FIND(K, V) K##V##_a3_ccache_find
+
+///
+///     bool A3_CCACHE_INSERT(K, V)(A3_CCACHE(K, V)*, K, V, void* callback_ctx);
+///
+/// Insert an entry, evicting another from the same shard if it is full. Returns `false`, leaving
+/// the cache unchanged, if an entry with the same key already exists, as it may when several
+/// threads miss on the same key at once.
+#define A3_CCACHE_INSERT(K, V) K##V##_a3_ccache_insert
+
+///
+///     void A3_CCACHE_CLEAR(K, V)(A3_CCACHE(K, V)*, void* callback_ctx);
+///
+/// Evict every entry, one shard at a time.
+#define A3_CCACHE_CLEAR(K, V) K##V##_a3_ccache_clear
+
+///
+///     size_t A3_CCACHE_SIZE(K, V)(A3_CCACHE(K, V)*);
+///
+/// Get the number of entries in the cache. If writers are active, this is only approximate.
+#define A3_CCACHE_SIZE(K, V) K##V##_a3_ccache_size
+
+/// Declare all methods for the given concurrent cache. The declarations from
+/// ::A3_CCACHE_DEFINE_STRUCTS must be visible.
+#define A3_CCACHE_DECLARE_METHODS(K, V)                                                            \
+    A3_CACHE_DECLARE_METHODS(K, V)                                                                 \
+                                                                                                   \
+    A3_H_BEGIN                                                                                     \
+    void A3_CCACHE_INIT(K, V)(A3_CCACHE(K, V)*, size_t capacity, A3_CACHE_EVICT_CB(K, V));         \
+    A3_CCACHE(K, V) * A3_CCACHE_NEW(K, V)(size_t capacity, A3_CACHE_EVICT_CB(K, V));               \
+    void A3_CCACHE_DESTROY(K, V)(A3_CCACHE(K, V)*);                                                \
+    void A3_CCACHE_FREE(K, V)(A3_CCACHE(K, V)*);                                                   \
+                                                                                                   \
+    bool   A3_CCACHE_FIND(K, V)(A3_CCACHE(K, V)*, K, V*);                                          \
+    bool   A3_CCACHE_INSERT(K, V)(A3_CCACHE(K, V)*, K, V, void* callback_ctx);                     \
+    void   A3_CCACHE_CLEAR(K, V)(A3_CCACHE(K, V)*, void* callback_ctx);                            \
+    size_t A3_CCACHE_SIZE(K, V)(A3_CCACHE(K, V)*);                                                 \
+    A3_H_END
+
+#ifndef DOXYGEN
+#define A3_CCACHE_DEFINE_METHODS_NOCACHE(K, V)                                                     \
+    /* Every shard shares the hash key of the first, so one hash picks both shard and slot. */     \
+    static uint64_t A3_CCACHE_HASH(K, V)(A3_CCACHE(K, V) * cache, K key) {                         \
+        assert(cache);                                                                             \
+        return A3_CACHE_HT(A3_HT_HASH, K, V)(&cache->shards[0].cache.table, key);                  \
+    }                                                                                              \
+                                                                                                   \
+    /* Writers take the shard by making its sequence number odd. */                                \
+    static bool A3_CCACHE_TRY_LOCK(K, V)(A3_CCACHE_SHARD(K, V) * shard, size_t seq) {              \
+        assert(shard);                                                                             \
+                                                                                                   \
+        if ((seq & 1) || !A3_ATOMIC_COMPARE_EXCHANGE_WEAK(&shard->seq, &seq, seq + 1, A3_ACQUIRE,  \
+                                                          A3_RELAXED))                             \
+            return false;                                                                          \
+        /* Readers which see any of the following writes must also see the odd sequence number. */ \
+        A3_ATOMIC_FENCE(A3_RELEASE);                                                               \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    static void A3_CCACHE_LOCK(K, V)(A3_CCACHE_SHARD(K, V) * shard) {                              \
+        assert(shard);                                                                             \
+                                                                                                   \
+        size_t spins = 0;                                                                          \
+        while (!A3_CCACHE_TRY_LOCK(K, V)(shard, A3_ATOMIC_LOAD(&shard->seq, A3_RELAXED)))          \
+            a3_shim_backoff(&spins);                                                               \
+    }                                                                                              \
+                                                                                                   \
+    static void A3_CCACHE_UNLOCK(K, V)(A3_CCACHE_SHARD(K, V) * shard) {                            \
+        assert(shard);                                                                             \
+        A3_ATOMIC_FETCH_ADD(&shard->seq, 1, A3_RELEASE);                                           \
+    }                                                                                              \
+                                                                                                   \
+    void A3_CCACHE_INIT(K, V)(A3_CCACHE(K, V) * cache, size_t capacity,                            \
+                              A3_CACHE_EVICT_CB(K, V) eviction_callback) {                         \
+        assert(cache);                                                                             \
+        assert(capacity > 0);                                                                      \
+                                                                                                   \
+        memset(cache, 0, sizeof(*cache));                                                          \
+        cache->capacity       = capacity;                                                          \
+        size_t shard_capacity = (capacity + A3_CCACHE_SHARDS - 1) / A3_CCACHE_SHARDS;              \
+        for (size_t i = 0; i < A3_CCACHE_SHARDS; i++) {                                            \
+            A3_ATOMIC_INIT(&cache->shards[i].seq, 0);                                              \
+            A3_CACHE_INIT_KEYED(K, V)                                                              \
+            (&cache->shards[i].cache, shard_capacity, eviction_callback,                           \
+             i ? A3_HT_HASH_KEY(&cache->shards[0].cache.table) : A3_HT_NO_HASH_KEY);               \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    A3_CCACHE(K, V) *                                                                              \
+        A3_CCACHE_NEW(K, V)(size_t capacity, A3_CACHE_EVICT_CB(K, V) eviction_callback) {          \
+        A3_CCACHE(K, V)* ret = NULL;                                                               \
+        A3_UNWRAPN(ret, (A3_CCACHE(K, V)*)calloc(1, sizeof(A3_CCACHE(K, V))));                     \
+        A3_CCACHE_INIT(K, V)(ret, capacity, eviction_callback);                                    \
+        return ret;                                                                                \
+    }                                                                                              \
+                                                                                                   \
+    void A3_CCACHE_DESTROY(K, V)(A3_CCACHE(K, V) * cache) {                                        \
+        assert(cache);                                                                             \
+                                                                                                   \
+        for (size_t i = 0; i < A3_CCACHE_SHARDS; i++)                                              \
+            A3_CACHE_DESTROY(K, V)(&cache->shards[i].cache);                                       \
+    }                                                                                              \
+                                                                                                   \
+    void A3_CCACHE_FREE(K, V)(A3_CCACHE(K, V) * cache) {                                           \
+        assert(cache);                                                                             \
+        A3_CCACHE_DESTROY(K, V)(cache);                                                            \
+        free(cache);                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    bool A3_CCACHE_FIND(K, V)(A3_CCACHE(K, V) * cache, K key, V * out) {                           \
+        assert(cache);                                                                             \
+                                                                                                   \
+        uint64_t               hash  = A3_CCACHE_HASH(K, V)(cache, key);                           \
+        A3_CCACHE_SHARD(K, V)* shard = &cache->shards[A3_CCACHE_SHARD_INDEX(hash)];                \
+        A3_CACHE_TABLE(K, V)* table  = &shard->cache.table;                                        \
+        A3_CACHE_SLOT(K, V)   slot;                                                                \
+        memset(&slot, 0, sizeof(slot));                                                            \
+                                                                                                   \
+        for (size_t spins = 0;; a3_shim_backoff(&spins)) {                                         \
+            size_t seq = A3_ATOMIC_LOAD(&shard->seq, A3_ACQUIRE);                                  \
+            if (seq & 1)                                                                           \
+                continue;                                                                          \
+                                                                                                   \
+            /* The table never grows, so its array is the same one writers are modifying. Probes   \
+             * are not counted, since the table's counters belong to writers. */                   \
+            A3_SSIZE_T i = A3_CCACHE_LOOKUP(K, V)(table->entries, table->cap, hash, key, NULL);    \
+            if (i >= 0)                                                                            \
+                slot = table->entries[i].value;                                                    \
+                                                                                                   \
+            /* Anything read above is only valid if no writer has started since. */                \
+            A3_ATOMIC_FENCE(A3_ACQUIRE);                                                           \
+            if (A3_ATOMIC_LOAD(&shard->seq, A3_RELAXED) != seq)                                    \
+                continue;                                                                          \
+                                                                                                   \
+            if (i < 0)                                                                             \
+                return false;                                                                      \
+                                                                                                   \
+            /* If the shard is unchanged since the lookup, the entry is still at i. */             \
+            if (slot.freq < A3_CACHE_MAX_FREQ && A3_CCACHE_TRY_LOCK(K, V)(shard, seq)) {           \
+                table->entries[i].value.freq = (uint8_t)(slot.freq + 1);                           \
+                A3_CCACHE_UNLOCK(K, V)(shard);                                                     \
+            }                                                                                      \
+                                                                                                   \
+            if (out)                                                                               \
+                *out = slot.value;                                                                 \
+            return true;                                                                           \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    bool A3_CCACHE_INSERT(K, V)(A3_CCACHE(K, V) * cache, K key, V value, void* callback_ctx) {     \
+        assert(cache);                                                                             \
+                                                                                                   \
+        uint64_t               hash  = A3_CCACHE_HASH(K, V)(cache, key);                           \
+        A3_CCACHE_SHARD(K, V)* shard = &cache->shards[A3_CCACHE_SHARD_INDEX(hash)];                \
+        A3_CCACHE_LOCK(K, V)(shard);                                                               \
+                                                                                                   \
+        bool ret =                                                                                 \
+            A3_CACHE_HT(A3_HT_FIND_INDEX_HASHED, K, V)(&shard->cache.table, hash, key) < 0;        \
+        if (ret)                                                                                   \
+            A3_CACHE_INSERT_HASHED(K, V)(&shard->cache, hash, key, value, 0, callback_ctx);        \
+                                                                                                   \
+        A3_CCACHE_UNLOCK(K, V)(shard);                                                             \
+        return ret;                                                                                \
+    }                                                                                              \
+                                                                                                   \
+    void A3_CCACHE_CLEAR(K, V)(A3_CCACHE(K, V) * cache, void* callback_ctx) {                      \
+        assert(cache);                                                                             \
+                                                                                                   \
+        for (size_t i = 0; i < A3_CCACHE_SHARDS; i++) {                                            \
+            A3_CCACHE_LOCK(K, V)(&cache->shards[i]);                                               \
+            A3_CACHE_CLEAR(K, V)(&cache->shards[i].cache, callback_ctx);                           \
+            A3_CCACHE_UNLOCK(K, V)(&cache->shards[i]);                                             \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    size_t A3_CCACHE_SIZE(K, V)(A3_CCACHE(K, V) * cache) {                                         \
+        assert(cache);                                                                             \
+                                                                                                   \
+        size_t ret = 0;                                                                            \
+        for (size_t i = 0; i < A3_CCACHE_SHARDS; i++) {                                            \
+            A3_CCACHE_LOCK(K, V)(&cache->shards[i]);                                               \
+            ret += cache->shards[i].cache.table.size;                                              \
+            A3_CCACHE_UNLOCK(K, V)(&cache->shards[i]);                                             \
+        }                                                                                          \
+        return ret;                                                                                \
+    }
+#endif
+
+/// Define methods with HighwayHash as the hash function. See ::A3_HT_DEFINE_METHODS for the meaning
+/// of the arguments.
+#define A3_CCACHE_DEFINE_METHODS(K, V, KEY_BYTES, KEY_SIZE, C)                                     \
+    A3_CACHE_DEFINE_METHODS(K, V, KEY_BYTES, KEY_SIZE, C)                                          \
+    A3_HT_DEFINE_RH_LOOKUP_(K, A3_CACHE_ENTRY(K, V), K##V##_a3_ccache, C, MOD)                     \
+    A3_CCACHE_DEFINE_METHODS_NOCACHE(K, V)
+
+/// Define methods with a custom hash function. See ::A3_HT_DEFINE_METHODS_HASHER.
+#define A3_CCACHE_DEFINE_METHODS_HASHER(K, V, H, C)                                                \
+    A3_CACHE_DEFINE_METHODS_HASHER(K, V, H, C)                                                     \
+    A3_HT_DEFINE_RH_LOOKUP_(K, A3_CACHE_ENTRY(K, V), K##V##_a3_ccache, C, MOD)                     \
+    A3_CCACHE_DEFINE_METHODS_NOCACHE(K, V)
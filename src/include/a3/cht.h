@@ -0,0 +1,399 @@
+/*
+ * CONCURRENT HASH TABLE -- A type-generic thread-safe hash table. Uses sharded
+ * Robin Hood tables, with writers serialized per shard and readers protected
+ * by a seqlock.
+ *
+ * Copyright (c) 2022, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in
+ * the project root for details.
+ */
+
+/// \file cht.h
+/// # Concurrent Hash Table
+/// A type-generic hash table which may be used from many threads at once. To instantiate a table,
+/// use ::A3_CHT_DEFINE_STRUCTS, ::A3_CHT_DECLARE_METHODS, and ::A3_CHT_DEFINE_METHODS, in the same
+/// way as for a hash table from ht.h.
+///
+/// The table is split into ::A3_CHT_SHARDS shards, chosen by the high bits of each key's hash, and
+/// each shard is a Robin Hood table with the same layout as the default ::A3_HT. Writers lock only
+/// the shard they modify. Readers take no lock at all: each shard carries a sequence number which
+/// writers make odd while they work, and a reader simply retries if the sequence number changed
+/// under it. Readers therefore copy values out rather than returning pointers into the table.
+/// Threads which find a shard busy spin briefly, then yield (see ::A3_SPINS).
+///
+/// When a shard grows, its previous array is retired rather than freed, since a reader may still
+/// be probing it. Retired arrays total less than the live arrays, and are freed by
+/// ::A3_CHT_RECLAIM or ::A3_CHT_DESTROY.
+///
+/// Since a reader may observe an entry while it is being written, the comparator must tolerate
+/// being handed a key which is being overwritten. For keys which point to other memory (such as
+/// strings), that memory must remain readable for as long as a reader could observe the key.
+
+#pragma once
+
+#include <a3/shim/atomic.h>
+#include <a3/shim/thread.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <a3/alloc.h>
+#include <a3/cpp.h>
+#include <a3/ht.h>
+#include <a3/types.h>
+#include <a3/util.h>
+
+#ifndef A3_CHT_SHARD_BITS
+/// The base-2 logarithm of the number of shards in a concurrent table. Can be overridden.
+#define A3_CHT_SHARD_BITS 6
+#endif
+
+/// The number of shards in a concurrent table.
+#define A3_CHT_SHARDS (1ULL << A3_CHT_SHARD_BITS)
+
+#ifndef A3_CHT_SHARD_INITIAL_CAP
+/// The initial capacity of each shard. Must be a power of two. Can be overridden.
+#define A3_CHT_SHARD_INITIAL_CAP 16ULL
+#endif
+
+/// The concurrent hash table type.
+#define A3_CHT(K, V) struct K##V##A3CHT
+
+#ifndef DOXYGEN
+#define A3_CHT_ENTRY(K, V) struct K##V##A3CHTEntry
+#define A3_CHT_ARRAY(K, V) struct K##V##A3CHTArray
+#define A3_CHT_SHARD(K, V) struct K##V##A3CHTShard
+
+// The high bits of the hash choose the shard, and the low bits the slot within it.
+#define A3_CHT_SHARD_INDEX(HASH) ((size_t)((HASH) >> (64 - A3_CHT_SHARD_BITS)))
+#endif
+
+/// Define all types required for the given concurrent table.
+#define A3_CHT_DEFINE_STRUCTS(K, V)                                                                \
+    A3_H_BEGIN                                                                                     \
+                                                                                                   \
+    A3_CHT_ENTRY(K, V) {                                                                           \
+        K        key;                                                                              \
+        V        value;                                                                            \
+        uint64_t hash;                                                                             \
+    };                                                                                             \
+                                                                                                   \
+    A3_CHT_ARRAY(K, V) {                                                                           \
+        size_t cap;                                                                                \
+        A3_CHT_ARRAY(K, V) * retired;                                                              \
+        A3_CHT_ENTRY(K, V) * entries;                                                              \
+    };                                                                                             \
+                                                                                                   \
+    /* Keep shards on separate cache lines, and off the line holding the hash key. */              \
+    A3_CHT_SHARD(K, V) {                                                                           \
+        A3_ALIGNAS(64) A3_ATOMIC(size_t) seq;                                                      \
+        A3_ATOMIC(void*) array;                                                                    \
+        A3_ATOMIC(size_t) size;                                                                    \
+    };                                                                                             \
+                                                                                                   \
+    A3_CHT(K, V) {                                                                                 \
+        uint64_t hash_key[A3_HT_HASH_KEY_SIZE];                                                    \
+        A3_CHT_SHARD(K, V) shards[A3_CHT_SHARDS];                                                  \
+    };                                                                                             \
+                                                                                                   \
+    A3_H_END
+
+#ifndef DOXYGEN
+#define A3_CHT_HASH(K, V)         K##V##_a3_cht_hash
+#define A3_CHT_DEFAULT_HASH(K, V) K##V##_a3_cht_default_hash
+#define A3_CHT_LOOKUP(K, V)       K##V##_a3_cht_lookup
+#define A3_CHT_PLACE(K, V)        K##V##_a3_cht_place
+#define A3_CHT_SHIFT_BACK(K, V)   K##V##_a3_cht_shift_back
+#define A3_CHT_ARRAY_NEW(K, V)    K##V##_a3_cht_array_new
+#define A3_CHT_LOCK(K, V)         K##V##_a3_cht_lock
+#define A3_CHT_UNLOCK(K, V)       K##V##_a3_cht_unlock
+#define A3_CHT_GROW(K, V)         K##V##_a3_cht_grow
+#endif
+
+///
+///     void A3_CHT_INIT(K, V)(A3_CHT(K, V)*, uint8_t * key);
+///
+/// Initialize a new concurrent table. `key` should be a pointer to the hash key, or the value
+/// `A3_HT_NO_HASH_KEY`. NOT THREAD SAFE.
+#define A3_CHT_INIT(K, V) K##V##_a3_cht_init
+
+///
+///     A3_CHT(K, V)* A3_CHT_NEW(K, V)(uint8_t * key);
+///
+/// Allocate and initialize a new concurrent table.
+#define A3_CHT_NEW(K, V) K##V##_a3_cht_new
+
+///
+///     void A3_CHT_DESTROY(K, V)(A3_CHT(K, V)*);
+///
+/// Destroy a concurrent table, deallocating all owned memory. NOT THREAD SAFE. Ensure all other
+/// users are gone before calling.
+#define A3_CHT_DESTROY(K, V) K##V##_a3_cht_destroy
+
+///
+///     void A3_CHT_FREE(K, V)(A3_CHT(K, V)*);
+///
+/// Free a concurrent table, deallocating it and all owned memory. NOT THREAD SAFE.
+#define A3_CHT_FREE(K, V) K##V##_a3_cht_free
+
+///
+///     void A3_CHT_RECLAIM(K, V)(A3_CHT(K, V)*);
+///
+/// Free the arrays retired by shards which have grown. Writers may run concurrently, but readers
+/// must not.
+#define A3_CHT_RECLAIM(K, V) K##V##_a3_cht_reclaim
+
+///
+///     bool A3_CHT_INSERT(K, V)(A3_CHT(K, V)*, K, V);
+///
+/// Insert an entry into the table. Returns `false`, leaving the table unchanged, if an entry with
+/// the same key already exists.
+#define A3_CHT_INSERT(K, V) K##V##_a3_cht_insert
+
+///
+///     bool A3_CHT_FIND(K, V)(A3_CHT(K, V)*, K, V* out);
+///
+/// Find the entry (if any) with the given key. If it exists, returns `true` and copies its value to
+/// `out` (which may be `NULL`). Never blocks other readers or writers.
+#define A3_CHT_FIND(K, V) K##V##_a3_cht_find
+
+///
+///     bool A3_CHT_DELETE(K, V)(A3_CHT(K, V)*, K);
+///
+/// Delete the entry with the specified key. Returns `true` if such an entry existed.
+#define A3_CHT_DELETE(K, V) K##V##_a3_cht_delete
+
+///
+///     size_t A3_CHT_SIZE(K, V)(A3_CHT(K, V)*);
+///
+/// Get the number of entries in the table. If writers are active, this is only approximate.
+#define A3_CHT_SIZE(K, V) K##V##_a3_cht_size
+
+/// Declare all methods for the given concurrent table. The declarations from
+/// ::A3_CHT_DEFINE_STRUCTS must be visible.
+#define A3_CHT_DECLARE_METHODS(K, V)                                                               \
+    A3_H_BEGIN                                                                                     \
+    void A3_CHT_INIT(K, V)(A3_CHT(K, V)*, uint8_t * key);                                          \
+    A3_CHT(K, V) * A3_CHT_NEW(K, V)(uint8_t * key);                                                \
+    void A3_CHT_DESTROY(K, V)(A3_CHT(K, V)*);                                                      \
+    void A3_CHT_FREE(K, V)(A3_CHT(K, V)*);                                                         \
+    void A3_CHT_RECLAIM(K, V)(A3_CHT(K, V)*);                                                      \
+                                                                                                   \
+    bool   A3_CHT_INSERT(K, V)(A3_CHT(K, V)*, K, V);                                               \
+    bool   A3_CHT_FIND(K, V)(A3_CHT(K, V)*, K, V*);                                                \
+    bool   A3_CHT_DELETE(K, V)(A3_CHT(K, V)*, K);                                                  \
+    size_t A3_CHT_SIZE(K, V)(A3_CHT(K, V)*);                                                       \
+    A3_H_END
+
+/// Define methods with a custom hash function. H has the signature:
+///
+///     uint64_t H(A3_CHT(K, V)* table, K key);
+///
+/// See ::A3_HT_DEFINE_METHODS_HASHER for information on the comparator C.
+#define A3_CHT_DEFINE_METHODS_HASHER(K, V, H, C)                                                   \
+    static uint64_t A3_CHT_HASH(K, V)(A3_CHT(K, V) * table, K key) {                               \
+        assert(table);                                                                             \
+        uint64_t ret = H(table, key);                                                              \
+        return ret ? ret : 1;                                                                      \
+    }                                                                                              \
+                                                                                                   \
+    A3_HT_DEFINE_RH_PRIMITIVES_(K, A3_CHT_ENTRY(K, V), K##V##_a3_cht, C, POW2)                     \
+                                                                                                   \
+    static A3_CHT_ARRAY(K, V) * A3_CHT_ARRAY_NEW(K, V)(size_t cap) {                               \
+        A3_CHT_ARRAY(K, V)* ret = NULL;                                                            \
+        A3_UNWRAPN(ret, (A3_CHT_ARRAY(K, V)*)calloc(1, sizeof(A3_CHT_ARRAY(K, V))));               \
+        ret->cap = cap;                                                                            \
+        A3_UNWRAPN(ret->entries, (A3_CHT_ENTRY(K, V)*)calloc(cap, sizeof(A3_CHT_ENTRY(K, V))));    \
+        return ret;                                                                                \
+    }                                                                                              \
+                                                                                                   \
+    /* Writers take the shard by making its sequence number odd. */                                \
+    static void A3_CHT_LOCK(K, V)(A3_CHT_SHARD(K, V) * shard) {                                    \
+        assert(shard);                                                                             \
+                                                                                                   \
+        size_t seq   = A3_ATOMIC_LOAD(&shard->seq, A3_RELAXED);                                    \
+        size_t spins = 0;                                                                          \
+        while ((seq & 1) || !A3_ATOMIC_COMPARE_EXCHANGE_WEAK(&shard->seq, &seq, seq + 1,           \
+                                                             A3_ACQUIRE, A3_RELAXED)) {            \
+            a3_shim_backoff(&spins);                                                               \
+            seq = A3_ATOMIC_LOAD(&shard->seq, A3_RELAXED);                                         \
+        }                                                                                          \
+        /* Readers which see any of the following writes must also see the odd sequence number. */ \
+        A3_ATOMIC_FENCE(A3_RELEASE);                                                               \
+    }                                                                                              \
+                                                                                                   \
+    static void A3_CHT_UNLOCK(K, V)(A3_CHT_SHARD(K, V) * shard) {                                  \
+        assert(shard);                                                                             \
+        A3_ATOMIC_FETCH_ADD(&shard->seq, 1, A3_RELEASE);                                           \
+    }                                                                                              \
+                                                                                                   \
+    static A3_CHT_ARRAY(K, V) *                                                                    \
+        A3_CHT_GROW(K, V)(A3_CHT_SHARD(K, V) * shard, A3_CHT_ARRAY(K, V) * array) {                \
+        assert(shard);                                                                             \
+        assert(array);                                                                             \
+                                                                                                   \
+        A3_CHT_ARRAY(K, V)* ret = A3_CHT_ARRAY_NEW(K, V)(array->cap * 2);                          \
+        for (size_t i = 0; i < array->cap; i++)                                                    \
+            if (array->entries[i].hash)                                                            \
+                A3_CHT_PLACE(K, V)(ret->entries, ret->cap, array->entries[i], NULL);               \
+                                                                                                   \
+        /* Readers may still be probing the old array. */                                          \
+        ret->retired = array;                                                                      \
+        A3_ATOMIC_STORE(&shard->array, (void*)ret, A3_RELEASE);                                    \
+        return ret;                                                                                \
+    }                                                                                              \
+                                                                                                   \
+    void A3_CHT_INIT(K, V)(A3_CHT(K, V) * table, uint8_t * key) {                                  \
+        assert(table);                                                                             \
+                                                                                                   \
+        memset(table, 0, sizeof(*table));                                                          \
+        a3_ht_init_hash_key(table->hash_key, key);                                                 \
+        for (size_t i = 0; i < A3_CHT_SHARDS; i++) {                                               \
+            A3_ATOMIC_INIT(&table->shards[i].seq, 0);                                              \
+            A3_ATOMIC_INIT(&table->shards[i].size, 0);                                             \
+            A3_ATOMIC_INIT(&table->shards[i].array,                                                \
+                           (void*)A3_CHT_ARRAY_NEW(K, V)(A3_CHT_SHARD_INITIAL_CAP));               \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    A3_CHT(K, V) * A3_CHT_NEW(K, V)(uint8_t * key) {                                               \
+        A3_CHT(K, V)* ret = NULL;                                                                  \
+        A3_UNWRAPN(ret, (A3_CHT(K, V)*)a3_large_aligned_alloc(sizeof(A3_CHT(K, V)), 64));          \
+        A3_CHT_INIT(K, V)(ret, key);                                                               \
+        return ret;                                                                                \
+    }                                                                                              \
+                                                                                                   \
+    void A3_CHT_RECLAIM(K, V)(A3_CHT(K, V) * table) {                                              \
+        assert(table);                                                                             \
+                                                                                                   \
+        for (size_t i = 0; i < A3_CHT_SHARDS; i++) {                                               \
+            A3_CHT_SHARD(K, V)* shard = &table->shards[i];                                         \
+            A3_CHT_LOCK(K, V)(shard);                                                              \
+            A3_CHT_ARRAY(K, V)* array =                                                            \
+                (A3_CHT_ARRAY(K, V)*)A3_ATOMIC_LOAD(&shard->array, A3_RELAXED);                    \
+            while (array->retired) {                                                               \
+                A3_CHT_ARRAY(K, V)* retired = array->retired;                                      \
+                array->retired              = retired->retired;                                    \
+                free(retired->entries);                                                            \
+                free(retired);                                                                     \
+            }                                                                                      \
+            A3_CHT_UNLOCK(K, V)(shard);                                                            \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    void A3_CHT_DESTROY(K, V)(A3_CHT(K, V) * table) {                                              \
+        assert(table);                                                                             \
+                                                                                                   \
+        A3_CHT_RECLAIM(K, V)(table);                                                               \
+        for (size_t i = 0; i < A3_CHT_SHARDS; i++) {                                               \
+            A3_CHT_ARRAY(K, V)* array =                                                            \
+                (A3_CHT_ARRAY(K, V)*)A3_ATOMIC_LOAD(&table->shards[i].array, A3_RELAXED);          \
+            free(array->entries);                                                                  \
+            free(array);                                                                           \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    void A3_CHT_FREE(K, V)(A3_CHT(K, V) * table) {                                                 \
+        assert(table);                                                                             \
+        A3_CHT_DESTROY(K, V)(table);                                                               \
+        a3_large_aligned_free(table, sizeof(A3_CHT(K, V)));                                        \
+    }                                                                                              \
+                                                                                                   \
+    bool A3_CHT_INSERT(K, V)(A3_CHT(K, V) * table, K key, V value) {                               \
+        assert(table);                                                                             \
+                                                                                                   \
+        uint64_t            hash  = A3_CHT_HASH(K, V)(table, key);                                 \
+        A3_CHT_SHARD(K, V)* shard = &table->shards[A3_CHT_SHARD_INDEX(hash)];                      \
+        A3_CHT_LOCK(K, V)(shard);                                                                  \
+        A3_CHT_ARRAY(K, V)* array =                                                                \
+            (A3_CHT_ARRAY(K, V)*)A3_ATOMIC_LOAD(&shard->array, A3_RELAXED);                        \
+                                                                                                   \
+        bool ret = A3_CHT_LOOKUP(K, V)(array->entries, array->cap, hash, key, NULL) < 0;           \
+        if (ret) {                                                                                 \
+            size_t size = A3_ATOMIC_LOAD(&shard->size, A3_RELAXED);                                \
+            if (size * 100 >= array->cap * A3_HT_LOAD_FACTOR)                                      \
+                array = A3_CHT_GROW(K, V)(shard, array);                                           \
+                                                                                                   \
+            A3_CHT_ENTRY(K, V) entry = { key, value, hash };                                       \
+            A3_CHT_PLACE(K, V)(array->entries, array->cap, entry, NULL);                           \
+            A3_ATOMIC_STORE(&shard->size, size + 1, A3_RELAXED);                                   \
+        }                                                                                          \
+                                                                                                   \
+        A3_CHT_UNLOCK(K, V)(shard);                                                                \
+        return ret;                                                                                \
+    }                                                                                              \
+                                                                                                   \
+    bool A3_CHT_FIND(K, V)(A3_CHT(K, V) * table, K key, V * out) {                                 \
+        assert(table);                                                                             \
+                                                                                                   \
+        uint64_t            hash  = A3_CHT_HASH(K, V)(table, key);                                 \
+        A3_CHT_SHARD(K, V)* shard = &table->shards[A3_CHT_SHARD_INDEX(hash)];                      \
+        V                   value;                                                                 \
+        memset(&value, 0, sizeof(value));                                                          \
+                                                                                                   \
+        for (size_t spins = 0;; a3_shim_backoff(&spins)) {                                         \
+            size_t seq = A3_ATOMIC_LOAD(&shard->seq, A3_ACQUIRE);                                  \
+            if (seq & 1)                                                                           \
+                continue;                                                                          \
+                                                                                                   \
+            A3_CHT_ARRAY(K, V)* array =                                                            \
+                (A3_CHT_ARRAY(K, V)*)A3_ATOMIC_LOAD(&shard->array, A3_ACQUIRE);                    \
+            A3_SSIZE_T i = A3_CHT_LOOKUP(K, V)(array->entries, array->cap, hash, key, NULL);       \
+            if (i >= 0)                                                                            \
+                value = array->entries[i].value;                                                   \
+                                                                                                   \
+            /* Anything read above is only valid if no writer has started since. */                \
+            A3_ATOMIC_FENCE(A3_ACQUIRE);                                                           \
+            if (A3_ATOMIC_LOAD(&shard->seq, A3_RELAXED) != seq)                                    \
+                continue;                                                                          \
+                                                                                                   \
+            if (i < 0)                                                                             \
+                return false;                                                                      \
+            if (out)                                                                               \
+                *out = value;                                                                      \
+            return true;                                                                           \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    bool A3_CHT_DELETE(K, V)(A3_CHT(K, V) * table, K key) {                                        \
+        assert(table);                                                                             \
+                                                                                                   \
+        uint64_t            hash  = A3_CHT_HASH(K, V)(table, key);                                 \
+        A3_CHT_SHARD(K, V)* shard = &table->shards[A3_CHT_SHARD_INDEX(hash)];                      \
+        A3_CHT_LOCK(K, V)(shard);                                                                  \
+        A3_CHT_ARRAY(K, V)* array =                                                                \
+            (A3_CHT_ARRAY(K, V)*)A3_ATOMIC_LOAD(&shard->array, A3_RELAXED);                        \
+                                                                                                   \
+        A3_SSIZE_T i = A3_CHT_LOOKUP(K, V)(array->entries, array->cap, hash, key, NULL);           \
+        if (i >= 0) {                                                                              \
+            A3_CHT_SHIFT_BACK(K, V)(array->entries, array->cap, (size_t)i);                        \
+            A3_ATOMIC_STORE(&shard->size, A3_ATOMIC_LOAD(&shard->size, A3_RELAXED) - 1,            \
+                            A3_RELAXED);                                                           \
+        }                                                                                          \
+                                                                                                   \
+        A3_CHT_UNLOCK(K, V)(shard);                                                                \
+        return i >= 0;                                                                             \
+    }                                                                                              \
+                                                                                                   \
+    size_t A3_CHT_SIZE(K, V)(A3_CHT(K, V) * table) {                                               \
+        assert(table);                                                                             \
+                                                                                                   \
+        size_t ret = 0;                                                                            \
+        for (size_t i = 0; i < A3_CHT_SHARDS; i++)                                                 \
+            ret += A3_ATOMIC_LOAD(&table->shards[i].size, A3_RELAXED);                             \
+        return ret;                                                                                \
+    }
+
+/// Define methods with HighwayHash as the hash function. See ::A3_HT_DEFINE_METHODS for the meaning
+/// of the arguments.
+#define A3_CHT_DEFINE_METHODS(K, V, KEY_BYTES, KEY_SIZE, C)                                        \
+    static uint64_t A3_CHT_DEFAULT_HASH(K, V)(A3_CHT(K, V) * table, K key) {                       \
+        assert(table);                                                                             \
+        return HighwayHash64(KEY_BYTES(key), KEY_SIZE(key), table->hash_key);                      \
+    }                                                                                              \
+                                                                                                   \
+    A3_CHT_DEFINE_METHODS_HASHER(K, V, A3_CHT_DEFAULT_HASH(K, V), C)
@@ -0,0 +1,305 @@
+/*
+ * HASH SET -- A type-generic hash set, sharing the Robin Hood core of the hash table.
+ *
+ * Copyright (c) 2020-2021, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in
+ * the project root for details.
+ */
+
+/// \file hs.h
+/// # Hash Set
+/// A type-generic hash set. A set is a Robin Hood hash table (see ht.h) whose entries hold only a
+/// key and its hash, with no value, and no padding to accommodate one. To instantiate a set, use
+/// ::A3_HS_DEFINE_STRUCTS, ::A3_HS_DECLARE_METHODS, and ::A3_HS_DEFINE_METHODS, in the same way as
+/// for a table.
+///
+/// The lifecycle and maintenance functions of a set are those of the underlying table, and are
+/// available under set names (::A3_HS_INIT, ::A3_HS_RESERVE, ::A3_HS_STATS, and so on). The bulk
+/// operations ::A3_HS_UNION, ::A3_HS_INTERSECT, and ::A3_HS_DIFFERENCE modify their first argument
+/// in place, and allocate nothing beyond what growing it requires. When both sets share a hash key
+/// (see ::A3_HT_HASH_KEY), stored hashes are reused and no key is hashed again.
+
+#pragma once
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <a3/cpp.h>
+#include <a3/ht.h>
+#include <a3/types.h>
+
+/// The placeholder value type of a set's underlying table.
+typedef uint8_t A3HSUnit;
+
+/// The type of a hash set with keys of type K. This is an ordinary table, so the `A3_HT_*` methods
+/// may also be used on it, with `A3HSUnit` as the value type.
+#define A3_HS(K) A3_HT(K, A3HSUnit)
+
+/// An entry in a hash set, holding a key and its hash.
+#define A3_HS_ENTRY(K) A3_HT_ENTRY(K, A3HSUnit)
+
+/// Define all types required for the given hash set.
+#define A3_HS_DEFINE_STRUCTS(K)                                                                    \
+    A3_H_BEGIN                                                                                     \
+                                                                                                   \
+    A3_HT_DEFINE_CALLBACKS_(K, A3HSUnit)                                                           \
+                                                                                                   \
+    A3_HS_ENTRY(K) {                                                                               \
+        K        key;                                                                              \
+        uint64_t hash;                                                                             \
+    };                                                                                             \
+                                                                                                   \
+    A3_HS(K) {                                                                                     \
+        bool     can_grow;                                                                         \
+        bool     mapped;                                                                           \
+        A3HSUnit unit;                                                                             \
+        size_t   size;                                                                             \
+        size_t   cap;                                                                              \
+        uint64_t hash_key[A3_HT_HASH_KEY_SIZE];                                                    \
+        A3_HT_DUP_CB(K, A3HSUnit) duplicate_cb;                                                    \
+        A3_HT_COUNTERS_FIELD_                                                                      \
+        A3_HS_ENTRY(K) * entries;                                                                  \
+    };                                                                                             \
+                                                                                                   \
+    A3_ALWAYS_INLINE K* A3_HT_KEY_AT(K, A3HSUnit)(A3_HS(K) * set, size_t index) {                  \
+        assert(set);                                                                               \
+        return &set->entries[index].key;                                                           \
+    }                                                                                              \
+                                                                                                   \
+    A3_ALWAYS_INLINE A3HSUnit* A3_HT_VALUE_AT(K, A3HSUnit)(A3_HS(K) * set, size_t index) {         \
+        assert(set);                                                                               \
+        (void)index;                                                                               \
+        return &set->unit;                                                                         \
+    }                                                                                              \
+                                                                                                   \
+    A3_H_END
+
+///
+///     void A3_HS_INIT(K)(A3_HS(K)*, uint8_t * key, bool can_grow);
+///
+/// Initialize a new set. See ::A3_HT_INIT.
+#define A3_HS_INIT(K) A3_HT_INIT(K, A3HSUnit)
+
+///
+///     void A3_HS_INIT_WITH_CAPACITY(K)(A3_HS(K)*, uint8_t * key, bool can_grow, size_t entries);
+///
+/// Initialize a new set with room for `entries` keys. See ::A3_HT_INIT_WITH_CAPACITY.
+#define A3_HS_INIT_WITH_CAPACITY(K) A3_HT_INIT_WITH_CAPACITY(K, A3HSUnit)
+
+///
+///     A3_HS(K)* A3_HS_NEW(K)(uint8_t * key, bool can_grow);
+///
+/// Allocate and initialize a new set. See ::A3_HT_NEW.
+#define A3_HS_NEW(K) A3_HT_NEW(K, A3HSUnit)
+
+///
+///     void A3_HS_DESTROY(K)(A3_HS(K)*);
+///
+/// Destroy a set.
+#define A3_HS_DESTROY(K) A3_HT_DESTROY(K, A3HSUnit)
+
+///
+///     void A3_HS_FREE(K)(A3_HS(K)*);
+///
+/// Destroy and free a set.
+#define A3_HS_FREE(K) A3_HT_FREE(K, A3HSUnit)
+
+///
+///     void A3_HS_CLEAR(K)(A3_HS(K)*);
+///
+/// Remove every key. See ::A3_HT_CLEAR.
+#define A3_HS_CLEAR(K) A3_HT_CLEAR(K, A3HSUnit)
+
+///
+///     size_t A3_HS_SIZE(K)(A3_HS(K)*);
+///
+/// Get the number of keys in the set.
+#define A3_HS_SIZE(K) A3_HT_SIZE(K, A3HSUnit)
+
+///
+///     void A3_HS_RESERVE(K)(A3_HS(K)*, size_t entries);
+///
+/// See ::A3_HT_RESERVE.
+#define A3_HS_RESERVE(K) A3_HT_RESERVE(K, A3HSUnit)
+
+///
+///     void A3_HS_SHRINK_TO_FIT(K)(A3_HS(K)*);
+///
+/// See ::A3_HT_SHRINK_TO_FIT.
+#define A3_HS_SHRINK_TO_FIT(K) A3_HT_SHRINK_TO_FIT(K, A3HSUnit)
+
+///
+///     void A3_HS_STATS(K)(A3_HS(K)*, A3HTStats*);
+///
+/// See ::A3_HT_STATS.
+#define A3_HS_STATS(K) A3_HT_STATS(K, A3HSUnit)
+
+///
+///     bool A3_HS_SAVE(K)(A3_HS(K)*, int fd);
+///
+/// See ::A3_HT_SAVE.
+#define A3_HS_SAVE(K) A3_HT_SAVE(K, A3HSUnit)
+
+///
+///     bool A3_HS_MAP(K)(A3_HS(K)*, void* ptr, size_t len);
+///
+/// See ::A3_HT_MAP.
+#define A3_HS_MAP(K) A3_HT_MAP(K, A3HSUnit)
+
+///
+///     bool A3_HS_INSERT(K)(A3_HS(K)*, K key);
+///
+/// Insert a key. Returns `false` if it was already present, or if the set is full and cannot grow.
+#define A3_HS_INSERT(K) K##_a3_hs_insert
+
+///
+///     bool A3_HS_CONTAINS(K)(A3_HS(K)*, K key);
+///
+/// Check whether a key is present.
+#define A3_HS_CONTAINS(K) K##_a3_hs_contains
+
+///
+///     bool A3_HS_REMOVE(K)(A3_HS(K)*, K key);
+///
+/// Remove a key. Returns `false` if it was not present.
+#define A3_HS_REMOVE(K) K##_a3_hs_remove
+
+///
+///     void A3_HS_UNION(K)(A3_HS(K) * dst, A3_HS(K) * src);
+///
+/// Insert every key of `src` into `dst`.
+#define A3_HS_UNION(K) K##_a3_hs_union
+
+///
+///     void A3_HS_INTERSECT(K)(A3_HS(K) * dst, A3_HS(K) * src);
+///
+/// Remove every key of `dst` which is not in `src`.
+#define A3_HS_INTERSECT(K) K##_a3_hs_intersect
+
+///
+///     void A3_HS_DIFFERENCE(K)(A3_HS(K) * dst, A3_HS(K) * src);
+///
+/// Remove every key of `src` from `dst`.
+#define A3_HS_DIFFERENCE(K) K##_a3_hs_difference
+
+#ifndef DOXYGEN
+#define A3_HS_HASH_FOR(K) K##_a3_hs_hash_for
+#define A3_HS_FILTER(K)   K##_a3_hs_filter
+#endif
+
+/// Declare all methods for the given hash set. The declarations from ::A3_HS_DEFINE_STRUCTS must
+/// be visible.
+#define A3_HS_DECLARE_METHODS(K)                                                                   \
+    A3_HT_DECLARE_METHODS(K, A3HSUnit)                                                             \
+                                                                                                   \
+    A3_H_BEGIN                                                                                     \
+    bool A3_HS_INSERT(K)(A3_HS(K)*, K);                                                            \
+    bool A3_HS_CONTAINS(K)(A3_HS(K)*, K);                                                          \
+    bool A3_HS_REMOVE(K)(A3_HS(K)*, K);                                                            \
+    void A3_HS_UNION(K)(A3_HS(K)*, A3_HS(K)*);                                                     \
+    void A3_HS_INTERSECT(K)(A3_HS(K)*, A3_HS(K)*);                                                 \
+    void A3_HS_DIFFERENCE(K)(A3_HS(K)*, A3_HS(K)*);                                                \
+    A3_H_END
+
+#ifndef DOXYGEN
+#define A3_HS_DEFINE_SET_METHODS_(K)                                                               \
+    bool A3_HS_INSERT(K)(A3_HS(K) * set, K key) {                                                  \
+        return A3_HT_INSERT(K, A3HSUnit)(set, key, 0);                                             \
+    }                                                                                              \
+                                                                                                   \
+    bool A3_HS_CONTAINS(K)(A3_HS(K) * set, K key) {                                                \
+        return A3_HT_FIND_INDEX(K, A3HSUnit)(set, key) >= 0;                                       \
+    }                                                                                              \
+                                                                                                   \
+    bool A3_HS_REMOVE(K)(A3_HS(K) * set, K key) { return A3_HT_DELETE(K, A3HSUnit)(set, key); }    \
+                                                                                                   \
+    /* The hash of an entry of one set, for use in another. */                                     \
+    static uint64_t A3_HS_HASH_FOR(K)(A3_HS(K) * set, A3_HS_ENTRY(K) * entry, bool same_key) {     \
+        return same_key ? entry->hash : A3_HT_HASH(K, A3HSUnit)(set, entry->key);                  \
+    }                                                                                              \
+                                                                                                   \
+    /* Remove each key of dst whose presence in src is not `keep`. */                              \
+    static void A3_HS_FILTER(K)(A3_HS(K) * dst, A3_HS(K) * src, bool keep) {                       \
+        assert(dst);                                                                               \
+        assert(src);                                                                               \
+                                                                                                   \
+        bool same_key = memcmp(dst->hash_key, src->hash_key, sizeof(dst->hash_key)) == 0;          \
+        /* Deletion shifts later entries back, so the same slot is examined again. */              \
+        for (size_t i = 0; i < dst->cap;) {                                                        \
+            A3_HS_ENTRY(K)* entry = &dst->entries[i];                                              \
+            if (!entry->hash ||                                                                    \
+                (A3_HT_FIND_INDEX_HASHED(K, A3HSUnit)(                                             \
+                     src, A3_HS_HASH_FOR(K)(src, entry, same_key), entry->key) >= 0) == keep) {    \
+                i++;                                                                               \
+                continue;                                                                          \
+            }                                                                                      \
+            A3_HT_DELETE_INDEX(K, A3HSUnit)(dst, i);                                               \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    void A3_HS_UNION(K)(A3_HS(K) * dst, A3_HS(K) * src) {                                          \
+        assert(dst);                                                                               \
+        assert(src);                                                                               \
+        if (dst == src)                                                                            \
+            return;                                                                                \
+                                                                                                   \
+        bool same_key = memcmp(dst->hash_key, src->hash_key, sizeof(dst->hash_key)) == 0;          \
+        for (size_t i = 0; i < src->cap; i++) {                                                    \
+            A3_HS_ENTRY(K)* entry = &src->entries[i];                                              \
+            if (entry->hash)                                                                       \
+                A3_HT_INSERT_HASHED(K, A3HSUnit)                                                   \
+                (dst, A3_HS_HASH_FOR(K)(dst, entry, same_key), entry->key, 0);                     \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    void A3_HS_INTERSECT(K)(A3_HS(K) * dst, A3_HS(K) * src) { A3_HS_FILTER(K)(dst, src, true); }   \
+                                                                                                   \
+    void A3_HS_DIFFERENCE(K)(A3_HS(K) * dst, A3_HS(K) * src) {                                     \
+        assert(dst);                                                                               \
+        assert(src);                                                                               \
+                                                                                                   \
+        /* Walk whichever set is smaller. */                                                       \
+        if (dst == src || dst->size <= src->size) {                                                \
+            A3_HS_FILTER(K)(dst, src, false);                                                      \
+            return;                                                                                \
+        }                                                                                          \
+                                                                                                   \
+        bool same_key = memcmp(dst->hash_key, src->hash_key, sizeof(dst->hash_key)) == 0;          \
+        for (size_t i = 0; i < src->cap; i++) {                                                    \
+            A3_HS_ENTRY(K)* entry = &src->entries[i];                                              \
+            if (entry->hash)                                                                       \
+                A3_HT_DELETE_HASHED(K, A3HSUnit)                                                   \
+                (dst, A3_HS_HASH_FOR(K)(dst, entry, same_key), entry->key);                        \
+        }                                                                                          \
+    }
+#endif
+
+/// Define methods for a set with a custom hash function. See ::A3_HT_DEFINE_METHODS_HASHER for the
+/// meaning of H and C. H receives an `A3_HS(K)*`.
+#define A3_HS_DEFINE_METHODS_HASHER(K, H, C)                                                       \
+    A3_HT_DEFINE_METHODS_RH_(K, A3HSUnit, H, C, MOD, SET)                                          \
+    A3_HS_DEFINE_SET_METHODS_(K)
+
+/// Define methods for a set whose capacity is always a power of two, with a custom hash function.
+/// See ::A3_HT_DEFINE_METHODS_POW2_HASHER.
+#define A3_HS_DEFINE_METHODS_POW2_HASHER(K, H, C)                                                  \
+    A3_HT_DEFINE_METHODS_RH_(K, A3HSUnit, H, C, POW2, SET)                                         \
+    A3_HS_DEFINE_SET_METHODS_(K)
+
+/// Define methods for a set with HighwayHash as the hash function. See ::A3_HT_DEFINE_METHODS for
+/// the meaning of the arguments.
+#define A3_HS_DEFINE_METHODS(K, KEY_BYTES, KEY_SIZE, C)                                            \
+    A3_HT_DEFINE_DEFAULT_HASH_(K, A3HSUnit, KEY_BYTES, KEY_SIZE)                                   \
+                                                                                                   \
+    A3_HS_DEFINE_METHODS_HASHER(K, A3_HT_DEFAULT_HASH(K, A3HSUnit), C)
+
+/// Iterate over every key of the hash set `S`, storing keys in `K_OUT` on every iteration.
+#define A3_HS_FOR_EACH(K, S, K_OUT)                                                                \
+    A3_SSIZE_T K_OUT##_i = A3_HT_NEXT_ENTRY(K, A3HSUnit)((S), 0);                                  \
+    K*         K_OUT     = (K_OUT##_i >= 0) ? &(S)->entries[K_OUT##_i].key : NULL;                 \
+    for (; K_OUT##_i >= 0 && (size_t)K_OUT##_i < (S)->cap;                                         \
+         K_OUT##_i = A3_HT_NEXT_ENTRY(K, A3HSUnit)((S), (size_t)K_OUT##_i + 1),                    \
+         K_OUT     = &(S)->entries[MAX(K_OUT##_i, 0)].key)
@@ -13,24 +13,145 @@
 /// A type-generic hash table using open addressing with Robin Hood hashing. To instantiate a table,
 /// use ::A3_HT_DEFINE_STRUCTS to define the necessary structures, ::A3_HT_DECLARE_METHODS to
 /// generate method prototypes, and ::A3_HT_DEFINE_METHODS to create method bodies.
+///
+/// ## Swiss Tables
+/// An alternative layout in the style of Abseil's "Swiss tables" is available by using
+/// ::A3_HT_DEFINE_STRUCTS_SWISS and ::A3_HT_DEFINE_METHODS_SWISS instead. Alongside the entries,
+/// such a table keeps an array of 1-byte control tags holding 7 bits of each entry's hash, and
+/// probes a whole group of tags (::A3_HT_GROUP_WIDTH) at once with SIMD compares. Most lookups, and
+/// particularly most misses, therefore touch a single group of tags before examining any entry. The
+/// capacity of such a table is always a power of two. The API is identical to that of the default
+/// layout.
+///
+/// ## Power-of-Two Capacities
+/// The default layout accepts any capacity and finds each entry's home slot with a division.
+/// ::A3_HT_DEFINE_METHODS_POW2 instead keeps the capacity at a power of two, so that all index
+/// arithmetic reduces to masks. The structures and API are otherwise unchanged.
+///
+/// ## Split Values
+/// Each entry normally holds its key, value, and hash together, so that every probe also pulls the
+/// value into cache. For large values, ::A3_HT_DEFINE_STRUCTS_SPLIT and
+/// ::A3_HT_DEFINE_METHODS_SPLIT instead keep only keys and hashes in the entries array, and values
+/// in a parallel array. Probes then scan densely packed entries, and touch a value only once its
+/// key has matched. ::A3_HT_FIND still returns a pointer to the value, valid until the table is
+/// next modified, and ::A3_HT_FOR_EACH works as usual. ::A3_HT_FIND_ENTRY returns an entry without
+/// a value.
+///
+/// ## Compact Entries
+/// Each entry normally stores the full 64-bit hash of its key, so that the comparator only runs on
+/// a genuine match, and so that resizing never rehashes. A table defined with
+/// ::A3_HT_DEFINE_STRUCTS_COMPACT and ::A3_HT_DEFINE_METHODS_COMPACT instead stores a 16- or 32-bit
+/// fingerprint of the hash, and the entry's displacement in a single byte, both in arrays beside
+/// the entries. Each slot then costs its key and value plus 3 (or 5) bytes, rather than 8 bytes and
+/// any padding. Probes scan the dense array of displacements, end on it without recomputing any
+/// home slot, and only touch the fingerprint and the entry once the displacement matches; the
+/// fingerprint still rules out all but one in 2^16 (or 2^32) of the other keys met along the way.
+/// In exchange, each resize hashes every key again, and the capacity is always a power of two.
+/// Since a displacement must fit in a byte, an insert can also fail when too many keys share a
+/// cluster; see ::A3_HT_INSERT.
+///
+/// ## Incremental Resizing
+/// Normally, growing the table moves every entry at once, inside whichever insertion crosses the
+/// load factor. A table defined with ::A3_HT_DEFINE_STRUCTS_INCREMENTAL and
+/// ::A3_HT_DEFINE_METHODS_INCREMENTAL instead keeps the old array of entries alive while it grows,
+/// and each subsequent insertion or deletion moves at most ::A3_HT_MIGRATE_STEP slots across.
+/// Lookups consult both arrays until the migration is complete, so no single insertion pays for
+/// the whole resize. Iteration moves nothing either: ::A3_HT_FOR_EACH, and methods which visit
+/// every entry, cover the current array and then the entries of the old array not yet migrated.
+/// Only ::A3_HT_SAVE, which records the current array alone, completes a migration in progress.
+///
+/// ::A3_HT_FIND and ::A3_HT_FIND_HASHED never move entries, so the pointers they return stay valid
+/// until the table is next modified, as in every other layout. ::A3_HT_FIND_INDEX and
+/// ::A3_HT_FIND_ENTRY must return a slot of the current array, so they move an entry found in the
+/// old array across, and also take a migration step. On this layout they count as modifications:
+/// any pointer or index obtained before them is invalidated.
+///
+/// ## Insertion Order
+/// A table defined with ::A3_HT_DEFINE_STRUCTS_ORDERED and ::A3_HT_DEFINE_METHODS_ORDERED keeps its
+/// entries in a dense array, in the order in which they were first inserted, and probes a separate
+/// array of 8-byte slots, each holding an entry's position and the low half of its hash. Lookups
+/// only touch an entry once that half matches. ::A3_HT_FOR_EACH walks the live entries in
+/// insertion order, and costs O(size) rather than O(capacity), even after mass deletions or in a
+/// table which cannot grow. Deletions leave holes in the dense array, which are closed up once they
+/// outnumber the live entries, so the indices returned by ::A3_HT_FIND_INDEX are invalidated by
+/// any deletion. The capacity is always a power of two.
+///
+/// ## Frozen Tables
+/// A table which is built once and then only read can be converted with ::A3_HT_FREEZE into a
+/// frozen table, defined with ::A3_HT_DEFINE_STRUCTS_FROZEN and ::A3_HT_DEFINE_METHODS_FROZEN
+/// alongside the table of any layout. A frozen table packs its entries densely by hash, with no
+/// empty slots, and supports only lookups, which may run on any number of threads at once.
+///
+/// ## Hash Functions
+/// The `DEFINE_METHODS` macros hash the bytes of each key with HighwayHash, keyed by a random
+/// per-table key. HighwayHash is a strong keyed hash, so an attacker who controls the keys but not
+/// the hash key cannot cheaply produce colliding keys. This makes it the right choice for keys from
+/// untrusted sources, but it is comparatively slow, particularly for small keys.
+///
+/// Faster presets are available for use with the `_HASHER` variants of the macros:
+/// - ::A3_HT_HASH_INT and ::A3_HT_HASH_PTR apply a keyed multiply-xorshift mix to a single word.
+///   The mix is invertible and the key enters it linearly, so an attacker able to observe iteration
+///   order or timing can learn enough to construct collisions. Use it for trusted keys only.
+/// - ::A3_HT_HASH_STRING is a keyed hash in the style of wyhash, which handles short strings in a
+///   couple of multiplies. It is not a PRF, but has no known practical key-recovery attack; it
+///   resists casual flooding while the hash key remains secret, and hash values must never be
+///   exposed. Prefer HighwayHash where adversarial input is expected.
+///
+/// For example:
+///
+///     A3_HT_DEFINE_METHODS_HASHER(uint64_t, V, A3_HT_HASH_INT, cmp)
+///
+/// ## Snapshots
+/// A table whose keys and values are plain data can be written to a file with ::A3_HT_SAVE, and
+/// later opened directly over an `mmap` of that file with ::A3_HT_MAP. The snapshot holds the
+/// table's capacity and hash key alongside its arrays, so every probe sequence remains valid and
+/// nothing is rehashed on load. A snapshot is only readable by an identical instantiation (layout,
+/// types, and hash function) on a machine of the same byte order.
+///
+/// If the memory is mapped read-only, the table must only be read. If it is mapped copy-on-write
+/// (`MAP_PRIVATE`), the table may also be modified. A mapped table never grows on its own. Any
+/// operation which does resize it, such as ::A3_HT_RESERVE, copies it onto the heap, after which it
+/// no longer refers to the mapping at all. ::A3_HT_DESTROY never frees mapped memory, which remains
+/// owned by the caller.
+///
+/// ## Large Tables
+/// The arrays backing a table are allocated through alloc.h, so very large tables can be backed by
+/// huge pages with ::a3_alloc_policy_set, which cuts TLB misses on random lookups.
 
 #pragma once
 
 #include <assert.h>
+#include <errno.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include <time.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include <a3/alloc.h>
 #include <a3/cpp.h>
+#include <a3/shim/prefetch.h>
+#include <a3/shim/thread.h>
+#include <a3/shim/write.h>
 #include <a3/types.h>
 #include <a3/util.h>
 
-// From highwayhash.h. Forward-declared since the library header causes unused
-// function warnings.
+// Provided by liba3, with the same signature and results as HighwayHash64 from highwayhash.h. The
+// best implementation for the running CPU (AVX2, SSE4.1, NEON, or portable C) is selected on first
+// use.
 #ifndef DOXYGEN
 A3_H_BEGIN
-uint64_t HighwayHash64(const uint8_t* data, size_t size, const uint64_t key[4]);
+A3_EXPORT uint64_t HighwayHash64(const uint8_t* data, size_t size, const uint64_t key[4]);
 A3_H_END
 #endif
 
@@ -44,6 +165,23 @@ A3_H_END
 #define A3_HT_LOAD_FACTOR 90ULL
 #endif
 
+#ifndef A3_HT_BATCH_SIZE
+/// The number of keys hashed and prefetched at once by batched operations. Can be overridden.
+#define A3_HT_BATCH_SIZE 16ULL
+#endif
+
+#ifndef A3_HT_PARALLEL_MIN
+/// The fewest entries ::A3_HT_BUILD_PARALLEL gives to each thread. Smaller builds use fewer
+/// threads, or none. Can be overridden.
+#define A3_HT_PARALLEL_MIN 4096ULL
+#endif
+
+#ifndef A3_HT_MIGRATE_STEP
+/// The number of slots moved out of the old array by each operation on a table which is being
+/// resized incrementally. Can be overridden.
+#define A3_HT_MIGRATE_STEP 16ULL
+#endif
+
 #ifndef A3_HT_HASH_KEY_SIZE
 /// The size, in multiples of 8 bytes, of the hash key. This _must_ be overridden if the hash
 /// function is changed.
@@ -58,6 +196,449 @@ A3_H_END
 /// Do not use a hash key. See ::A3_HT_INIT.
 #define A3_HT_NO_HASH_KEY NULL
 
+/// Control tag for a Swiss table slot which has never held an entry.
+#define A3_HT_CTRL_EMPTY ((uint8_t)0x80)
+/// Control tag for a Swiss table slot whose entry was deleted.
+#define A3_HT_CTRL_DELETED ((uint8_t)0xFE)
+
+#ifndef DOXYGEN
+// The control tag of a full slot holds the low 7 bits of the hash, and the remaining bits choose
+// the starting group.
+#define A3_HT_H1(HASH) ((size_t)((HASH) >> 7))
+#define A3_HT_H2(HASH) ((uint8_t)((HASH)&0x7F))
+#endif
+
+A3_H_BEGIN
+
+A3_ALWAYS_INLINE unsigned a3_ht_ctz(uint64_t v) {
+    assert(v);
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctzll(v);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long ret;
+    _BitScanForward64(&ret, v);
+    return (unsigned)ret;
+#else
+    unsigned ret = 0;
+    for (; !(v & 1); v >>= 1)
+        ret++;
+    return ret;
+#endif
+}
+
+A3_ALWAYS_INLINE unsigned a3_ht_clz(uint64_t v) {
+    assert(v);
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_clzll(v);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long ret;
+    _BitScanReverse64(&ret, v);
+    return 63 - (unsigned)ret;
+#else
+    unsigned ret = 0;
+    for (; !(v & (1ULL << 63)); v <<= 1)
+        ret++;
+    return ret;
+#endif
+}
+
+#if defined(__AVX2__)
+
+/// The number of control tags checked by a single probe of a Swiss table.
+#define A3_HT_GROUP_WIDTH 32ULL
+#define A3_HT_GROUP_SHIFT 0
+
+A3_ALWAYS_INLINE uint64_t a3_ht_group_match(uint8_t const* ctrl, uint8_t tag) {
+    __m256i group = _mm256_loadu_si256((__m256i const*)ctrl);
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(group, _mm256_set1_epi8((char)tag)));
+}
+
+A3_ALWAYS_INLINE uint64_t a3_ht_group_match_free(uint8_t const* ctrl) {
+    return (uint32_t)_mm256_movemask_epi8(_mm256_loadu_si256((__m256i const*)ctrl));
+}
+
+A3_ALWAYS_INLINE unsigned a3_ht_group_leading(uint64_t mask) {
+    return mask ? a3_ht_clz(mask) - 32 : (unsigned)A3_HT_GROUP_WIDTH;
+}
+
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+
+#define A3_HT_GROUP_WIDTH 16ULL
+#define A3_HT_GROUP_SHIFT 0
+
+A3_ALWAYS_INLINE uint64_t a3_ht_group_match(uint8_t const* ctrl, uint8_t tag) {
+    __m128i group = _mm_loadu_si128((__m128i const*)ctrl);
+    return (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)tag)));
+}
+
+A3_ALWAYS_INLINE uint64_t a3_ht_group_match_free(uint8_t const* ctrl) {
+    return (uint16_t)_mm_movemask_epi8(_mm_loadu_si128((__m128i const*)ctrl));
+}
+
+A3_ALWAYS_INLINE unsigned a3_ht_group_leading(uint64_t mask) {
+    return mask ? a3_ht_clz(mask) - 48 : (unsigned)A3_HT_GROUP_WIDTH;
+}
+
+#else
+
+// Portable fallback: treat 8 tags as a single word, with the result for each tag in its high bit.
+#define A3_HT_GROUP_WIDTH 8ULL
+#define A3_HT_GROUP_SHIFT 3
+#define A3_HT_LSBS_       0x0101010101010101ULL
+#define A3_HT_MSBS_       0x8080808080808080ULL
+
+A3_ALWAYS_INLINE uint64_t a3_ht_group_load_(uint8_t const* ctrl) {
+    uint64_t ret = 0;
+    for (unsigned i = 0; i < 8; i++)
+        ret |= (uint64_t)ctrl[i] << (i * 8);
+    return ret;
+}
+
+// May yield false positives, but these are filtered out by the full hash comparison.
+A3_ALWAYS_INLINE uint64_t a3_ht_group_match(uint8_t const* ctrl, uint8_t tag) {
+    uint64_t x = a3_ht_group_load_(ctrl) ^ (A3_HT_LSBS_ * tag);
+    return (x - A3_HT_LSBS_) & ~x & A3_HT_MSBS_;
+}
+
+A3_ALWAYS_INLINE uint64_t a3_ht_group_match_free(uint8_t const* ctrl) {
+    return a3_ht_group_load_(ctrl) & A3_HT_MSBS_;
+}
+
+// Exact: only EMPTY has the high bit set and bit 1 clear.
+A3_ALWAYS_INLINE uint64_t a3_ht_group_match_empty(uint8_t const* ctrl) {
+    uint64_t group = a3_ht_group_load_(ctrl);
+    return group & ~(group << 6) & A3_HT_MSBS_;
+}
+
+A3_ALWAYS_INLINE unsigned a3_ht_group_leading(uint64_t mask) {
+    return mask ? a3_ht_clz(mask) >> 3 : (unsigned)A3_HT_GROUP_WIDTH;
+}
+
+#endif
+
+#if A3_HT_GROUP_SHIFT == 0
+A3_ALWAYS_INLINE uint64_t a3_ht_group_match_empty(uint8_t const* ctrl) {
+    return a3_ht_group_match(ctrl, A3_HT_CTRL_EMPTY);
+}
+#endif
+
+/// Get the offset of the first slot in a (nonzero) group mask.
+A3_ALWAYS_INLINE size_t a3_ht_group_first(uint64_t mask) {
+    return a3_ht_ctz(mask) >> A3_HT_GROUP_SHIFT;
+}
+
+/// Get the number of slots before the first set slot in a group mask.
+A3_ALWAYS_INLINE unsigned a3_ht_group_trailing(uint64_t mask) {
+    return mask ? (unsigned)a3_ht_group_first(mask) : (unsigned)A3_HT_GROUP_WIDTH;
+}
+
+A3_ALWAYS_INLINE bool a3_ht_ctrl_is_full(uint8_t ctrl) { return !(ctrl & 0x80); }
+
+/// Allocate the control tags for a Swiss table with the given capacity. The first group of tags is
+/// mirrored past the end so that a group can be loaded at any position without wrapping.
+A3_ALWAYS_INLINE uint8_t* a3_ht_ctrl_new(size_t cap) {
+    uint8_t* ret = NULL;
+    A3_UNWRAPN(ret, (uint8_t*)a3_large_calloc(cap + A3_HT_GROUP_WIDTH, 1));
+    memset(ret, A3_HT_CTRL_EMPTY, cap + A3_HT_GROUP_WIDTH);
+    return ret;
+}
+
+/// Free the control tags of a Swiss table with the given capacity.
+A3_ALWAYS_INLINE void a3_ht_ctrl_free(uint8_t* ctrl, size_t cap) {
+    a3_large_free(ctrl, cap + A3_HT_GROUP_WIDTH, 1);
+}
+
+A3_ALWAYS_INLINE void a3_ht_ctrl_set(uint8_t* ctrl, size_t cap, size_t index, uint8_t tag) {
+    ctrl[index] = tag;
+    if (index < A3_HT_GROUP_WIDTH)
+        ctrl[cap + index] = tag;
+}
+
+/// Round a requested capacity up to a power of two.
+A3_ALWAYS_INLINE size_t a3_ht_pow2_cap(size_t cap) {
+    return cap > 1 ? 1ULL << (64 - a3_ht_clz((uint64_t)cap - 1)) : 1;
+}
+
+/// Round a requested capacity to one usable by a Swiss table.
+A3_ALWAYS_INLINE size_t a3_ht_swiss_cap(size_t cap) {
+    return a3_ht_pow2_cap(cap > A3_HT_GROUP_WIDTH ? cap : A3_HT_GROUP_WIDTH);
+}
+
+/// A slot in the probe table of an insertion-ordered table (see ::A3_HT_DEFINE_STRUCTS_ORDERED).
+typedef struct A3HTSlot {
+    uint32_t index; ///< The entry's position in the dense array, plus one, or zero if empty.
+    uint32_t hash;  ///< The low half of the entry's hash.
+} A3HTSlot;
+
+#ifndef DOXYGEN
+A3_ALWAYS_INLINE A3HTSlot a3_ht_slot_new(size_t index, uint64_t hash) {
+    A3HTSlot ret A3_EMPTY_INIT;
+    ret.index = (uint32_t)index + 1;
+    ret.hash  = (uint32_t)hash;
+    return ret;
+}
+#endif
+
+A3_ALWAYS_INLINE void a3_ht_init_hash_key(uint64_t* hash_key, uint8_t const* key) {
+    if (key) {
+        memcpy(hash_key, key, A3_HT_HASH_KEY_SIZE * sizeof(hash_key[0]));
+    } else {
+        uint8_t* key_bytes = (uint8_t*)hash_key;
+        for (size_t i = 0; i < A3_HT_HASH_KEY_SIZE * sizeof(hash_key[0]); i++)
+            /* NOLINTNEXTLINE(concurrency-mt-unsafe, cert-msc30-c, cert-msc50-cpp) */
+            key_bytes[i] = (uint8_t)rand();
+    }
+}
+
+#ifndef A3_HT_SNAPSHOT_ALIGN
+/// The alignment of each array within a snapshot. Can be overridden.
+#define A3_HT_SNAPSHOT_ALIGN 64ULL
+#endif
+
+#ifndef DOXYGEN
+#define A3_HT_SNAPSHOT_MAGIC  0x41334831UL // "A3H1"
+#define A3_HT_SNAPSHOT_ARRAYS 2
+
+#define A3_HT_SNAPSHOT_TAG_MOD         0x01U
+#define A3_HT_SNAPSHOT_TAG_POW2        0x02U
+#define A3_HT_SNAPSHOT_TAG_AOS         0x10U
+#define A3_HT_SNAPSHOT_TAG_SOA         0x20U
+#define A3_HT_SNAPSHOT_TAG_SET         0x40U
+#define A3_HT_SNAPSHOT_TAG_SWISS       0x100U
+#define A3_HT_SNAPSHOT_TAG_INCREMENTAL 0x200U
+#define A3_HT_SNAPSHOT_TAG_COMPACT16   0x400U
+#define A3_HT_SNAPSHOT_TAG_COMPACT32   0x800U
+#define A3_HT_SNAPSHOT_TAG_ORDERED     0x1000U
+#endif
+
+/// The header of a table snapshot, as written by ::A3_HT_SAVE. It is followed by each of the
+/// table's arrays, each aligned to ::A3_HT_SNAPSHOT_ALIGN.
+typedef struct A3HTSnapshot {
+    uint32_t magic;
+    uint32_t layout;
+    uint64_t entry_size;
+    uint64_t value_size;
+    uint64_t size;
+    uint64_t cap;
+    uint64_t hash_key[A3_HT_HASH_KEY_SIZE];
+    uint64_t array_size[A3_HT_SNAPSHOT_ARRAYS];
+} A3HTSnapshot;
+
+/// Get the offset of an array within a snapshot.
+A3_ALWAYS_INLINE size_t a3_ht_snapshot_offset(A3HTSnapshot const* header, size_t index) {
+    size_t ret = sizeof(*header);
+    for (size_t i = 0; i <= index; i++) {
+        ret = (ret + A3_HT_SNAPSHOT_ALIGN - 1) & ~(size_t)(A3_HT_SNAPSHOT_ALIGN - 1);
+        if (i < index)
+            ret += (size_t)header->array_size[i];
+    }
+    return ret;
+}
+
+A3_ALWAYS_INLINE bool a3_ht_snapshot_write(int fd, void const* data, size_t len) {
+    uint8_t const* bytes = (uint8_t const*)data;
+    while (len) {
+        A3_SSIZE_T res = a3_shim_write(fd, bytes, len);
+        if (res < 0 && errno == EINTR)
+            continue;
+        if (res <= 0)
+            return false;
+        bytes += res;
+        len -= (size_t)res;
+    }
+    return true;
+}
+
+/// Write a snapshot header followed by the arrays it describes.
+A3_ALWAYS_INLINE bool a3_ht_snapshot_save(int fd, A3HTSnapshot const* header,
+                                          void* const arrays[A3_HT_SNAPSHOT_ARRAYS]) {
+    static uint8_t const PADDING[A3_HT_SNAPSHOT_ALIGN] = { 0 };
+
+    if (!a3_ht_snapshot_write(fd, header, sizeof(*header)))
+        return false;
+
+    size_t pos = sizeof(*header);
+    for (size_t i = 0; i < A3_HT_SNAPSHOT_ARRAYS; i++) {
+        size_t offset = a3_ht_snapshot_offset(header, i);
+        if (!a3_ht_snapshot_write(fd, PADDING, offset - pos) ||
+            !a3_ht_snapshot_write(fd, arrays[i], (size_t)header->array_size[i]))
+            return false;
+        pos = offset + (size_t)header->array_size[i];
+    }
+
+    return true;
+}
+
+/// Check that a region of memory plausibly holds a snapshot, before its arrays are examined.
+A3_ALWAYS_INLINE bool a3_ht_snapshot_valid(void const* ptr, size_t len) {
+    A3HTSnapshot const* header = (A3HTSnapshot const*)ptr;
+    if ((uintptr_t)ptr % A3_HT_SNAPSHOT_ALIGN || len < sizeof(*header) ||
+        header->magic != A3_HT_SNAPSHOT_MAGIC || !header->cap || header->cap > len ||
+        header->size > header->cap)
+        return false;
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < A3_HT_SNAPSHOT_ARRAYS; i++) {
+        if (header->array_size[i] > len)
+            return false;
+        total += header->array_size[i];
+    }
+    return total <= len &&
+           a3_ht_snapshot_offset(header, A3_HT_SNAPSHOT_ARRAYS - 1) +
+                   header->array_size[A3_HT_SNAPSHOT_ARRAYS - 1] <=
+               len;
+}
+
+#ifndef A3_HT_STATS_BUCKETS
+/// The number of buckets in the displacement histogram of ::A3HTStats. Can be overridden.
+#define A3_HT_STATS_BUCKETS 16
+#endif
+
+/// Counters of the work done by a table. They are only maintained when built with `PROFILE`.
+typedef struct A3HTCounters {
+    uint64_t probes;      ///< Probe sequences started, by lookups and insertions.
+    uint64_t probe_steps; ///< Slots (or, for Swiss tables, groups) examined by those sequences.
+    uint64_t resizes;     ///< Reallocations of the table's arrays.
+} A3HTCounters;
+
+/// A summary of the occupancy of a table, as filled in by ::A3_HT_STATS.
+typedef struct A3HTStats {
+    size_t size;
+    size_t cap;
+    double load;
+    /// The displacement of an entry is the number of probe steps between its home slot and the
+    /// slot in which it lies.
+    size_t max_displacement;
+    double mean_displacement;
+    /// The number of entries with each displacement. The last bucket also counts every larger
+    /// displacement.
+    size_t       histogram[A3_HT_STATS_BUCKETS];
+    A3HTCounters counters; ///< Zero unless built with `PROFILE`.
+} A3HTStats;
+
+#ifndef DOXYGEN
+#ifdef PROFILE
+#define A3_HT_COUNTERS_FIELD_                 A3HTCounters counters;
+#define A3_HT_COUNTERS_(TABLE)                (&(TABLE)->counters)
+#define A3_HT_COUNT_(COUNTERS, FIELD)         ((COUNTERS) ? (void)(COUNTERS)->FIELD++ : (void)0)
+#define A3_HT_COPY_COUNTERS_(STATS, COUNTERS) ((STATS)->counters = *(COUNTERS))
+#else
+#define A3_HT_COUNTERS_FIELD_
+#define A3_HT_COUNTERS_(TABLE)                ((A3HTCounters*)NULL)
+#define A3_HT_COUNT_(COUNTERS, FIELD)         ((void)(COUNTERS))
+#define A3_HT_COPY_COUNTERS_(STATS, COUNTERS) ((void)(COUNTERS))
+#endif
+#endif
+
+/// Record the displacement of one entry in a set of statistics.
+A3_ALWAYS_INLINE void a3_ht_stats_add(A3HTStats* stats, size_t displacement) {
+    if (displacement > stats->max_displacement)
+        stats->max_displacement = displacement;
+    stats->mean_displacement += (double)displacement;
+    stats->histogram[displacement < A3_HT_STATS_BUCKETS ? displacement
+                                                        : A3_HT_STATS_BUCKETS - 1]++;
+}
+
+/// Multiply two 64-bit integers, storing the low and high halves of the 128-bit product.
+A3_ALWAYS_INLINE void a3_ht_mul128(uint64_t a, uint64_t b, uint64_t* lo, uint64_t* hi) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)a * b;
+    *lo           = (uint64_t)r;
+    *hi           = (uint64_t)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    *lo = _umul128(a, b, hi);
+#else
+    uint64_t a_lo = a & 0xFFFFFFFF, a_hi = a >> 32, b_lo = b & 0xFFFFFFFF, b_hi = b >> 32;
+    uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo, hh = a_hi * b_hi;
+    uint64_t mid = (ll >> 32) + (lh & 0xFFFFFFFF) + (hl & 0xFFFFFFFF);
+    *lo          = (mid << 32) | (ll & 0xFFFFFFFF);
+    *hi          = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+}
+
+/// Multiply two 64-bit integers and fold the 128-bit product back to 64 bits.
+A3_ALWAYS_INLINE uint64_t a3_ht_mix(uint64_t a, uint64_t b) {
+    uint64_t lo;
+    uint64_t hi;
+    a3_ht_mul128(a, b, &lo, &hi);
+    return lo ^ hi;
+}
+
+/// Hash a 64-bit integer with a keyed multiply-xorshift mix. The mix is a bijection, so distinct
+/// keys never have identical hashes, though they may of course share a slot. Not resistant to
+/// deliberate flooding. See ::A3_HT_HASH_INT.
+A3_ALWAYS_INLINE uint64_t a3_ht_hash_int(uint64_t const* hash_key, uint64_t key) {
+    uint64_t x = key ^ hash_key[0];
+    x ^= x >> 32;
+    x *= 0xD6E8FEB86659FD93ULL;
+    x ^= (x >> 32) ^ hash_key[1];
+    x *= 0xD6E8FEB86659FD93ULL;
+    return x ^ (x >> 32);
+}
+
+#ifndef DOXYGEN
+#define A3_HT_WY0 0xA0761D6478BD642FULL
+#define A3_HT_WY1 0xE7037ED1A0B428DBULL
+
+A3_ALWAYS_INLINE uint64_t a3_ht_read64(uint8_t const* p) {
+    uint64_t ret;
+    memcpy(&ret, p, sizeof(ret));
+    return ret;
+}
+
+A3_ALWAYS_INLINE uint64_t a3_ht_read32(uint8_t const* p) {
+    uint32_t ret;
+    memcpy(&ret, p, sizeof(ret));
+    return ret;
+}
+#endif
+
+/// Hash a byte string with a keyed function in the style of wyhash, which reads at most two
+/// overlapping words for strings of up to 16 bytes. Resists flooding only as long as the hash key
+/// is secret and hash values are never exposed. See ::A3_HT_HASH_STRING.
+A3_ALWAYS_INLINE uint64_t a3_ht_hash_bytes(uint64_t const* hash_key, uint8_t const* data,
+                                           size_t len) {
+    uint64_t seed = hash_key[0] ^ a3_ht_mix(hash_key[1] ^ A3_HT_WY0, A3_HT_WY1);
+    uint64_t a    = 0;
+    uint64_t b    = 0;
+
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t off = (len >> 3) << 2;
+            a          = (a3_ht_read32(data) << 32) | a3_ht_read32(data + off);
+            b = (a3_ht_read32(data + len - 4) << 32) | a3_ht_read32(data + len - 4 - off);
+        } else if (len > 0) {
+            a = ((uint64_t)data[0] << 16) | ((uint64_t)data[len >> 1] << 8) | data[len - 1];
+        }
+    } else {
+        size_t i = len;
+        for (; i > 16; i -= 16, data += 16)
+            seed = a3_ht_mix(a3_ht_read64(data) ^ A3_HT_WY1, a3_ht_read64(data + 8) ^ seed);
+        /* The final words may overlap bytes already consumed. */
+        a = a3_ht_read64(data + i - 16);
+        b = a3_ht_read64(data + i - 8);
+    }
+
+    uint64_t lo;
+    uint64_t hi;
+    a3_ht_mul128(a ^ A3_HT_WY1, b ^ seed, &lo, &hi);
+    return a3_ht_mix(lo ^ A3_HT_WY0 ^ len, hi ^ A3_HT_WY1);
+}
+
+A3_H_END
+
+/// A hash function for integer keys, usable as the `H` argument to ::A3_HT_DEFINE_METHODS_HASHER
+/// and the other `_HASHER` variants. See ::a3_ht_hash_int.
+#define A3_HT_HASH_INT(TABLE, KEY) a3_ht_hash_int((TABLE)->hash_key, (uint64_t)(KEY))
+
+/// A hash function for pointer keys, which hashes the address rather than the pointee. See
+/// ::A3_HT_HASH_INT.
+#define A3_HT_HASH_PTR(TABLE, KEY) a3_ht_hash_int((TABLE)->hash_key, (uint64_t)(uintptr_t)(KEY))
+
+/// A hash function for ::A3CString or ::A3String keys, usable in the same way as ::A3_HT_HASH_INT.
+/// Much faster than the default for short keys. See ::a3_ht_hash_bytes.
+#define A3_HT_HASH_STRING(TABLE, KEY) a3_ht_hash_bytes((TABLE)->hash_key, (KEY).ptr, (KEY).len)
+
 /// The hash table type.
 #define A3_HT(K, V) struct K##V##A3HT
 
@@ -67,39 +648,326 @@ A3_H_END
 /// See ::A3_HT_SET_DUPLICATE_CB.
 #define A3_HT_DUP_CB(K, V) K##V##A3HTDuplicateCallback
 
+/// See ::A3_HT_RETAIN.
+#define A3_HT_RETAIN_CB(K, V) K##V##A3HTRetainCallback
+
+/// See ::A3_HT_DRAIN.
+#define A3_HT_DRAIN_CB(K, V) K##V##A3HTDrainCallback
+
+/// The type of the hash fingerprint in a compact entry. See ::A3_HT_DEFINE_STRUCTS_COMPACT.
+#define A3_HT_TAG(K, V) K##V##A3HTTag
+
+#ifndef DOXYGEN
+#define A3_HT_DEFINE_CALLBACKS_(K, V)                                                              \
+    typedef bool (*A3_HT_DUP_CB(K, V))(V * current_value, V new_value);                            \
+    typedef bool (*A3_HT_RETAIN_CB(K, V))(void* ctx, K* key, V* value);                            \
+    typedef void (*A3_HT_DRAIN_CB(K, V))(void* ctx, K* key, V* value);
+
+#define A3_HT_DEFINE_ENTRY_(K, V)                                                                  \
+    A3_HT_DEFINE_CALLBACKS_(K, V)                                                                  \
+                                                                                                   \
+    A3_HT_ENTRY(K, V) {                                                                            \
+        K        key;                                                                              \
+        V        value;                                                                            \
+        uint64_t hash;                                                                             \
+    };
+
+// Storage of values. AOS keeps each value inside its entry, and SOA keeps values in a parallel
+// array, so that probing touches only keys and hashes.
+#define A3_HT_VAL_AOS(TABLE, I) ((TABLE)->entries[I].value)
+#define A3_HT_ALLOC_AOS(K, V, TABLE)                                                               \
+    A3_UNWRAPN((TABLE)->entries,                                                                   \
+               (A3_HT_ENTRY(K, V)*)a3_large_calloc((TABLE)->cap, sizeof(A3_HT_ENTRY(K, V))))
+#define A3_HT_RELEASE_AOS(TABLE)                                                                   \
+    a3_large_free((TABLE)->entries, (TABLE)->cap, sizeof(*(TABLE)->entries))
+#define A3_HT_STORAGE_AOS(K, V, TABLE, ARRAYS, SIZES)                                              \
+    A3_M_BEGIN                                                                                     \
+        (ARRAYS)[0] = (TABLE)->entries;                                                            \
+        (SIZES)[0]  = (TABLE)->cap * sizeof(A3_HT_ENTRY(K, V));                                    \
+    A3_M_END
+#define A3_HT_ATTACH_AOS(K, V, TABLE, ARRAYS) (TABLE)->entries = (A3_HT_ENTRY(K, V)*)(ARRAYS)[0]
+
+#define A3_HT_VAL_SOA(TABLE, I) ((TABLE)->values[I])
+#define A3_HT_ALLOC_SOA(K, V, TABLE)                                                               \
+    A3_M_BEGIN                                                                                     \
+        A3_HT_ALLOC_AOS(K, V, TABLE);                                                              \
+        A3_UNWRAPN((TABLE)->values, (V*)a3_large_calloc((TABLE)->cap, sizeof(V)));                 \
+    A3_M_END
+#define A3_HT_RELEASE_SOA(TABLE)                                                                   \
+    A3_M_BEGIN                                                                                     \
+        A3_HT_RELEASE_AOS(TABLE);                                                                  \
+        a3_large_free((TABLE)->values, (TABLE)->cap, sizeof(*(TABLE)->values));                    \
+    A3_M_END
+#define A3_HT_STORAGE_SOA(K, V, TABLE, ARRAYS, SIZES)                                              \
+    A3_M_BEGIN                                                                                     \
+        A3_HT_STORAGE_AOS(K, V, TABLE, ARRAYS, SIZES);                                             \
+        (ARRAYS)[1] = (TABLE)->values;                                                             \
+        (SIZES)[1]  = (TABLE)->cap * sizeof(V);                                                    \
+    A3_M_END
+#define A3_HT_ATTACH_SOA(K, V, TABLE, ARRAYS)                                                      \
+    A3_M_BEGIN                                                                                     \
+        A3_HT_ATTACH_AOS(K, V, TABLE, ARRAYS);                                                     \
+        (TABLE)->values = (V*)(ARRAYS)[1];                                                         \
+    A3_M_END
+
+// SET keeps no values at all, for hash sets (see hs.h). The core still moves a value along with
+// each key, so every value refers to a single scratch slot in the table, which absorbs the moves.
+#define A3_HT_VAL_SET(TABLE, I)                       ((TABLE)->unit)
+#define A3_HT_ALLOC_SET(K, V, TABLE)                  A3_HT_ALLOC_AOS(K, V, TABLE)
+#define A3_HT_RELEASE_SET(TABLE)                      A3_HT_RELEASE_AOS(TABLE)
+#define A3_HT_STORAGE_SET(K, V, TABLE, ARRAYS, SIZES) A3_HT_STORAGE_AOS(K, V, TABLE, ARRAYS, SIZES)
+#define A3_HT_ATTACH_SET(K, V, TABLE, ARRAYS)         A3_HT_ATTACH_AOS(K, V, TABLE, ARRAYS)
+
+// Store a value while other threads fill other slots of the same table. Sets share one value
+// between all entries, so nothing is written.
+#define A3_HT_STORE_AOS(TABLE, I, VALUE) (A3_HT_VAL_AOS(TABLE, I) = (VALUE))
+#define A3_HT_STORE_SOA(TABLE, I, VALUE) (A3_HT_VAL_SOA(TABLE, I) = (VALUE))
+#define A3_HT_STORE_SET(TABLE, I, VALUE) ((void)(VALUE))
+
+#define A3_HT_DEFINE_VALUE_AT_(K, V, L)                                                            \
+    A3_ALWAYS_INLINE K* A3_HT_KEY_AT(K, V)(A3_HT(K, V) * table, size_t index) {                    \
+        assert(table);                                                                             \
+        return &table->entries[index].key;                                                         \
+    }                                                                                              \
+                                                                                                   \
+    A3_ALWAYS_INLINE V* A3_HT_VALUE_AT(K, V)(A3_HT(K, V) * table, size_t index) {                  \
+        assert(table);                                                                             \
+        return &A3_HT_VAL_##L(table, index);                                                       \
+    }
+#endif
+
 /// Define all types required for the given hash table.
 #define A3_HT_DEFINE_STRUCTS(K, V)                                                                 \
     A3_H_BEGIN                                                                                     \
                                                                                                    \
-    typedef bool (*A3_HT_DUP_CB(K, V))(V * current_value, V new_value);                            \
+    A3_HT_DEFINE_ENTRY_(K, V)                                                                      \
+                                                                                                   \
+    A3_HT(K, V) {                                                                                  \
+        bool     can_grow;                                                                         \
+        bool     mapped;                                                                           \
+        size_t   size;                                                                             \
+        size_t   cap;                                                                              \
+        uint64_t hash_key[A3_HT_HASH_KEY_SIZE];                                                    \
+        A3_HT_DUP_CB(K, V) duplicate_cb;                                                           \
+        A3_HT_COUNTERS_FIELD_                                                                      \
+        A3_HT_ENTRY(K, V) * entries;                                                               \
+    };                                                                                             \
+                                                                                                   \
+    A3_HT_DEFINE_VALUE_AT_(K, V, AOS)                                                              \
+                                                                                                   \
+    A3_H_END
+
+/// Define all types required for the given hash table, using the Swiss table layout. Must be paired
+/// with ::A3_HT_DEFINE_METHODS_SWISS.
+#define A3_HT_DEFINE_STRUCTS_SWISS(K, V)                                                           \
+    A3_H_BEGIN                                                                                     \
+                                                                                                   \
+    A3_HT_DEFINE_ENTRY_(K, V)                                                                      \
+                                                                                                   \
+    A3_HT(K, V) {                                                                                  \
+        bool     can_grow;                                                                         \
+        bool     mapped;                                                                           \
+        size_t   size;                                                                             \
+        size_t   cap;                                                                              \
+        uint64_t hash_key[A3_HT_HASH_KEY_SIZE];                                                    \
+        A3_HT_DUP_CB(K, V) duplicate_cb;                                                           \
+        A3_HT_COUNTERS_FIELD_                                                                      \
+        A3_HT_ENTRY(K, V) * entries;                                                               \
+        uint8_t* ctrl;                                                                             \
+        size_t   tombstones;                                                                       \
+    };                                                                                             \
+                                                                                                   \
+    A3_HT_DEFINE_VALUE_AT_(K, V, AOS)                                                              \
+                                                                                                   \
+    A3_H_END
+
+/// Define all types required for the given hash table, storing values apart from keys and hashes.
+/// Must be paired with ::A3_HT_DEFINE_METHODS_SPLIT.
+#define A3_HT_DEFINE_STRUCTS_SPLIT(K, V)                                                           \
+    A3_H_BEGIN                                                                                     \
+                                                                                                   \
+    A3_HT_DEFINE_CALLBACKS_(K, V)                                                                  \
                                                                                                    \
     A3_HT_ENTRY(K, V) {                                                                            \
         K        key;                                                                              \
-        V        value;                                                                            \
         uint64_t hash;                                                                             \
     };                                                                                             \
                                                                                                    \
     A3_HT(K, V) {                                                                                  \
         bool     can_grow;                                                                         \
+        bool     mapped;                                                                           \
+        size_t   size;                                                                             \
+        size_t   cap;                                                                              \
+        uint64_t hash_key[A3_HT_HASH_KEY_SIZE];                                                    \
+        A3_HT_DUP_CB(K, V) duplicate_cb;                                                           \
+        A3_HT_COUNTERS_FIELD_                                                                      \
+        A3_HT_ENTRY(K, V) * entries;                                                               \
+        V* values;                                                                                 \
+    };                                                                                             \
+                                                                                                   \
+    A3_HT_DEFINE_VALUE_AT_(K, V, SOA)                                                              \
+                                                                                                   \
+    A3_H_END
+
+/// Define all types required for the given hash table, with incremental resizing. Must be paired
+/// with ::A3_HT_DEFINE_METHODS_INCREMENTAL.
+#define A3_HT_DEFINE_STRUCTS_INCREMENTAL(K, V)                                                     \
+    A3_H_BEGIN                                                                                     \
+                                                                                                   \
+    A3_HT_DEFINE_ENTRY_(K, V)                                                                      \
+                                                                                                   \
+    A3_HT(K, V) {                                                                                  \
+        bool     can_grow;                                                                         \
+        bool     mapped;                                                                           \
+        size_t   size;                                                                             \
+        size_t   cap;                                                                              \
+        uint64_t hash_key[A3_HT_HASH_KEY_SIZE];                                                    \
+        A3_HT_DUP_CB(K, V) duplicate_cb;                                                           \
+        A3_HT_COUNTERS_FIELD_                                                                      \
+        A3_HT_ENTRY(K, V) * entries;                                                               \
+        A3_HT_ENTRY(K, V) * old_entries;                                                           \
+        size_t old_cap;                                                                            \
+        size_t old_start;                                                                          \
+        size_t migrated;                                                                           \
+    };                                                                                             \
+                                                                                                   \
+    /* Indices past the current array refer to the old array, while it is being migrated. */       \
+    A3_ALWAYS_INLINE A3_HT_ENTRY(K, V) * A3_HT_ENTRY_AT(K, V)(A3_HT(K, V) * table, size_t index) { \
+        assert(table);                                                                             \
+        return index < table->cap ? &table->entries[index]                                         \
+                                  : &table->old_entries[index - table->cap];                       \
+    }                                                                                              \
+                                                                                                   \
+    A3_ALWAYS_INLINE K* A3_HT_KEY_AT(K, V)(A3_HT(K, V) * table, size_t index) {                    \
+        return &A3_HT_ENTRY_AT(K, V)(table, index)->key;                                           \
+    }                                                                                              \
+                                                                                                   \
+    A3_ALWAYS_INLINE V* A3_HT_VALUE_AT(K, V)(A3_HT(K, V) * table, size_t index) {                  \
+        return &A3_HT_ENTRY_AT(K, V)(table, index)->value;                                         \
+    }                                                                                              \
+                                                                                                   \
+    A3_H_END
+
+/// Define all types required for the given hash table, keeping entries in insertion order. Must be
+/// paired with ::A3_HT_DEFINE_METHODS_ORDERED.
+#define A3_HT_DEFINE_STRUCTS_ORDERED(K, V)                                                         \
+    A3_H_BEGIN                                                                                     \
+                                                                                                   \
+    A3_HT_DEFINE_ENTRY_(K, V)                                                                      \
+                                                                                                   \
+    A3_HT(K, V) {                                                                                  \
+        bool     can_grow;                                                                         \
+        bool     mapped;                                                                           \
+        size_t   size;                                                                             \
+        size_t   cap;                                                                              \
+        uint64_t hash_key[A3_HT_HASH_KEY_SIZE];                                                    \
+        A3_HT_DUP_CB(K, V) duplicate_cb;                                                           \
+        A3_HT_COUNTERS_FIELD_                                                                      \
+        A3_HT_ENTRY(K, V) * entries;                                                               \
+        A3HTSlot* slots;                                                                           \
+        size_t    used;                                                                            \
+    };                                                                                             \
+                                                                                                   \
+    A3_HT_DEFINE_VALUE_AT_(K, V, AOS)                                                              \
+                                                                                                   \
+    A3_H_END
+
+/// Define all types required for the given hash table, with compact entries holding only the key
+/// and value. A `BITS`-bit fingerprint of each hash (16 or 32) and a displacement byte are kept in
+/// separate arrays, parallel to the entries, in place of the full hash. Must be paired with
+/// ::A3_HT_DEFINE_METHODS_COMPACT.
+#define A3_HT_DEFINE_STRUCTS_COMPACT(K, V, BITS)                                                   \
+    A3_H_BEGIN                                                                                     \
+                                                                                                   \
+    A3_HT_DEFINE_CALLBACKS_(K, V)                                                                  \
+    typedef uint##BITS##_t A3_HT_TAG(K, V);                                                        \
+                                                                                                   \
+    A3_HT_ENTRY(K, V) {                                                                            \
+        K key;                                                                                     \
+        V value;                                                                                   \
+    };                                                                                             \
+                                                                                                   \
+    A3_HT(K, V) {                                                                                  \
+        bool     can_grow;                                                                         \
+        bool     mapped;                                                                           \
         size_t   size;                                                                             \
         size_t   cap;                                                                              \
         uint64_t hash_key[A3_HT_HASH_KEY_SIZE];                                                    \
         A3_HT_DUP_CB(K, V) duplicate_cb;                                                           \
+        A3_HT_COUNTERS_FIELD_                                                                      \
         A3_HT_ENTRY(K, V) * entries;                                                               \
+        A3_HT_TAG(K, V) * tags;                                                                    \
+        uint8_t* dists;                                                                            \
     };                                                                                             \
                                                                                                    \
+    A3_HT_DEFINE_VALUE_AT_(K, V, AOS)                                                              \
+                                                                                                   \
     A3_H_END
 
 #ifndef DOXYGEN
-#define A3_HT_HASH(K, V)         K##V##_a3_ht_hash
 #define A3_HT_DEFAULT_HASH(K, V) K##V##_a3_ht_default_hash
 #define A3_HT_PROBE_COUNT(K, V)  K##V##_a3_ht_probe_count
 #define A3_HT_INSERT_AT(K, V)    K##V##_a3_ht_insert_at
+#define A3_HT_INSERT_SHIFT(K, V) K##V##_a3_ht_insert_shift
 #define A3_HT_RESIZE(K, V)       K##V##_a3_ht_resize
 #define A3_HT_GROW(K, V)         K##V##_a3_ht_grow
 #define A3_HT_FIND_INDEX(K, V)   K##V##_a3_ht_find_index
 #define A3_HT_FIND_ENTRY(K, V)   K##V##_a3_ht_find_entry
 #define A3_HT_NEXT_ENTRY(K, V)   K##V##a3_ht_next_entry
+#define A3_HT_LOOKUP(K, V)       K##V##_a3_ht_lookup
+#define A3_HT_FREE_SLOT(K, V)    K##V##_a3_ht_free_slot
+#define A3_HT_REHASH(K, V)       K##V##_a3_ht_rehash
+#define A3_HT_PLACE(K, V)        K##V##_a3_ht_place
+#define A3_HT_SHIFT_BACK(K, V)   K##V##_a3_ht_shift_back
+#define A3_HT_IS_MIGRATED(K, V)  K##V##_a3_ht_is_migrated
+#define A3_HT_MIGRATE(K, V)      K##V##_a3_ht_migrate
+#define A3_HT_KEY_AT(K, V)       K##V##_a3_ht_key_at
+#define A3_HT_VALUE_AT(K, V)     K##V##_a3_ht_value_at
+#define A3_HT_ENTRY_AT(K, V)     K##V##_a3_ht_entry_at
+#define A3_HT_PREFETCH(K, V)     K##V##_a3_ht_prefetch
+#define A3_HT_BEGIN_BATCH(K, V)  K##V##_a3_ht_begin_batch
+#define A3_HT_INIT_SLOTS(K, V)   K##V##_a3_ht_init_slots
+#define A3_HT_STORAGE(K, V)      K##V##_a3_ht_storage
+#define A3_HT_ATTACH(K, V)       K##V##_a3_ht_attach
+#define A3_HT_DISPLACEMENT(K, V) K##V##_a3_ht_displacement
+#define A3_HT_SLOT_OF(K, V)      K##V##_a3_ht_slot_of
+#define A3_HT_DISCARD(K, V)      K##V##_a3_ht_discard
+#define A3_HT_REPAIR(K, V)       K##V##_a3_ht_repair
+#define A3_HT_REPAIR_RANGE(K, V) K##V##_a3_ht_repair_range
+#define A3_HT_HASH_AT(K, V)      K##V##_a3_ht_hash_at
+#define A3_HT_PACK(K, V)         K##V##_a3_ht_pack
+#define A3_HT_BUILD_CTX(K, V)    struct K##V##A3HTBuild
+#define A3_HT_BUILD_HASH(K, V)   K##V##_a3_ht_build_hash
+#define A3_HT_PLACE_BATCH(K, V)  K##V##_a3_ht_place_batch
+#define A3_HT_PLACEMENT(K, V)    struct K##V##A3HTPlacement
+#define A3_HT_RANGE_OF(K, V)     K##V##_a3_ht_range_of
+#define A3_HT_PLACE_COUNT(K, V)  K##V##_a3_ht_place_count
+#define A3_HT_PLACE_SPREAD(K, V) K##V##_a3_ht_place_spread
+#define A3_HT_PLACE_RANGE(K, V)  K##V##_a3_ht_place_range
+
+#define A3_HT_FIND_INDEX_HASHED(K, V) K##V##_a3_ht_find_index_hashed
+#define A3_HT_FIND_STABLE(K, V)       K##V##_a3_ht_find_stable
+
+// Index arithmetic for the Robin Hood layout, selected by pasting a policy name. MOD supports any
+// capacity, at the cost of a division to find each home slot. POW2 keeps the capacity at a power
+// of two so that every wrap is a mask.
+#define A3_HT_CAP_MOD(CAP)               (CAP)
+#define A3_HT_HOME_MOD(CAP, HASH)        ((size_t)((HASH) % (CAP)))
+#define A3_HT_NEXT_MOD(CAP, I)           ((I) + 1 == (CAP) ? 0 : (I) + 1)
+#define A3_HT_PREV_MOD(CAP, I)           ((I) == 0 ? (CAP)-1 : (I)-1)
+#define A3_HT_DISTANCE_MOD(CAP, I, HOME) ((I) >= (HOME) ? (I) - (HOME) : (I) + (CAP) - (HOME))
+
+#define A3_HT_CAP_POW2(CAP)               a3_ht_pow2_cap(CAP)
+#define A3_HT_HOME_POW2(CAP, HASH)        ((size_t)(HASH) & ((CAP)-1))
+#define A3_HT_NEXT_POW2(CAP, I)           (((I) + 1) & ((CAP)-1))
+#define A3_HT_PREV_POW2(CAP, I)           (((I)-1) & ((CAP)-1))
+#define A3_HT_DISTANCE_POW2(CAP, I, HOME) (((I) - (HOME)) & ((CAP)-1))
+
+// The smallest capacity which holds N entries without exceeding the load factor.
+#define A3_HT_CAP_FOR(N) ((N)*100 / A3_HT_LOAD_FACTOR + 1)
+
+// The start of part I of N items split into PARTS nearly equal parts.
+#define A3_HT_SPLIT_(N, PARTS, I) ((N) * (I) / (PARTS))
 #endif
 
 ///
@@ -109,6 +977,54 @@ A3_H_END
 /// `A3_HT_NO_HASH_KEY`. `can_grow` should be `A3_HT_ALLOW_GROWTH` or `A3_HT_FORBID_GROWTH`.
 #define A3_HT_INIT(K, V) K##V##_a3_ht_init
 
+///
+///     void A3_HT_INIT_WITH_CAPACITY(K, V)(A3_HT(K, V)*, uint8_t * key, bool can_grow,
+///                                         size_t entries);
+///
+/// Initialize a new hash table, as with ::A3_HT_INIT, but sized so that `entries` entries can be
+/// inserted without the table growing.
+#define A3_HT_INIT_WITH_CAPACITY(K, V) K##V##_a3_ht_init_with_capacity
+
+///
+///     void A3_HT_RESERVE(K, V)(A3_HT(K, V)*, size_t entries);
+///
+/// Grow the table, if necessary, so that it can hold `entries` entries in total without growing
+/// again. This works even on a table created with `A3_HT_FORBID_GROWTH`.
+#define A3_HT_RESERVE(K, V) K##V##_a3_ht_reserve
+
+///
+///     void A3_HT_SHRINK_TO_FIT(K, V)(A3_HT(K, V)*);
+///
+/// Shrink the table to the smallest capacity which holds its current entries under the load
+/// factor, releasing the rest of its memory. Useful after a large number of deletions.
+#define A3_HT_SHRINK_TO_FIT(K, V) K##V##_a3_ht_shrink_to_fit
+
+///
+///     bool A3_HT_SAVE(K, V)(A3_HT(K, V)*, int fd);
+///
+/// Write a snapshot of the table to the file descriptor `fd`, which can later be opened with
+/// ::A3_HT_MAP. Keys and values are written as raw bytes, so both must be trivially copyable and
+/// free of pointers. Returns `false` if a write fails, in which case `errno` is set.
+#define A3_HT_SAVE(K, V) K##V##_a3_ht_save
+
+///
+///     bool A3_HT_MAP(K, V)(A3_HT(K, V)*, void* ptr, size_t len);
+///
+/// Open a snapshot written by ::A3_HT_SAVE over the `len` bytes at `ptr`, typically an `mmap`ed
+/// file. The table uses the memory in place, with no copying or rehashing. `ptr` must be aligned
+/// to ::A3_HT_SNAPSHOT_ALIGN, as any page is. Returns `false` if the memory does not hold a
+/// snapshot of a table with the same layout, key type, and value type.
+#define A3_HT_MAP(K, V) K##V##_a3_ht_map
+
+///
+///     void A3_HT_STATS(K, V)(A3_HT(K, V)*, A3HTStats* stats);
+///
+/// Fill in `stats` with the table's load and the distribution of its entries' displacements. This
+/// examines every slot, so it is not for hot paths. The work counters in `stats->counters` are
+/// only maintained when the library's `profile` option (`-DPROFILE`) is enabled, and are zero
+/// otherwise.
+#define A3_HT_STATS(K, V) K##V##_a3_ht_stats
+
 ///
 ///     A3_HT(K, V)* A3_HT_NEW(K, V)(uint8_t * key, bool can_grow);
 ///
@@ -146,13 +1062,19 @@ A3_H_END
 /// * If there was an existing entry, and no duplicate callback was set, returns `false`.
 /// * If there was an existing entry, and there is a duplicate callback, invokes the duplicate
 /// callback and returns its result.
+/// * In a table with compact entries (see ::A3_HT_DEFINE_STRUCTS_COMPACT), if inserting the key
+/// would displace it or another entry 255 or more slots from home, and growing cannot help because
+/// the table was created with `A3_HT_FORBID_GROWTH` or is already less than a quarter full, returns
+/// `false` and leaves the table unchanged.
 #define A3_HT_INSERT(K, V) K##V##_a3_ht_insert
 
 ///
 ///     V* A3_HT_FIND(K, V)(A3_HT(K, V)*, K);
 ///
 /// Find an entry (if any) with the given key. Returns a pointer into the table, or `NULL` if such
-/// an entry does not exist.
+/// an entry does not exist. Lookups never move entries, so the pointer is valid until the table is
+/// next modified. On an incrementally-resized table, ::A3_HT_FIND_INDEX and ::A3_HT_FIND_ENTRY
+/// count as modifications (see "Incremental Resizing" above).
 #define A3_HT_FIND(K, V) K##V##_a3_ht_find
 
 ///
@@ -168,22 +1090,124 @@ A3_H_END
 #define A3_HT_DELETE(K, V) K##V##_a3_ht_delete
 
 ///
-///     size_t A3_HT_SIZE(K, V)(A3_HT(K, V) * table);
+///     uint64_t A3_HT_HASH(K, V)(A3_HT(K, V)*, K);
 ///
-/// Get the current number of entries in the table.
-#define A3_HT_SIZE(K, V) K##V##_a3_ht_size
+/// Compute the hash of a key, for use with the `_HASHED` methods. The hash depends only on the key,
+/// the hash function, and the table's hash key, so it can be reused with any table which shares
+/// both (see ::A3_HT_HASH_KEY).
+#define A3_HT_HASH(K, V) K##V##_a3_ht_hash
 
-/// Declare all methods for the given hash table. The declarations from ::A3_HT_DEFINE_STRUCTS must
-/// be visible.
-#define A3_HT_DECLARE_METHODS(K, V)                                                                \
-    A3_H_BEGIN                                                                                     \
+///
+///     V* A3_HT_FIND_HASHED(K, V)(A3_HT(K, V)*, uint64_t hash, K);
+///
+/// Equivalent to ::A3_HT_FIND, with a hash previously computed by ::A3_HT_HASH.
+#define A3_HT_FIND_HASHED(K, V) K##V##_a3_ht_find_hashed
+
+///
+///     bool A3_HT_INSERT_HASHED(K, V)(A3_HT(K, V)*, uint64_t hash, K, V);
+///
+/// Equivalent to ::A3_HT_INSERT, with a hash previously computed by ::A3_HT_HASH.
+#define A3_HT_INSERT_HASHED(K, V) K##V##_a3_ht_insert_hashed
+
+///
+///     bool A3_HT_DELETE_HASHED(K, V)(A3_HT(K, V)*, uint64_t hash, K);
+///
+/// Equivalent to ::A3_HT_DELETE, with a hash previously computed by ::A3_HT_HASH.
+#define A3_HT_DELETE_HASHED(K, V) K##V##_a3_ht_delete_hashed
+
+/// The hash key of an initialized table, which can be passed as the `key` argument of ::A3_HT_INIT
+/// or ::A3_HT_NEW. Tables created this way, and which use the same hash function, agree on the hash
+/// of every key, so one ::A3_HT_HASH can serve lookups in all of them.
+#define A3_HT_HASH_KEY(TABLE) ((uint8_t*)(TABLE)->hash_key)
+
+///
+///     void A3_HT_FIND_BATCH(K, V)(A3_HT(K, V)*, K const* keys, size_t count, V** out);
+///
+/// Find the entries with each of `count` keys, storing a pointer to each value (or `NULL`) in the
+/// corresponding element of `out`. Equivalent to calling ::A3_HT_FIND on each key, but keys are
+/// hashed and their slots prefetched ::A3_HT_BATCH_SIZE at a time, so that the cache misses of
+/// separate lookups overlap. The pointers are valid until the table is next modified.
+#define A3_HT_FIND_BATCH(K, V) K##V##_a3_ht_find_batch
+
+///
+///     size_t A3_HT_INSERT_BATCH(K, V)(A3_HT(K, V)*, K const* keys, V const* values, size_t count);
+///
+/// Insert `count` entries in order, prefetching as ::A3_HT_FIND_BATCH does. Returns the number of
+/// entries for which ::A3_HT_INSERT would have returned `true`.
+#define A3_HT_INSERT_BATCH(K, V) K##V##_a3_ht_insert_batch
+
+///
+///     size_t A3_HT_BUILD_PARALLEL(K, V)(A3_HT(K, V)*, K const* keys, V const* values,
+///                                       size_t count, size_t nthreads);
+///
+/// Insert `count` entries, using up to `nthreads` threads, and return the number of entries for
+/// which ::A3_HT_INSERT would have returned `true`. The table is first grown to hold them all, if
+/// it is allowed to grow. The result holds the same entries as that of ::A3_HT_INSERT_BATCH, and
+/// each slot is filled by an entry with the same home slot, though entries which share a home slot
+/// may be in a different order. Keys are hashed in parallel by every layout. In a Robin Hood table
+/// which starts out empty, the entries are also sorted by home slot and placed in parallel, each
+/// thread filling its own range of slots, and only those which spill out of the end of a range are
+/// inserted one at a time afterwards. Each thread is given at least ::A3_HT_PARALLEL_MIN entries.
+/// The duplicate callback, if any, may run on any of the threads, but never on two values with the
+/// same key at once.
+#define A3_HT_BUILD_PARALLEL(K, V) K##V##_a3_ht_build_parallel
+
+///
+///     void A3_HT_CLEAR(K, V)(A3_HT(K, V)*);
+///
+/// Remove every entry, keeping the table's capacity. This resets the table's slots in bulk, rather
+/// than deleting entries one at a time.
+#define A3_HT_CLEAR(K, V) K##V##_a3_ht_clear
+
+///
+///     size_t A3_HT_RETAIN(K, V)(A3_HT(K, V)*, A3_HT_RETAIN_CB(K, V) pred, void* ctx);
+///
+/// Remove every entry for which `pred(ctx, &key, &value)` returns `false`, and return the number
+/// removed. The entries are visited in a single pass, and the table is repaired once at the end,
+/// so the whole operation costs O(capacity) with sequential access, however many entries go.
+/// `pred` must not modify the table.
+#define A3_HT_RETAIN(K, V) K##V##_a3_ht_retain
+
+///
+///     void A3_HT_DRAIN(K, V)(A3_HT(K, V)*, A3_HT_DRAIN_CB(K, V) cb, void* ctx);
+///
+/// Call `cb(ctx, &key, &value)` on every entry, if `cb` is not `NULL`, and then ::A3_HT_CLEAR the
+/// table. `cb` must not modify the table.
+#define A3_HT_DRAIN(K, V) K##V##_a3_ht_drain
+
+///
+///     size_t A3_HT_MERGE(K, V)(A3_HT(K, V) * dst, A3_HT(K, V) * src);
+///
+/// Insert every entry of `src` into `dst`, which grows once up front rather than repeatedly, if it
+/// is allowed to grow. Keys already in `dst` are handled as by ::A3_HT_INSERT, and the return value
+/// is the number of entries for which it would have returned `true`. When both tables share a hash
+/// key (see ::A3_HT_HASH_KEY), keys are not hashed again.
+#define A3_HT_MERGE(K, V) K##V##_a3_ht_merge
+
+///
+///     size_t A3_HT_SIZE(K, V)(A3_HT(K, V) * table);
+///
+/// Get the current number of entries in the table.
+#define A3_HT_SIZE(K, V) K##V##_a3_ht_size
+
+/// Declare all methods for the given hash table. The declarations from ::A3_HT_DEFINE_STRUCTS must
+/// be visible.
+#define A3_HT_DECLARE_METHODS(K, V)                                                                \
+    A3_H_BEGIN                                                                                     \
     void A3_HT_INIT(K, V)(A3_HT(K, V)*, uint8_t * key, bool can_grow);                             \
+    void A3_HT_INIT_WITH_CAPACITY(K, V)(A3_HT(K, V)*, uint8_t * key, bool can_grow, size_t);       \
+    void A3_HT_INIT_SLOTS(K, V)(A3_HT(K, V)*, uint8_t * key, bool can_grow, size_t);               \
     A3_HT(K, V) * A3_HT_NEW(K, V)(uint8_t * key, bool can_grow);                                   \
     void A3_HT_SET_DUPLICATE_CB(K, V)(A3_HT(K, V)*, A3_HT_DUP_CB(K, V));                           \
     void A3_HT_DESTROY(K, V)(A3_HT(K, V)*);                                                        \
     void A3_HT_FREE(K, V)(A3_HT(K, V)*);                                                           \
                                                                                                    \
     void A3_HT_RESIZE(K, V)(A3_HT(K, V)*, size_t);                                                 \
+    void A3_HT_RESERVE(K, V)(A3_HT(K, V)*, size_t);                                                \
+    void A3_HT_SHRINK_TO_FIT(K, V)(A3_HT(K, V)*);                                                  \
+    bool A3_HT_SAVE(K, V)(A3_HT(K, V)*, int fd);                                                   \
+    bool A3_HT_MAP(K, V)(A3_HT(K, V)*, void* ptr, size_t len);                                     \
+    void A3_HT_STATS(K, V)(A3_HT(K, V)*, A3HTStats*);                                              \
                                                                                                    \
     bool       A3_HT_INSERT(K, V)(A3_HT(K, V)*, K, V);                                             \
     A3_SSIZE_T A3_HT_FIND_INDEX(K, V)(A3_HT(K, V)*, K);                                            \
@@ -191,6 +1215,20 @@ A3_H_END
     V*         A3_HT_FIND(K, V)(A3_HT(K, V)*, K);                                                  \
     bool       A3_HT_DELETE_INDEX(K, V)(A3_HT(K, V)*, size_t);                                     \
     bool       A3_HT_DELETE(K, V)(A3_HT(K, V)*, K);                                                \
+    void       A3_HT_FIND_BATCH(K, V)(A3_HT(K, V)*, K const*, size_t, V**);                        \
+    size_t     A3_HT_INSERT_BATCH(K, V)(A3_HT(K, V)*, K const*, V const*, size_t);                 \
+    size_t A3_HT_BUILD_PARALLEL(K, V)(A3_HT(K, V)*, K const*, V const*, size_t, size_t);           \
+                                                                                                   \
+    void   A3_HT_CLEAR(K, V)(A3_HT(K, V)*);                                                        \
+    size_t A3_HT_RETAIN(K, V)(A3_HT(K, V)*, A3_HT_RETAIN_CB(K, V), void*);                         \
+    void   A3_HT_DRAIN(K, V)(A3_HT(K, V)*, A3_HT_DRAIN_CB(K, V), void*);                           \
+    size_t A3_HT_MERGE(K, V)(A3_HT(K, V)*, A3_HT(K, V)*);                                          \
+                                                                                                   \
+    uint64_t   A3_HT_HASH(K, V)(A3_HT(K, V)*, K);                                                  \
+    A3_SSIZE_T A3_HT_FIND_INDEX_HASHED(K, V)(A3_HT(K, V)*, uint64_t, K);                           \
+    V*         A3_HT_FIND_HASHED(K, V)(A3_HT(K, V)*, uint64_t, K);                                 \
+    bool       A3_HT_INSERT_HASHED(K, V)(A3_HT(K, V)*, uint64_t, K, V);                            \
+    bool       A3_HT_DELETE_HASHED(K, V)(A3_HT(K, V)*, uint64_t, K);                               \
     A3_SSIZE_T A3_HT_NEXT_ENTRY(K, V)(A3_HT(K, V)*, size_t index);                                 \
                                                                                                    \
     A3_ALWAYS_INLINE size_t A3_HT_SIZE(K, V)(A3_HT(K, V) * table) {                                \
@@ -199,23 +1237,393 @@ A3_H_END
     }                                                                                              \
     A3_H_END
 
-/// Define methods with a custom hash function. H has the signature:
-///
-///     uint64_t H(A3_HT(K, V)* table, K key);
-///
-/// C is a comparator, and must return zero for equal keys. It has the signature:
-///
-///     int8_t C(K lhs, K rhs);
-#define A3_HT_DEFINE_METHODS_HASHER(K, V, H, C)                                                    \
-    static uint64_t A3_HT_HASH(K, V)(A3_HT(K, V) * table, K key) {                                 \
+#ifndef DOXYGEN
+#define A3_HT_DEFINE_HASH_(K, V, H)                                                                \
+    uint64_t A3_HT_HASH(K, V)(A3_HT(K, V) * table, K key) {                                        \
         assert(table);                                                                             \
         uint64_t ret = H(table, key);                                                              \
         return ret ? ret : 1;                                                                      \
+    }
+
+#define A3_HT_DEFINE_DEFAULT_HASH_(K, V, KEY_BYTES, KEY_SIZE)                                      \
+    static uint64_t A3_HT_DEFAULT_HASH(K, V)(A3_HT(K, V) * table, K key) {                         \
+        assert(table);                                                                             \
+        /* See above definition w/ alignas. */                                                     \
+        return HighwayHash64(KEY_BYTES(key), KEY_SIZE(key), table->hash_key);                      \
+    }
+
+// Robin Hood primitives over a bare array of entries of type E, for layouts which manage their own
+// arrays. The functions are named PREFIX_probe_count, PREFIX_lookup, PREFIX_place, and
+// PREFIX_shift_back, and use the index policy P. Probes are counted in `counters`, which may be
+// NULL. Readers which only look entries up can define just the first two with
+// A3_HT_DEFINE_RH_LOOKUP_.
+#define A3_HT_DEFINE_RH_LOOKUP_(K, E, PREFIX, C, P)                                                \
+    static size_t PREFIX##_probe_count(size_t cap, size_t index, uint64_t hash) {                  \
+        return A3_HT_DISTANCE_##P(cap, index, A3_HT_HOME_##P(cap, hash));                          \
+    }                                                                                              \
+                                                                                                   \
+    static A3_SSIZE_T PREFIX##_lookup(E * entries, size_t cap, uint64_t hash, K key,               \
+                                      A3HTCounters * counters) {                                   \
+        assert(entries);                                                                           \
+                                                                                                   \
+        A3_HT_COUNT_(counters, probes);                                                            \
+        for (size_t i = A3_HT_HOME_##P(cap, hash), probe_count = 0;;                               \
+             i = A3_HT_NEXT_##P(cap, i), probe_count++) {                                          \
+            A3_HT_COUNT_(counters, probe_steps);                                                   \
+            E* entry = &entries[i];                                                                \
+            if (!entry->hash || PREFIX##_probe_count(cap, i, entry->hash) < probe_count)           \
+                return -1;                                                                         \
+            if (hash == entry->hash && C(key, entry->key) == 0)                                    \
+                return (A3_SSIZE_T)i;                                                              \
+        }                                                                                          \
+    }
+
+#define A3_HT_DEFINE_RH_PRIMITIVES_(K, E, PREFIX, C, P)                                            \
+    A3_HT_DEFINE_RH_LOOKUP_(K, E, PREFIX, C, P)                                                    \
+                                                                                                   \
+    /* Place an entry whose key is known to be absent. Returns the index at which it lands. */     \
+    static size_t PREFIX##_place(E * entries, size_t cap, E entry, A3HTCounters * counters) {      \
+        assert(entries);                                                                           \
+        assert(entry.hash);                                                                        \
+                                                                                                   \
+        A3_SSIZE_T ret = -1;                                                                       \
+        A3_HT_COUNT_(counters, probes);                                                            \
+        for (size_t i = A3_HT_HOME_##P(cap, entry.hash), probe_count = 0;;                         \
+             i = A3_HT_NEXT_##P(cap, i), probe_count++) {                                          \
+            A3_HT_COUNT_(counters, probe_steps);                                                   \
+            E* current = &entries[i];                                                              \
+            if (!current->hash) {                                                                  \
+                *current = entry;                                                                  \
+                return ret < 0 ? i : (size_t)ret;                                                  \
+            }                                                                                      \
+                                                                                                   \
+            if (PREFIX##_probe_count(cap, i, current->hash) < probe_count) {                       \
+                E displaced = *current;                                                            \
+                *current    = entry;                                                               \
+                entry       = displaced;                                                           \
+                probe_count = PREFIX##_probe_count(cap, i, entry.hash);                            \
+                if (ret < 0)                                                                       \
+                    ret = (A3_SSIZE_T)i;                                                           \
+            }                                                                                      \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    /* Remove the entry at the given index, shifting the following sequence of entries back. */    \
+    static void PREFIX##_shift_back(E * entries, size_t cap, size_t index) {                       \
+        assert(entries);                                                                           \
+                                                                                                   \
+        size_t i = A3_HT_NEXT_##P(cap, index);                                                     \
+        while (entries[i].hash && PREFIX##_probe_count(cap, i, entries[i].hash)) {                 \
+            entries[index] = entries[i];                                                           \
+            index          = i;                                                                    \
+            i              = A3_HT_NEXT_##P(cap, i);                                               \
+        }                                                                                          \
+        entries[index].hash = 0;                                                                   \
+    }
+
+// Methods which do not depend on the table layout.
+#define A3_HT_DEFINE_COMMON_METHODS_(K, V)                                                         \
+    void A3_HT_INIT(K, V)(A3_HT(K, V) * table, uint8_t * key, bool can_grow) {                     \
+        A3_HT_INIT_SLOTS(K, V)(table, key, can_grow, A3_HT_INITIAL_CAP);                           \
+    }                                                                                              \
+                                                                                                   \
+    void A3_HT_INIT_WITH_CAPACITY(K, V)(A3_HT(K, V) * table, uint8_t * key, bool can_grow,         \
+                                        size_t entries) {                                          \
+        size_t cap = A3_HT_CAP_FOR(entries);                                                       \
+        if (cap < A3_HT_INITIAL_CAP)                                                               \
+            cap = A3_HT_INITIAL_CAP;                                                               \
+        A3_HT_INIT_SLOTS(K, V)(table, key, can_grow, cap);                                         \
+    }                                                                                              \
+                                                                                                   \
+    void A3_HT_RESERVE(K, V)(A3_HT(K, V) * table, size_t entries) {                                \
+        assert(table);                                                                             \
+        size_t cap = A3_HT_CAP_FOR(entries);                                                       \
+        if (cap > table->cap)                                                                      \
+            A3_HT_RESIZE(K, V)(table, cap);                                                        \
+    }                                                                                              \
+                                                                                                   \
+    void A3_HT_SHRINK_TO_FIT(K, V)(A3_HT(K, V) * table) {                                          \
+        assert(table);                                                                             \
+        size_t cap = A3_HT_CAP_FOR(table->size);                                                   \
+        if (cap < A3_HT_INITIAL_CAP)                                                               \
+            cap = A3_HT_INITIAL_CAP;                                                               \
+        if (cap < table->cap)                                                                      \
+            A3_HT_RESIZE(K, V)(table, cap);                                                        \
+    }                                                                                              \
+                                                                                                   \
+    void A3_HT_STATS(K, V)(A3_HT(K, V) * table, A3HTStats * stats) {                               \
+        assert(table);                                                                             \
+        assert(stats);                                                                             \
+                                                                                                   \
+        memset(stats, 0, sizeof(*stats));                                                          \
+        for (A3_SSIZE_T i = A3_HT_NEXT_ENTRY(K, V)(table, 0); i >= 0;                              \
+             i            = A3_HT_NEXT_ENTRY(K, V)(table, (size_t)i + 1))                          \
+            a3_ht_stats_add(stats, A3_HT_DISPLACEMENT(K, V)(table, (size_t)i));                    \
+                                                                                                   \
+        stats->size = table->size;                                                                 \
+        stats->cap  = table->cap;                                                                  \
+        stats->load = (double)table->size / (double)table->cap;                                    \
+        if (table->size)                                                                           \
+            stats->mean_displacement /= (double)table->size;                                       \
+        A3_HT_COPY_COUNTERS_(stats, A3_HT_COUNTERS_(table));                                       \
+    }                                                                                              \
+                                                                                                   \
+    bool A3_HT_SAVE(K, V)(A3_HT(K, V) * table, int fd) {                                           \
+        assert(table);                                                                             \
+                                                                                                   \
+        A3HTSnapshot header;                                                                       \
+        void*        arrays[A3_HT_SNAPSHOT_ARRAYS] = { NULL };                                     \
+        size_t       sizes[A3_HT_SNAPSHOT_ARRAYS]  = { 0 };                                        \
+        memset(&header, 0, sizeof(header));                                                        \
+        header.magic      = A3_HT_SNAPSHOT_MAGIC;                                                  \
+        header.layout     = A3_HT_STORAGE(K, V)(table, arrays, sizes);                             \
+        header.entry_size = sizeof(A3_HT_ENTRY(K, V));                                             \
+        header.value_size = sizeof(V);                                                             \
+        header.size       = table->size;                                                           \
+        header.cap        = table->cap;                                                            \
+        memcpy(header.hash_key, table->hash_key, sizeof(header.hash_key));                         \
+        for (size_t i = 0; i < A3_HT_SNAPSHOT_ARRAYS; i++)                                         \
+            header.array_size[i] = sizes[i];                                                       \
+                                                                                                   \
+        return a3_ht_snapshot_save(fd, &header, arrays);                                           \
+    }                                                                                              \
+                                                                                                   \
+    bool A3_HT_MAP(K, V)(A3_HT(K, V) * table, void* ptr, size_t len) {                             \
+        assert(table);                                                                             \
+        assert(ptr);                                                                               \
+                                                                                                   \
+        if (!a3_ht_snapshot_valid(ptr, len))                                                       \
+            return false;                                                                          \
+        A3HTSnapshot const* header = (A3HTSnapshot const*)ptr;                                     \
+                                                                                                   \
+        A3_HT(K, V) mapped;                                                                        \
+        void*  arrays[A3_HT_SNAPSHOT_ARRAYS] = { NULL };                                           \
+        size_t sizes[A3_HT_SNAPSHOT_ARRAYS]  = { 0 };                                              \
+        memset(&mapped, 0, sizeof(mapped));                                                        \
+        mapped.cap = (size_t)header->cap;                                                          \
+        if (A3_HT_STORAGE(K, V)(&mapped, arrays, sizes) != header->layout ||                       \
+            header->entry_size != sizeof(A3_HT_ENTRY(K, V)) || header->value_size != sizeof(V))    \
+            return false;                                                                          \
+        for (size_t i = 0; i < A3_HT_SNAPSHOT_ARRAYS; i++) {                                       \
+            if (header->array_size[i] != sizes[i])                                                 \
+                return false;                                                                      \
+            arrays[i] = (uint8_t*)ptr + a3_ht_snapshot_offset(header, i);                          \
+        }                                                                                          \
+                                                                                                   \
+        mapped.size   = (size_t)header->size;                                                      \
+        mapped.mapped = true;                                                                      \
+        A3_HT_ATTACH(K, V)(&mapped, arrays);                                                       \
+        memcpy(mapped.hash_key, header->hash_key, sizeof(mapped.hash_key));                        \
+        *table = mapped;                                                                           \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    A3_HT(K, V) * A3_HT_NEW(K, V)(uint8_t * key, bool can_grow) {                                  \
+        A3_HT(K, V)* ret = (A3_HT(K, V)*)calloc(1, sizeof(A3_HT(K, V)));                           \
+        A3_HT_INIT(K, V)(ret, key, can_grow);                                                      \
+        return ret;                                                                                \
+    }                                                                                              \
+                                                                                                   \
+    void A3_HT_SET_DUPLICATE_CB(K, V)(A3_HT(K, V) * table, A3_HT_DUP_CB(K, V) cb) {                \
+        assert(table);                                                                             \
+        table->duplicate_cb = cb;                                                                  \
+    }                                                                                              \
+                                                                                                   \
+    void A3_HT_FREE(K, V)(A3_HT(K, V) * table) {                                                   \
+        assert(table);                                                                             \
+        A3_HT_DESTROY(K, V)(table);                                                                \
+        free(table);                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    A3_SSIZE_T A3_HT_FIND_INDEX(K, V)(A3_HT(K, V) * table, K key) {                                \
+        assert(table);                                                                             \
+        return A3_HT_FIND_INDEX_HASHED(K, V)(table, A3_HT_HASH(K, V)(table, key), key);            \
+    }                                                                                              \
+                                                                                                   \
+    bool A3_HT_INSERT(K, V)(A3_HT(K, V) * table, K key, V value) {                                 \
+        assert(table);                                                                             \
+        return A3_HT_INSERT_HASHED(K, V)(table, A3_HT_HASH(K, V)(table, key), key, value);         \
+    }                                                                                              \
+                                                                                                   \
+    /* Hash a chunk of keys and prefetch all of their home slots before resolving any of them, so  \
+     * that the cache misses of different keys overlap. */                                         \
+    void A3_HT_FIND_BATCH(K, V)(A3_HT(K, V) * table, K const* keys, size_t count, V** out) {       \
+        assert(table);                                                                             \
+        assert(!count || (keys && out));                                                           \
+                                                                                                   \
+        A3_HT_BEGIN_BATCH(K, V)(table, count);                                                     \
+                                                                                                   \
+        uint64_t hashes[A3_HT_BATCH_SIZE];                                                         \
+        for (size_t base = 0; base < count; base += A3_HT_BATCH_SIZE) {                            \
+            size_t n = MIN(count - base, (size_t)A3_HT_BATCH_SIZE);                                \
+            for (size_t i = 0; i < n; i++) {                                                       \
+                hashes[i] = A3_HT_HASH(K, V)(table, keys[base + i]);                               \
+                A3_HT_PREFETCH(K, V)(table, hashes[i]);                                            \
+            }                                                                                      \
+            for (size_t i = 0; i < n; i++)                                                         \
+                out[base + i] = A3_HT_FIND_STABLE(K, V)(table, hashes[i], keys[base + i]);         \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    size_t A3_HT_INSERT_BATCH(K, V)(A3_HT(K, V) * table, K const* keys, V const* values,           \
+                                    size_t count) {                                                \
+        assert(table);                                                                             \
+        assert(!count || (keys && values));                                                        \
+                                                                                                   \
+        size_t   ret = 0;                                                                          \
+        uint64_t hashes[A3_HT_BATCH_SIZE];                                                         \
+        for (size_t base = 0; base < count; base += A3_HT_BATCH_SIZE) {                            \
+            size_t n = MIN(count - base, (size_t)A3_HT_BATCH_SIZE);                                \
+            for (size_t i = 0; i < n; i++) {                                                       \
+                hashes[i] = A3_HT_HASH(K, V)(table, keys[base + i]);                               \
+                A3_HT_PREFETCH(K, V)(table, hashes[i]);                                            \
+            }                                                                                      \
+            for (size_t i = 0; i < n; i++)                                                         \
+                ret += A3_HT_INSERT_HASHED(K, V)(table, hashes[i], keys[base + i],                 \
+                                                 values[base + i]);                                \
+        }                                                                                          \
+                                                                                                   \
+        return ret;                                                                                \
+    }                                                                                              \
+                                                                                                   \
+    /* The keys hashed by each thread of A3_HT_BUILD_PARALLEL. */                                  \
+    A3_HT_BUILD_CTX(K, V) {                                                                        \
+        A3_HT(K, V) * table;                                                                       \
+        K const*  keys;                                                                            \
+        uint64_t* hashes;                                                                          \
+        size_t    count;                                                                           \
+        size_t    threads;                                                                         \
+    };                                                                                             \
+                                                                                                   \
+    static void A3_HT_BUILD_HASH(K, V)(void* arg, size_t index) {                                  \
+        A3_HT_BUILD_CTX(K, V)* ctx = (A3_HT_BUILD_CTX(K, V)*)arg;                                  \
+        size_t end                 = A3_HT_SPLIT_(ctx->count, ctx->threads, index + 1);            \
+        for (size_t i = A3_HT_SPLIT_(ctx->count, ctx->threads, index); i < end; i++)               \
+            ctx->hashes[i] = A3_HT_HASH(K, V)(ctx->table, ctx->keys[i]);                           \
+    }                                                                                              \
+                                                                                                   \
+    size_t A3_HT_BUILD_PARALLEL(K, V)(A3_HT(K, V) * table, K const* keys, V const* values,         \
+                                      size_t count, size_t nthreads) {                             \
+        assert(table);                                                                             \
+        assert(!count || (keys && values));                                                        \
+                                                                                                   \
+        if (table->can_grow)                                                                       \
+            A3_HT_RESERVE(K, V)(table, table->size + count);                                       \
+                                                                                                   \
+        size_t threads = MIN(nthreads, count / (size_t)A3_HT_PARALLEL_MIN);                        \
+        if (threads <= 1)                                                                          \
+            return A3_HT_INSERT_BATCH(K, V)(table, keys, values, count);                           \
+                                                                                                   \
+        A3_HT_BUILD_CTX(K, V) ctx = { table, keys, NULL, count, threads };                         \
+        A3_UNWRAPN(ctx.hashes, (uint64_t*)calloc(count, sizeof(uint64_t)));                        \
+        a3_shim_parallel(threads, A3_HT_BUILD_HASH(K, V), &ctx);                                   \
+                                                                                                   \
+        size_t ret = A3_HT_PLACE_BATCH(K, V)(table, keys, values, ctx.hashes, count, threads);     \
+        free(ctx.hashes);                                                                          \
+        return ret;                                                                                \
+    }                                                                                              \
+                                                                                                   \
+    A3_HT_ENTRY(K, V) * A3_HT_FIND_ENTRY(K, V)(A3_HT(K, V) * table, K key) {                       \
+        assert(table);                                                                             \
+        A3_SSIZE_T i = A3_HT_FIND_INDEX(K, V)(table, key);                                         \
+        if (i < 0)                                                                                 \
+            return NULL;                                                                           \
+        return &table->entries[i];                                                                 \
+    }                                                                                              \
+                                                                                                   \
+    /* Every layout can find a value without moving entries, even where finding its index          \
+     * cannot. */                                                                                  \
+    V* A3_HT_FIND_HASHED(K, V)(A3_HT(K, V) * table, uint64_t hash, K key) {                        \
+        assert(table);                                                                             \
+        return A3_HT_FIND_STABLE(K, V)(table, hash, key);                                          \
+    }                                                                                              \
+                                                                                                   \
+    V* A3_HT_FIND(K, V)(A3_HT(K, V) * table, K key) {                                              \
+        assert(table);                                                                             \
+        return A3_HT_FIND_HASHED(K, V)(table, A3_HT_HASH(K, V)(table, key), key);                  \
+    }                                                                                              \
+                                                                                                   \
+    bool A3_HT_DELETE_HASHED(K, V)(A3_HT(K, V) * table, uint64_t hash, K key) {                    \
+        assert(table);                                                                             \
+                                                                                                   \
+        A3_SSIZE_T index = A3_HT_FIND_INDEX_HASHED(K, V)(table, hash, key);                        \
+        if (index < 0)                                                                             \
+            return false;                                                                          \
+        return A3_HT_DELETE_INDEX(K, V)(table, (size_t)index);                                     \
+    }                                                                                              \
+                                                                                                   \
+    bool A3_HT_DELETE(K, V)(A3_HT(K, V) * table, K key) {                                          \
+        assert(table);                                                                             \
+        return A3_HT_DELETE_HASHED(K, V)(table, A3_HT_HASH(K, V)(table, key), key);                \
+    }                                                                                              \
+                                                                                                   \
+    /* Entries are only marked as they are visited, which leaves probe sequences broken until the  \
+     * single repair at the end. */                                                                \
+    size_t A3_HT_RETAIN(K, V)(A3_HT(K, V) * table, A3_HT_RETAIN_CB(K, V) pred, void* ctx) {        \
+        assert(table);                                                                             \
+        assert(pred);                                                                              \
+                                                                                                   \
+        size_t ret = 0;                                                                            \
+        for (A3_SSIZE_T i = A3_HT_NEXT_ENTRY(K, V)(table, 0); i >= 0;                              \
+             i            = A3_HT_NEXT_ENTRY(K, V)(table, (size_t)i + 1)) {                        \
+            if (pred(ctx, A3_HT_KEY_AT(K, V)(table, (size_t)i),                                    \
+                     A3_HT_VALUE_AT(K, V)(table, (size_t)i)))                                      \
+                continue;                                                                          \
+            A3_HT_DISCARD(K, V)(table, (size_t)i);                                                 \
+            ret++;                                                                                 \
+        }                                                                                          \
+        if (ret)                                                                                   \
+            A3_HT_REPAIR(K, V)(table);                                                             \
+                                                                                                   \
+        return ret;                                                                                \
+    }                                                                                              \
+                                                                                                   \
+    void A3_HT_DRAIN(K, V)(A3_HT(K, V) * table, A3_HT_DRAIN_CB(K, V) cb, void* ctx) {              \
+        assert(table);                                                                             \
+                                                                                                   \
+        if (cb) {                                                                                  \
+            for (A3_SSIZE_T i = A3_HT_NEXT_ENTRY(K, V)(table, 0); i >= 0;                          \
+                 i            = A3_HT_NEXT_ENTRY(K, V)(table, (size_t)i + 1))                      \
+                cb(ctx, A3_HT_KEY_AT(K, V)(table, (size_t)i),                                      \
+                   A3_HT_VALUE_AT(K, V)(table, (size_t)i));                                        \
+        }                                                                                          \
+        A3_HT_CLEAR(K, V)(table);                                                                  \
     }                                                                                              \
                                                                                                    \
+    size_t A3_HT_MERGE(K, V)(A3_HT(K, V) * dst, A3_HT(K, V) * src) {                               \
+        assert(dst);                                                                               \
+        assert(src);                                                                               \
+        if (dst == src)                                                                            \
+            return 0;                                                                              \
+                                                                                                   \
+        if (dst->can_grow)                                                                         \
+            A3_HT_RESERVE(K, V)(dst, dst->size + src->size);                                       \
+                                                                                                   \
+        bool   same_key = memcmp(dst->hash_key, src->hash_key, sizeof(dst->hash_key)) == 0;        \
+        size_t ret      = 0;                                                                       \
+        for (A3_SSIZE_T i = A3_HT_NEXT_ENTRY(K, V)(src, 0); i >= 0;                                \
+             i            = A3_HT_NEXT_ENTRY(K, V)(src, (size_t)i + 1)) {                          \
+            K        key   = *A3_HT_KEY_AT(K, V)(src, (size_t)i);                                  \
+            uint64_t hash  = same_key ? A3_HT_HASH_AT(K, V)(src, (size_t)i)                        \
+                                      : A3_HT_HASH(K, V)(dst, key);                                \
+            V*       value = A3_HT_VALUE_AT(K, V)(src, (size_t)i);                                 \
+            ret += A3_HT_INSERT_HASHED(K, V)(dst, hash, key, *value);                              \
+        }                                                                                          \
+                                                                                                   \
+        return ret;                                                                                \
+    }
+#endif
+
+
+#ifndef DOXYGEN
+// The Robin Hood layout, with index arithmetic given by the policy P (MOD or POW2), and storage
+// given by L (AOS, with values inside entries, or SOA, with values in a parallel array).
+#define A3_HT_DEFINE_METHODS_RH_(K, V, H, C, P, L)                                                 \
+    A3_HT_DEFINE_HASH_(K, V, H)                                                                    \
+                                                                                                   \
     static size_t A3_HT_PROBE_COUNT(K, V)(A3_HT(K, V) * table, size_t index, uint64_t hash) {      \
         assert(table);                                                                             \
-        return (index + table->cap - hash % table->cap) % table->cap;                              \
+        return A3_HT_DISTANCE_##P(table->cap, index, A3_HT_HOME_##P(table->cap, hash));            \
     }                                                                                              \
                                                                                                    \
     static bool A3_HT_INSERT_AT(K, V)(A3_HT(K, V) * table, uint64_t hash, K key, V value) {        \
@@ -223,16 +1631,19 @@ A3_H_END
         assert(hash);                                                                              \
         assert(table->cap > 0ULL);                                                                 \
                                                                                                    \
+        A3_HT_COUNT_(A3_HT_COUNTERS_(table), probes);                                              \
         /* NOLINTNEXTLINE(clang-analyzer-core.UndefinedBinaryOperatorResult) */                    \
-        for (size_t i = hash % table->cap, probe_count = 0;;                                       \
-             i = (i + 1) % table->cap, probe_count++) {                                            \
+        for (size_t i = A3_HT_HOME_##P(table->cap, hash), probe_count = 0;;                        \
+             i = A3_HT_NEXT_##P(table->cap, i), probe_count++) {                                   \
+            A3_HT_COUNT_(A3_HT_COUNTERS_(table), probe_steps);                                     \
             A3_HT_ENTRY(K, V)* current_entry = &table->entries[i];                                 \
                                                                                                    \
             /* Empty hash? It's free real estate. */                                               \
             if (!current_entry->hash) {                                                            \
-                current_entry->key   = key;                                                        \
-                current_entry->value = value;                                                      \
-                current_entry->hash  = hash;                                                       \
+                current_entry->key      = key;                                                     \
+                A3_HT_VAL_##L(table, i) = value;                                                   \
+                current_entry->hash     = hash;                                                    \
+                table->size++;                                                                     \
                 return true;                                                                       \
             }                                                                                      \
                                                                                                    \
@@ -240,22 +1651,73 @@ A3_H_END
             if (hash == current_entry->hash && C(key, current_entry->key) == 0) {                  \
                 if (!table->duplicate_cb)                                                          \
                     return false;                                                                  \
-                return table->duplicate_cb(&current_entry->value, value);                          \
+                return table->duplicate_cb(&A3_HT_VAL_##L(table, i), value);                       \
             }                                                                                      \
                                                                                                    \
             if (A3_HT_PROBE_COUNT(K, V)(table, i, current_entry->hash) < probe_count) {            \
                 A3_HT_ENTRY(K, V) old_entry = *current_entry;                                      \
+                V old_value                 = A3_HT_VAL_##L(table, i);                             \
                 current_entry->key          = key;                                                 \
-                current_entry->value        = value;                                               \
+                A3_HT_VAL_##L(table, i)     = value;                                               \
                 current_entry->hash         = hash;                                                \
                 key                         = old_entry.key;                                       \
-                value                       = old_entry.value;                                     \
+                value                       = old_value;                                           \
                 hash                        = old_entry.hash;                                      \
                 probe_count                 = A3_HT_PROBE_COUNT(K, V)(table, i, hash);             \
             }                                                                                      \
         }                                                                                          \
     }                                                                                              \
                                                                                                    \
+    /* As A3_HT_INSERT_AT, but rather than swapping with the first richer entry and carrying it    \
+     * onwards, shift the rest of the run forward by one slot. The run keeps its order, so entries \
+     * with the same home stay in insertion order, which A3_HT_PLACE_BATCH relies on when it       \
+     * inserts the entries spilled out of a range. This passes over the run twice, so ordinary     \
+     * insertions swap instead. */                                                                 \
+    static bool A3_HT_INSERT_SHIFT(K, V)(A3_HT(K, V) * table, uint64_t hash, K key, V value) {     \
+        assert(table);                                                                             \
+        assert(hash);                                                                              \
+        assert(table->cap > 0ULL);                                                                 \
+                                                                                                   \
+        A3_HT_COUNT_(A3_HT_COUNTERS_(table), probes);                                              \
+        /* NOLINTNEXTLINE(clang-analyzer-core.UndefinedBinaryOperatorResult) */                    \
+        for (size_t i = A3_HT_HOME_##P(table->cap, hash), probe_count = 0;;                        \
+             i = A3_HT_NEXT_##P(table->cap, i), probe_count++) {                                   \
+            A3_HT_COUNT_(A3_HT_COUNTERS_(table), probe_steps);                                     \
+            A3_HT_ENTRY(K, V)* current_entry = &table->entries[i];                                 \
+                                                                                                   \
+            if (!current_entry->hash) {                                                            \
+                current_entry->key      = key;                                                     \
+                A3_HT_VAL_##L(table, i) = value;                                                   \
+                current_entry->hash     = hash;                                                    \
+                table->size++;                                                                     \
+                return true;                                                                       \
+            }                                                                                      \
+                                                                                                   \
+            if (hash == current_entry->hash && C(key, current_entry->key) == 0) {                  \
+                if (!table->duplicate_cb)                                                          \
+                    return false;                                                                  \
+                return table->duplicate_cb(&A3_HT_VAL_##L(table, i), value);                       \
+            }                                                                                      \
+                                                                                                   \
+            if (A3_HT_PROBE_COUNT(K, V)(table, i, current_entry->hash) < probe_count) {            \
+                size_t end = i;                                                                    \
+                while (table->entries[end].hash)                                                   \
+                    end = A3_HT_NEXT_##P(table->cap, end);                                         \
+                for (size_t j = end; j != i;) {                                                    \
+                    size_t prev             = A3_HT_PREV_##P(table->cap, j);                       \
+                    table->entries[j]       = table->entries[prev];                                \
+                    A3_HT_VAL_##L(table, j) = A3_HT_VAL_##L(table, prev);                          \
+                    j                       = prev;                                                \
+                }                                                                                  \
+                current_entry->key      = key;                                                     \
+                A3_HT_VAL_##L(table, i) = value;                                                   \
+                current_entry->hash     = hash;                                                    \
+                table->size++;                                                                     \
+                return true;                                                                       \
+            }                                                                                      \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
     A3_SSIZE_T A3_HT_NEXT_ENTRY(K, V)(A3_HT(K, V) * table, size_t index) {                         \
         for (; index < table->cap; index++)                                                        \
             if (table->entries[index].hash)                                                        \
@@ -265,22 +1727,25 @@ A3_H_END
                                                                                                    \
     void A3_HT_RESIZE(K, V)(A3_HT(K, V) * table, size_t new_cap) {                                 \
         assert(table);                                                                             \
-        assert(new_cap > table->cap);                                                              \
+        assert(new_cap > table->size);                                                             \
                                                                                                    \
-        A3_HT_ENTRY(K, V)* prev_entries = table->entries;                                          \
-        size_t prev_cap                 = table->cap;                                              \
-        table->cap                      = new_cap;                                                 \
-        table->entries = (A3_HT_ENTRY(K, V)*)(calloc(table->cap, sizeof(A3_HT_ENTRY(K, V))));      \
+        A3_HT_COUNT_(A3_HT_COUNTERS_(table), resizes);                                             \
+        A3_HT(K, V) prev = *table;                                                                 \
+        table->cap       = A3_HT_CAP_##P(new_cap);                                                 \
+        table->size      = 0;                                                                      \
+        table->mapped    = false;                                                                  \
+        A3_HT_ALLOC_##L(K, V, table);                                                              \
                                                                                                    \
-        for (size_t i = 0; i < prev_cap; i++) {                                                    \
-            A3_HT_ENTRY(K, V)* current_entry = &prev_entries[i];                                   \
+        for (size_t i = 0; i < prev.cap; i++) {                                                    \
+            A3_HT_ENTRY(K, V)* current_entry = &prev.entries[i];                                   \
             if (!current_entry->hash)                                                              \
                 continue;                                                                          \
             A3_HT_INSERT_AT(K, V)                                                                  \
-            (table, current_entry->hash, current_entry->key, current_entry->value);                \
+            (table, current_entry->hash, current_entry->key, A3_HT_VAL_##L(&prev, i));             \
         }                                                                                          \
                                                                                                    \
-        free(prev_entries);                                                                        \
+        if (!prev.mapped)                                                                          \
+            A3_HT_RELEASE_##L(&prev);                                                              \
     }                                                                                              \
                                                                                                    \
     static bool A3_HT_GROW(K, V)(A3_HT(K, V) * table) {                                            \
@@ -291,12 +1756,23 @@ A3_H_END
         return true;                                                                               \
     }                                                                                              \
                                                                                                    \
-    A3_SSIZE_T A3_HT_FIND_INDEX(K, V)(A3_HT(K, V) * table, K key) {                                \
+    static void A3_HT_PREFETCH(K, V)(A3_HT(K, V) * table, uint64_t hash) {                         \
+        assert(table);                                                                             \
+        A3_PREFETCH(&table->entries[A3_HT_HOME_##P(table->cap, hash)]);                            \
+    }                                                                                              \
+                                                                                                   \
+    static void A3_HT_BEGIN_BATCH(K, V)(A3_HT(K, V) * table, size_t count) {                       \
+        (void)table;                                                                               \
+        (void)count;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    A3_SSIZE_T A3_HT_FIND_INDEX_HASHED(K, V)(A3_HT(K, V) * table, uint64_t hash, K key) {          \
         assert(table);                                                                             \
                                                                                                    \
-        uint64_t hash = A3_HT_HASH(K, V)(table, key);                                              \
-        for (size_t i = hash % table->cap, probe_count = 0;;                                       \
-             i = (i + 1) % table->cap, probe_count++) {                                            \
+        A3_HT_COUNT_(A3_HT_COUNTERS_(table), probes);                                              \
+        for (size_t i = A3_HT_HOME_##P(table->cap, hash), probe_count = 0;;                        \
+             i = A3_HT_NEXT_##P(table->cap, i), probe_count++) {                                   \
+            A3_HT_COUNT_(A3_HT_COUNTERS_(table), probe_steps);                                     \
             A3_HT_ENTRY(K, V)* current_entry = &table->entries[i];                                 \
             if (!current_entry->hash ||                                                            \
                 A3_HT_PROBE_COUNT(K, V)(table, i, current_entry->hash) < probe_count)              \
@@ -306,72 +1782,224 @@ A3_H_END
         }                                                                                          \
     }                                                                                              \
                                                                                                    \
-    A3_HT_ENTRY(K, V) * A3_HT_FIND_ENTRY(K, V)(A3_HT(K, V) * table, K key) {                       \
-        assert(table);                                                                             \
-        A3_SSIZE_T i = A3_HT_FIND_INDEX(K, V)(table, key);                                         \
-        if (i < 0)                                                                                 \
-            return NULL;                                                                           \
-        return &table->entries[i];                                                                 \
-    }                                                                                              \
-                                                                                                   \
-    void A3_HT_INIT(K, V)(A3_HT(K, V) * table, uint8_t * key, bool can_grow) {                     \
+    void A3_HT_INIT_SLOTS(K, V)(A3_HT(K, V) * table, uint8_t * key, bool can_grow, size_t cap) {   \
         assert(table);                                                                             \
         memset(table, 0, sizeof(*table));                                                          \
         table->can_grow = can_grow;                                                                \
         table->size     = 0;                                                                       \
-        table->cap      = A3_HT_INITIAL_CAP;                                                       \
-        if (key) {                                                                                 \
-            memcpy(table->hash_key, key, A3_HT_HASH_KEY_SIZE);                                     \
-        } else {                                                                                   \
-            uint8_t* key_bytes = (uint8_t*)&table->hash_key[0];                                    \
-            for (size_t i = 0; i < A3_HT_HASH_KEY_SIZE * sizeof(table->hash_key[0]); i++)          \
-                /* NOLINTNEXTLINE(concurrency-mt-unsafe, cert-msc30-c, cert-msc50-cpp) */          \
-                key_bytes[i] = (uint8_t)rand();                                                    \
-        }                                                                                          \
-        table->entries = (A3_HT_ENTRY(K, V)*)calloc(table->cap, sizeof(A3_HT_ENTRY(K, V)));        \
-        A3_UNWRAPND(table->entries);                                                               \
+        table->cap      = A3_HT_CAP_##P(cap);                                                      \
+        a3_ht_init_hash_key(table->hash_key, key);                                                 \
+        A3_HT_ALLOC_##L(K, V, table);                                                              \
     }                                                                                              \
                                                                                                    \
-    A3_HT(K, V) * A3_HT_NEW(K, V)(uint8_t * key, bool can_grow) {                                  \
-        A3_HT(K, V)* ret = (A3_HT(K, V)*)calloc(1, sizeof(A3_HT(K, V)));                           \
-        A3_HT_INIT(K, V)(ret, key, can_grow);                                                      \
-        return ret;                                                                                \
+    void A3_HT_DESTROY(K, V)(A3_HT(K, V) * table) {                                                \
+        assert(table);                                                                             \
+        if (!table->mapped)                                                                        \
+            A3_HT_RELEASE_##L(table);                                                              \
     }                                                                                              \
                                                                                                    \
-    void A3_HT_SET_DUPLICATE_CB(K, V)(A3_HT(K, V) * table, A3_HT_DUP_CB(K, V) cb) {                \
-        assert(table);                                                                             \
-        table->duplicate_cb = cb;                                                                  \
+    static size_t A3_HT_DISPLACEMENT(K, V)(A3_HT(K, V) * table, size_t index) {                    \
+        return A3_HT_PROBE_COUNT(K, V)(table, index, table->entries[index].hash);                  \
     }                                                                                              \
                                                                                                    \
-    void A3_HT_DESTROY(K, V)(A3_HT(K, V) * table) {                                                \
+    static uint32_t A3_HT_STORAGE(K, V)(A3_HT(K, V) * table, void* arrays[], size_t sizes[]) {     \
         assert(table);                                                                             \
-        if (table->entries)                                                                        \
-            free(table->entries);                                                                  \
+        A3_HT_STORAGE_##L(K, V, table, arrays, sizes);                                             \
+        return A3_HT_SNAPSHOT_TAG_##P | A3_HT_SNAPSHOT_TAG_##L;                                    \
     }                                                                                              \
                                                                                                    \
-    void A3_HT_FREE(K, V)(A3_HT(K, V) * table) {                                                   \
+    static void A3_HT_ATTACH(K, V)(A3_HT(K, V) * table, void* arrays[]) {                          \
         assert(table);                                                                             \
-        A3_HT_DESTROY(K, V)(table);                                                                \
-        free(table);                                                                               \
+        A3_HT_ATTACH_##L(K, V, table, arrays);                                                     \
     }                                                                                              \
                                                                                                    \
-    bool A3_HT_INSERT(K, V)(A3_HT(K, V) * table, K key, V value) {                                 \
+    static V* A3_HT_FIND_STABLE(K, V)(A3_HT(K, V) * table, uint64_t hash, K key) {                 \
+        A3_SSIZE_T i = A3_HT_FIND_INDEX_HASHED(K, V)(table, hash, key);                            \
+        return i < 0 ? NULL : &A3_HT_VAL_##L(table, i);                                            \
+    }                                                                                              \
+                                                                                                   \
+    bool A3_HT_INSERT_HASHED(K, V)(A3_HT(K, V) * table, uint64_t hash, K key, V value) {           \
         assert(table);                                                                             \
                                                                                                    \
         if (table->size * 100 >= table->cap * A3_HT_LOAD_FACTOR)                                   \
             if (!A3_HT_GROW(K, V)(table) && table->size >= table->cap)                             \
                 return false;                                                                      \
                                                                                                    \
-        table->size++;                                                                             \
-        return A3_HT_INSERT_AT(K, V)(table, A3_HT_HASH(K, V)(table, key), key, value);             \
+        return A3_HT_INSERT_AT(K, V)(table, hash, key, value);                                     \
     }                                                                                              \
                                                                                                    \
-    V* A3_HT_FIND(K, V)(A3_HT(K, V) * table, K key) {                                              \
+    /* The state shared by the threads of A3_HT_PLACE_BATCH. The slots are split into one range    \
+     * per thread, and the input into one chunk per thread. */                                     \
+    A3_HT_PLACEMENT(K, V) {                                                                        \
+        A3_HT(K, V) * table;                                                                       \
+        K const*        keys;                                                                      \
+        V const*        values;                                                                    \
+        uint64_t const* hashes;                                                                    \
+        size_t          count;                                                                     \
+        size_t          threads;                                                                   \
+        size_t*         counts;   /* For each chunk, the position of its entries in each range. */ \
+        size_t*         starts;   /* Range r is sorted[starts[r]..starts[r + 1]). */               \
+        size_t*         order;    /* Input indices, grouped by range. */                           \
+        size_t*         sorted;   /* Input indices, sorted by home slot within each range. */      \
+        size_t*         spills;   /* The first entry of each range which did not fit in it. */     \
+        size_t*         placed;   /* The number of slots filled in each range. */                  \
+        size_t*         inserted; /* The number of successful insertions in each range. */         \
+    };                                                                                             \
+                                                                                                   \
+    static size_t A3_HT_RANGE_OF(K, V)(A3_HT_PLACEMENT(K, V) * ctx, uint64_t hash) {               \
+        size_t cap = ctx->table->cap;                                                              \
+        return ((A3_HT_HOME_##P(cap, hash) + 1) * ctx->threads + cap - 1) / cap - 1;               \
+    }                                                                                              \
+                                                                                                   \
+    static void A3_HT_PLACE_COUNT(K, V)(void* arg, size_t index) {                                 \
+        A3_HT_PLACEMENT(K, V)* ctx = (A3_HT_PLACEMENT(K, V)*)arg;                                  \
+        size_t* counts             = &ctx->counts[index * ctx->threads];                           \
+        size_t  end                = A3_HT_SPLIT_(ctx->count, ctx->threads, index + 1);            \
+        for (size_t i = A3_HT_SPLIT_(ctx->count, ctx->threads, index); i < end; i++)               \
+            counts[A3_HT_RANGE_OF(K, V)(ctx, ctx->hashes[i])]++;                                   \
+    }                                                                                              \
+                                                                                                   \
+    static void A3_HT_PLACE_SPREAD(K, V)(void* arg, size_t index) {                                \
+        A3_HT_PLACEMENT(K, V)* ctx = (A3_HT_PLACEMENT(K, V)*)arg;                                  \
+        size_t* counts             = &ctx->counts[index * ctx->threads];                           \
+        size_t  end                = A3_HT_SPLIT_(ctx->count, ctx->threads, index + 1);            \
+        for (size_t i = A3_HT_SPLIT_(ctx->count, ctx->threads, index); i < end; i++)               \
+            ctx->order[counts[A3_HT_RANGE_OF(K, V)(ctx, ctx->hashes[i])]++] = i;                   \
+    }                                                                                              \
+                                                                                                   \
+    /* Fill one range of slots. Shifting insertion leaves the entries of a cluster sorted by home  \
+     * slot, and those with the same home in the order they were inserted, so that is the order    \
+     * they are placed in here, each in the first slot after both its home and the entry before    \
+     * it. Entries which would run past the end of the range are left for A3_HT_PLACE_BATCH. */    \
+    static void A3_HT_PLACE_RANGE(K, V)(void* arg, size_t index) {                                 \
+        A3_HT_PLACEMENT(K, V)* ctx = (A3_HT_PLACEMENT(K, V)*)arg;                                  \
+        A3_HT(K, V)* table         = ctx->table;                                                   \
+        size_t start               = A3_HT_SPLIT_(table->cap, ctx->threads, index);                \
+        size_t end                 = A3_HT_SPLIT_(table->cap, ctx->threads, index + 1);            \
+        size_t first               = ctx->starts[index];                                           \
+        size_t last                = ctx->starts[index + 1];                                       \
+                                                                                                   \
+        /* Counting sort by home slot, which keeps entries with the same home in input order. */   \
+        size_t* homes = NULL;                                                                      \
+        A3_UNWRAPN(homes, (size_t*)calloc(end - start + 1, sizeof(size_t)));                       \
+        for (size_t k = first; k < last; k++)                                                      \
+            homes[A3_HT_HOME_##P(table->cap, ctx->hashes[ctx->order[k]]) - start + 1]++;           \
+        for (size_t h = 1; h <= end - start; h++)                                                  \
+            homes[h] += homes[h - 1];                                                              \
+        for (size_t k = first; k < last; k++) {                                                    \
+            size_t i = ctx->order[k];                                                              \
+            ctx->sorted[first + homes[A3_HT_HOME_##P(table->cap, ctx->hashes[i]) - start]++] = i;  \
+        }                                                                                          \
+        free(homes);                                                                               \
+                                                                                                   \
+        size_t next     = start;                                                                   \
+        size_t home     = end;                                                                     \
+        size_t group    = start;                                                                   \
+        size_t placed   = 0;                                                                       \
+        size_t inserted = 0;                                                                       \
+        size_t k        = first;                                                                   \
+        for (; k < last; k++) {                                                                    \
+            size_t   i    = ctx->sorted[k];                                                        \
+            uint64_t hash = ctx->hashes[i];                                                        \
+            if (A3_HT_HOME_##P(table->cap, hash) != home) {                                        \
+                home  = A3_HT_HOME_##P(table->cap, hash);                                          \
+                group = MAX(home, next);                                                           \
+            }                                                                                      \
+                                                                                                   \
+            /* Any duplicate has the same home, and so is among the entries placed since group. */ \
+            size_t j = group;                                                                      \
+            while (j < next && !(table->entries[j].hash == hash &&                                 \
+                                 C(ctx->keys[i], table->entries[j].key) == 0))                     \
+                j++;                                                                               \
+            if (j < next) {                                                                        \
+                if (table->duplicate_cb)                                                           \
+                    inserted += table->duplicate_cb(&A3_HT_VAL_##L(table, j), ctx->values[i]);     \
+                continue;                                                                          \
+            }                                                                                      \
+                                                                                                   \
+            size_t slot = MAX(home, next);                                                         \
+            if (slot >= end)                                                                       \
+                break;                                                                             \
+            table->entries[slot].key = ctx->keys[i];                                               \
+            A3_HT_STORE_##L(table, slot, ctx->values[i]);                                          \
+            table->entries[slot].hash = hash;                                                      \
+            next                      = slot + 1;                                                  \
+            placed++;                                                                              \
+            inserted++;                                                                            \
+        }                                                                                          \
+                                                                                                   \
+        ctx->spills[index]   = k;                                                                  \
+        ctx->placed[index]   = placed;                                                             \
+        ctx->inserted[index] = inserted;                                                           \
+    }                                                                                              \
+                                                                                                   \
+    static size_t A3_HT_PLACE_BATCH(K, V)(A3_HT(K, V) * table, K const* keys, V const* values,     \
+                                          uint64_t const* hashes, size_t count, size_t threads) {  \
         assert(table);                                                                             \
                                                                                                    \
-        A3_HT_ENTRY(K, V)* entry = A3_HT_FIND_ENTRY(K, V)(table, key);                             \
-        A3_TRYB_MAP(entry, NULL);                                                                  \
-        return &entry->value;                                                                      \
+        /* Parallel placement assumes empty slots, which no insertion may grow. */                 \
+        if (table->size || table->mapped || count * 100 >= table->cap * A3_HT_LOAD_FACTOR) {       \
+            size_t ret = 0;                                                                        \
+            for (size_t i = 0; i < count; i++)                                                     \
+                ret += A3_HT_INSERT_HASHED(K, V)(table, hashes[i], keys[i], values[i]);            \
+            return ret;                                                                            \
+        }                                                                                          \
+                                                                                                   \
+        size_t  scratch_len = threads * threads + 4 * threads + 1 + 2 * count;                     \
+        size_t* scratch     = NULL;                                                                \
+        A3_UNWRAPN(scratch, (size_t*)calloc(scratch_len, sizeof(size_t)));                         \
+                                                                                                   \
+        A3_HT_PLACEMENT(K, V) ctx;                                                                 \
+        ctx.table    = table;                                                                      \
+        ctx.keys     = keys;                                                                       \
+        ctx.values   = values;                                                                     \
+        ctx.hashes   = hashes;                                                                     \
+        ctx.count    = count;                                                                      \
+        ctx.threads  = threads;                                                                    \
+        ctx.counts   = scratch;                                                                    \
+        ctx.starts   = ctx.counts + threads * threads;                                             \
+        ctx.spills   = ctx.starts + threads + 1;                                                   \
+        ctx.placed   = ctx.spills + threads;                                                       \
+        ctx.inserted = ctx.placed + threads;                                                       \
+        ctx.order    = ctx.inserted + threads;                                                     \
+        ctx.sorted   = ctx.order + count;                                                          \
+                                                                                                   \
+        a3_shim_parallel(threads, A3_HT_PLACE_COUNT(K, V), &ctx);                                  \
+                                                                                                   \
+        /* Lay the ranges out one after another, and within each, the entries of each chunk after  \
+         * those of the chunks before it, so that every range stays in input order. */             \
+        size_t total = 0;                                                                          \
+        for (size_t r = 0; r < threads; r++) {                                                     \
+            ctx.starts[r] = total;                                                                 \
+            for (size_t t = 0; t < threads; t++) {                                                 \
+                size_t n                    = ctx.counts[t * threads + r];                         \
+                ctx.counts[t * threads + r] = total;                                               \
+                total += n;                                                                        \
+            }                                                                                      \
+        }                                                                                          \
+        ctx.starts[threads] = total;                                                               \
+                                                                                                   \
+        a3_shim_parallel(threads, A3_HT_PLACE_SPREAD(K, V), &ctx);                                 \
+        a3_shim_parallel(threads, A3_HT_PLACE_RANGE(K, V), &ctx);                                  \
+                                                                                                   \
+        size_t ret = 0;                                                                            \
+        for (size_t r = 0; r < threads; r++) {                                                     \
+            table->size += ctx.placed[r];                                                          \
+            ret += ctx.inserted[r];                                                                \
+        }                                                                                          \
+                                                                                                   \
+        /* An entry which spilled out of its range belongs before every entry homed in the next    \
+         * one, so shifting it in displaces them exactly as shifting it in input order would have. \
+         * Each range's spill follows everything else homed in that range, and keeps its order. */ \
+        for (size_t r = 0; r < threads; r++) {                                                     \
+            for (size_t k = ctx.spills[r]; k < ctx.starts[r + 1]; k++) {                           \
+                size_t i = ctx.sorted[k];                                                          \
+                ret += A3_HT_INSERT_SHIFT(K, V)(table, hashes[i], keys[i], values[i]);             \
+            }                                                                                      \
+        }                                                                                          \
+                                                                                                   \
+        free(scratch);                                                                             \
+        return ret;                                                                                \
     }                                                                                              \
                                                                                                    \
     bool A3_HT_DELETE_INDEX(K, V)(A3_HT(K, V) * table, size_t index) {                             \
@@ -383,28 +2011,77 @@ A3_H_END
         table->size--;                                                                             \
                                                                                                    \
         /* Shift the following sequence of entries back. */                                        \
-        size_t i                      = ((size_t)index + 1) % table->cap;                          \
-        A3_HT_ENTRY(K, V)* next_entry = &table->entries[i];                                        \
-        while (next_entry->hash && A3_HT_PROBE_COUNT(K, V)(table, i, next_entry->hash)) {          \
-            entry->hash = 0;                                                                       \
-            *entry      = *next_entry;                                                             \
-            i           = (i + 1) % table->cap;                                                    \
-            entry       = next_entry;                                                              \
-            next_entry  = &table->entries[i];                                                      \
+        size_t i = A3_HT_NEXT_##P(table->cap, index);                                              \
+        while (table->entries[i].hash &&                                                           \
+               A3_HT_PROBE_COUNT(K, V)(table, i, table->entries[i].hash)) {                        \
+            table->entries[index]       = table->entries[i];                                       \
+            A3_HT_VAL_##L(table, index) = A3_HT_VAL_##L(table, i);                                 \
+            index                       = i;                                                       \
+            i                           = A3_HT_NEXT_##P(table->cap, i);                           \
         }                                                                                          \
-        entry->hash = 0;                                                                           \
+        table->entries[index].hash = 0;                                                            \
                                                                                                    \
         return true;                                                                               \
     }                                                                                              \
                                                                                                    \
-    bool A3_HT_DELETE(K, V)(A3_HT(K, V) * table, K key) {                                          \
+    void A3_HT_CLEAR(K, V)(A3_HT(K, V) * table) {                                                  \
         assert(table);                                                                             \
+        memset(table->entries, 0, table->cap * sizeof(A3_HT_ENTRY(K, V)));                         \
+        table->size = 0;                                                                           \
+    }                                                                                              \
                                                                                                    \
-        A3_SSIZE_T index = A3_HT_FIND_INDEX(K, V)(table, key);                                     \
-        if (index < 0)                                                                             \
-            return false;                                                                          \
-        return A3_HT_DELETE_INDEX(K, V)(table, (size_t)index);                                     \
-    }
+    static uint64_t A3_HT_HASH_AT(K, V)(A3_HT(K, V) * table, size_t index) {                       \
+        return table->entries[index].hash;                                                         \
+    }                                                                                              \
+                                                                                                   \
+    /* Empty a slot without shifting the entries after it back. See A3_HT_REPAIR. */               \
+    static void A3_HT_DISCARD(K, V)(A3_HT(K, V) * table, size_t index) {                           \
+        assert(table);                                                                             \
+        table->entries[index].hash = 0;                                                            \
+        table->size--;                                                                             \
+    }                                                                                              \
+                                                                                                   \
+    /* Move every entry as far back towards its home as the slots emptied by A3_HT_DISCARD allow.  \
+     * The sweep starts from an empty slot, but a run of entries may have crossed that slot before \
+     * it was emptied, so the sweep goes around twice. */                                          \
+    static void A3_HT_REPAIR(K, V)(A3_HT(K, V) * table) {                                          \
+        assert(table);                                                                             \
+                                                                                                   \
+        size_t hole = 0;                                                                           \
+        while (hole < table->cap && table->entries[hole].hash)                                     \
+            hole++;                                                                                \
+        if (hole == table->cap)                                                                    \
+            return;                                                                                \
+                                                                                                   \
+        for (size_t n = 0, i = hole; n < 2 * table->cap; n++, i = A3_HT_NEXT_##P(table->cap, i)) { \
+            uint64_t hash = table->entries[i].hash;                                                \
+            if (!hash)                                                                             \
+                continue;                                                                          \
+                                                                                                   \
+            size_t target      = i;                                                                \
+            size_t back        = A3_HT_DISTANCE_##P(table->cap, i, hole);                          \
+            size_t probe_count = A3_HT_PROBE_COUNT(K, V)(table, i, hash);                          \
+            if (back && probe_count)                                                               \
+                target = back <= probe_count ? hole : A3_HT_HOME_##P(table->cap, hash);            \
+            if (target != i) {                                                                     \
+                table->entries[target]       = table->entries[i];                                  \
+                A3_HT_VAL_##L(table, target) = A3_HT_VAL_##L(table, i);                            \
+                table->entries[i].hash       = 0;                                                  \
+            }                                                                                      \
+            hole = A3_HT_NEXT_##P(table->cap, target);                                             \
+        }                                                                                          \
+    }                                                                                              \
+    A3_HT_DEFINE_COMMON_METHODS_(K, V)
+#endif
+
+/// Define methods with a custom hash function. H has the signature:
+///
+///     uint64_t H(A3_HT(K, V)* table, K key);
+///
+/// C is a comparator, and must return zero for equal keys. It has the signature:
+///
+///     int8_t C(K lhs, K rhs);
+#define A3_HT_DEFINE_METHODS_HASHER(K, V, H, C) A3_HT_DEFINE_METHODS_RH_(K, V, H, C, MOD, AOS)
 
 /// Define methods with HighwayHash as the hash function. Helpers have the
 /// signatures:
@@ -414,21 +2091,1410 @@ A3_H_END
 ///
 /// See ::A3_HT_DEFINE_METHODS_HASHER for information on the comparator C.
 #define A3_HT_DEFINE_METHODS(K, V, KEY_BYTES, KEY_SIZE, C)                                         \
-    static uint64_t A3_HT_DEFAULT_HASH(K, V)(A3_HT(K, V) * table, K key) {                         \
+    A3_HT_DEFINE_DEFAULT_HASH_(K, V, KEY_BYTES, KEY_SIZE)                                          \
+                                                                                                   \
+    A3_HT_DEFINE_METHODS_HASHER(K, V, A3_HT_DEFAULT_HASH(K, V), C)
+
+/// Define methods for a table whose capacity is always a power of two, with a custom hash function.
+/// Such a table is defined with ::A3_HT_DEFINE_STRUCTS, and behaves identically to one defined with
+/// ::A3_HT_DEFINE_METHODS_HASHER, except that requested capacities are rounded up and each slot
+/// index is found with a mask rather than a division. Since only the low bits of the hash select
+/// the home slot, H must mix well into them.
+#define A3_HT_DEFINE_METHODS_POW2_HASHER(K, V, H, C)                                               \
+    A3_HT_DEFINE_METHODS_RH_(K, V, H, C, POW2, AOS)
+
+/// Define methods for a power-of-two table (see ::A3_HT_DEFINE_METHODS_POW2_HASHER) with
+/// HighwayHash as the hash function. See ::A3_HT_DEFINE_METHODS for the meaning of the helpers.
+#define A3_HT_DEFINE_METHODS_POW2(K, V, KEY_BYTES, KEY_SIZE, C)                                    \
+    A3_HT_DEFINE_DEFAULT_HASH_(K, V, KEY_BYTES, KEY_SIZE)                                          \
+                                                                                                   \
+    A3_HT_DEFINE_METHODS_POW2_HASHER(K, V, A3_HT_DEFAULT_HASH(K, V), C)
+
+/// Define methods for a table with values stored apart from entries (see
+/// ::A3_HT_DEFINE_STRUCTS_SPLIT), with a custom hash function. See
+/// ::A3_HT_DEFINE_METHODS_HASHER for the meaning of H and C.
+#define A3_HT_DEFINE_METHODS_SPLIT_HASHER(K, V, H, C)                                              \
+    A3_HT_DEFINE_METHODS_RH_(K, V, H, C, MOD, SOA)
+
+/// Define methods for a table with values stored apart from entries, with HighwayHash as the hash
+/// function. See ::A3_HT_DEFINE_METHODS for the meaning of the arguments.
+#define A3_HT_DEFINE_METHODS_SPLIT(K, V, KEY_BYTES, KEY_SIZE, C)                                   \
+    A3_HT_DEFINE_DEFAULT_HASH_(K, V, KEY_BYTES, KEY_SIZE)                                          \
+                                                                                                   \
+    A3_HT_DEFINE_METHODS_SPLIT_HASHER(K, V, A3_HT_DEFAULT_HASH(K, V), C)
+
+/// Define methods for a Swiss table (see ::A3_HT_DEFINE_STRUCTS_SWISS) with a custom hash function.
+/// See ::A3_HT_DEFINE_METHODS_HASHER for the meaning of H and C.
+#define A3_HT_DEFINE_METHODS_SWISS_HASHER(K, V, H, C)                                              \
+    A3_HT_DEFINE_HASH_(K, V, H)                                                                    \
+                                                                                                   \
+    static A3_SSIZE_T A3_HT_LOOKUP(K, V)(A3_HT(K, V) * table, uint64_t hash, K key) {              \
         assert(table);                                                                             \
-        /* See above definition w/ alignas. */                                                     \
-        return HighwayHash64(KEY_BYTES(key), KEY_SIZE(key), table->hash_key);                      \
+                                                                                                   \
+        size_t  mask = table->cap - 1;                                                             \
+        size_t  pos  = A3_HT_H1(hash) & mask;                                                      \
+        uint8_t tag  = A3_HT_H2(hash);                                                             \
+        A3_HT_COUNT_(A3_HT_COUNTERS_(table), probes);                                              \
+        /* Triangular probing visits every group exactly once. */                                  \
+        for (size_t stride = 0; stride <= mask;                                                    \
+             stride += A3_HT_GROUP_WIDTH, pos = (pos + stride) & mask) {                           \
+            A3_HT_COUNT_(A3_HT_COUNTERS_(table), probe_steps);                                     \
+            uint8_t const* group = &table->ctrl[pos];                                              \
+            for (uint64_t m = a3_ht_group_match(group, tag); m; m &= m - 1) {                      \
+                size_t             i     = (pos + a3_ht_group_first(m)) & mask;                    \
+                A3_HT_ENTRY(K, V)* entry = &table->entries[i];                                     \
+                if (entry->hash == hash && C(key, entry->key) == 0)                                \
+                    return (A3_SSIZE_T)i;                                                          \
+            }                                                                                      \
+            if (a3_ht_group_match_empty(group))                                                    \
+                return -1;                                                                         \
+        }                                                                                          \
+                                                                                                   \
+        return -1;                                                                                 \
     }                                                                                              \
                                                                                                    \
-    A3_HT_DEFINE_METHODS_HASHER(K, V, A3_HT_DEFAULT_HASH(K, V), C)
+    /* Find the first empty or deleted slot for the given hash. One must exist. */                 \
+    static size_t A3_HT_FREE_SLOT(K, V)(A3_HT(K, V) * table, uint64_t hash) {                      \
+        assert(table);                                                                             \
+        assert(table->size < table->cap);                                                          \
+                                                                                                   \
+        size_t mask = table->cap - 1;                                                              \
+        size_t pos  = A3_HT_H1(hash) & mask;                                                       \
+        A3_HT_COUNT_(A3_HT_COUNTERS_(table), probes);                                              \
+        for (size_t stride = 0;; stride += A3_HT_GROUP_WIDTH, pos = (pos + stride) & mask) {       \
+            A3_HT_COUNT_(A3_HT_COUNTERS_(table), probe_steps);                                     \
+            uint64_t m = a3_ht_group_match_free(&table->ctrl[pos]);                                \
+            if (m)                                                                                 \
+                return (pos + a3_ht_group_first(m)) & mask;                                        \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    static void A3_HT_REHASH(K, V)(A3_HT(K, V) * table, size_t new_cap) {                          \
+        assert(table);                                                                             \
+        assert(new_cap >= table->size);                                                            \
+                                                                                                   \
+        A3_HT_ENTRY(K, V)* prev_entries = table->entries;                                          \
+        uint8_t*           prev_ctrl    = table->ctrl;                                             \
+        size_t             prev_cap     = table->cap;                                              \
+        bool               prev_mapped  = table->mapped;                                           \
+                                                                                                   \
+        A3_HT_COUNT_(A3_HT_COUNTERS_(table), resizes);                                             \
+        table->cap        = new_cap;                                                               \
+        table->tombstones = 0;                                                                     \
+        table->mapped     = false;                                                                 \
+        A3_HT_ALLOC_AOS(K, V, table);                                                              \
+        table->ctrl = a3_ht_ctrl_new(table->cap);                                                  \
+                                                                                                   \
+        for (size_t i = 0; i < prev_cap; i++) {                                                    \
+            if (!a3_ht_ctrl_is_full(prev_ctrl[i]))                                                 \
+                continue;                                                                          \
+            size_t slot = A3_HT_FREE_SLOT(K, V)(table, prev_entries[i].hash);                      \
+            a3_ht_ctrl_set(table->ctrl, table->cap, slot, prev_ctrl[i]);                           \
+            table->entries[slot] = prev_entries[i];                                                \
+        }                                                                                          \
+                                                                                                   \
+        if (!prev_mapped) {                                                                        \
+            a3_large_free(prev_entries, prev_cap, sizeof(A3_HT_ENTRY(K, V)));                      \
+            a3_ht_ctrl_free(prev_ctrl, prev_cap);                                                  \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    static bool A3_HT_INSERT_AT(K, V)(A3_HT(K, V) * table, uint64_t hash, K key, V value) {        \
+        assert(table);                                                                             \
+        assert(hash);                                                                              \
+                                                                                                   \
+        A3_SSIZE_T existing = A3_HT_LOOKUP(K, V)(table, hash, key);                                \
+        if (existing >= 0) {                                                                       \
+            if (!table->duplicate_cb)                                                              \
+                return false;                                                                      \
+            return table->duplicate_cb(&table->entries[existing].value, value);                    \
+        }                                                                                          \
+                                                                                                   \
+        size_t i = A3_HT_FREE_SLOT(K, V)(table, hash);                                             \
+        if (table->ctrl[i] == A3_HT_CTRL_DELETED)                                                  \
+            table->tombstones--;                                                                   \
+        a3_ht_ctrl_set(table->ctrl, table->cap, i, A3_HT_H2(hash));                                \
+        table->entries[i].key   = key;                                                             \
+        table->entries[i].value = value;                                                           \
+        table->entries[i].hash  = hash;                                                            \
+        table->size++;                                                                             \
+                                                                                                   \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    A3_SSIZE_T A3_HT_NEXT_ENTRY(K, V)(A3_HT(K, V) * table, size_t index) {                         \
+        for (; index < table->cap; index++)                                                        \
+            if (a3_ht_ctrl_is_full(table->ctrl[index]))                                            \
+                return (A3_SSIZE_T)index;                                                          \
+        return -1;                                                                                 \
+    }                                                                                              \
+                                                                                                   \
+    void A3_HT_RESIZE(K, V)(A3_HT(K, V) * table, size_t new_cap) {                                 \
+        assert(table);                                                                             \
+        assert(new_cap > table->size);                                                             \
+                                                                                                   \
+        A3_HT_REHASH(K, V)(table, a3_ht_swiss_cap(new_cap));                                       \
+    }                                                                                              \
+                                                                                                   \
+    static bool A3_HT_GROW(K, V)(A3_HT(K, V) * table) {                                            \
+        assert(table);                                                                             \
+                                                                                                   \
+        /* Only grow if the table is really full, rather than just full of tombstones. */          \
+        if (table->can_grow && table->size * 200 >= table->cap * A3_HT_LOAD_FACTOR)                \
+            A3_HT_REHASH(K, V)(table, table->cap * 2);                                             \
+        else if (table->tombstones * 16 >= table->cap)                                             \
+            A3_HT_REHASH(K, V)(table, table->cap);                                                 \
+        else                                                                                       \
+            return false;                                                                          \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    static void A3_HT_PREFETCH(K, V)(A3_HT(K, V) * table, uint64_t hash) {                         \
+        assert(table);                                                                             \
+        size_t pos = A3_HT_H1(hash) & (table->cap - 1);                                            \
+        A3_PREFETCH(&table->ctrl[pos]);                                                            \
+        A3_PREFETCH(&table->entries[pos]);                                                         \
+    }                                                                                              \
+                                                                                                   \
+    static void A3_HT_BEGIN_BATCH(K, V)(A3_HT(K, V) * table, size_t count) {                       \
+        (void)table;                                                                               \
+        (void)count;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    A3_SSIZE_T A3_HT_FIND_INDEX_HASHED(K, V)(A3_HT(K, V) * table, uint64_t hash, K key) {          \
+        assert(table);                                                                             \
+        return A3_HT_LOOKUP(K, V)(table, hash, key);                                               \
+    }                                                                                              \
+                                                                                                   \
+    static V* A3_HT_FIND_STABLE(K, V)(A3_HT(K, V) * table, uint64_t hash, K key) {                 \
+        A3_SSIZE_T i = A3_HT_LOOKUP(K, V)(table, hash, key);                                       \
+        return i < 0 ? NULL : &table->entries[i].value;                                            \
+    }                                                                                              \
+                                                                                                   \
+    void A3_HT_INIT_SLOTS(K, V)(A3_HT(K, V) * table, uint8_t * key, bool can_grow, size_t cap) {   \
+        assert(table);                                                                             \
+        memset(table, 0, sizeof(*table));                                                          \
+        table->can_grow   = can_grow;                                                              \
+        table->size       = 0;                                                                     \
+        table->tombstones = 0;                                                                     \
+        table->cap        = a3_ht_swiss_cap(cap);                                                  \
+        a3_ht_init_hash_key(table->hash_key, key);                                                 \
+        A3_HT_ALLOC_AOS(K, V, table);                                                              \
+        table->ctrl = a3_ht_ctrl_new(table->cap);                                                  \
+    }                                                                                              \
+                                                                                                   \
+    void A3_HT_DESTROY(K, V)(A3_HT(K, V) * table) {                                                \
+        assert(table);                                                                             \
+        if (table->mapped)                                                                         \
+            return;                                                                                \
+        if (table->entries)                                                                        \
+            A3_HT_RELEASE_AOS(table);                                                              \
+        if (table->ctrl)                                                                           \
+            a3_ht_ctrl_free(table->ctrl, table->cap);                                              \
+    }                                                                                              \
+                                                                                                   \
+    /* The number of groups probed before the one holding the entry. */                            \
+    static size_t A3_HT_DISPLACEMENT(K, V)(A3_HT(K, V) * table, size_t index) {                    \
+        size_t mask = table->cap - 1;                                                              \
+        size_t pos  = A3_HT_H1(table->entries[index].hash) & mask;                                 \
+        size_t ret  = 0;                                                                           \
+        for (size_t stride = A3_HT_GROUP_WIDTH; ((index - pos) & mask) >= A3_HT_GROUP_WIDTH;       \
+             stride += A3_HT_GROUP_WIDTH, ret++)                                                   \
+            pos = (pos + stride) & mask;                                                           \
+        return ret;                                                                                \
+    }                                                                                              \
+                                                                                                   \
+    /* Tombstones are not recorded in a snapshot, so any are cleared first. */                     \
+    static uint32_t A3_HT_STORAGE(K, V)(A3_HT(K, V) * table, void* arrays[], size_t sizes[]) {     \
+        assert(table);                                                                             \
+        if (table->tombstones)                                                                     \
+            A3_HT_REHASH(K, V)(table, table->cap);                                                 \
+        arrays[0] = table->entries;                                                                \
+        sizes[0]  = table->cap * sizeof(A3_HT_ENTRY(K, V));                                        \
+        arrays[1] = table->ctrl;                                                                   \
+        sizes[1]  = table->cap + A3_HT_GROUP_WIDTH;                                                \
+        return A3_HT_SNAPSHOT_TAG_SWISS;                                                           \
+    }                                                                                              \
+                                                                                                   \
+    static void A3_HT_ATTACH(K, V)(A3_HT(K, V) * table, void* arrays[]) {                          \
+        assert(table);                                                                             \
+        table->entries = (A3_HT_ENTRY(K, V)*)arrays[0];                                            \
+        table->ctrl    = (uint8_t*)arrays[1];                                                      \
+    }                                                                                              \
+                                                                                                   \
+    bool A3_HT_INSERT_HASHED(K, V)(A3_HT(K, V) * table, uint64_t hash, K key, V value) {           \
+        assert(table);                                                                             \
+                                                                                                   \
+        if ((table->size + table->tombstones) * 100 >= table->cap * A3_HT_LOAD_FACTOR)             \
+            if (!A3_HT_GROW(K, V)(table) && table->size >= table->cap)                             \
+                return false;                                                                      \
+                                                                                                   \
+        return A3_HT_INSERT_AT(K, V)(table, hash, key, value);                                     \
+    }                                                                                              \
+                                                                                                   \
+    /* Hashes are known up front, so slots can be prefetched a batch ahead. */                     \
+    static size_t A3_HT_PLACE_BATCH(K, V)(A3_HT(K, V) * table, K const* keys, V const* values,     \
+                                          uint64_t const* hashes, size_t count, size_t threads) {  \
+        assert(table);                                                                             \
+        (void)threads;                                                                             \
+                                                                                                   \
+        size_t ret = 0;                                                                            \
+        for (size_t i = 0; i < count; i++) {                                                       \
+            if (i + A3_HT_BATCH_SIZE < count)                                                      \
+                A3_HT_PREFETCH(K, V)(table, hashes[i + A3_HT_BATCH_SIZE]);                         \
+            ret += A3_HT_INSERT_HASHED(K, V)(table, hashes[i], keys[i], values[i]);                \
+        }                                                                                          \
+                                                                                                   \
+        return ret;                                                                                \
+    }                                                                                              \
+                                                                                                   \
+    bool A3_HT_DELETE_INDEX(K, V)(A3_HT(K, V) * table, size_t index) {                             \
+        assert(table);                                                                             \
+        assert(index < table->cap);                                                                \
+        A3_TRYB(a3_ht_ctrl_is_full(table->ctrl[index]));                                           \
+                                                                                                   \
+        /* If every group containing this slot also contains an empty slot, no probe sequence has  \
+         * ever passed over it, and it can be marked empty rather than deleted. */                 \
+        size_t   mask  = table->cap - 1;                                                           \
+        uint64_t after = a3_ht_group_match_empty(&table->ctrl[index]);                             \
+        uint64_t before =                                                                          \
+            a3_ht_group_match_empty(&table->ctrl[(index - A3_HT_GROUP_WIDTH) & mask]);             \
+        if (after && before &&                                                                     \
+            a3_ht_group_trailing(after) + a3_ht_group_leading(before) < A3_HT_GROUP_WIDTH) {       \
+            a3_ht_ctrl_set(table->ctrl, table->cap, index, A3_HT_CTRL_EMPTY);                      \
+        } else {                                                                                   \
+            a3_ht_ctrl_set(table->ctrl, table->cap, index, A3_HT_CTRL_DELETED);                    \
+            table->tombstones++;                                                                   \
+        }                                                                                          \
+        table->entries[index].hash = 0;                                                            \
+        table->size--;                                                                             \
+                                                                                                   \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    void A3_HT_CLEAR(K, V)(A3_HT(K, V) * table) {                                                  \
+        assert(table);                                                                             \
+        memset(table->ctrl, A3_HT_CTRL_EMPTY, table->cap + A3_HT_GROUP_WIDTH);                     \
+        table->size       = 0;                                                                     \
+        table->tombstones = 0;                                                                     \
+    }                                                                                              \
+                                                                                                   \
+    static uint64_t A3_HT_HASH_AT(K, V)(A3_HT(K, V) * table, size_t index) {                       \
+        return table->entries[index].hash;                                                         \
+    }                                                                                              \
+                                                                                                   \
+    /* Deletion never moves other entries, so there is nothing to defer. */                        \
+    static void A3_HT_DISCARD(K, V)(A3_HT(K, V) * table, size_t index) {                           \
+        A3_HT_DELETE_INDEX(K, V)(table, index);                                                    \
+    }                                                                                              \
+                                                                                                   \
+    /* Clear out the tombstones left behind, if there are enough to lengthen probes. */            \
+    static void A3_HT_REPAIR(K, V)(A3_HT(K, V) * table) {                                          \
+        assert(table);                                                                             \
+        if (table->tombstones * 16 >= table->cap)                                                  \
+            A3_HT_REHASH(K, V)(table, table->cap);                                                 \
+    }                                                                                              \
+    A3_HT_DEFINE_COMMON_METHODS_(K, V)
 
-/// Iterate over every entry of the hash table `T`, storing keys in `K_OUT` and values in `V_OUT` on
-/// every iteration.
-#define A3_HT_FOR_EACH(K, V, T, K_OUT, V_OUT)                                                      \
-    A3_SSIZE_T K_OUT##_i = A3_HT_NEXT_ENTRY(K, V)((T), 0);                                         \
-    K*         K_OUT     = (K_OUT##_i >= 0) ? &(T)->entries[K_OUT##_i].key : NULL;                 \
-    V*         V_OUT     = (K_OUT##_i >= 0) ? &(T)->entries[K_OUT##_i].value : NULL;               \
-    for (; K_OUT##_i >= 0 && (size_t)K_OUT##_i < (T)->cap;                                         \
-         K_OUT##_i = A3_HT_NEXT_ENTRY(K, V)((T), (size_t)K_OUT##_i + 1),                           \
-         K_OUT     = &(T)->entries[MAX(K_OUT##_i, 0)].key,                                         \
-         V_OUT     = &(T)->entries[MAX(K_OUT##_i, 0)].value)
+/// Define methods for a Swiss table (see ::A3_HT_DEFINE_STRUCTS_SWISS) with HighwayHash as the hash
+/// function. See ::A3_HT_DEFINE_METHODS for the meaning of the arguments.
+#define A3_HT_DEFINE_METHODS_SWISS(K, V, KEY_BYTES, KEY_SIZE, C)                                   \
+    A3_HT_DEFINE_DEFAULT_HASH_(K, V, KEY_BYTES, KEY_SIZE)                                          \
+                                                                                                   \
+    A3_HT_DEFINE_METHODS_SWISS_HASHER(K, V, A3_HT_DEFAULT_HASH(K, V), C)
+
+/// Define methods for an incrementally-resized table (see ::A3_HT_DEFINE_STRUCTS_INCREMENTAL) with
+/// a custom hash function. See ::A3_HT_DEFINE_METHODS_HASHER for the meaning of H and C.
+#define A3_HT_DEFINE_METHODS_INCREMENTAL_HASHER(K, V, H, C)                                        \
+    A3_HT_DEFINE_HASH_(K, V, H)                                                                    \
+                                                                                                   \
+    A3_HT_DEFINE_RH_PRIMITIVES_(K, A3_HT_ENTRY(K, V), K##V##_a3_ht, C, MOD)                        \
+                                                                                                   \
+    /* Migrated entries are left in place in the old array, so that it remains a valid table. They \
+     * are only ever found before the migration cursor, and must be ignored. */                    \
+    static bool A3_HT_IS_MIGRATED(K, V)(A3_HT(K, V) * table, size_t index) {                       \
+        assert(table);                                                                             \
+        return A3_HT_DISTANCE_MOD(table->old_cap, index, table->old_start) < table->migrated;      \
+    }                                                                                              \
+                                                                                                   \
+    static void A3_HT_MIGRATE(K, V)(A3_HT(K, V) * table, size_t steps) {                           \
+        assert(table);                                                                             \
+        if (!table->old_entries)                                                                   \
+            return;                                                                                \
+                                                                                                   \
+        for (; steps && table->migrated < table->old_cap; steps--, table->migrated++) {            \
+            A3_HT_ENTRY(K, V)* entry =                                                             \
+                &table->old_entries[(table->old_start + table->migrated) % table->old_cap];        \
+            if (entry->hash)                                                                       \
+                A3_HT_PLACE(K, V)(table->entries, table->cap, *entry, A3_HT_COUNTERS_(table));     \
+        }                                                                                          \
+                                                                                                   \
+        if (table->migrated == table->old_cap) {                                                   \
+            if (!table->mapped)                                                                    \
+                a3_large_free(table->old_entries, table->old_cap, sizeof(A3_HT_ENTRY(K, V)));      \
+            table->old_entries = NULL;                                                             \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    static bool A3_HT_INSERT_AT(K, V)(A3_HT(K, V) * table, uint64_t hash, K key, V value) {        \
+        assert(table);                                                                             \
+        assert(hash);                                                                              \
+                                                                                                   \
+        A3_HT_ENTRY(K, V)* existing = NULL;                                                        \
+        A3_SSIZE_T i                = A3_HT_LOOKUP(K, V)(table->entries, table->cap, hash, key,    \
+                                                         A3_HT_COUNTERS_(table));                  \
+        if (i >= 0) {                                                                              \
+            existing = &table->entries[i];                                                         \
+        } else if (table->old_entries) {                                                           \
+            i = A3_HT_LOOKUP(K, V)(table->old_entries, table->old_cap, hash, key,                  \
+                                   A3_HT_COUNTERS_(table));                                        \
+            if (i >= 0 && !A3_HT_IS_MIGRATED(K, V)(table, (size_t)i))                              \
+                existing = &table->old_entries[i];                                                 \
+        }                                                                                          \
+                                                                                                   \
+        if (existing) {                                                                            \
+            if (!table->duplicate_cb)                                                              \
+                return false;                                                                      \
+            return table->duplicate_cb(&existing->value, value);                                   \
+        }                                                                                          \
+                                                                                                   \
+        A3_HT_ENTRY(K, V) entry = { key, value, hash };                                            \
+        A3_HT_PLACE(K, V)(table->entries, table->cap, entry, A3_HT_COUNTERS_(table));              \
+        table->size++;                                                                             \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /* Iteration moves nothing. Once past the current array, it continues with the entries of the  \
+     * old array which have not been migrated yet, at indices offset by the current capacity. */   \
+    A3_SSIZE_T A3_HT_NEXT_ENTRY(K, V)(A3_HT(K, V) * table, size_t index) {                         \
+        for (; index < table->cap; index++)                                                        \
+            if (table->entries[index].hash)                                                        \
+                return (A3_SSIZE_T)index;                                                          \
+        if (!table->old_entries)                                                                   \
+            return -1;                                                                             \
+                                                                                                   \
+        for (size_t i = index - table->cap; i < table->old_cap; i++)                               \
+            if (table->old_entries[i].hash && !A3_HT_IS_MIGRATED(K, V)(table, i))                  \
+                return (A3_SSIZE_T)(table->cap + i);                                               \
+        return -1;                                                                                 \
+    }                                                                                              \
+                                                                                                   \
+    /* Entries are not moved here. Instead, subsequent operations each move a bounded number. */   \
+    void A3_HT_RESIZE(K, V)(A3_HT(K, V) * table, size_t new_cap) {                                 \
+        assert(table);                                                                             \
+        assert(new_cap > table->size);                                                             \
+                                                                                                   \
+        /* Only one migration can be in progress at a time. */                                     \
+        A3_HT_MIGRATE(K, V)(table, SIZE_MAX);                                                      \
+        A3_HT_COUNT_(A3_HT_COUNTERS_(table), resizes);                                             \
+                                                                                                   \
+        /* Migration starts from an empty slot, so that no run of entries crosses the cursor. */   \
+        size_t start = 0;                                                                          \
+        while (start < table->cap && table->entries[start].hash)                                   \
+            start++;                                                                               \
+                                                                                                   \
+        table->old_entries = table->entries;                                                       \
+        table->old_cap     = table->cap;                                                           \
+        table->old_start   = start;                                                                \
+        table->migrated    = 0;                                                                    \
+        table->cap         = new_cap;                                                              \
+        A3_HT_ALLOC_AOS(K, V, table);                                                              \
+                                                                                                   \
+        /* A full table has no such slot, so it is moved all at once. A mapped array is also moved \
+         * at once, since it belongs to the caller and must not be referenced afterwards. */       \
+        if (start == table->old_cap || table->mapped) {                                            \
+            table->old_start = start == table->old_cap ? 0 : start;                                \
+            A3_HT_MIGRATE(K, V)(table, SIZE_MAX);                                                  \
+            table->mapped = false;                                                                 \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    static bool A3_HT_GROW(K, V)(A3_HT(K, V) * table) {                                            \
+        assert(table);                                                                             \
+        if (!table->can_grow)                                                                      \
+            return false;                                                                          \
+        A3_HT_RESIZE(K, V)(table, table->cap * 2);                                                 \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    static void A3_HT_PREFETCH(K, V)(A3_HT(K, V) * table, uint64_t hash) {                         \
+        assert(table);                                                                             \
+        A3_PREFETCH(&table->entries[A3_HT_HOME_MOD(table->cap, hash)]);                            \
+        if (table->old_entries)                                                                    \
+            A3_PREFETCH(&table->old_entries[A3_HT_HOME_MOD(table->old_cap, hash)]);                \
+    }                                                                                              \
+                                                                                                   \
+    /* Batched lookups must not move entries, since that would invalidate the results of earlier   \
+     * lookups in the batch. The migration they would have done is done up front instead. */       \
+    static void A3_HT_BEGIN_BATCH(K, V)(A3_HT(K, V) * table, size_t count) {                       \
+        A3_HT_MIGRATE(K, V)(table, count * A3_HT_MIGRATE_STEP);                                    \
+    }                                                                                              \
+                                                                                                   \
+    static V* A3_HT_FIND_STABLE(K, V)(A3_HT(K, V) * table, uint64_t hash, K key) {                 \
+        assert(table);                                                                             \
+                                                                                                   \
+        A3_SSIZE_T i =                                                                             \
+            A3_HT_LOOKUP(K, V)(table->entries, table->cap, hash, key, A3_HT_COUNTERS_(table));     \
+        if (i >= 0)                                                                                \
+            return &table->entries[i].value;                                                       \
+        if (!table->old_entries)                                                                   \
+            return NULL;                                                                           \
+                                                                                                   \
+        i = A3_HT_LOOKUP(K, V)(table->old_entries, table->old_cap, hash, key,                      \
+                               A3_HT_COUNTERS_(table));                                            \
+        if (i < 0 || A3_HT_IS_MIGRATED(K, V)(table, (size_t)i))                                    \
+            return NULL;                                                                           \
+        return &table->old_entries[i].value;                                                       \
+    }                                                                                              \
+                                                                                                   \
+    A3_SSIZE_T A3_HT_FIND_INDEX_HASHED(K, V)(A3_HT(K, V) * table, uint64_t hash, K key) {          \
+        assert(table);                                                                             \
+        A3_HT_MIGRATE(K, V)(table, A3_HT_MIGRATE_STEP);                                            \
+                                                                                                   \
+        A3_SSIZE_T ret =                                                                           \
+            A3_HT_LOOKUP(K, V)(table->entries, table->cap, hash, key, A3_HT_COUNTERS_(table));     \
+        if (ret >= 0 || !table->old_entries)                                                       \
+            return ret;                                                                            \
+                                                                                                   \
+        /* Move a hit in the old array over immediately, so that the index refers to entries. */   \
+        A3_SSIZE_T old = A3_HT_LOOKUP(K, V)(table->old_entries, table->old_cap, hash, key,         \
+                                            A3_HT_COUNTERS_(table));                               \
+        if (old < 0 || A3_HT_IS_MIGRATED(K, V)(table, (size_t)old))                                \
+            return -1;                                                                             \
+        ret = (A3_SSIZE_T)A3_HT_PLACE(K, V)(table->entries, table->cap, table->old_entries[old],   \
+                                            A3_HT_COUNTERS_(table));                               \
+        A3_HT_SHIFT_BACK(K, V)(table->old_entries, table->old_cap, (size_t)old);                   \
+        return ret;                                                                                \
+    }                                                                                              \
+                                                                                                   \
+    void A3_HT_INIT_SLOTS(K, V)(A3_HT(K, V) * table, uint8_t * key, bool can_grow, size_t cap) {   \
+        assert(table);                                                                             \
+        memset(table, 0, sizeof(*table));                                                          \
+        table->can_grow = can_grow;                                                                \
+        table->cap      = cap;                                                                     \
+        a3_ht_init_hash_key(table->hash_key, key);                                                 \
+        A3_HT_ALLOC_AOS(K, V, table);                                                              \
+    }                                                                                              \
+                                                                                                   \
+    void A3_HT_DESTROY(K, V)(A3_HT(K, V) * table) {                                                \
+        assert(table);                                                                             \
+        if (table->mapped)                                                                         \
+            return;                                                                                \
+        if (table->entries)                                                                        \
+            A3_HT_RELEASE_AOS(table);                                                              \
+        if (table->old_entries)                                                                    \
+            a3_large_free(table->old_entries, table->old_cap, sizeof(A3_HT_ENTRY(K, V)));          \
+    }                                                                                              \
+                                                                                                   \
+    static size_t A3_HT_DISPLACEMENT(K, V)(A3_HT(K, V) * table, size_t index) {                    \
+        if (index < table->cap)                                                                    \
+            return A3_HT_PROBE_COUNT(K, V)(table->cap, index, table->entries[index].hash);         \
+        index -= table->cap;                                                                       \
+        return A3_HT_PROBE_COUNT(K, V)(table->old_cap, index, table->old_entries[index].hash);     \
+    }                                                                                              \
+                                                                                                   \
+    /* Only the current array is recorded in a snapshot, so any migration is finished first. */    \
+    static uint32_t A3_HT_STORAGE(K, V)(A3_HT(K, V) * table, void* arrays[], size_t sizes[]) {     \
+        assert(table);                                                                             \
+        A3_HT_MIGRATE(K, V)(table, SIZE_MAX);                                                      \
+        arrays[0] = table->entries;                                                                \
+        sizes[0]  = table->cap * sizeof(A3_HT_ENTRY(K, V));                                        \
+        return A3_HT_SNAPSHOT_TAG_INCREMENTAL;                                                     \
+    }                                                                                              \
+                                                                                                   \
+    static void A3_HT_ATTACH(K, V)(A3_HT(K, V) * table, void* arrays[]) {                          \
+        assert(table);                                                                             \
+        table->entries = (A3_HT_ENTRY(K, V)*)arrays[0];                                            \
+    }                                                                                              \
+                                                                                                   \
+    bool A3_HT_INSERT_HASHED(K, V)(A3_HT(K, V) * table, uint64_t hash, K key, V value) {           \
+        assert(table);                                                                             \
+        A3_HT_MIGRATE(K, V)(table, A3_HT_MIGRATE_STEP);                                            \
+                                                                                                   \
+        if (table->size * 100 >= table->cap * A3_HT_LOAD_FACTOR)                                   \
+            if (!A3_HT_GROW(K, V)(table) && table->size >= table->cap)                             \
+                return false;                                                                      \
+                                                                                                   \
+        return A3_HT_INSERT_AT(K, V)(table, hash, key, value);                                     \
+    }                                                                                              \
+                                                                                                   \
+    /* Hashes are known up front, so slots can be prefetched a batch ahead. */                     \
+    static size_t A3_HT_PLACE_BATCH(K, V)(A3_HT(K, V) * table, K const* keys, V const* values,     \
+                                          uint64_t const* hashes, size_t count, size_t threads) {  \
+        assert(table);                                                                             \
+        (void)threads;                                                                             \
+                                                                                                   \
+        size_t ret = 0;                                                                            \
+        for (size_t i = 0; i < count; i++) {                                                       \
+            if (i + A3_HT_BATCH_SIZE < count)                                                      \
+                A3_HT_PREFETCH(K, V)(table, hashes[i + A3_HT_BATCH_SIZE]);                         \
+            ret += A3_HT_INSERT_HASHED(K, V)(table, hashes[i], keys[i], values[i]);                \
+        }                                                                                          \
+                                                                                                   \
+        return ret;                                                                                \
+    }                                                                                              \
+                                                                                                   \
+    bool A3_HT_DELETE_INDEX(K, V)(A3_HT(K, V) * table, size_t index) {                             \
+        assert(table);                                                                             \
+        assert(index < table->cap);                                                                \
+                                                                                                   \
+        if (!table->entries[index].hash)                                                           \
+            return false;                                                                          \
+        A3_HT_SHIFT_BACK(K, V)(table->entries, table->cap, index);                                 \
+        table->size--;                                                                             \
+                                                                                                   \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    void A3_HT_CLEAR(K, V)(A3_HT(K, V) * table) {                                                  \
+        assert(table);                                                                             \
+        if (table->old_entries && !table->mapped)                                                  \
+            a3_large_free(table->old_entries, table->old_cap, sizeof(A3_HT_ENTRY(K, V)));          \
+        table->old_entries = NULL;                                                                 \
+        memset(table->entries, 0, table->cap * sizeof(A3_HT_ENTRY(K, V)));                         \
+        table->size = 0;                                                                           \
+    }                                                                                              \
+                                                                                                   \
+    static uint64_t A3_HT_HASH_AT(K, V)(A3_HT(K, V) * table, size_t index) {                       \
+        return A3_HT_ENTRY_AT(K, V)(table, index)->hash;                                           \
+    }                                                                                              \
+                                                                                                   \
+    static void A3_HT_DISCARD(K, V)(A3_HT(K, V) * table, size_t index) {                           \
+        assert(table);                                                                             \
+        A3_HT_ENTRY_AT(K, V)(table, index)->hash = 0;                                              \
+        table->size--;                                                                             \
+    }                                                                                              \
+                                                                                                   \
+    /* As for the default layout, over `count` slots from `start`. No entry moves before           \
+     * `start`. */                                                                                 \
+    static void A3_HT_REPAIR_RANGE(K, V)(A3_HT_ENTRY(K, V) * entries, size_t cap, size_t start,    \
+                                         size_t count) {                                           \
+        size_t hole = start;                                                                       \
+        for (size_t n = 0, i = start; n < count; n++, i = A3_HT_NEXT_MOD(cap, i)) {                \
+            uint64_t hash = entries[i].hash;                                                       \
+            if (!hash)                                                                             \
+                continue;                                                                          \
+                                                                                                   \
+            size_t target      = i;                                                                \
+            size_t back        = A3_HT_DISTANCE_MOD(cap, i, hole);                                 \
+            size_t probe_count = A3_HT_PROBE_COUNT(K, V)(cap, i, hash);                            \
+            if (back && probe_count)                                                               \
+                target = back <= probe_count ? hole : A3_HT_HOME_MOD(cap, hash);                   \
+            if (target != i) {                                                                     \
+                entries[target] = entries[i];                                                      \
+                entries[i].hash = 0;                                                               \
+            }                                                                                      \
+            hole = A3_HT_NEXT_MOD(cap, target);                                                    \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    /* In the old array, only the slots from the migration cursor on are repaired, so that no      \
+     * entry moves behind it and is mistaken for a migrated one. Migration began at an empty slot, \
+     * so no run wraps past the end of that range. */                                              \
+    static void A3_HT_REPAIR(K, V)(A3_HT(K, V) * table) {                                          \
+        assert(table);                                                                             \
+                                                                                                   \
+        size_t hole = 0;                                                                           \
+        while (hole < table->cap && table->entries[hole].hash)                                     \
+            hole++;                                                                                \
+        if (hole < table->cap)                                                                     \
+            A3_HT_REPAIR_RANGE(K, V)(table->entries, table->cap, hole, 2 * table->cap);            \
+                                                                                                   \
+        if (table->old_entries)                                                                    \
+            A3_HT_REPAIR_RANGE(K, V)(table->old_entries, table->old_cap,                           \
+                                     (table->old_start + table->migrated) % table->old_cap,        \
+                                     table->old_cap - table->migrated);                            \
+    }                                                                                              \
+    A3_HT_DEFINE_COMMON_METHODS_(K, V)
+
+/// Define methods for an incrementally-resized table with HighwayHash as the hash function. See
+/// ::A3_HT_DEFINE_METHODS for the meaning of the arguments.
+#define A3_HT_DEFINE_METHODS_INCREMENTAL(K, V, KEY_BYTES, KEY_SIZE, C)                             \
+    A3_HT_DEFINE_DEFAULT_HASH_(K, V, KEY_BYTES, KEY_SIZE)                                          \
+                                                                                                   \
+    A3_HT_DEFINE_METHODS_INCREMENTAL_HASHER(K, V, A3_HT_DEFAULT_HASH(K, V), C)
+
+#ifndef DOXYGEN
+// The fingerprint of a hash in a compact entry is its top bits, which the home slot does not use.
+#define A3_HT_TAG_OF_(K, V, HASH)                                                                  \
+    ((A3_HT_TAG(K, V))((HASH) >> (64 - 8 * sizeof(A3_HT_TAG(K, V)))))
+
+// A compact table keeps every fingerprint, then every displacement byte, in a single block beside
+// its entries.
+#define A3_HT_META_SIZE_(K, V) (sizeof(A3_HT_TAG(K, V)) + 1)
+#define A3_HT_ALLOC_COMPACT_(K, V, TABLE)                                                          \
+    A3_M_BEGIN                                                                                     \
+        A3_HT_ALLOC_AOS(K, V, TABLE);                                                              \
+        A3_UNWRAPN((TABLE)->tags, (A3_HT_TAG(K, V)*)a3_large_calloc((TABLE)->cap,                  \
+                                                                    A3_HT_META_SIZE_(K, V)));      \
+        (TABLE)->dists = (uint8_t*)((TABLE)->tags + (TABLE)->cap);                                 \
+    A3_M_END
+#define A3_HT_RELEASE_COMPACT_(K, V, TABLE)                                                        \
+    A3_M_BEGIN                                                                                     \
+        A3_HT_RELEASE_AOS(TABLE);                                                                  \
+        a3_large_free((TABLE)->tags, (TABLE)->cap, A3_HT_META_SIZE_(K, V));                        \
+    A3_M_END
+#endif
+
+/// Define methods for a table with compact entries (see ::A3_HT_DEFINE_STRUCTS_COMPACT) with a
+/// custom hash function. See ::A3_HT_DEFINE_METHODS_HASHER for the meaning of H and C. The capacity
+/// is always a power of two, as with ::A3_HT_DEFINE_METHODS_POW2_HASHER, so H must mix well into
+/// its low bits.
+#define A3_HT_DEFINE_METHODS_COMPACT_HASHER(K, V, H, C)                                            \
+    A3_HT_DEFINE_HASH_(K, V, H)                                                                    \
+                                                                                                   \
+    /* A slot's dist is one more than the displacement of its entry, so that zero marks an empty   \
+     * slot. A new entry takes the first slot holding an entry closer to its home, and the rest of \
+     * the run shifts along by one. Every displacement is checked before anything moves, so that   \
+     * an insert which cannot be done leaves the table as it was. */                               \
+    static bool A3_HT_INSERT_AT(K, V)(A3_HT(K, V) * table, uint64_t hash, K key, V value) {        \
+        assert(table);                                                                             \
+        assert(table->cap > 0ULL);                                                                 \
+                                                                                                   \
+        size_t          mask = table->cap - 1;                                                     \
+        A3_HT_TAG(K, V) tag  = A3_HT_TAG_OF_(K, V, hash);                                          \
+        size_t          i    = (size_t)hash & mask;                                                \
+        size_t          dist = 1;                                                                  \
+        A3_HT_COUNT_(A3_HT_COUNTERS_(table), probes);                                              \
+        for (;; i = (i + 1) & mask, dist++) {                                                      \
+            A3_HT_COUNT_(A3_HT_COUNTERS_(table), probe_steps);                                     \
+            if (table->dists[i] < dist)                                                            \
+                break;                                                                             \
+                                                                                                   \
+            /* Only an entry with the same home and fingerprint can be a duplicate. */             \
+            if (table->dists[i] == dist && table->tags[i] == tag &&                                \
+                C(key, table->entries[i].key) == 0) {                                              \
+                if (!table->duplicate_cb)                                                          \
+                    return false;                                                                  \
+                return table->duplicate_cb(&table->entries[i].value, value);                       \
+            }                                                                                      \
+        }                                                                                          \
+                                                                                                   \
+        bool   overflow = dist >= UINT8_MAX;                                                       \
+        size_t end      = i;                                                                       \
+        for (; !overflow && table->dists[end]; end = (end + 1) & mask)                             \
+            overflow = table->dists[end] >= UINT8_MAX - 1;                                         \
+                                                                                                   \
+        /* A displacement would no longer fit in a byte. Growing the table spreads out the         \
+         * cluster, unless the table is already sparse, in which case the keys are colliding       \
+         * outright. A resize which cannot place every key leaves the capacity unchanged. */       \
+        if (overflow) {                                                                            \
+            size_t cap = table->cap;                                                               \
+            if (!table->can_grow || table->size * 4 < cap)                                         \
+                return false;                                                                      \
+            A3_HT_RESIZE(K, V)(table, cap * 2);                                                    \
+            if (table->cap == cap)                                                                 \
+                return false;                                                                      \
+            return A3_HT_INSERT_AT(K, V)(table, hash, key, value);                                 \
+        }                                                                                          \
+                                                                                                   \
+        for (; end != i; end = (end - 1) & mask) {                                                 \
+            size_t prev         = (end - 1) & mask;                                                \
+            table->entries[end] = table->entries[prev];                                            \
+            table->tags[end]    = table->tags[prev];                                               \
+            table->dists[end]   = (uint8_t)(table->dists[prev] + 1);                               \
+        }                                                                                          \
+        table->entries[i].key   = key;                                                             \
+        table->entries[i].value = value;                                                           \
+        table->tags[i]          = tag;                                                             \
+        table->dists[i]         = (uint8_t)dist;                                                   \
+        table->size++;                                                                             \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    A3_SSIZE_T A3_HT_NEXT_ENTRY(K, V)(A3_HT(K, V) * table, size_t index) {                         \
+        for (; index < table->cap; index++)                                                        \
+            if (table->dists[index])                                                               \
+                return (A3_SSIZE_T)index;                                                          \
+        return -1;                                                                                 \
+    }                                                                                              \
+                                                                                                   \
+    /* Entries do not keep their full hashes, so every key is hashed again. Displacements can      \
+     * still overflow at the new capacity, most likely when shrinking, in which case the new       \
+     * arrays are dropped and the table is left as it was. The table may not grow while it is      \
+     * rebuilt. */                                                                                 \
+    void A3_HT_RESIZE(K, V)(A3_HT(K, V) * table, size_t new_cap) {                                 \
+        assert(table);                                                                             \
+        assert(new_cap > table->size);                                                             \
+                                                                                                   \
+        A3_HT_COUNT_(A3_HT_COUNTERS_(table), resizes);                                             \
+        A3_HT(K, V) prev = *table;                                                                 \
+        table->cap       = a3_ht_pow2_cap(new_cap);                                                \
+        table->size      = 0;                                                                      \
+        table->mapped    = false;                                                                  \
+        table->can_grow  = false;                                                                  \
+        A3_HT_ALLOC_COMPACT_(K, V, table);                                                         \
+                                                                                                   \
+        for (size_t i = 0; i < prev.cap; i++) {                                                    \
+            if (!prev.dists[i])                                                                    \
+                continue;                                                                          \
+            A3_HT_ENTRY(K, V)* current_entry = &prev.entries[i];                                   \
+            if (!A3_HT_INSERT_AT(K, V)(table, A3_HT_HASH(K, V)(table, current_entry->key),         \
+                                       current_entry->key, current_entry->value)) {                \
+                A3_HT_RELEASE_COMPACT_(K, V, table);                                               \
+                *table = prev;                                                                     \
+                return;                                                                            \
+            }                                                                                      \
+        }                                                                                          \
+                                                                                                   \
+        table->can_grow = prev.can_grow;                                                           \
+        if (!prev.mapped)                                                                          \
+            A3_HT_RELEASE_COMPACT_(K, V, &prev);                                                   \
+    }                                                                                              \
+                                                                                                   \
+    static bool A3_HT_GROW(K, V)(A3_HT(K, V) * table) {                                            \
+        assert(table);                                                                             \
+        if (!table->can_grow)                                                                      \
+            return false;                                                                          \
+        A3_HT_RESIZE(K, V)(table, table->cap * 2);                                                 \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    static void A3_HT_PREFETCH(K, V)(A3_HT(K, V) * table, uint64_t hash) {                         \
+        assert(table);                                                                             \
+        size_t home = (size_t)hash & (table->cap - 1);                                             \
+        A3_PREFETCH(&table->dists[home]);                                                          \
+        A3_PREFETCH(&table->tags[home]);                                                           \
+        A3_PREFETCH(&table->entries[home]);                                                        \
+    }                                                                                              \
+                                                                                                   \
+    static void A3_HT_BEGIN_BATCH(K, V)(A3_HT(K, V) * table, size_t count) {                       \
+        (void)table;                                                                               \
+        (void)count;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /* The stored displacement ends the probe without recomputing any entry's home slot, and the   \
+     * fingerprint rules out nearly every other key before an entry is touched. */                 \
+    A3_SSIZE_T A3_HT_FIND_INDEX_HASHED(K, V)(A3_HT(K, V) * table, uint64_t hash, K key) {          \
+        assert(table);                                                                             \
+                                                                                                   \
+        size_t          mask = table->cap - 1;                                                     \
+        A3_HT_TAG(K, V) tag  = A3_HT_TAG_OF_(K, V, hash);                                          \
+        A3_HT_COUNT_(A3_HT_COUNTERS_(table), probes);                                              \
+        for (size_t i = (size_t)hash & mask, dist = 1;; i = (i + 1) & mask, dist++) {              \
+            A3_HT_COUNT_(A3_HT_COUNTERS_(table), probe_steps);                                     \
+            if (table->dists[i] < dist)                                                            \
+                return -1;                                                                         \
+            if (table->dists[i] == dist && table->tags[i] == tag &&                                \
+                C(key, table->entries[i].key) == 0)                                                \
+                return (A3_SSIZE_T)i;                                                              \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    void A3_HT_INIT_SLOTS(K, V)(A3_HT(K, V) * table, uint8_t * key, bool can_grow, size_t cap) {   \
+        assert(table);                                                                             \
+        memset(table, 0, sizeof(*table));                                                          \
+        table->can_grow = can_grow;                                                                \
+        table->size     = 0;                                                                       \
+        table->cap      = a3_ht_pow2_cap(cap);                                                     \
+        a3_ht_init_hash_key(table->hash_key, key);                                                 \
+        A3_HT_ALLOC_COMPACT_(K, V, table);                                                         \
+    }                                                                                              \
+                                                                                                   \
+    void A3_HT_DESTROY(K, V)(A3_HT(K, V) * table) {                                                \
+        assert(table);                                                                             \
+        if (!table->mapped)                                                                        \
+            A3_HT_RELEASE_COMPACT_(K, V, table);                                                   \
+    }                                                                                              \
+                                                                                                   \
+    static size_t A3_HT_DISPLACEMENT(K, V)(A3_HT(K, V) * table, size_t index) {                    \
+        return (size_t)table->dists[index] - 1;                                                    \
+    }                                                                                              \
+                                                                                                   \
+    static uint32_t A3_HT_STORAGE(K, V)(A3_HT(K, V) * table, void* arrays[], size_t sizes[]) {     \
+        assert(table);                                                                             \
+        A3_HT_STORAGE_AOS(K, V, table, arrays, sizes);                                             \
+        arrays[1] = table->tags;                                                                   \
+        sizes[1]  = table->cap * A3_HT_META_SIZE_(K, V);                                           \
+        return sizeof(A3_HT_TAG(K, V)) == sizeof(uint16_t) ? A3_HT_SNAPSHOT_TAG_COMPACT16          \
+                                                           : A3_HT_SNAPSHOT_TAG_COMPACT32;         \
+    }                                                                                              \
+                                                                                                   \
+    static void A3_HT_ATTACH(K, V)(A3_HT(K, V) * table, void* arrays[]) {                          \
+        assert(table);                                                                             \
+        A3_HT_ATTACH_AOS(K, V, table, arrays);                                                     \
+        table->tags  = (A3_HT_TAG(K, V)*)arrays[1];                                                \
+        table->dists = (uint8_t*)(table->tags + table->cap);                                       \
+    }                                                                                              \
+                                                                                                   \
+    static V* A3_HT_FIND_STABLE(K, V)(A3_HT(K, V) * table, uint64_t hash, K key) {                 \
+        A3_SSIZE_T i = A3_HT_FIND_INDEX_HASHED(K, V)(table, hash, key);                            \
+        return i < 0 ? NULL : &table->entries[i].value;                                            \
+    }                                                                                              \
+                                                                                                   \
+    bool A3_HT_INSERT_HASHED(K, V)(A3_HT(K, V) * table, uint64_t hash, K key, V value) {           \
+        assert(table);                                                                             \
+                                                                                                   \
+        if (table->size * 100 >= table->cap * A3_HT_LOAD_FACTOR)                                   \
+            if (!A3_HT_GROW(K, V)(table) && table->size >= table->cap)                             \
+                return false;                                                                      \
+                                                                                                   \
+        return A3_HT_INSERT_AT(K, V)(table, hash, key, value);                                     \
+    }                                                                                              \
+                                                                                                   \
+    /* Hashes are known up front, so slots can be prefetched a batch ahead. */                     \
+    static size_t A3_HT_PLACE_BATCH(K, V)(A3_HT(K, V) * table, K const* keys, V const* values,     \
+                                          uint64_t const* hashes, size_t count, size_t threads) {  \
+        assert(table);                                                                             \
+        (void)threads;                                                                             \
+                                                                                                   \
+        size_t ret = 0;                                                                            \
+        for (size_t i = 0; i < count; i++) {                                                       \
+            if (i + A3_HT_BATCH_SIZE < count)                                                      \
+                A3_HT_PREFETCH(K, V)(table, hashes[i + A3_HT_BATCH_SIZE]);                         \
+            ret += A3_HT_INSERT_HASHED(K, V)(table, hashes[i], keys[i], values[i]);                \
+        }                                                                                          \
+                                                                                                   \
+        return ret;                                                                                \
+    }                                                                                              \
+                                                                                                   \
+    bool A3_HT_DELETE_INDEX(K, V)(A3_HT(K, V) * table, size_t index) {                             \
+        assert(table);                                                                             \
+        assert(index < table->cap);                                                                \
+                                                                                                   \
+        A3_TRYB(table->dists[index]);                                                              \
+        table->size--;                                                                             \
+                                                                                                   \
+        /* Shift the following sequence of entries back, each one slot closer to home. */          \
+        size_t mask = table->cap - 1;                                                              \
+        size_t i    = (index + 1) & mask;                                                          \
+        while (table->dists[i] > 1) {                                                              \
+            table->entries[index] = table->entries[i];                                             \
+            table->tags[index]    = table->tags[i];                                                \
+            table->dists[index]   = (uint8_t)(table->dists[i] - 1);                                \
+            index                 = i;                                                             \
+            i                     = (i + 1) & mask;                                                \
+        }                                                                                          \
+        table->dists[index] = 0;                                                                   \
+                                                                                                   \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    void A3_HT_CLEAR(K, V)(A3_HT(K, V) * table) {                                                  \
+        assert(table);                                                                             \
+        memset(table->dists, 0, table->cap);                                                       \
+        table->size = 0;                                                                           \
+    }                                                                                              \
+                                                                                                   \
+    /* Entries keep only a fingerprint, so the key is hashed again. */                             \
+    static uint64_t A3_HT_HASH_AT(K, V)(A3_HT(K, V) * table, size_t index) {                       \
+        return A3_HT_HASH(K, V)(table, table->entries[index].key);                                 \
+    }                                                                                              \
+                                                                                                   \
+    static void A3_HT_DISCARD(K, V)(A3_HT(K, V) * table, size_t index) {                           \
+        assert(table);                                                                             \
+        table->dists[index] = 0;                                                                   \
+        table->size--;                                                                             \
+    }                                                                                              \
+                                                                                                   \
+    /* As for the default layout, but the stored displacements say how far each entry may move. */ \
+    static void A3_HT_REPAIR(K, V)(A3_HT(K, V) * table) {                                          \
+        assert(table);                                                                             \
+                                                                                                   \
+        size_t mask = table->cap - 1;                                                              \
+        size_t hole = 0;                                                                           \
+        while (hole < table->cap && table->dists[hole])                                            \
+            hole++;                                                                                \
+        if (hole == table->cap)                                                                    \
+            return;                                                                                \
+                                                                                                   \
+        for (size_t n = 0, i = hole; n < 2 * table->cap; n++, i = (i + 1) & mask) {                \
+            if (!table->dists[i])                                                                  \
+                continue;                                                                          \
+                                                                                                   \
+            size_t shift  = MIN((i - hole) & mask, (size_t)table->dists[i] - 1);                   \
+            size_t target = (i - shift) & mask;                                                    \
+            if (shift) {                                                                           \
+                table->entries[target] = table->entries[i];                                        \
+                table->tags[target]    = table->tags[i];                                           \
+                table->dists[target]   = (uint8_t)(table->dists[i] - shift);                       \
+                table->dists[i]        = 0;                                                        \
+            }                                                                                      \
+            hole = (target + 1) & mask;                                                            \
+        }                                                                                          \
+    }                                                                                              \
+    A3_HT_DEFINE_COMMON_METHODS_(K, V)
+
+/// Define methods for a table with compact entries, with HighwayHash as the hash function. See
+/// ::A3_HT_DEFINE_METHODS for the meaning of the arguments.
+#define A3_HT_DEFINE_METHODS_COMPACT(K, V, KEY_BYTES, KEY_SIZE, C)                                 \
+    A3_HT_DEFINE_DEFAULT_HASH_(K, V, KEY_BYTES, KEY_SIZE)                                          \
+                                                                                                   \
+    A3_HT_DEFINE_METHODS_COMPACT_HASHER(K, V, A3_HT_DEFAULT_HASH(K, V), C)
+
+/// Define methods for an insertion-ordered table (see ::A3_HT_DEFINE_STRUCTS_ORDERED) with a custom
+/// hash function. See ::A3_HT_DEFINE_METHODS_HASHER for the meaning of H and C. The capacity is
+/// always a power of two, so H must mix well into the low bits.
+#define A3_HT_DEFINE_METHODS_ORDERED_HASHER(K, V, H, C)                                            \
+    A3_HT_DEFINE_HASH_(K, V, H)                                                                    \
+                                                                                                   \
+    static size_t A3_HT_PROBE_COUNT(K, V)(A3_HT(K, V) * table, size_t index, uint32_t hash) {      \
+        assert(table);                                                                             \
+        return (index - hash) & (table->cap - 1);                                                  \
+    }                                                                                              \
+                                                                                                   \
+    /* Find the slot which refers to the entry at the given position. */                           \
+    static size_t A3_HT_SLOT_OF(K, V)(A3_HT(K, V) * table, size_t index) {                         \
+        assert(table);                                                                             \
+        size_t mask = table->cap - 1;                                                              \
+        size_t i    = (size_t)table->entries[index].hash & mask;                                   \
+        while (table->slots[i].index != index + 1)                                                 \
+            i = (i + 1) & mask;                                                                    \
+        return i;                                                                                  \
+    }                                                                                              \
+                                                                                                   \
+    /* Place a slot whose entry is known to be absent. */                                          \
+    static void A3_HT_PLACE(K, V)(A3_HT(K, V) * table, A3HTSlot slot) {                            \
+        assert(table);                                                                             \
+                                                                                                   \
+        size_t mask = table->cap - 1;                                                              \
+        A3_HT_COUNT_(A3_HT_COUNTERS_(table), probes);                                              \
+        for (size_t i = slot.hash & mask, probe_count = 0;; i = (i + 1) & mask, probe_count++) {   \
+            A3_HT_COUNT_(A3_HT_COUNTERS_(table), probe_steps);                                     \
+            A3HTSlot* current = &table->slots[i];                                                  \
+            if (!current->index) {                                                                 \
+                *current = slot;                                                                   \
+                return;                                                                            \
+            }                                                                                      \
+                                                                                                   \
+            if (A3_HT_PROBE_COUNT(K, V)(table, i, current->hash) < probe_count) {                  \
+                A3HTSlot displaced = *current;                                                     \
+                *current           = slot;                                                         \
+                slot               = displaced;                                                    \
+                probe_count        = A3_HT_PROBE_COUNT(K, V)(table, i, slot.hash);                 \
+            }                                                                                      \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    /* Close up the holes left in the dense array by deletions, keeping the order of the rest.     \
+     * Only the slots of moved entries are rewritten, so this costs O(size), not O(cap). */        \
+    static void A3_HT_PACK(K, V)(A3_HT(K, V) * table) {                                            \
+        assert(table);                                                                             \
+                                                                                                   \
+        size_t to = 0;                                                                             \
+        for (size_t from = 0; from < table->used; from++) {                                        \
+            if (!table->entries[from].hash)                                                        \
+                continue;                                                                          \
+            if (from != to) {                                                                      \
+                table->slots[A3_HT_SLOT_OF(K, V)(table, from)].index = (uint32_t)to + 1;           \
+                table->entries[to]                                  = table->entries[from];        \
+            }                                                                                      \
+            to++;                                                                                  \
+        }                                                                                          \
+        memset(&table->entries[to], 0, (table->used - to) * sizeof(A3_HT_ENTRY(K, V)));            \
+        table->used = to;                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    A3_SSIZE_T A3_HT_NEXT_ENTRY(K, V)(A3_HT(K, V) * table, size_t index) {                         \
+        for (; index < table->used; index++)                                                       \
+            if (table->entries[index].hash)                                                        \
+                return (A3_SSIZE_T)index;                                                          \
+        return -1;                                                                                 \
+    }                                                                                              \
+                                                                                                   \
+    void A3_HT_RESIZE(K, V)(A3_HT(K, V) * table, size_t new_cap) {                                 \
+        assert(table);                                                                             \
+        assert(new_cap > table->size);                                                             \
+                                                                                                   \
+        A3_HT_COUNT_(A3_HT_COUNTERS_(table), resizes);                                             \
+        A3_HT(K, V) prev   = *table;                                                               \
+        table->cap         = a3_ht_pow2_cap(new_cap);                                              \
+        table->size        = 0;                                                                    \
+        table->used        = 0;                                                                    \
+        table->mapped      = false;                                                                \
+        assert(table->cap < UINT32_MAX);                                                           \
+        A3_HT_ALLOC_AOS(K, V, table);                                                              \
+        A3_UNWRAPN(table->slots, (A3HTSlot*)a3_large_calloc(table->cap, sizeof(A3HTSlot)));        \
+                                                                                                   \
+        for (size_t i = 0; i < prev.used; i++) {                                                   \
+            if (!prev.entries[i].hash)                                                             \
+                continue;                                                                          \
+            table->entries[table->used] = prev.entries[i];                                         \
+            A3_HT_PLACE(K, V)(table, a3_ht_slot_new(table->used++, prev.entries[i].hash));         \
+        }                                                                                          \
+        table->size = table->used;                                                                 \
+                                                                                                   \
+        if (!prev.mapped) {                                                                        \
+            A3_HT_RELEASE_AOS(&prev);                                                              \
+            a3_large_free(prev.slots, prev.cap, sizeof(A3HTSlot));                                 \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    static bool A3_HT_GROW(K, V)(A3_HT(K, V) * table) {                                            \
+        assert(table);                                                                             \
+        if (!table->can_grow)                                                                      \
+            return false;                                                                          \
+        A3_HT_RESIZE(K, V)(table, table->cap * 2);                                                 \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    static void A3_HT_PREFETCH(K, V)(A3_HT(K, V) * table, uint64_t hash) {                         \
+        assert(table);                                                                             \
+        A3_PREFETCH(&table->slots[(size_t)hash & (table->cap - 1)]);                               \
+    }                                                                                              \
+                                                                                                   \
+    static void A3_HT_BEGIN_BATCH(K, V)(A3_HT(K, V) * table, size_t count) {                       \
+        (void)table;                                                                               \
+        (void)count;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /* Returns the position of the entry in the dense array. Entries are only examined once the    \
+     * stored half of the hash matches. */                                                         \
+    A3_SSIZE_T A3_HT_FIND_INDEX_HASHED(K, V)(A3_HT(K, V) * table, uint64_t hash, K key) {          \
+        assert(table);                                                                             \
+                                                                                                   \
+        size_t mask = table->cap - 1;                                                              \
+        A3_HT_COUNT_(A3_HT_COUNTERS_(table), probes);                                              \
+        for (size_t i = (size_t)hash & mask, probe_count = 0;;                                     \
+             i = (i + 1) & mask, probe_count++) {                                                  \
+            A3_HT_COUNT_(A3_HT_COUNTERS_(table), probe_steps);                                     \
+            A3HTSlot slot = table->slots[i];                                                       \
+            if (!slot.index || A3_HT_PROBE_COUNT(K, V)(table, i, slot.hash) < probe_count)         \
+                return -1;                                                                         \
+            if (slot.hash != (uint32_t)hash)                                                       \
+                continue;                                                                          \
+                                                                                                   \
+            A3_HT_ENTRY(K, V)* entry = &table->entries[slot.index - 1];                            \
+            if (entry->hash == hash && C(key, entry->key) == 0)                                    \
+                return (A3_SSIZE_T)slot.index - 1;                                                 \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    void A3_HT_INIT_SLOTS(K, V)(A3_HT(K, V) * table, uint8_t * key, bool can_grow, size_t cap) {   \
+        assert(table);                                                                             \
+        memset(table, 0, sizeof(*table));                                                          \
+        table->can_grow    = can_grow;                                                             \
+        table->size        = 0;                                                                    \
+        table->used        = 0;                                                                    \
+        table->cap         = a3_ht_pow2_cap(cap);                                                  \
+        assert(table->cap < UINT32_MAX);                                                           \
+        a3_ht_init_hash_key(table->hash_key, key);                                                 \
+        A3_HT_ALLOC_AOS(K, V, table);                                                              \
+        A3_UNWRAPN(table->slots, (A3HTSlot*)a3_large_calloc(table->cap, sizeof(A3HTSlot)));        \
+    }                                                                                              \
+                                                                                                   \
+    void A3_HT_DESTROY(K, V)(A3_HT(K, V) * table) {                                                \
+        assert(table);                                                                             \
+        if (table->mapped)                                                                         \
+            return;                                                                                \
+        A3_HT_RELEASE_AOS(table);                                                                  \
+        a3_large_free(table->slots, table->cap, sizeof(A3HTSlot));                                 \
+    }                                                                                              \
+                                                                                                   \
+    static size_t A3_HT_DISPLACEMENT(K, V)(A3_HT(K, V) * table, size_t index) {                    \
+        return A3_HT_PROBE_COUNT(K, V)(table, A3_HT_SLOT_OF(K, V)(table, index),                   \
+                                       (uint32_t)table->entries[index].hash);                      \
+    }                                                                                              \
+                                                                                                   \
+    /* The dense array is packed first, since a snapshot does not record its holes. */             \
+    static uint32_t A3_HT_STORAGE(K, V)(A3_HT(K, V) * table, void* arrays[], size_t sizes[]) {     \
+        assert(table);                                                                             \
+        if (table->used > table->size)                                                             \
+            A3_HT_PACK(K, V)(table);                                                               \
+        arrays[0] = table->entries;                                                                \
+        sizes[0]  = table->cap * sizeof(A3_HT_ENTRY(K, V));                                        \
+        arrays[1] = table->slots;                                                                  \
+        sizes[1]  = table->cap * sizeof(A3HTSlot);                                                 \
+        return A3_HT_SNAPSHOT_TAG_ORDERED;                                                         \
+    }                                                                                              \
+                                                                                                   \
+    static void A3_HT_ATTACH(K, V)(A3_HT(K, V) * table, void* arrays[]) {                          \
+        assert(table);                                                                             \
+        table->entries = (A3_HT_ENTRY(K, V)*)arrays[0];                                            \
+        table->slots   = (A3HTSlot*)arrays[1];                                                     \
+        table->used    = table->size;                                                              \
+    }                                                                                              \
+                                                                                                   \
+    static V* A3_HT_FIND_STABLE(K, V)(A3_HT(K, V) * table, uint64_t hash, K key) {                 \
+        A3_SSIZE_T i = A3_HT_FIND_INDEX_HASHED(K, V)(table, hash, key);                            \
+        return i < 0 ? NULL : &table->entries[i].value;                                            \
+    }                                                                                              \
+                                                                                                   \
+    /* A duplicate keeps its original position. Holes are only packed when an entry would          \
+     * otherwise not fit. */                                                                       \
+    bool A3_HT_INSERT_HASHED(K, V)(A3_HT(K, V) * table, uint64_t hash, K key, V value) {           \
+        assert(table);                                                                             \
+                                                                                                   \
+        A3_SSIZE_T existing = A3_HT_FIND_INDEX_HASHED(K, V)(table, hash, key);                     \
+        if (existing >= 0) {                                                                       \
+            if (!table->duplicate_cb)                                                              \
+                return false;                                                                      \
+            return table->duplicate_cb(&table->entries[existing].value, value);                    \
+        }                                                                                          \
+                                                                                                   \
+        if (table->size * 100 >= table->cap * A3_HT_LOAD_FACTOR)                                   \
+            if (!A3_HT_GROW(K, V)(table) && table->size >= table->cap)                             \
+                return false;                                                                      \
+        if (table->used >= table->cap)                                                             \
+            A3_HT_PACK(K, V)(table);                                                               \
+                                                                                                   \
+        A3_HT_ENTRY(K, V)* entry = &table->entries[table->used];                                   \
+        entry->key               = key;                                                            \
+        entry->value             = value;                                                          \
+        entry->hash              = hash;                                                           \
+        A3_HT_PLACE(K, V)(table, a3_ht_slot_new(table->used++, hash));                             \
+        table->size++;                                                                             \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /* Hashes are known up front, so slots can be prefetched a batch ahead. */                     \
+    static size_t A3_HT_PLACE_BATCH(K, V)(A3_HT(K, V) * table, K const* keys, V const* values,     \
+                                          uint64_t const* hashes, size_t count, size_t threads) {  \
+        assert(table);                                                                             \
+        (void)threads;                                                                             \
+                                                                                                   \
+        size_t ret = 0;                                                                            \
+        for (size_t i = 0; i < count; i++) {                                                       \
+            if (i + A3_HT_BATCH_SIZE < count)                                                      \
+                A3_HT_PREFETCH(K, V)(table, hashes[i + A3_HT_BATCH_SIZE]);                         \
+            ret += A3_HT_INSERT_HASHED(K, V)(table, hashes[i], keys[i], values[i]);                \
+        }                                                                                          \
+                                                                                                   \
+        return ret;                                                                                \
+    }                                                                                              \
+                                                                                                   \
+    /* Deleting leaves a hole in the dense array, which is packed once holes outnumber entries.    \
+     * Either way, the positions of later entries may change. */                                   \
+    bool A3_HT_DELETE_INDEX(K, V)(A3_HT(K, V) * table, size_t index) {                             \
+        assert(table);                                                                             \
+        A3_TRYB(index < table->used && table->entries[index].hash);                                \
+                                                                                                   \
+        /* Shift the following sequence of slots back. */                                          \
+        size_t mask = table->cap - 1;                                                              \
+        size_t slot = A3_HT_SLOT_OF(K, V)(table, index);                                           \
+        size_t i    = (slot + 1) & mask;                                                           \
+        while (table->slots[i].index &&                                                            \
+               A3_HT_PROBE_COUNT(K, V)(table, i, table->slots[i].hash)) {                          \
+            table->slots[slot] = table->slots[i];                                                  \
+            slot               = i;                                                                \
+            i                  = (i + 1) & mask;                                                   \
+        }                                                                                          \
+        table->slots[slot].index = 0;                                                              \
+                                                                                                   \
+        table->entries[index].hash = 0;                                                            \
+        table->size--;                                                                             \
+        while (table->used && !table->entries[table->used - 1].hash)                               \
+            table->used--;                                                                         \
+        if (table->used - table->size > table->size)                                               \
+            A3_HT_PACK(K, V)(table);                                                               \
+                                                                                                   \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    void A3_HT_CLEAR(K, V)(A3_HT(K, V) * table) {                                                  \
+        assert(table);                                                                             \
+        memset(table->slots, 0, table->cap * sizeof(A3HTSlot));                                    \
+        memset(table->entries, 0, table->used * sizeof(A3_HT_ENTRY(K, V)));                        \
+        table->size = 0;                                                                           \
+        table->used = 0;                                                                           \
+    }                                                                                              \
+                                                                                                   \
+    static uint64_t A3_HT_HASH_AT(K, V)(A3_HT(K, V) * table, size_t index) {                       \
+        return table->entries[index].hash;                                                         \
+    }                                                                                              \
+                                                                                                   \
+    /* Leave a hole in the dense array, without touching the slots. See A3_HT_REPAIR. */           \
+    static void A3_HT_DISCARD(K, V)(A3_HT(K, V) * table, size_t index) {                           \
+        assert(table);                                                                             \
+        table->entries[index].hash = 0;                                                            \
+        table->size--;                                                                             \
+    }                                                                                              \
+                                                                                                   \
+    /* Close up the dense array and rebuild the slots from scratch, which is cheaper than finding  \
+     * and removing the slot of each discarded entry. */                                           \
+    static void A3_HT_REPAIR(K, V)(A3_HT(K, V) * table) {                                          \
+        assert(table);                                                                             \
+                                                                                                   \
+        size_t to = 0;                                                                             \
+        for (size_t from = 0; from < table->used; from++) {                                        \
+            if (table->entries[from].hash)                                                         \
+                table->entries[to++] = table->entries[from];                                       \
+        }                                                                                          \
+        memset(&table->entries[to], 0, (table->used - to) * sizeof(A3_HT_ENTRY(K, V)));            \
+        table->used = to;                                                                          \
+                                                                                                   \
+        memset(table->slots, 0, table->cap * sizeof(A3HTSlot));                                    \
+        for (size_t i = 0; i < table->used; i++)                                                   \
+            A3_HT_PLACE(K, V)(table, a3_ht_slot_new(i, table->entries[i].hash));                   \
+    }                                                                                              \
+    A3_HT_DEFINE_COMMON_METHODS_(K, V)
+
+/// Define methods for an insertion-ordered table with HighwayHash as the hash function. See
+/// ::A3_HT_DEFINE_METHODS for the meaning of the arguments.
+#define A3_HT_DEFINE_METHODS_ORDERED(K, V, KEY_BYTES, KEY_SIZE, C)                                 \
+    A3_HT_DEFINE_DEFAULT_HASH_(K, V, KEY_BYTES, KEY_SIZE)                                          \
+                                                                                                   \
+    A3_HT_DEFINE_METHODS_ORDERED_HASHER(K, V, A3_HT_DEFAULT_HASH(K, V), C)
+
+/// Iterate over every entry of the hash table `T`, storing keys in `K_OUT` and values in `V_OUT` on
+/// every iteration.
+#define A3_HT_FOR_EACH(K, V, T, K_OUT, V_OUT)                                                      \
+    A3_SSIZE_T K_OUT##_i = A3_HT_NEXT_ENTRY(K, V)((T), 0);                                         \
+    K*         K_OUT     = (K_OUT##_i >= 0) ? A3_HT_KEY_AT(K, V)((T), (size_t)K_OUT##_i) : NULL;   \
+    V*         V_OUT     = (K_OUT##_i >= 0) ? A3_HT_VALUE_AT(K, V)((T), (size_t)K_OUT##_i) : NULL; \
+    for (; K_OUT##_i >= 0;                                                                         \
+         K_OUT##_i = A3_HT_NEXT_ENTRY(K, V)((T), (size_t)K_OUT##_i + 1),                           \
+         K_OUT     = A3_HT_KEY_AT(K, V)((T), (size_t)MAX(K_OUT##_i, 0)),                           \
+         V_OUT     = A3_HT_VALUE_AT(K, V)((T), (size_t)MAX(K_OUT##_i, 0)))
+
+/// A frozen hash table. See ::A3_HT_FREEZE.
+#define A3_HT_FROZEN(K, V) struct K##V##A3HTFrozen
+
+/// An entry in a frozen hash table.
+#define A3_HT_FROZEN_ENTRY(K, V) struct K##V##A3HTFrozenEntry
+
+/// Define the types of a frozen table. The types of the table itself, from any of the
+/// `DEFINE_STRUCTS` macros, must already be defined.
+#define A3_HT_DEFINE_STRUCTS_FROZEN(K, V)                                                          \
+    A3_H_BEGIN                                                                                     \
+                                                                                                   \
+    A3_HT_FROZEN_ENTRY(K, V) {                                                                     \
+        K        key;                                                                              \
+        V        value;                                                                            \
+        uint64_t hash;                                                                             \
+    };                                                                                             \
+                                                                                                   \
+    A3_HT_FROZEN(K, V) {                                                                           \
+        A3_HT(K, V) header; /* Empty, but for the hash key. Keys are hashed against it. */         \
+        size_t    size;                                                                            \
+        uint32_t  shift;                                                                           \
+        uint32_t* buckets; /* Bucket b is entries[buckets[b]..buckets[b + 1]). */                  \
+        A3_HT_FROZEN_ENTRY(K, V) * entries;                                                        \
+    };                                                                                             \
+                                                                                                   \
+    A3_H_END
+
+///
+///     void A3_HT_FREEZE(K, V)(A3_HT_FROZEN(K, V)* frozen, A3_HT(K, V)* table);
+///
+/// Move every entry of `table` into `frozen`, and destroy `table`, as with ::A3_HT_DESTROY. A
+/// frozen table cannot be modified. In exchange, it has no empty slots: its entries are packed
+/// into a single array, sorted by the top bits of their hashes, with one 4-byte offset per bucket
+/// of about one entry. A lookup reads the offsets of one bucket and then scans that bucket's
+/// entries, which are almost always on the same cache line, comparing full hashes before keys.
+/// Since nothing about a frozen table changes after it is built, any number of threads may look
+/// keys up in it at once without locking.
+#define A3_HT_FREEZE(K, V) K##V##_a3_ht_freeze
+
+///
+///     V const* A3_HT_FROZEN_FIND(K, V)(A3_HT_FROZEN(K, V) const*, K key);
+///
+/// Find the value of the given key in a frozen table, or `NULL` if it is not present. The key is
+/// hashed with the hash function of the original table.
+#define A3_HT_FROZEN_FIND(K, V) K##V##_a3_ht_frozen_find
+
+///
+///     V const* A3_HT_FROZEN_FIND_HASHED(K, V)(A3_HT_FROZEN(K, V) const*, uint64_t hash, K key);
+///
+/// Find the value of a key whose hash is already known. The hash must have come from
+/// ::A3_HT_HASH on a table with the same hash key (see ::A3_HT_HASH_KEY) as the frozen table's
+/// `header`.
+#define A3_HT_FROZEN_FIND_HASHED(K, V) K##V##_a3_ht_frozen_find_hashed
+
+///
+///     size_t A3_HT_FROZEN_SIZE(K, V)(A3_HT_FROZEN(K, V) const*);
+///
+/// Get the number of entries in a frozen table. They are `entries[0]` to `entries[size - 1]`.
+#define A3_HT_FROZEN_SIZE(K, V) K##V##_a3_ht_frozen_size
+
+///
+///     void A3_HT_FROZEN_DESTROY(K, V)(A3_HT_FROZEN(K, V)*);
+///
+/// Free the memory of a frozen table.
+#define A3_HT_FROZEN_DESTROY(K, V) K##V##_a3_ht_frozen_destroy
+
+/// Declare the methods of a frozen table. The declarations from ::A3_HT_DEFINE_STRUCTS_FROZEN must
+/// be visible.
+#define A3_HT_DECLARE_METHODS_FROZEN(K, V)                                                         \
+    A3_H_BEGIN                                                                                     \
+                                                                                                   \
+    void A3_HT_FREEZE(K, V)(A3_HT_FROZEN(K, V)*, A3_HT(K, V)*);                                    \
+    V const* A3_HT_FROZEN_FIND(K, V)(A3_HT_FROZEN(K, V) const*, K);                                \
+    V const* A3_HT_FROZEN_FIND_HASHED(K, V)(A3_HT_FROZEN(K, V) const*, uint64_t, K);               \
+    void     A3_HT_FROZEN_DESTROY(K, V)(A3_HT_FROZEN(K, V)*);                                      \
+                                                                                                   \
+    A3_ALWAYS_INLINE size_t A3_HT_FROZEN_SIZE(K, V)(A3_HT_FROZEN(K, V) const* frozen) {            \
+        assert(frozen);                                                                            \
+        return frozen->size;                                                                       \
+    }                                                                                              \
+                                                                                                   \
+    A3_H_END
+
+/// Define the methods of a frozen table, after the methods of the table itself. C is the
+/// comparator the table was defined with.
+#define A3_HT_DEFINE_METHODS_FROZEN(K, V, C)                                                       \
+    void A3_HT_FREEZE(K, V)(A3_HT_FROZEN(K, V) * frozen, A3_HT(K, V) * table) {                    \
+        assert(frozen);                                                                            \
+        assert(table);                                                                             \
+        assert(table->size < UINT32_MAX);                                                          \
+                                                                                                   \
+        memset(frozen, 0, sizeof(*frozen));                                                        \
+        memcpy(frozen->header.hash_key, table->hash_key, sizeof(table->hash_key));                 \
+        frozen->size = table->size;                                                                \
+                                                                                                   \
+        size_t n_buckets = a3_ht_pow2_cap(MAX(table->size, (size_t)2));                            \
+        frozen->shift    = (uint32_t)a3_ht_clz((uint64_t)n_buckets - 1);                           \
+        A3_UNWRAPN(frozen->buckets,                                                                \
+                   (uint32_t*)a3_large_calloc(n_buckets + 1, sizeof(uint32_t)));                   \
+        A3_UNWRAPN(frozen->entries, (A3_HT_FROZEN_ENTRY(K, V)*)a3_large_calloc(                    \
+                                        MAX(table->size, (size_t)1), sizeof(*frozen->entries)));   \
+                                                                                                   \
+        /* Counting sort by bucket, keeping each entry's hash, since some layouts must recompute   \
+         * it. */                                                                                  \
+        uint64_t* hashes = NULL;                                                                   \
+        A3_UNWRAPN(hashes, (uint64_t*)calloc(MAX(table->size, (size_t)1), sizeof(uint64_t)));      \
+        size_t n = 0;                                                                              \
+        for (A3_SSIZE_T i = A3_HT_NEXT_ENTRY(K, V)(table, 0); i >= 0;                              \
+             i            = A3_HT_NEXT_ENTRY(K, V)(table, (size_t)i + 1)) {                        \
+            hashes[n] = A3_HT_HASH_AT(K, V)(table, (size_t)i);                                     \
+            frozen->buckets[(hashes[n++] >> frozen->shift) + 1]++;                                 \
+        }                                                                                          \
+        for (size_t b = 1; b <= n_buckets; b++)                                                    \
+            frozen->buckets[b] += frozen->buckets[b - 1];                                          \
+                                                                                                   \
+        n = 0;                                                                                     \
+        for (A3_SSIZE_T i = A3_HT_NEXT_ENTRY(K, V)(table, 0); i >= 0;                              \
+             i            = A3_HT_NEXT_ENTRY(K, V)(table, (size_t)i + 1)) {                        \
+            uint64_t hash = hashes[n++];                                                           \
+            A3_HT_FROZEN_ENTRY(K, V)* entry =                                                      \
+                &frozen->entries[frozen->buckets[hash >> frozen->shift]++];                        \
+            entry->key   = *A3_HT_KEY_AT(K, V)(table, (size_t)i);                                  \
+            entry->value = *A3_HT_VALUE_AT(K, V)(table, (size_t)i);                                \
+            entry->hash  = hash;                                                                   \
+        }                                                                                          \
+        free(hashes);                                                                              \
+                                                                                                   \
+        /* Each bucket's offset has been advanced to the start of the next. */                     \
+        memmove(&frozen->buckets[1], &frozen->buckets[0], n_buckets * sizeof(uint32_t));           \
+        frozen->buckets[0] = 0;                                                                    \
+                                                                                                   \
+        A3_HT_DESTROY(K, V)(table);                                                                \
+    }                                                                                              \
+                                                                                                   \
+    V const* A3_HT_FROZEN_FIND_HASHED(K, V)(A3_HT_FROZEN(K, V) const* frozen, uint64_t hash,       \
+                                            K key) {                                               \
+        assert(frozen);                                                                            \
+                                                                                                   \
+        size_t bucket = (size_t)(hash >> frozen->shift);                                           \
+        for (uint32_t i = frozen->buckets[bucket]; i < frozen->buckets[bucket + 1]; i++) {         \
+            A3_HT_FROZEN_ENTRY(K, V) const* entry = &frozen->entries[i];                           \
+            if (entry->hash == hash && C(key, entry->key) == 0)                                    \
+                return &entry->value;                                                              \
+        }                                                                                          \
+                                                                                                   \
+        return NULL;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    V const* A3_HT_FROZEN_FIND(K, V)(A3_HT_FROZEN(K, V) const* frozen, K key) {                    \
+        assert(frozen);                                                                            \
+        /* Hashing only reads the header, so the cast does not break immutability. */              \
+        uint64_t hash = A3_HT_HASH(K, V)((A3_HT(K, V)*)&frozen->header, key);                      \
+        return A3_HT_FROZEN_FIND_HASHED(K, V)(frozen, hash, key);                                  \
+    }                                                                                              \
+                                                                                                   \
+    void A3_HT_FROZEN_DESTROY(K, V)(A3_HT_FROZEN(K, V) * frozen) {                                 \
+        assert(frozen);                                                                            \
+        /* The bucket count is recovered from the shift it was stored as. */                       \
+        a3_large_free(frozen->buckets, ((size_t)1 << (64 - frozen->shift)) + 1, sizeof(uint32_t)); \
+        a3_large_free(frozen->entries, MAX(frozen->size, (size_t)1), sizeof(*frozen->entries));    \
+    }
@@ -0,0 +1,108 @@
+/*
+ * PERFECT HASH -- Collision-free lookup in fixed sets of strings.
+ *
+ * Copyright (c) 2020-2021, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in
+ * the project root for details.
+ */
+
+/// \file phf.h
+/// # Perfect Hash
+/// Lookup in a set of strings which is known ahead of time, such as HTTP method names or known
+/// header names. The table is built once, offline, so that every key has a slot of its own: a
+/// lookup hashes the key, reads the displacement of the key's bucket, and compares against the one
+/// key which can live in the resulting slot. There is no probing, and a miss costs the same as a
+/// hit.
+///
+/// Tables are not built at runtime. In C++20, a3::make_perfect_hash (see phf.hh) builds one at
+/// compile time. From C, the `a3_phf_gen` tool turns a file of keys, one per line, into a header
+/// defining an ::A3Phf, and the `a3_phf_gen` Meson generator does so as part of a build. In both
+/// cases, a key's index is its position in the original list, so lookups can be mapped to values
+/// with a parallel array.
+///
+/// The hash is FNV-1a with a murmur finalizer: cheap for the short keys perfect hashes are meant
+/// for, and simple enough to evaluate at compile time. It is not suitable for untrusted keys in a
+/// general-purpose table, but it need not be here, because the set of keys cannot change.
+
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <a3/cpp.h>
+#include <a3/str.h>
+#include <a3/types.h>
+
+A3_H_BEGIN
+
+/// The slot value of an unoccupied slot.
+#define A3_PHF_EMPTY UINT32_MAX
+
+/// A perfect hash table, generated by `a3_phf_gen`.
+typedef struct A3Phf {
+    uint64_t         seed;      ///< The seed the table was built with.
+    uint32_t         n_buckets; ///< The number of displacements.
+    uint32_t         mask;      ///< The number of slots, minus one.
+    uint32_t const*  disp;      ///< The displacement of each bucket.
+    uint32_t const*  slots;     ///< The index of the key in each slot, or ::A3_PHF_EMPTY.
+    A3CString const* keys;      ///< The keys, in their original order.
+} A3Phf;
+
+#ifndef DOXYGEN
+A3_ALWAYS_INLINE A3_CONSTEXPR uint64_t a3_phf_hash_init(uint64_t seed) {
+    return 0xCBF29CE484222325ULL ^ seed;
+}
+
+A3_ALWAYS_INLINE A3_CONSTEXPR uint64_t a3_phf_hash_step(uint64_t hash, uint8_t byte) {
+    return (hash ^ byte) * 0x100000001B3ULL;
+}
+
+A3_ALWAYS_INLINE A3_CONSTEXPR uint64_t a3_phf_hash_finish(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+#endif
+
+/// Hash a key for a perfect hash table with the given seed.
+A3_ALWAYS_INLINE A3_CONSTEXPR uint64_t a3_phf_hash(uint64_t seed, A3CString key) {
+    uint64_t hash = a3_phf_hash_init(seed);
+    for (size_t i = 0; i < key.len; i++)
+        hash = a3_phf_hash_step(hash, key.ptr[i]);
+    return a3_phf_hash_finish(hash);
+}
+
+/// The bucket, and so the displacement, used by the given hash. The upper half of the hash selects
+/// the bucket, and the lower half the slot.
+A3_ALWAYS_INLINE A3_CONSTEXPR uint32_t a3_phf_bucket(uint64_t hash, uint32_t n_buckets) {
+    return (uint32_t)(((hash >> 32) * n_buckets) >> 32);
+}
+
+/// The slot of a key with the given hash and bucket displacement. Each displacement steps through
+/// the slots with an odd stride, so every slot is reachable from any key.
+A3_ALWAYS_INLINE A3_CONSTEXPR uint32_t a3_phf_slot(uint64_t hash, uint32_t disp, uint32_t mask) {
+    return ((uint32_t)hash + disp * ((uint32_t)(hash >> 32) | 1)) & mask;
+}
+
+/// Find the index of the given key in the table, or -1 if it is not present.
+A3_ALWAYS_INLINE A3_SSIZE_T a3_phf_find(A3Phf const* phf, A3CString key) {
+    assert(phf);
+
+    uint64_t hash = a3_phf_hash(phf->seed, key);
+    uint32_t index =
+        phf->slots[a3_phf_slot(hash, phf->disp[a3_phf_bucket(hash, phf->n_buckets)], phf->mask)];
+    if (index == A3_PHF_EMPTY)
+        return -1;
+
+    A3CString candidate = phf->keys[index];
+    if (candidate.len != key.len || (key.len && memcmp(candidate.ptr, key.ptr, key.len) != 0))
+        return -1;
+    return (A3_SSIZE_T)index;
+}
+
+A3_H_END
@@ -0,0 +1,234 @@
+/*
+ * PERFECT HASH -- Compile-time perfect hash tables.
+ *
+ * Copyright (c) 2020-2021, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in
+ * the project root for details.
+ */
+
+/// \file phf.hh
+/// # Perfect Hash
+/// Perfect hash tables built by the compiler. See phf.h for the scheme.
+///
+///     static constexpr auto METHODS = a3::make_perfect_hash({ "GET", "HEAD", "POST" });
+///     static_assert(METHODS.find("POST") == 2);
+///
+/// Keys are given as `std::string_view`s, since the bytes behind an ::A3CString cannot be read
+/// during constant evaluation. Lookups accept either.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include <a3/phf.h>
+#include <a3/str.h>
+#include <a3/types.h>
+
+namespace a3 {
+
+namespace detail {
+
+/// The number of seeds to try before giving up on a keyset.
+constexpr uint32_t PHF_MAX_SEEDS = 4096;
+
+/// The number of slots for N keys: the smallest power of two which holds them all.
+constexpr uint32_t phf_cap(size_t n) {
+    uint32_t cap = 1;
+    while (cap < n)
+        cap <<= 1;
+    return cap;
+}
+
+/// The number of buckets for N keys. Smaller buckets are easier to place, and a bucket costs one
+/// displacement.
+constexpr uint32_t phf_buckets(size_t n) { return n < 2 ? 1 : static_cast<uint32_t>(n / 2); }
+
+constexpr uint64_t phf_hash(uint64_t seed, std::string_view key) {
+    uint64_t hash = a3_phf_hash_init(seed);
+    for (char c : key)
+        hash = a3_phf_hash_step(hash, static_cast<uint8_t>(c));
+    return a3_phf_hash_finish(hash);
+}
+
+constexpr uint64_t phf_seed(uint32_t attempt) {
+    return a3_phf_hash_finish((attempt + 1) * 0x9E3779B97F4A7C15ULL);
+}
+
+enum class PhfStatus { Ok, Duplicate, Failed };
+
+/// Try to build a table with the given seed. Keys, disp, and slots are indexable containers sized
+/// for the keyset, and hashes, order, and starts are scratch space of `keys.size()`,
+/// `keys.size()`, and `disp.size() + 1` elements, so this works on arrays at compile time and on
+/// vectors at runtime.
+template <typename Keys, typename Disp, typename Slots, typename Hashes, typename Order,
+          typename Starts>
+constexpr PhfStatus phf_try(Keys const& keys, uint64_t seed, Disp& disp, Slots& slots,
+                            Hashes& hashes, Order& order, Starts& starts) {
+    auto     n         = static_cast<uint32_t>(keys.size());
+    auto     n_buckets = static_cast<uint32_t>(disp.size());
+    auto     mask      = static_cast<uint32_t>(slots.size() - 1);
+    uint32_t max_size  = 0;
+
+    for (auto& start : starts)
+        start = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        hashes[i] = phf_hash(seed, keys[i]);
+        starts[a3_phf_bucket(hashes[i], n_buckets)]++;
+    }
+
+    // Counting sort the keys by bucket, so bucket b holds order[starts[b]..starts[b + 1]].
+    for (uint32_t b = 0; b < n_buckets; b++) {
+        if (starts[b] > max_size)
+            max_size = starts[b];
+        if (b > 0)
+            starts[b] += starts[b - 1];
+    }
+    starts[n_buckets] = n;
+    for (uint32_t i = n; i > 0; i--)
+        order[--starts[a3_phf_bucket(hashes[i - 1], n_buckets)]] = i - 1;
+
+    for (auto& slot : slots)
+        slot = A3_PHF_EMPTY;
+
+    // Place the largest buckets first, while the table is emptiest.
+    for (uint32_t size = max_size; size > 0; size--) {
+        for (uint32_t b = 0; b < n_buckets; b++) {
+            uint32_t start = starts[b];
+            uint32_t end   = starts[b + 1];
+            if (end - start != size)
+                continue;
+
+            for (uint32_t i = start; i < end; i++) {
+                for (uint32_t j = start; j < i; j++) {
+                    if (hashes[order[i]] == hashes[order[j]] && keys[order[i]] == keys[order[j]])
+                        return PhfStatus::Duplicate;
+                }
+            }
+
+            bool placed = false;
+            for (uint32_t d = 0; d <= mask && !placed; d++) {
+                placed = true;
+                for (uint32_t i = start; i < end && placed; i++) {
+                    uint32_t slot = a3_phf_slot(hashes[order[i]], d, mask);
+                    if (slots[slot] != A3_PHF_EMPTY) {
+                        placed = false;
+                        break;
+                    }
+                    for (uint32_t j = start; j < i; j++) {
+                        if (a3_phf_slot(hashes[order[j]], d, mask) == slot) {
+                            placed = false;
+                            break;
+                        }
+                    }
+                }
+                if (placed) {
+                    disp[b] = d;
+                    for (uint32_t i = start; i < end; i++)
+                        slots[a3_phf_slot(hashes[order[i]], d, mask)] = order[i];
+                }
+            }
+            if (!placed)
+                return PhfStatus::Failed;
+        }
+    }
+
+    return PhfStatus::Ok;
+}
+
+/// Search for a seed which gives a collision-free table. On success, the seed is stored in `seed`.
+template <typename Keys, typename Disp, typename Slots, typename Hashes, typename Order,
+          typename Starts>
+constexpr PhfStatus phf_build(Keys const& keys, uint64_t& seed, Disp& disp, Slots& slots,
+                              Hashes& hashes, Order& order, Starts& starts) {
+    for (uint32_t attempt = 0; attempt < PHF_MAX_SEEDS; attempt++) {
+        seed             = phf_seed(attempt);
+        PhfStatus status = phf_try(keys, seed, disp, slots, hashes, order, starts);
+        if (status != PhfStatus::Failed)
+            return status;
+    }
+
+    return PhfStatus::Failed;
+}
+
+// Deliberately not constexpr, so reaching these during constant evaluation names the problem in
+// the compiler's error.
+void perfect_hash_has_duplicate_keys();
+void perfect_hash_found_no_seed();
+
+} // namespace detail
+
+/// A perfect hash table over N keys, built at compile time by a3::make_perfect_hash.
+template <size_t N>
+struct PerfectHash {
+    static_assert(N > 0, "A perfect hash needs at least one key.");
+
+    static constexpr uint32_t CAP     = detail::phf_cap(N);     ///< The number of slots.
+    static constexpr uint32_t BUCKETS = detail::phf_buckets(N); ///< The number of displacements.
+
+    uint64_t                        seed;  ///< The seed the table was built with.
+    std::array<uint32_t, BUCKETS>   disp;  ///< The displacement of each bucket.
+    std::array<uint32_t, CAP>       slots; ///< The index of the key in each slot, or empty.
+    std::array<std::string_view, N> keys;  ///< The keys, in their original order.
+
+    /// The number of keys.
+    static constexpr size_t size() { return N; }
+
+    /// Find the index of the given key, or -1 if it is not present.
+    constexpr A3_SSIZE_T find(std::string_view key) const {
+        return check(slot_for(detail::phf_hash(seed, key)), key);
+    }
+
+    /// Find the index of the given key, or -1 if it is not present.
+    A3_SSIZE_T find(A3CString key) const {
+        return check(slot_for(a3_phf_hash(seed, key)),
+                     std::string_view { reinterpret_cast<char const*>(key.ptr), key.len });
+    }
+
+    /// Check whether the given key is present.
+    template <typename Key>
+    constexpr bool contains(Key key) const {
+        return find(key) >= 0;
+    }
+
+private:
+    constexpr uint32_t slot_for(uint64_t hash) const {
+        return slots[a3_phf_slot(hash, disp[a3_phf_bucket(hash, BUCKETS)], CAP - 1)];
+    }
+
+    constexpr A3_SSIZE_T check(uint32_t index, std::string_view key) const {
+        if (index == A3_PHF_EMPTY || keys[index] != key)
+            return -1;
+        return static_cast<A3_SSIZE_T>(index);
+    }
+};
+
+/// Build a perfect hash table over the given keys. This runs at compile time, and fails to compile
+/// if the keys contain duplicates.
+template <size_t N>
+consteval PerfectHash<N> make_perfect_hash(std::string_view const (&keys)[N]) {
+    PerfectHash<N> ret {};
+    for (size_t i = 0; i < N; i++)
+        ret.keys[i] = keys[i];
+
+    std::array<uint64_t, N>                           hashes {};
+    std::array<uint32_t, N>                           order {};
+    std::array<uint32_t, PerfectHash<N>::BUCKETS + 1> starts {};
+    switch (detail::phf_build(ret.keys, ret.seed, ret.disp, ret.slots, hashes, order, starts)) {
+    case detail::PhfStatus::Ok:
+        break;
+    case detail::PhfStatus::Duplicate:
+        detail::perfect_hash_has_duplicate_keys();
+        break;
+    case detail::PhfStatus::Failed:
+        detail::perfect_hash_found_no_seed();
+        break;
+    }
+
+    return ret;
+}
+
+} // namespace a3
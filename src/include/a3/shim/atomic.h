@@ -7,7 +7,7 @@
  * for details.
  *
  * Some platforms do not provide stdatomic. For now, this shim provides only the primitives used by
- * A3Spmc.
+ * A3Spmc and A3_CHT.
  */
 
 #pragma once
@@ -30,3 +30,4 @@ typedef enum A3MemoryOrder {
 #define A3_ATOMIC_COMPARE_EXCHANGE      atomic_compare_exchange_strong_explicit
 #define A3_ATOMIC_COMPARE_EXCHANGE_WEAK atomic_compare_exchange_weak_explicit
 #define A3_ATOMIC_FETCH_ADD             atomic_fetch_add_explicit
+#define A3_ATOMIC_FENCE                 atomic_thread_fence
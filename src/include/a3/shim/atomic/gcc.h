@@ -67,3 +67,4 @@ typedef enum A3MemoryOrder {
     })
 
 #define A3_ATOMIC_FETCH_ADD(ATOM, RHS, ORDER) __atomic_fetch_add((ATOM), (RHS), (ORDER))
+#define A3_ATOMIC_FENCE(ORDER)                __atomic_thread_fence((ORDER))
@@ -47,6 +47,7 @@ typedef enum A3MemoryOrder {
                         (ORDER_FAIL))
 #define A3_ATOMIC_FETCH_ADD(ATOM, RHS, ORDER)                                                      \
     _A3_ATOMIC_DISPATCH(ATOM, fetch_add, (ATOM), (RHS), (ORDER))
+#define A3_ATOMIC_FENCE(ORDER) a3_atomic_fence((ORDER))
 
 A3_EXPORT void*  a3_atomic_ptr_load(A3_ATOMIC(void*) const*, A3MemoryOrder);
 A3_EXPORT size_t a3_atomic_usize_load(A3_ATOMIC(size_t) const*, A3MemoryOrder);
@@ -65,3 +66,4 @@ A3_EXPORT bool a3_atomic_usize_compare_exchange_weak(A3_ATOMIC(size_t) *, size_t
                                                      A3MemoryOrder order_fail);
 A3_EXPORT void*  a3_atomic_ptr_fetch_add(A3_ATOMIC(void*) *, ptrdiff_t rhs, A3MemoryOrder);
 A3_EXPORT size_t a3_atomic_usize_fetch_add(A3_ATOMIC(size_t) *, size_t rhs, A3MemoryOrder);
+A3_EXPORT void   a3_atomic_fence(A3MemoryOrder);
@@ -0,0 +1,30 @@
+/*
+ * MMAP SHIM -- Cross-platform shim for mapping anonymous memory.
+ *
+ * Copyright (c) 2022, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in the project root
+ * for details.
+ *
+ * POSIX systems provide mmap, and Windows provides VirtualAlloc. Elsewhere, the heap stands in.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <a3/cpp.h>
+#include <a3/types.h>
+
+A3_H_BEGIN
+
+/// Map `size` bytes of zeroed, page-aligned memory, or return `NULL`. `huge_pages` asks for the
+/// mapping to be backed by huge pages, and `populate` for every page to be faulted in immediately.
+/// Both are hints, and are ignored where they are unsupported.
+A3_EXPORT void* a3_shim_map(size_t size, bool huge_pages, bool populate);
+
+/// Unmap memory from ::a3_shim_map, given the same `size`.
+A3_EXPORT void a3_shim_unmap(void* ptr, size_t size);
+
+A3_H_END
@@ -0,0 +1,19 @@
+/*
+ * PREFETCH — Cross-platform shim for software prefetching.
+ *
+ * Copyright (c) 2020, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in the project root
+ * for details.
+ */
+
+#pragma once
+
+#if defined(__GNUC__) || defined(__clang__)
+#define A3_PREFETCH(ADDR) __builtin_prefetch((ADDR))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#define A3_PREFETCH(ADDR) _mm_prefetch((char const*)(ADDR), _MM_HINT_T0)
+#else
+#define A3_PREFETCH(ADDR) ((void)(ADDR))
+#endif
@@ -0,0 +1,47 @@
+/*
+ * THREAD SHIM -- Cross-platform shim for running work on several threads.
+ *
+ * Copyright (c) 2022, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in the project root
+ * for details.
+ *
+ * POSIX systems provide pthreads, and Windows provides CreateThread. Elsewhere, the work runs on
+ * the calling thread, and yielding does nothing.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#include <a3/cpp.h>
+#include <a3/types.h>
+
+A3_H_BEGIN
+
+/// A task run by ::a3_shim_parallel, once for each index.
+typedef void (*A3ParallelTask)(void* ctx, size_t index);
+
+/// Call `task(ctx, i)` for each `i` in `[0, n)`, each on a thread of its own, and return once all
+/// have finished. Index 0 runs on the calling thread. If a thread cannot be started, its index also
+/// runs on the calling thread, so every index runs exactly once either way.
+A3_EXPORT void a3_shim_parallel(size_t n, A3ParallelTask task, void* ctx);
+
+/// Give up the rest of the calling thread's time slice, so that a thread holding a spinning lock
+/// can run.
+A3_EXPORT void a3_shim_yield(void);
+
+#ifndef A3_SPINS
+/// The number of times a thread retries a busy lock before yielding, so that a writer which was
+/// preempted while holding the lock can finish. Can be overridden.
+#define A3_SPINS 64
+#endif
+
+/// Count another retry of a busy lock in `spins`, which starts at zero, and yield every ::A3_SPINS
+/// retries.
+A3_ALWAYS_INLINE void a3_shim_backoff(size_t* spins) {
+    if (++*spins % A3_SPINS == 0)
+        a3_shim_yield();
+}
+
+A3_H_END
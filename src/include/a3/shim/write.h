@@ -0,0 +1,23 @@
+/*
+ * WRITE SHIM -- Cross-platform shim for write.
+ *
+ * Copyright (c) 2022, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in the project root
+ * for details.
+ *
+ * Windows provides _write in io.h instead of write in unistd.h.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#include <a3/cpp.h>
+#include <a3/types.h>
+
+A3_H_BEGIN
+
+A3_EXPORT A3_SSIZE_T a3_shim_write(int fd, void const* buf, size_t len);
+
+A3_H_END
@@ -0,0 +1,64 @@
+/*
+ * SKETCH -- A count-min sketch of access frequencies.
+ *
+ * Copyright (c) 2022, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in
+ * the project root for details.
+ */
+
+/// \file sketch.h
+/// # Frequency Sketch
+/// An estimate of how often each of a stream of items has been seen recently, in a fixed, small
+/// amount of memory. Items are identified by a 64-bit hash. This is the frequency filter of
+/// TinyLFU, which cache.h uses to decide whether a new entry deserves the place of an old one.
+///
+/// Counters are four bits wide, and packed sixteen to a word. Each item maps to ::A3_SKETCH_DEPTH
+/// counters, and its estimate is the least of them, so collisions can only inflate it. Only the
+/// least of an item's counters are incremented (the "conservative update"), which keeps the
+/// inflation down. A sketch for `capacity` items has between ::A3_SKETCH_COUNTERS and twice that
+/// many counters per item, since the total is rounded up to a power of two.
+///
+/// Once ten times `capacity` items have been recorded, every counter is halved. Old popularity
+/// therefore fades, and counters saturating at 15 does not matter.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <a3/cpp.h>
+#include <a3/types.h>
+
+A3_H_BEGIN
+
+/// The number of counters to which each item maps.
+#define A3_SKETCH_DEPTH 4
+
+/// The greatest value of a counter.
+#define A3_SKETCH_MAX 15
+
+/// The least number of counters per item. Each doubling buys a few points of hit ratio on skewed
+/// traces with a long tail, whose rare keys otherwise crowd the counters of popular ones.
+#ifndef A3_SKETCH_COUNTERS
+#define A3_SKETCH_COUNTERS 4
+#endif
+
+typedef struct A3Sketch A3Sketch;
+
+/// Create a sketch sized for a working set of `capacity` items.
+A3_EXPORT A3Sketch* a3_sketch_new(size_t capacity);
+
+/// Free a sketch.
+A3_EXPORT void a3_sketch_free(A3Sketch*);
+
+/// Record one occurrence of the item with the given hash.
+A3_EXPORT void a3_sketch_increment(A3Sketch*, uint64_t hash);
+
+/// Estimate how often the item with the given hash has been seen, up to ::A3_SKETCH_MAX.
+A3_EXPORT uint8_t a3_sketch_estimate(A3Sketch const*, uint64_t hash);
+
+/// Get the size of the sketch's counters, in bytes.
+A3_EXPORT size_t a3_sketch_bytes(A3Sketch const*);
+
+A3_H_END
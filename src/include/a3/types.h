@@ -49,3 +49,13 @@ typedef ssize_t A3_SSIZE_T;
 #else
 #define A3_THREAD_LOCAL __thread
 #endif
+
+#ifdef __cplusplus
+#define A3_ALIGNAS(N) alignas(N)
+#elif __STDC_VERSION__ >= 201112L
+#define A3_ALIGNAS(N) _Alignas(N)
+#elif defined(_MSC_VER)
+#define A3_ALIGNAS(N) __declspec(align(N))
+#else
+#define A3_ALIGNAS(N) __attribute__((aligned(N)))
+#endif
@@ -0,0 +1,82 @@
+/*
+ * WHEEL -- A hierarchical timer wheel.
+ *
+ * Copyright (c) 2022, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in
+ * the project root for details.
+ */
+
+/// \file wheel.h
+/// # Timer Wheel
+/// A set of timers, each of which fires once the wheel's clock reaches its deadline. Time is
+/// counted in ticks of whatever length the user chooses, and only moves when ::a3_wheel_advance is
+/// called.
+///
+/// The wheel has ::A3_WHEEL_LEVELS levels of ::A3_WHEEL_SLOTS slots each. A slot of the lowest level
+/// spans one tick, and a slot of each level above spans a whole turn of the level below. A timer is
+/// placed in the lowest level whose slot can tell its deadline apart from the current tick. When the
+/// clock enters a slot of a higher level, its timers are moved down, so each timer is moved at most
+/// once per level. Timers beyond the reach of the highest level wait in an overflow list, which is
+/// sorted again each time the highest level turns. Scheduling is therefore O(1), and advancing is
+/// O(1) per tick plus O(1) per timer fired. While no timers are scheduled, the clock jumps straight
+/// to its new value.
+///
+/// Timers cannot be cancelled. Users which need to should check, when a timer fires, whether the
+/// thing it was for is still current.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <a3/cpp.h>
+#include <a3/types.h>
+
+A3_H_BEGIN
+
+/// The base-2 logarithm of the number of slots in each level of a timer wheel.
+#define A3_WHEEL_SLOT_BITS 6
+
+/// The number of slots in each level of a timer wheel.
+#define A3_WHEEL_SLOTS (1U << A3_WHEEL_SLOT_BITS)
+
+/// The number of levels in a timer wheel. Together, they reach 2^24 ticks ahead.
+#define A3_WHEEL_LEVELS 4
+
+typedef struct A3TimerWheel A3TimerWheel;
+
+/// A scheduled timer. `id` is chosen by the user, and need not be unique.
+typedef struct A3Timer {
+    uint64_t id;
+    uint64_t deadline;
+} A3Timer;
+
+/// Called for each timer as it fires.
+typedef void (*A3TimerCallback)(void* ctx, A3Timer timer);
+
+/// Create a timer wheel whose clock reads `now`.
+A3_EXPORT A3TimerWheel* a3_wheel_new(uint64_t now);
+
+/// Free a timer wheel. Timers which have not fired are discarded.
+A3_EXPORT void a3_wheel_free(A3TimerWheel*);
+
+/// Schedule a timer to fire at `deadline`. A deadline which has already passed fires on the next
+/// tick.
+A3_EXPORT void a3_wheel_schedule(A3TimerWheel*, uint64_t id, uint64_t deadline);
+
+/// Move the clock forward to `now`, calling `callback` for each timer whose deadline is reached.
+/// Timers fire in order of the tick on which they fall due. Does nothing if `now` is not ahead of
+/// the clock. The callback may schedule further timers.
+A3_EXPORT void a3_wheel_advance(A3TimerWheel*, uint64_t now, A3TimerCallback callback, void* ctx);
+
+/// Discard every timer, without firing them.
+A3_EXPORT void a3_wheel_clear(A3TimerWheel*);
+
+/// Get the current time on the wheel's clock.
+A3_EXPORT uint64_t a3_wheel_now(A3TimerWheel const*);
+
+/// Get the number of timers which have not yet fired.
+A3_EXPORT size_t a3_wheel_count(A3TimerWheel const*);
+
+A3_H_END
@@ -112,3 +112,9 @@ size_t a3_atomic_usize_fetch_add(A3_ATOMIC(size_t) * atom, size_t rhs, A3MemoryO
 
     return ret;
 }
+
+void a3_atomic_fence(A3MemoryOrder order) {
+    (void)order;
+
+    MemoryBarrier();
+}
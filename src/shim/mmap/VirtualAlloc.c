@@ -0,0 +1,38 @@
+/*
+ * MMAP SHIM -- Cross-platform shim for mapping anonymous memory.
+ *
+ * Copyright (c) 2022, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in the project root
+ * for details.
+ *
+ * POSIX systems provide mmap, and Windows provides VirtualAlloc. Elsewhere, the heap stands in.
+ *
+ * Large pages on Windows need a privilege which processes rarely hold, so the hint is ignored.
+ * Committed pages are still only faulted in on first touch.
+ */
+
+#include <a3/shim/mmap.h>
+#include <assert.h>
+#include <stdint.h>
+#include <windows.h>
+
+void* a3_shim_map(size_t size, bool huge_pages, bool populate) {
+    assert(size > 0);
+    (void)huge_pages;
+
+    void* ret = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (ret && populate) {
+        for (size_t i = 0; i < size; i += 4096)
+            ((volatile uint8_t*)ret)[i] = 0;
+    }
+
+    return ret;
+}
+
+void a3_shim_unmap(void* ptr, size_t size) {
+    assert(ptr);
+    (void)size;
+
+    VirtualFree(ptr, 0, MEM_RELEASE);
+}
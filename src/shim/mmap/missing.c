@@ -0,0 +1,33 @@
+/*
+ * MMAP SHIM -- Cross-platform shim for mapping anonymous memory.
+ *
+ * Copyright (c) 2022, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in the project root
+ * for details.
+ *
+ * POSIX systems provide mmap, and Windows provides VirtualAlloc. Elsewhere, the heap stands in.
+ */
+
+#include <a3/shim/aligned_alloc.h>
+#include <a3/shim/mmap.h>
+#include <assert.h>
+#include <string.h>
+
+void* a3_shim_map(size_t size, bool huge_pages, bool populate) {
+    assert(size > 0);
+    (void)huge_pages;
+    (void)populate;
+
+    void* ret = a3_shim_aligned_alloc(size, 4096);
+    if (ret)
+        memset(ret, 0, size);
+    return ret;
+}
+
+void a3_shim_unmap(void* ptr, size_t size) {
+    assert(ptr);
+    (void)size;
+
+    a3_shim_aligned_free(ptr);
+}
@@ -0,0 +1,65 @@
+/*
+ * MMAP SHIM -- Cross-platform shim for mapping anonymous memory.
+ *
+ * Copyright (c) 2022, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in the project root
+ * for details.
+ *
+ * POSIX systems provide mmap, and Windows provides VirtualAlloc. Elsewhere, the heap stands in.
+ */
+
+#define _GNU_SOURCE
+
+#include <a3/shim/mmap.h>
+#include <assert.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+void* a3_shim_map(size_t size, bool huge_pages, bool populate) {
+    assert(size > 0);
+
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_POPULATE
+    // MAP_POPULATE faults pages in before they can be advised, which would make them small pages,
+    // so mappings which want huge pages are populated after the advice instead.
+    if (populate && !huge_pages) {
+        flags |= MAP_POPULATE;
+        populate = false;
+    }
+#endif
+
+    void* ret = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (ret == MAP_FAILED)
+        return NULL;
+
+#ifdef MADV_HUGEPAGE
+    if (huge_pages)
+        madvise(ret, size, MADV_HUGEPAGE);
+#else
+    (void)huge_pages;
+#endif
+
+    if (populate) {
+#ifdef MADV_POPULATE_WRITE
+        if (madvise(ret, size, MADV_POPULATE_WRITE) == 0)
+            return ret;
+#endif
+        // Writing one byte of each page faults it in. The stride is the smallest page size in
+        // common use, since touching a page twice is harmless.
+        for (size_t i = 0; i < size; i += 4096)
+            ((volatile uint8_t*)ret)[i] = 0;
+    }
+
+    return ret;
+}
+
+void a3_shim_unmap(void* ptr, size_t size) {
+    assert(ptr);
+
+    munmap(ptr, size);
+}
@@ -0,0 +1,58 @@
+/*
+ * THREAD SHIM -- Cross-platform shim for running work on several threads.
+ *
+ * Copyright (c) 2022, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in the project root
+ * for details.
+ *
+ * Windows does not provide pthreads.
+ */
+
+#include <a3/shim/thread.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <windows.h>
+
+#include <a3/util.h>
+
+typedef struct A3ParallelRun {
+    A3ParallelTask task;
+    void*          ctx;
+    size_t         index;
+    HANDLE         thread;
+} A3ParallelRun;
+
+static DWORD WINAPI a3_parallel_run(LPVOID arg) {
+    A3ParallelRun* run = arg;
+    run->task(run->ctx, run->index);
+    return 0;
+}
+
+void a3_shim_parallel(size_t n, A3ParallelTask task, void* ctx) {
+    assert(task);
+    if (!n)
+        return;
+
+    A3_UNWRAPNI(A3ParallelRun*, runs, calloc(n, sizeof(*runs)));
+    for (size_t i = 1; i < n; i++) {
+        runs[i].task   = task;
+        runs[i].ctx    = ctx;
+        runs[i].index  = i;
+        runs[i].thread = CreateThread(NULL, 0, a3_parallel_run, &runs[i], 0, NULL);
+    }
+
+    task(ctx, 0);
+    for (size_t i = 1; i < n; i++) {
+        if (runs[i].thread) {
+            WaitForSingleObject(runs[i].thread, INFINITE);
+            CloseHandle(runs[i].thread);
+        } else {
+            task(ctx, i);
+        }
+    }
+
+    free(runs);
+}
+
+void a3_shim_yield(void) { SwitchToThread(); }
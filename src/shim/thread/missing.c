@@ -0,0 +1,22 @@
+/*
+ * THREAD SHIM -- Cross-platform shim for running work on several threads.
+ *
+ * Copyright (c) 2022, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in the project root
+ * for details.
+ *
+ * Without any threads, every index runs on the calling thread, in order.
+ */
+
+#include <a3/shim/thread.h>
+#include <assert.h>
+
+void a3_shim_parallel(size_t n, A3ParallelTask task, void* ctx) {
+    assert(task);
+
+    for (size_t i = 0; i < n; i++)
+        task(ctx, i);
+}
+
+void a3_shim_yield(void) {}
@@ -0,0 +1,57 @@
+/*
+ * THREAD SHIM -- Cross-platform shim for running work on several threads.
+ *
+ * Copyright (c) 2022, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in the project root
+ * for details.
+ */
+
+#include <a3/shim/thread.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <a3/util.h>
+
+typedef struct A3ParallelRun {
+    A3ParallelTask task;
+    void*          ctx;
+    size_t         index;
+    pthread_t      thread;
+    bool           started;
+} A3ParallelRun;
+
+static void* a3_parallel_run(void* arg) {
+    A3ParallelRun* run = arg;
+    run->task(run->ctx, run->index);
+    return NULL;
+}
+
+void a3_shim_parallel(size_t n, A3ParallelTask task, void* ctx) {
+    assert(task);
+    if (!n)
+        return;
+
+    A3_UNWRAPNI(A3ParallelRun*, runs, calloc(n, sizeof(*runs)));
+    for (size_t i = 1; i < n; i++) {
+        runs[i].task    = task;
+        runs[i].ctx     = ctx;
+        runs[i].index   = i;
+        runs[i].started = pthread_create(&runs[i].thread, NULL, a3_parallel_run, &runs[i]) == 0;
+    }
+
+    task(ctx, 0);
+    for (size_t i = 1; i < n; i++) {
+        if (runs[i].started)
+            pthread_join(runs[i].thread, NULL);
+        else
+            task(ctx, i);
+    }
+
+    free(runs);
+}
+
+void a3_shim_yield(void) { sched_yield(); }
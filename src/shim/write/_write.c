@@ -0,0 +1,18 @@
+/*
+ * WRITE SHIM -- Cross-platform shim for write.
+ *
+ * Copyright (c) 2022, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in the project root
+ * for details.
+ */
+
+#include <io.h>
+#include <limits.h>
+
+#include <a3/shim/write.h>
+
+A3_SSIZE_T a3_shim_write(int fd, void const* buf, size_t len) {
+    // _write takes an unsigned int count. The caller handles short writes.
+    return _write(fd, buf, len > INT_MAX ? INT_MAX : (unsigned int)len);
+}
@@ -0,0 +1,122 @@
+/*
+ * SKETCH -- A count-min sketch of access frequencies.
+ *
+ * Copyright (c) 2022, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in
+ * the project root for details.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <a3/sketch.h>
+#include <a3/util.h>
+
+#define COUNTER_BITS      4
+#define COUNTERS_PER_WORD (64 / COUNTER_BITS)
+#define COUNTER_MASK      0xFULL
+
+// Every counter but the top bit of each, for halving a whole word at once.
+#define HALF_MASK 0x7777777777777777ULL
+
+// Recorded items per item of capacity, between each halving.
+#define SAMPLE_FACTOR 10
+
+struct A3Sketch {
+    size_t    counter_mask;
+    size_t    additions;
+    size_t    sample_size;
+    size_t    words;
+    uint64_t* table;
+};
+
+// Odd multipliers which spread the hash differently for each counter.
+static uint64_t const A3_SKETCH_SEEDS[A3_SKETCH_DEPTH] = {
+    0x97CB3127E3B9C3F5ULL,
+    0xC2B2AE3D27D4EB4FULL,
+    0x165667B19E3779F9ULL,
+    0x9E3779B97F4A7C15ULL,
+};
+
+A3Sketch* a3_sketch_new(size_t capacity) {
+    size_t counters = COUNTERS_PER_WORD;
+    while (counters < capacity * A3_SKETCH_COUNTERS)
+        counters *= 2;
+
+    A3Sketch* ret = NULL;
+    A3_UNWRAPN(ret, calloc(1, sizeof(A3Sketch)));
+    ret->counter_mask = counters - 1;
+    ret->sample_size  = (capacity ? capacity : 1) * SAMPLE_FACTOR;
+    ret->words        = counters / COUNTERS_PER_WORD;
+    A3_UNWRAPN(ret->table, calloc(ret->words, sizeof(uint64_t)));
+
+    return ret;
+}
+
+void a3_sketch_free(A3Sketch* sketch) {
+    assert(sketch);
+
+    free(sketch->table);
+    free(sketch);
+}
+
+static size_t a3_sketch_index(A3Sketch const* sketch, uint64_t hash, size_t i) {
+    uint64_t h = hash * A3_SKETCH_SEEDS[i];
+    return (size_t)(h >> 32 ^ h) & sketch->counter_mask;
+}
+
+static uint8_t a3_sketch_get(A3Sketch const* sketch, size_t index) {
+    return (uint8_t)((sketch->table[index / COUNTERS_PER_WORD] >>
+                      (index % COUNTERS_PER_WORD * COUNTER_BITS)) &
+                     COUNTER_MASK);
+}
+
+static void a3_sketch_age(A3Sketch* sketch) {
+    for (size_t i = 0; i < sketch->words; i++)
+        sketch->table[i] = (sketch->table[i] >> 1) & HALF_MASK;
+    sketch->additions /= 2;
+}
+
+void a3_sketch_increment(A3Sketch* sketch, uint64_t hash) {
+    assert(sketch);
+
+    size_t  indices[A3_SKETCH_DEPTH];
+    uint8_t least = A3_SKETCH_MAX;
+    for (size_t i = 0; i < A3_SKETCH_DEPTH; i++) {
+        indices[i]    = a3_sketch_index(sketch, hash, i);
+        uint8_t count = a3_sketch_get(sketch, indices[i]);
+        if (count < least)
+            least = count;
+    }
+    if (least == A3_SKETCH_MAX)
+        return;
+
+    for (size_t i = 0; i < A3_SKETCH_DEPTH; i++) {
+        // Two of the counters may be the same one, which must only be incremented once.
+        if (a3_sketch_get(sketch, indices[i]) == least)
+            sketch->table[indices[i] / COUNTERS_PER_WORD] +=
+                1ULL << (indices[i] % COUNTERS_PER_WORD * COUNTER_BITS);
+    }
+
+    if (++sketch->additions >= sketch->sample_size)
+        a3_sketch_age(sketch);
+}
+
+uint8_t a3_sketch_estimate(A3Sketch const* sketch, uint64_t hash) {
+    assert(sketch);
+
+    uint8_t ret = A3_SKETCH_MAX;
+    for (size_t i = 0; i < A3_SKETCH_DEPTH; i++) {
+        uint8_t count = a3_sketch_get(sketch, a3_sketch_index(sketch, hash, i));
+        if (count < ret)
+            ret = count;
+    }
+    return ret;
+}
+
+size_t a3_sketch_bytes(A3Sketch const* sketch) {
+    assert(sketch);
+    return sketch->words * sizeof(uint64_t);
+}
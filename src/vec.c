@@ -7,10 +7,10 @@
  * the project root for details.
  */
 
-#include <a3/shim/aligned_alloc.h>
 #include <stddef.h>
 #include <stdint.h>
 
+#include <a3/alloc.h>
 #include <a3/util.h>
 #include <a3/vec.h>
 
@@ -37,7 +37,7 @@ void a3_vec_init_(A3Vec* vec, size_t elem_size, size_t elem_align, size_t cap) {
                      .elem_align = elem_align,
                      .buf        = NULL };
     if (cap)
-        A3_UNWRAPN(vec->buf, a3_shim_aligned_alloc(cap * elem_size, elem_align));
+        A3_UNWRAPN(vec->buf, a3_large_aligned_alloc(cap * vec->elem_size, elem_align));
 }
 
 void* a3_vec_write_ptr_(A3Vec* vec) {
@@ -64,16 +64,17 @@ void a3_vec_reserve(A3Vec* vec, size_t additional) {
 
     if (!vec->buf) {
         vec->cap = additional;
-        A3_UNWRAPN(vec->buf, a3_shim_aligned_alloc(vec->cap * vec->elem_size, vec->elem_align));
+        A3_UNWRAPN(vec->buf, a3_large_aligned_alloc(vec->cap * vec->elem_size, vec->elem_align));
         return;
     }
 
+    size_t prev_cap = vec->cap;
     while (vec->cap - vec->len < additional)
         vec->cap *= 2;
 
-    A3_UNWRAPNI(void*, new_buf, a3_shim_aligned_alloc(vec->cap * vec->elem_size, vec->elem_align));
+    A3_UNWRAPNI(void*, new_buf, a3_large_aligned_alloc(vec->cap * vec->elem_size, vec->elem_align));
     memcpy(new_buf, vec->buf, vec->len * vec->elem_size);
-    a3_shim_aligned_free(vec->buf);
+    a3_large_aligned_free(vec->buf, prev_cap * vec->elem_size);
     vec->buf = new_buf;
 }
 
@@ -81,7 +82,8 @@ void a3_vec_destroy(A3Vec* vec) {
     assert(vec);
 
     if (vec->buf)
-        a3_shim_aligned_free(vec->buf);
+        a3_large_aligned_free(vec->buf, vec->cap * vec->elem_size);
+    vec->buf = NULL;
     vec->len = 0;
     vec->cap = 0;
 }
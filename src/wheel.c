@@ -0,0 +1,151 @@
+/*
+ * WHEEL -- A hierarchical timer wheel.
+ *
+ * Copyright (c) 2022, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in
+ * the project root for details.
+ */
+
+#include <assert.h>
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <a3/util.h>
+#include <a3/vec.h>
+#include <a3/wheel.h>
+
+#define SLOT_MASK ((uint64_t)A3_WHEEL_SLOTS - 1)
+
+// The ticks spanned by one slot of the given level, less one.
+#define LEVEL_MASK(LEVEL) ((1ULL << (A3_WHEEL_SLOT_BITS * (LEVEL))) - 1)
+
+struct A3TimerWheel {
+    uint64_t now;
+    size_t   count;
+    A3Vec    slots[A3_WHEEL_LEVELS][A3_WHEEL_SLOTS];
+    A3Vec    overflow;
+};
+
+static void a3_wheel_timers_init(A3Vec* timers) {
+    a3_vec_init_(timers, sizeof(A3Timer), alignof(A3Timer), 0);
+}
+
+// File a timer in the lowest level whose slot tells its deadline apart from the current tick. It
+// falls due no earlier than `earliest`.
+static void a3_wheel_place(A3TimerWheel* wheel, A3Timer timer, uint64_t earliest) {
+    assert(wheel);
+
+    uint64_t due  = timer.deadline > earliest ? timer.deadline : earliest;
+    uint64_t diff = due ^ wheel->now;
+    for (size_t level = 0; level < A3_WHEEL_LEVELS; level++) {
+        if (diff & ~LEVEL_MASK(level + 1))
+            continue;
+        size_t slot = (size_t)((due >> (A3_WHEEL_SLOT_BITS * level)) & SLOT_MASK);
+        A3_VEC_PUSH(&wheel->slots[level][slot], &timer);
+        return;
+    }
+    A3_VEC_PUSH(&wheel->overflow, &timer);
+}
+
+A3TimerWheel* a3_wheel_new(uint64_t now) {
+    A3TimerWheel* ret = NULL;
+    A3_UNWRAPN(ret, calloc(1, sizeof(A3TimerWheel)));
+
+    ret->now = now;
+    for (size_t level = 0; level < A3_WHEEL_LEVELS; level++)
+        for (size_t slot = 0; slot < A3_WHEEL_SLOTS; slot++)
+            a3_wheel_timers_init(&ret->slots[level][slot]);
+    a3_wheel_timers_init(&ret->overflow);
+
+    return ret;
+}
+
+void a3_wheel_free(A3TimerWheel* wheel) {
+    assert(wheel);
+
+    for (size_t level = 0; level < A3_WHEEL_LEVELS; level++)
+        for (size_t slot = 0; slot < A3_WHEEL_SLOTS; slot++)
+            a3_vec_destroy(&wheel->slots[level][slot]);
+    a3_vec_destroy(&wheel->overflow);
+    free(wheel);
+}
+
+void a3_wheel_schedule(A3TimerWheel* wheel, uint64_t id, uint64_t deadline) {
+    assert(wheel);
+
+    A3Timer timer = { .id = id, .deadline = deadline };
+    a3_wheel_place(wheel, timer, wheel->now + 1);
+    wheel->count++;
+}
+
+// Move the timers of a higher slot which the clock has just entered down to lower levels. None can
+// land in the slot itself.
+static void a3_wheel_cascade(A3TimerWheel* wheel, A3Vec* timers) {
+    assert(wheel);
+    assert(timers);
+
+    for (size_t i = 0; i < timers->len; i++)
+        a3_wheel_place(wheel, *A3_VEC_AT(A3Timer, timers, i), wheel->now);
+    timers->len = 0;
+}
+
+void a3_wheel_advance(A3TimerWheel* wheel, uint64_t now, A3TimerCallback callback, void* ctx) {
+    assert(wheel);
+    assert(callback);
+
+    while (wheel->now < now) {
+        if (!wheel->count) {
+            wheel->now = now;
+            return;
+        }
+
+        uint64_t tick = ++wheel->now;
+
+        // Overflowing timers may come within reach once the highest level turns. They can land back
+        // in the overflow list, so it is swapped out first.
+        if (!(tick & LEVEL_MASK(A3_WHEEL_LEVELS)) && wheel->overflow.len) {
+            A3Vec overflow = wheel->overflow;
+            a3_wheel_timers_init(&wheel->overflow);
+            a3_wheel_cascade(wheel, &overflow);
+            a3_vec_destroy(&overflow);
+        }
+
+        // Higher levels first, since their timers may land in lower slots entered on this tick.
+        for (size_t level = A3_WHEEL_LEVELS - 1; level > 0; level--) {
+            if (!(tick & LEVEL_MASK(level)))
+                a3_wheel_cascade(
+                    wheel,
+                    &wheel->slots[level][(tick >> (A3_WHEEL_SLOT_BITS * level)) & SLOT_MASK]);
+        }
+
+        // The callback may schedule timers, but never into this slot, which is due now.
+        A3Vec* due = &wheel->slots[0][tick & SLOT_MASK];
+        for (size_t i = 0; i < due->len; i++) {
+            wheel->count--;
+            callback(ctx, *A3_VEC_AT(A3Timer, due, i));
+        }
+        due->len = 0;
+    }
+}
+
+void a3_wheel_clear(A3TimerWheel* wheel) {
+    assert(wheel);
+
+    for (size_t level = 0; level < A3_WHEEL_LEVELS; level++)
+        for (size_t slot = 0; slot < A3_WHEEL_SLOTS; slot++)
+            wheel->slots[level][slot].len = 0;
+    wheel->overflow.len = 0;
+    wheel->count        = 0;
+}
+
+uint64_t a3_wheel_now(A3TimerWheel const* wheel) {
+    assert(wheel);
+    return wheel->now;
+}
+
+size_t a3_wheel_count(A3TimerWheel const* wheel) {
+    assert(wheel);
+    return wheel->count;
+}
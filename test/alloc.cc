@@ -0,0 +1,116 @@
+#include <cstddef>
+#include <cstdint>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <a3/alloc.h>
+#include <a3/util.h>
+#include <a3/util.hh>
+#include <a3/vec.h>
+
+namespace a3 {
+namespace test {
+namespace alloc {
+
+using namespace testing;
+
+class AllocTest : public Test {
+    A3_PINNED(AllocTest);
+
+protected:
+    A3AllocPolicy prev; // NOLINT(misc-non-private-member-variables-in-classes)
+
+    AllocTest() : prev { a3_alloc_policy() } {}
+    ~AllocTest() { a3_alloc_policy_set(prev); }
+};
+
+TEST_F(AllocTest, default_policy) {
+    EXPECT_EQ(prev.map_threshold, A3_ALLOC_MAP_NEVER);
+    EXPECT_FALSE(prev.huge_pages);
+    EXPECT_FALSE(prev.populate);
+
+    a3_alloc_policy_set(
+        A3AllocPolicy { .map_threshold = 4096, .huge_pages = true, .populate = false });
+    EXPECT_EQ(a3_alloc_policy().map_threshold, 4096ULL);
+    EXPECT_TRUE(a3_alloc_policy().huge_pages);
+}
+
+TEST_F(AllocTest, calloc_zeroed) {
+    for (bool populate : { false, true }) {
+        a3_alloc_policy_set(
+            A3AllocPolicy { .map_threshold = 1 << 16, .huge_pages = true, .populate = populate });
+
+        // One array on each side of the threshold.
+        for (size_t count : { 1000, 100000 }) {
+            auto* array = static_cast<uint32_t*>(a3_large_calloc(count, sizeof(uint32_t)));
+            ASSERT_TRUE(array);
+            for (size_t i = 0; i < count; i++) {
+                ASSERT_EQ(array[i], 0U);
+                array[i] = static_cast<uint32_t>(i);
+            }
+            EXPECT_EQ(array[count - 1], count - 1);
+            a3_large_free(array, count, sizeof(uint32_t));
+        }
+    }
+
+    EXPECT_FALSE(a3_large_calloc(SIZE_MAX / 2, 4));
+}
+
+TEST_F(AllocTest, aligned) {
+    a3_alloc_policy_set(
+        A3AllocPolicy { .map_threshold = 1 << 16, .huge_pages = false, .populate = false });
+
+    for (size_t size : { 256, 1 << 20 }) {
+        void* ptr = a3_large_aligned_alloc(size, 256);
+        ASSERT_TRUE(ptr);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % 256, 0U);
+        a3_large_aligned_free(ptr, size);
+    }
+}
+
+TEST_F(AllocTest, policy_change_while_live) {
+    A3AllocPolicy mapped { .map_threshold = 1 << 12, .huge_pages = false, .populate = false };
+    A3AllocPolicy heap { .map_threshold = A3_ALLOC_MAP_NEVER,
+                         .huge_pages    = false,
+                         .populate      = false };
+
+    // Each block is released as it was obtained, whatever the policy is by then.
+    for (bool map_first : { false, true }) {
+        a3_alloc_policy_set(map_first ? mapped : heap);
+        auto* array   = static_cast<uint64_t*>(a3_large_calloc(1 << 12, sizeof(uint64_t)));
+        void* aligned = a3_large_aligned_alloc(1 << 15, 64);
+        ASSERT_TRUE(array);
+        ASSERT_TRUE(aligned);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned) % 64, 0U);
+        array[(1 << 12) - 1] = 1;
+
+        a3_alloc_policy_set(map_first ? heap : mapped);
+        a3_large_free(array, 1 << 12, sizeof(uint64_t));
+        a3_large_aligned_free(aligned, 1 << 15);
+    }
+}
+
+TEST_F(AllocTest, vec_mapped) {
+    a3_alloc_policy_set(
+        A3AllocPolicy { .map_threshold = 1 << 12, .huge_pages = true, .populate = false });
+
+    // The buffer crosses the threshold while growing, so both kinds of buffer are freed.
+    A3Vec vec;
+    A3_VEC_INIT(size_t, &vec);
+    for (size_t i = 0; i < 10000; i++)
+        A3_VEC_PUSH(&vec, &i);
+    for (size_t i = 0; i < 10000; i++)
+        EXPECT_EQ(*A3_VEC_AT(size_t, &vec, i), i);
+
+    // A cleared vector can be reused.
+    A3_VEC_CLEAR(&vec);
+    size_t value = 42;
+    A3_VEC_PUSH(&vec, &value);
+    EXPECT_EQ(*A3_VEC_AT(size_t, &vec, 0), value);
+    a3_vec_destroy(&vec);
+}
+
+} // namespace alloc
+} // namespace test
+} // namespace a3
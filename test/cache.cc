@@ -13,7 +13,7 @@
 A3_CACHE_DEFINE_STRUCTS(A3CString, A3CString)
 
 A3_CACHE_DECLARE_METHODS(A3CString, A3CString)
-A3_CACHE_DEFINE_METHODS_NOHT(A3CString, A3CString)
+A3_CACHE_DEFINE_METHODS(A3CString, A3CString, a3_string_cptr, a3_string_len, a3_string_cmp)
 
 namespace a3 {
 namespace test {
@@ -36,9 +36,9 @@ protected:
 };
 
 TEST_F(CacheTest, init) {
-    EXPECT_TRUE(cache.accessed);
     EXPECT_EQ(cache.table.size, 0ULL);
-    EXPECT_EQ(cache.table.cap, CACHE_CAPACITY);
+    EXPECT_EQ(cache.capacity, CACHE_CAPACITY);
+    EXPECT_GE(cache.table.cap, CACHE_CAPACITY);
     EXPECT_TRUE(cache.table.entries);
 }
 
@@ -49,14 +49,16 @@ TEST_F(CacheTest, insert) {
     auto* found = A3_CACHE_FIND(A3CString, A3CString)(&cache, A3_CS("Key"));
     ASSERT_TRUE(found);
 
-    A3_SSIZE_T index = A3_HT_FIND_INDEX(A3CString, A3CString)(&cache.table, A3_CS("Key"));
+    A3_SSIZE_T index =
+        A3_CACHE_HT(A3_HT_FIND_INDEX, A3CString, A3CString)(&cache.table, A3_CS("Key"));
     ASSERT_GE(index, 0LL);
-    ASSERT_EQ(found, &cache.table.entries[(size_t)index].value);
+    ASSERT_EQ(found, &cache.table.entries[(size_t)index].value.value);
     EXPECT_TRUE(A3_CACHE_ACCESSED(A3CString, A3CString)(&cache, (size_t)index));
 }
 
 TEST_F(CacheTest, eviction) {
     vector<A3String> strings;
+    size_t           cap = cache.table.cap;
 
     for (size_t i = 0; i < CACHE_CAPACITY * 3; i++) {
         auto s = a3_string_itoa(i);
@@ -64,9 +66,34 @@ TEST_F(CacheTest, eviction) {
         auto sc = A3_S_CONST(s);
         A3_CACHE_INSERT(A3CString, A3CString)(&cache, sc, sc, nullptr);
         ASSERT_TRUE(A3_CACHE_FIND(A3CString, A3CString)(&cache, sc));
-        EXPECT_LE(cache.table.size, cache.table.cap);
-        EXPECT_EQ(cache.table.cap, CACHE_CAPACITY);
+        EXPECT_LE(cache.table.size, CACHE_CAPACITY);
+        EXPECT_EQ(cache.table.cap, cap);
     }
+    EXPECT_EQ(A3_CACHE_WEIGHT(A3CString, A3CString)(&cache), 0ULL);
+
+    for (auto& s : strings)
+        a3_string_free(&s);
+}
+
+TEST_F(CacheTest, keeps_hot_entries) {
+    vector<A3String> strings;
+    for (size_t i = 0; i < CACHE_CAPACITY * 8; i++)
+        strings.push_back(a3_string_itoa(i));
+
+    // A few keys are used constantly, while a stream of others is each used once. Evictions shift
+    // entries around the table, which must not lose track of which entries are hot.
+    size_t hot = CACHE_CAPACITY / 8;
+    for (size_t i = 0; i < hot; i++)
+        A3_CACHE_INSERT(A3CString, A3CString)
+        (&cache, A3_S_CONST(strings[i]), A3_S_CONST(strings[i]), nullptr);
+    for (size_t i = hot; i < strings.size(); i++) {
+        A3_CACHE_INSERT(A3CString, A3CString)
+        (&cache, A3_S_CONST(strings[i]), A3_S_CONST(strings[i]), nullptr);
+        EXPECT_TRUE(A3_CACHE_FIND(A3CString, A3CString)(&cache, A3_S_CONST(strings[i % hot])));
+    }
+
+    for (size_t i = 0; i < hot; i++)
+        EXPECT_TRUE(A3_CACHE_FIND(A3CString, A3CString)(&cache, A3_S_CONST(strings[i])));
 
     for (auto& s : strings)
         a3_string_free(&s);
@@ -101,6 +128,388 @@ TEST_F(CacheTest, eviction_callback) {
     EXPECT_EQ(cache.table.size, 0ULL);
 }
 
+TEST_F(CacheTest, clear) {
+    A3_CACHE_DESTROY(A3CString, A3CString)(&cache);
+    A3_CACHE_INIT(A3CString, A3CString)
+    (&cache, CACHE_CAPACITY, eviction_callback);
+    evicted = 0;
+
+    for (size_t i = 0; i < CACHE_CAPACITY; i++) {
+        auto s = A3_S_CONST(a3_string_itoa(i));
+        A3_CACHE_INSERT(A3CString, A3CString)(&cache, s, s, nullptr);
+    }
+
+    A3_CACHE_CLEAR(A3CString, A3CString)(&cache, nullptr);
+    EXPECT_EQ(evicted, CACHE_CAPACITY);
+    EXPECT_EQ(cache.table.size, 0ULL);
+    EXPECT_EQ(cache.capacity, CACHE_CAPACITY);
+}
+
+// Values weigh 16 units per byte, so that the callback can tell how much weight each eviction frees.
+static size_t weight_of(A3CString value) { return value.len * 16; }
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+static void weighed_eviction_callback(void* ctx, A3CString* key, A3CString* value) {
+    *static_cast<size_t*>(ctx) += weight_of(*value);
+    a3_string_free(reinterpret_cast<A3String*>(key));
+}
+
+TEST_F(CacheTest, weighted) {
+    constexpr size_t BUDGET = 4096;
+
+    A3_CACHE_DESTROY(A3CString, A3CString)(&cache);
+    A3_CACHE_INIT_WEIGHTED(A3CString, A3CString)
+    (&cache, CACHE_CAPACITY, BUDGET, weighed_eviction_callback);
+
+    size_t inserted = 0;
+    size_t freed    = 0;
+    for (size_t i = 0; i < CACHE_CAPACITY * 4; i++) {
+        auto s = A3_S_CONST(a3_string_itoa(i * i));
+        ASSERT_TRUE(A3_CACHE_INSERT_WEIGHTED(A3CString, A3CString)(&cache, s, s, weight_of(s),
+                                                                   &freed));
+        inserted += weight_of(s);
+
+        size_t weight = A3_CACHE_WEIGHT(A3CString, A3CString)(&cache);
+        EXPECT_LE(weight, BUDGET);
+        EXPECT_EQ(weight, inserted - freed);
+        EXPECT_TRUE(A3_CACHE_FIND(A3CString, A3CString)(&cache, s));
+    }
+    // The budget, not the capacity, limits the cache.
+    EXPECT_LT(cache.table.size, CACHE_CAPACITY);
+
+    // An entry heavier than the budget is refused, and evicts nothing.
+    auto   heavy  = a3_string_alloc(BUDGET);
+    size_t before = A3_CACHE_WEIGHT(A3CString, A3CString)(&cache);
+    EXPECT_FALSE(A3_CACHE_INSERT_WEIGHTED(A3CString, A3CString)(
+        &cache, A3_S_CONST(heavy), A3_S_CONST(heavy), BUDGET + 1, &freed));
+    EXPECT_EQ(A3_CACHE_WEIGHT(A3CString, A3CString)(&cache), before);
+    a3_string_free(&heavy);
+
+    // An entry of the whole budget evicts everything else.
+    auto whole = A3_S_CONST(a3_string_itoa(SIZE_MAX));
+    ASSERT_TRUE(
+        A3_CACHE_INSERT_WEIGHTED(A3CString, A3CString)(&cache, whole, whole, BUDGET, &freed));
+    inserted += weight_of(whole);
+    EXPECT_EQ(cache.table.size, 1ULL);
+    EXPECT_EQ(A3_CACHE_WEIGHT(A3CString, A3CString)(&cache), BUDGET);
+
+    A3_CACHE_CLEAR(A3CString, A3CString)(&cache, &freed);
+    EXPECT_EQ(A3_CACHE_WEIGHT(A3CString, A3CString)(&cache), 0ULL);
+    EXPECT_EQ(freed, inserted);
+}
+
+TEST_F(CacheTest, ttl_on_lookup) {
+    A3_CACHE_DESTROY(A3CString, A3CString)(&cache);
+    A3_CACHE_INIT(A3CString, A3CString)(&cache, CACHE_CAPACITY, eviction_callback);
+    evicted = 0;
+
+    auto key = A3_S_CONST(a3_string_itoa(1));
+    ASSERT_TRUE(
+        A3_CACHE_INSERT_TTL(A3CString, A3CString)(&cache, key, key, 0, 100, 10, nullptr));
+
+    EXPECT_TRUE(A3_CACHE_FIND_AT(A3CString, A3CString)(&cache, key, 109, nullptr));
+    EXPECT_EQ(evicted, 0ULL);
+    // The key is freed by the callback when it expires.
+    EXPECT_FALSE(
+        A3_CACHE_FIND_AT(A3CString, A3CString)(&cache, A3_CS("1"), 110, nullptr));
+    EXPECT_EQ(evicted, 1ULL);
+    EXPECT_EQ(cache.table.size, 0ULL);
+
+    // The timer for the entry finds nothing to expire.
+    A3_CACHE_ADVANCE(A3CString, A3CString)(&cache, 200, nullptr);
+    EXPECT_EQ(evicted, 1ULL);
+}
+
+TEST_F(CacheTest, ttl_on_advance) {
+    A3_CACHE_DESTROY(A3CString, A3CString)(&cache);
+    A3_CACHE_INIT_WEIGHTED(A3CString, A3CString)
+    (&cache, CACHE_CAPACITY, SIZE_MAX, eviction_callback);
+    evicted = 0;
+
+    // Entries live for 1 to 1000 ticks, except every tenth, which never expires.
+    constexpr uint64_t NOW = 5000;
+    constexpr size_t   N   = CACHE_CAPACITY / 2;
+    for (size_t i = 0; i < N; i++) {
+        auto s = A3_S_CONST(a3_string_itoa(i));
+        if (i % 10 == 0)
+            ASSERT_TRUE(A3_CACHE_INSERT_WEIGHTED(A3CString, A3CString)(&cache, s, s, 1, nullptr));
+        else
+            ASSERT_TRUE(A3_CACHE_INSERT_TTL(A3CString, A3CString)(&cache, s, s, 1, NOW,
+                                                                  i * 7 % 1000 + 1, nullptr));
+    }
+
+    for (uint64_t now = NOW; now <= NOW + 1000; now += 50) {
+        A3_CACHE_ADVANCE(A3CString, A3CString)(&cache, now, nullptr);
+
+        size_t live = 0;
+        for (size_t i = 0; i < N; i++) {
+            bool expected = i % 10 == 0 || NOW + i * 7 % 1000 + 1 > now;
+            live += expected;
+            auto s = a3_string_itoa(i);
+            EXPECT_EQ(A3_CACHE_FIND(A3CString, A3CString)(&cache, A3_S_CONST(s)) != nullptr,
+                      expected);
+            a3_string_free(&s);
+        }
+        EXPECT_EQ(cache.table.size, live);
+        EXPECT_EQ(A3_CACHE_WEIGHT(A3CString, A3CString)(&cache), live);
+        EXPECT_EQ(evicted, N - live);
+    }
+
+    A3_CACHE_CLEAR(A3CString, A3CString)(&cache, nullptr);
+}
+
+TEST_F(CacheTest, ttl_after_eviction) {
+    A3_CACHE_DESTROY(A3CString, A3CString)(&cache);
+    A3_CACHE_INIT(A3CString, A3CString)(&cache, CACHE_CAPACITY, eviction_callback);
+    evicted = 0;
+
+    // Most entries are evicted, and their keys freed, before their timers fire.
+    for (size_t i = 0; i < CACHE_CAPACITY * 4; i++) {
+        auto s = A3_S_CONST(a3_string_itoa(i));
+        ASSERT_TRUE(
+            A3_CACHE_INSERT_TTL(A3CString, A3CString)(&cache, s, s, 0, i, 100, nullptr));
+    }
+    EXPECT_EQ(evicted, CACHE_CAPACITY * 3);
+
+    A3_CACHE_ADVANCE(A3CString, A3CString)(&cache, CACHE_CAPACITY * 4 + 100, nullptr);
+    EXPECT_EQ(evicted, CACHE_CAPACITY * 4);
+    EXPECT_EQ(cache.table.size, 0ULL);
+}
+
+TEST_F(CacheTest, reinsert_replaces) {
+    for (bool admission : { false, true }) {
+        A3_CACHE_DESTROY(A3CString, A3CString)(&cache);
+        A3_CACHE_INIT_WEIGHTED(A3CString, A3CString)
+        (&cache, CACHE_CAPACITY, SIZE_MAX, weighed_eviction_callback);
+        if (admission)
+            A3_CACHE_ENABLE_ADMISSION(A3CString, A3CString)(&cache);
+
+        size_t inserted = 0;
+        size_t freed    = 0;
+        for (size_t i = 0; i < CACHE_CAPACITY; i++) {
+            auto s = A3_S_CONST(a3_string_itoa(i));
+            ASSERT_TRUE(A3_CACHE_INSERT_WEIGHTED(A3CString, A3CString)(&cache, s, s, weight_of(s),
+                                                                       &freed));
+            inserted += weight_of(s);
+        }
+        ASSERT_EQ(freed, 0ULL);
+
+        // Only the old entry is evicted from the full cache, whether the new one is lighter or
+        // heavier.
+        size_t old_weight = weight_of(A3_CS("7"));
+        for (A3CString value : { A3_CS("lighter"), A3_CS("a good deal heavier"), A3_CS("") }) {
+            auto key = A3_S_CONST(a3_string_itoa(7));
+            ASSERT_TRUE(A3_CACHE_INSERT_WEIGHTED(A3CString, A3CString)(&cache, key, value,
+                                                                       weight_of(value), &freed));
+            inserted += weight_of(value);
+            EXPECT_EQ(freed, old_weight);
+            freed      = 0;
+            inserted  -= old_weight;
+            old_weight = weight_of(value);
+
+            EXPECT_EQ(cache.table.size, CACHE_CAPACITY);
+            EXPECT_EQ(A3_CACHE_WEIGHT(A3CString, A3CString)(&cache), inserted);
+            EXPECT_LE(cache.window_size, cache.table.size);
+            auto* found = A3_CACHE_FIND(A3CString, A3CString)(&cache, A3_CS("7"));
+            ASSERT_TRUE(found);
+            EXPECT_EQ(a3_string_cmp(*found, value), 0);
+        }
+
+        A3_CACHE_CLEAR(A3CString, A3CString)(&cache, &freed);
+        EXPECT_EQ(freed, inserted);
+    }
+}
+
+TEST_F(CacheTest, reinsert_keeps_accesses) {
+    for (bool admission : { false, true }) {
+        A3_CACHE_DESTROY(A3CString, A3CString)(&cache);
+        A3_CACHE_INIT(A3CString, A3CString)(&cache, CACHE_CAPACITY, nullptr);
+        if (admission)
+            A3_CACHE_ENABLE_ADMISSION(A3CString, A3CString)(&cache);
+
+        A3_CACHE_INSERT(A3CString, A3CString)(&cache, A3_CS("Key"), A3_CS("Value"), nullptr);
+        ASSERT_TRUE(A3_CACHE_FIND(A3CString, A3CString)(&cache, A3_CS("Key")));
+        A3_SSIZE_T index =
+            A3_CACHE_HT(A3_HT_FIND_INDEX, A3CString, A3CString)(&cache.table, A3_CS("Key"));
+        ASSERT_GE(index, 0LL);
+        uint8_t  freq     = cache.table.entries[(size_t)index].value.freq;
+        uint64_t hash     = cache.table.entries[(size_t)index].hash;
+        uint8_t  estimate = admission ? a3_sketch_estimate(cache.sketch, hash) : 0;
+
+        // Replacing the value neither records an access nor bumps the key's estimated frequency.
+        for (size_t i = 0; i < 3; i++) {
+            A3_CACHE_INSERT(A3CString, A3CString)(&cache, A3_CS("Key"), A3_CS("Other"), nullptr);
+            EXPECT_EQ(cache.table.entries[(size_t)index].value.freq, freq);
+            if (admission) {
+                EXPECT_EQ(a3_sketch_estimate(cache.sketch, hash), estimate);
+            }
+        }
+    }
+}
+
+TEST_F(CacheTest, reinsert_refreshes_ttl) {
+    A3_CACHE_DESTROY(A3CString, A3CString)(&cache);
+    A3_CACHE_INIT(A3CString, A3CString)(&cache, CACHE_CAPACITY, eviction_callback);
+    evicted = 0;
+
+    auto key = A3_S_CONST(a3_string_itoa(1));
+    ASSERT_TRUE(
+        A3_CACHE_INSERT_TTL(A3CString, A3CString)(&cache, key, key, 0, 100, 10, nullptr));
+    key = A3_S_CONST(a3_string_itoa(1));
+    ASSERT_TRUE(
+        A3_CACHE_INSERT_TTL(A3CString, A3CString)(&cache, key, key, 0, 105, 10, nullptr));
+    EXPECT_EQ(evicted, 1ULL);
+    EXPECT_EQ(cache.table.size, 1ULL);
+
+    // The first timer fires, but the entry now lives until 115.
+    A3_CACHE_ADVANCE(A3CString, A3CString)(&cache, 112, nullptr);
+    EXPECT_TRUE(A3_CACHE_FIND_AT(A3CString, A3CString)(&cache, A3_CS("1"), 114, nullptr));
+    A3_CACHE_ADVANCE(A3CString, A3CString)(&cache, 115, nullptr);
+    EXPECT_FALSE(A3_CACHE_FIND(A3CString, A3CString)(&cache, A3_CS("1")));
+    EXPECT_EQ(evicted, 2ULL);
+
+    // Re-inserting without a TTL makes the entry permanent.
+    key = A3_S_CONST(a3_string_itoa(2));
+    ASSERT_TRUE(
+        A3_CACHE_INSERT_TTL(A3CString, A3CString)(&cache, key, key, 0, 200, 10, nullptr));
+    key = A3_S_CONST(a3_string_itoa(2));
+    A3_CACHE_INSERT(A3CString, A3CString)(&cache, key, key, nullptr);
+    A3_CACHE_ADVANCE(A3CString, A3CString)(&cache, 300, nullptr);
+    EXPECT_TRUE(A3_CACHE_FIND_AT(A3CString, A3CString)(&cache, A3_CS("2"), 300, nullptr));
+    EXPECT_EQ(evicted, 3ULL);
+
+    A3_CACHE_CLEAR(A3CString, A3CString)(&cache, nullptr);
+}
+
+// Warm up a set of hot keys, then scan through many more keys which are each used once, and count
+// how many of the hot keys are still cached.
+static size_t hot_after_scan(A3_CACHE(A3CString, A3CString) * cache) {
+    constexpr size_t HOT  = CACHE_CAPACITY * 3 / 4;
+    constexpr size_t SCAN = CACHE_CAPACITY * 4;
+
+    vector<A3String> strings;
+    for (size_t i = 0; i < HOT + SCAN; i++)
+        strings.push_back(a3_string_itoa(i));
+
+    for (size_t i = 0; i < HOT; i++)
+        A3_CACHE_INSERT(A3CString, A3CString)
+        (cache, A3_S_CONST(strings[i]), A3_S_CONST(strings[i]), nullptr);
+    for (size_t pass = 0; pass < 3; pass++) {
+        for (size_t i = 0; i < HOT; i++)
+            A3_CACHE_FIND(A3CString, A3CString)(cache, A3_S_CONST(strings[i]));
+    }
+
+    for (size_t i = HOT; i < HOT + SCAN; i++) {
+        A3_CACHE_INSERT(A3CString, A3CString)
+        (cache, A3_S_CONST(strings[i]), A3_S_CONST(strings[i]), &evicted);
+        EXPECT_LE(cache->table.size, CACHE_CAPACITY);
+    }
+
+    size_t hot = 0;
+    for (size_t i = 0; i < HOT; i++)
+        hot += A3_CACHE_FIND(A3CString, A3CString)(cache, A3_S_CONST(strings[i])) != nullptr;
+
+    A3_CACHE_CLEAR(A3CString, A3CString)(cache, nullptr);
+    for (auto& s : strings)
+        a3_string_free(&s);
+    return hot;
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+static void counting_eviction_callback(void* ctx, A3CString* key, A3CString* value) {
+    (void)key;
+    (void)value;
+    if (ctx)
+        (*static_cast<size_t*>(ctx))++;
+}
+
+TEST_F(CacheTest, admission_resists_scan) {
+    constexpr size_t HOT = CACHE_CAPACITY * 3 / 4;
+
+    A3_CACHE_DESTROY(A3CString, A3CString)(&cache);
+    A3_CACHE_INIT(A3CString, A3CString)(&cache, CACHE_CAPACITY, counting_eviction_callback);
+    evicted = 0;
+    EXPECT_LT(hot_after_scan(&cache), HOT / 4);
+
+    A3_CACHE_DESTROY(A3CString, A3CString)(&cache);
+    A3_CACHE_INIT(A3CString, A3CString)(&cache, CACHE_CAPACITY, counting_eviction_callback);
+    A3_CACHE_ENABLE_ADMISSION(A3CString, A3CString)(&cache);
+    evicted = 0;
+    EXPECT_GT(hot_after_scan(&cache), HOT * 3 / 4);
+    // Refused entries are passed to the callback, like evicted ones.
+    EXPECT_EQ(evicted, CACHE_CAPACITY * 4 - (CACHE_CAPACITY - HOT));
+}
+
+TEST_F(CacheTest, admission_admits_repeated) {
+    A3_CACHE_ENABLE_ADMISSION(A3CString, A3CString)(&cache);
+
+    vector<A3String> strings;
+    for (size_t i = 0; i < CACHE_CAPACITY * 3; i++)
+        strings.push_back(a3_string_itoa(i));
+    for (size_t i = 0; i < CACHE_CAPACITY; i++)
+        A3_CACHE_INSERT(A3CString, A3CString)
+        (&cache, A3_S_CONST(strings[i]), A3_S_CONST(strings[i]), nullptr);
+
+    // A new set of keys, each missed twice, displaces the old one, which is not used again.
+    for (size_t round = 0; round < 2; round++) {
+        for (size_t i = CACHE_CAPACITY; i < CACHE_CAPACITY * 2; i++) {
+            auto s = A3_S_CONST(strings[i]);
+            if (!A3_CACHE_FIND(A3CString, A3CString)(&cache, s))
+                A3_CACHE_INSERT(A3CString, A3CString)(&cache, s, s, nullptr);
+        }
+    }
+
+    size_t found = 0;
+    for (size_t i = CACHE_CAPACITY; i < CACHE_CAPACITY * 2; i++)
+        found += A3_CACHE_FIND(A3CString, A3CString)(&cache, A3_S_CONST(strings[i])) != nullptr;
+    EXPECT_GT(found, CACHE_CAPACITY / 2);
+
+    A3_CACHE_CLEAR(A3CString, A3CString)(&cache, nullptr);
+    for (auto& s : strings)
+        a3_string_free(&s);
+}
+
+TEST_F(CacheTest, admission_with_ttl) {
+    A3_CACHE_DESTROY(A3CString, A3CString)(&cache);
+    A3_CACHE_INIT_WEIGHTED(A3CString, A3CString)
+    (&cache, CACHE_CAPACITY, CACHE_CAPACITY * 8, eviction_callback);
+    A3_CACHE_ENABLE_ADMISSION(A3CString, A3CString)(&cache);
+    evicted = 0;
+
+    // Entries of varied weight and lifetime, some of which expire while still in the window.
+    constexpr size_t N        = CACHE_CAPACITY * 8;
+    size_t           inserted = 0;
+    for (size_t i = 0; i < N; i++) {
+        auto s = A3_S_CONST(a3_string_itoa(i % (CACHE_CAPACITY * 2)));
+        if (A3_CACHE_FIND_AT(A3CString, A3CString)(&cache, s, i, nullptr)) {
+            a3_string_free(reinterpret_cast<A3String*>(&s));
+            continue;
+        }
+        ASSERT_TRUE(A3_CACHE_INSERT_TTL(A3CString, A3CString)(&cache, s, s, i % 7 * 4, i,
+                                                              i % 3 ? 1000 : 3, nullptr));
+        inserted++;
+        A3_CACHE_ADVANCE(A3CString, A3CString)(&cache, i, nullptr);
+        EXPECT_LE(cache.table.size, CACHE_CAPACITY);
+        EXPECT_LE(A3_CACHE_WEIGHT(A3CString, A3CString)(&cache), CACHE_CAPACITY * 8);
+        EXPECT_LE(cache.window_size, cache.window_capacity);
+    }
+
+    A3_CACHE_CLEAR(A3CString, A3CString)(&cache, nullptr);
+    EXPECT_EQ(evicted, inserted);
+    EXPECT_EQ(cache.window_size, 0ULL);
+}
+
+TEST_F(CacheTest, admission_capacity_one) {
+    A3_CACHE_DESTROY(A3CString, A3CString)(&cache);
+    A3_CACHE_INIT(A3CString, A3CString)(&cache, 1, nullptr);
+    A3_CACHE_ENABLE_ADMISSION(A3CString, A3CString)(&cache);
+
+    A3_CACHE_INSERT(A3CString, A3CString)(&cache, A3_CS("a"), A3_CS("a"), nullptr);
+    A3_CACHE_INSERT(A3CString, A3CString)(&cache, A3_CS("b"), A3_CS("b"), nullptr);
+    EXPECT_EQ(cache.table.size, 1ULL);
+    EXPECT_TRUE(A3_CACHE_FIND(A3CString, A3CString)(&cache, A3_CS("b")));
+}
+
 } // namespace cache
 } // namespace test
 } // namespace a3
@@ -0,0 +1,178 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <a3/ccache.h>
+#include <a3/ht.h>
+#include <a3/types.h>
+
+static int8_t u64_cmp(uint64_t lhs, uint64_t rhs) { return lhs < rhs ? -1 : lhs > rhs; }
+
+A3_CCACHE_DEFINE_STRUCTS(uint64_t, uint64_t)
+
+A3_CCACHE_DECLARE_METHODS(uint64_t, uint64_t)
+A3_CCACHE_DEFINE_METHODS_HASHER(uint64_t, uint64_t, A3_HT_HASH_INT, u64_cmp)
+
+namespace a3 {
+namespace test {
+namespace ccache {
+
+using std::atomic;
+using std::thread;
+using std::vector;
+
+// Readers check that they never observe a value which does not belong to its key.
+static uint64_t value_of(uint64_t key) { return key * 3 + 1; }
+
+constexpr size_t CAPACITY = 1024;
+
+// Counts evictions, and checks that each evicted entry is intact.
+struct Evictions {
+    atomic<size_t> count { 0 };
+    atomic<size_t> errors { 0 };
+};
+
+static void on_evict(void* ctx, uint64_t* key, uint64_t* value) {
+    auto* evictions = static_cast<Evictions*>(ctx);
+    evictions->count++;
+    if (*value != value_of(*key))
+        evictions->errors++;
+}
+
+class CCacheTest : public ::testing::Test {
+protected:
+    A3_CCACHE(uint64_t, uint64_t) cache {}; // NOLINT(misc-non-private-member-variables-in-classes)
+    Evictions evictions;                    // NOLINT(misc-non-private-member-variables-in-classes)
+
+    void SetUp() override { A3_CCACHE_INIT(uint64_t, uint64_t)(&cache, CAPACITY, on_evict); }
+    void TearDown() override { A3_CCACHE_DESTROY(uint64_t, uint64_t)(&cache); }
+
+    bool insert(uint64_t key) {
+        return A3_CCACHE_INSERT(uint64_t, uint64_t)(&cache, key, value_of(key), &evictions);
+    }
+    bool find(uint64_t key, uint64_t* out = nullptr) {
+        return A3_CCACHE_FIND(uint64_t, uint64_t)(&cache, key, out);
+    }
+    size_t size() { return A3_CCACHE_SIZE(uint64_t, uint64_t)(&cache); }
+};
+
+TEST_F(CCacheTest, insert_find) {
+    uint64_t value = 0;
+
+    EXPECT_FALSE(find(1, &value));
+    EXPECT_TRUE(insert(1));
+    EXPECT_FALSE(insert(1));
+    EXPECT_EQ(size(), 1ULL);
+
+    EXPECT_TRUE(find(1, &value));
+    EXPECT_EQ(value, value_of(1));
+    EXPECT_TRUE(find(1));
+    EXPECT_EQ(evictions.count.load(), 0ULL);
+}
+
+TEST_F(CCacheTest, eviction) {
+    constexpr uint64_t COUNT = CAPACITY * 8;
+
+    for (uint64_t i = 0; i < COUNT; i++)
+        ASSERT_TRUE(insert(i));
+
+    size_t shard_capacity = (CAPACITY + A3_CCACHE_SHARDS - 1) / A3_CCACHE_SHARDS;
+    EXPECT_LE(size(), shard_capacity * A3_CCACHE_SHARDS);
+    EXPECT_GT(size(), CAPACITY / 2);
+    EXPECT_EQ(evictions.count.load(), COUNT - size());
+    EXPECT_EQ(evictions.errors.load(), 0ULL);
+
+    size_t found = 0;
+    for (uint64_t i = 0; i < COUNT; i++)
+        found += find(i);
+    EXPECT_EQ(found, size());
+}
+
+TEST_F(CCacheTest, clear) {
+    for (uint64_t i = 0; i < CAPACITY / 2; i++)
+        ASSERT_TRUE(insert(i));
+    size_t before = size();
+
+    A3_CCACHE_CLEAR(uint64_t, uint64_t)(&cache, &evictions);
+    EXPECT_EQ(size(), 0ULL);
+    EXPECT_EQ(evictions.count.load(), before);
+    EXPECT_FALSE(find(0));
+    EXPECT_TRUE(insert(0));
+}
+
+TEST_F(CCacheTest, keeps_hot_entries) {
+    constexpr uint64_t HOT  = 64;
+    constexpr uint64_t COLD = CAPACITY * 8;
+
+    for (uint64_t i = 0; i < HOT; i++)
+        ASSERT_TRUE(insert(i));
+
+    // Each cold key is seen once, and each hot key between consecutive cold ones.
+    for (uint64_t i = 0; i < COLD; i++) {
+        for (uint64_t h = 0; h < HOT; h += 16)
+            find((h + i) % HOT);
+        insert(HOT + i);
+    }
+
+    size_t hot = 0;
+    for (uint64_t i = 0; i < HOT; i++)
+        hot += find(i);
+    EXPECT_EQ(hot, HOT);
+}
+
+TEST_F(CCacheTest, concurrent_stress) {
+    constexpr size_t   WRITERS    = 4;
+    constexpr size_t   READERS    = 4;
+    constexpr uint64_t PER_WRITER = CAPACITY * 16;
+
+    atomic<bool>   done { false };
+    atomic<size_t> inserted { 0 };
+    atomic<size_t> errors { 0 };
+
+    vector<thread> writers;
+    for (size_t w = 0; w < WRITERS; w++) {
+        writers.emplace_back([&, w] {
+            // Writers overlap, so some of their inserts find the key already present.
+            for (uint64_t i = 0; i < PER_WRITER; i++)
+                inserted += insert((i * 7 + w * PER_WRITER / 2) % (PER_WRITER * 2));
+        });
+    }
+
+    atomic<size_t> hits { 0 };
+    vector<thread> readers;
+    for (size_t r = 0; r < READERS; r++) {
+        readers.emplace_back([&, r] {
+            uint64_t key   = r;
+            size_t   count = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                key            = key * 6364136223846793005ULL + 1442695040888963407ULL;
+                uint64_t k     = (key >> 20) % (PER_WRITER * 2);
+                uint64_t value = 0;
+                if (find(k, &value)) {
+                    count++;
+                    if (value != value_of(k))
+                        errors++;
+                }
+            }
+            hits += count;
+        });
+    }
+
+    for (auto& t : writers)
+        t.join();
+    done = true;
+    for (auto& t : readers)
+        t.join();
+
+    EXPECT_EQ(errors.load(), 0ULL);
+    EXPECT_EQ(evictions.errors.load(), 0ULL);
+    EXPECT_EQ(inserted.load() - evictions.count.load(), size());
+}
+
+} // namespace ccache
+} // namespace test
+} // namespace a3
@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <a3/cht.h>
+#include <a3/types.h>
+
+#define U64_BYTES(K) (reinterpret_cast<uint8_t const*>(&(K)))
+#define U64_SIZE(K)  sizeof(K)
+
+static int8_t u64_cmp(uint64_t lhs, uint64_t rhs) { return lhs < rhs ? -1 : lhs > rhs; }
+
+A3_CHT_DEFINE_STRUCTS(uint64_t, uint64_t)
+
+A3_CHT_DECLARE_METHODS(uint64_t, uint64_t)
+A3_CHT_DEFINE_METHODS(uint64_t, uint64_t, U64_BYTES, U64_SIZE, u64_cmp)
+
+namespace a3 {
+namespace test {
+namespace cht {
+
+using std::atomic;
+using std::thread;
+using std::vector;
+
+using Clock = std::chrono::steady_clock;
+
+// Readers check that they never observe a value which does not belong to its key.
+static uint64_t value_of(uint64_t key) { return key * 3 + 1; }
+
+class CHTTest : public ::testing::Test {
+protected:
+    A3_CHT(uint64_t, uint64_t) table {}; // NOLINT(misc-non-private-member-variables-in-classes)
+
+    void SetUp() override { A3_CHT_INIT(uint64_t, uint64_t)(&table, A3_HT_NO_HASH_KEY); }
+    void TearDown() override { A3_CHT_DESTROY(uint64_t, uint64_t)(&table); }
+
+    bool insert(uint64_t key) {
+        return A3_CHT_INSERT(uint64_t, uint64_t)(&table, key, value_of(key));
+    }
+    bool find(uint64_t key, uint64_t* out = nullptr) {
+        return A3_CHT_FIND(uint64_t, uint64_t)(&table, key, out);
+    }
+    bool remove(uint64_t key) { return A3_CHT_DELETE(uint64_t, uint64_t)(&table, key); }
+    size_t size() { return A3_CHT_SIZE(uint64_t, uint64_t)(&table); }
+};
+
+TEST_F(CHTTest, insert_find_delete) {
+    uint64_t value = 0;
+
+    EXPECT_FALSE(find(1, &value));
+    EXPECT_TRUE(insert(1));
+    EXPECT_FALSE(insert(1));
+    EXPECT_EQ(size(), 1ULL);
+
+    EXPECT_TRUE(find(1, &value));
+    EXPECT_EQ(value, value_of(1));
+    EXPECT_TRUE(find(1));
+
+    EXPECT_TRUE(remove(1));
+    EXPECT_FALSE(remove(1));
+    EXPECT_FALSE(find(1));
+    EXPECT_EQ(size(), 0ULL);
+}
+
+TEST_F(CHTTest, grow) {
+    constexpr uint64_t COUNT = 100000;
+
+    for (uint64_t i = 0; i < COUNT; i++)
+        ASSERT_TRUE(insert(i));
+    EXPECT_EQ(size(), COUNT);
+
+    A3_CHT_RECLAIM(uint64_t, uint64_t)(&table);
+    for (uint64_t i = 0; i < COUNT; i++) {
+        uint64_t value = 0;
+        ASSERT_TRUE(find(i, &value));
+        EXPECT_EQ(value, value_of(i));
+    }
+
+    for (uint64_t i = 0; i < COUNT; i += 2)
+        ASSERT_TRUE(remove(i));
+    EXPECT_EQ(size(), COUNT / 2);
+    for (uint64_t i = 0; i < COUNT; i++)
+        EXPECT_EQ(find(i), i % 2 == 1);
+}
+
+TEST(CHTLayoutTest, shards_on_separate_lines) {
+    A3_CHT(uint64_t, uint64_t)* table = A3_CHT_NEW(uint64_t, uint64_t)(A3_HT_NO_HASH_KEY);
+
+    EXPECT_EQ(sizeof(table->shards[0]), 64ULL);
+    for (size_t i = 0; i < A3_CHT_SHARDS; i++)
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(&table->shards[i]) % 64, 0ULL);
+    EXPECT_GE(reinterpret_cast<uintptr_t>(&table->shards[0]),
+              reinterpret_cast<uintptr_t>(&table->hash_key[A3_HT_HASH_KEY_SIZE - 1]) + 8);
+
+    A3_CHT_FREE(uint64_t, uint64_t)(table);
+}
+
+TEST_F(CHTTest, concurrent_stress) {
+    constexpr uint64_t WRITERS    = 4;
+    constexpr uint64_t READERS    = 4;
+    constexpr uint64_t PERMANENT  = 10000;
+    constexpr uint64_t PER_WRITER = 5000;
+    constexpr size_t   ROUNDS     = 3;
+
+    // These keys stay in the table throughout, so readers must always find them, even while
+    // writers force their shards to grow.
+    for (uint64_t i = 0; i < PERMANENT; i++)
+        ASSERT_TRUE(insert(i));
+
+    atomic<bool>   done { false };
+    atomic<size_t> errors { 0 };
+
+    vector<thread> threads;
+    for (uint64_t w = 0; w < WRITERS; w++) {
+        threads.emplace_back([&, w] {
+            uint64_t base = PERMANENT + w * PER_WRITER;
+            for (size_t round = 0; round < ROUNDS; round++) {
+                for (uint64_t i = base; i < base + PER_WRITER; i++)
+                    if (!insert(i))
+                        errors++;
+                for (uint64_t i = base; i < base + PER_WRITER; i++)
+                    if (!remove(i))
+                        errors++;
+            }
+        });
+    }
+
+    atomic<size_t> reads { 0 };
+    vector<thread> readers;
+    for (uint64_t r = 0; r < READERS; r++) {
+        readers.emplace_back([&, r] {
+            uint64_t key   = r;
+            size_t   count = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                key = (key * 6364136223846793005ULL + 1442695040888963407ULL);
+                uint64_t k     = key % (PERMANENT + WRITERS * PER_WRITER);
+                uint64_t value = 0;
+                bool     found = find(k, &value);
+                if ((k < PERMANENT && !found) || (found && value != value_of(k)))
+                    errors++;
+                count++;
+            }
+            reads += count;
+        });
+    }
+
+    for (auto& t : threads)
+        t.join();
+    done = true;
+    for (auto& t : readers)
+        t.join();
+
+    EXPECT_EQ(errors.load(), 0ULL);
+    EXPECT_GT(reads.load(), 0ULL);
+    EXPECT_EQ(size(), PERMANENT);
+    for (uint64_t i = 0; i < PERMANENT + WRITERS * PER_WRITER; i++)
+        EXPECT_EQ(find(i), i < PERMANENT);
+}
+
+TEST_F(CHTTest, throughput) {
+    constexpr uint64_t KEYS    = 1ULL << 16;
+    constexpr size_t   OPS     = 200000;
+    const size_t       threads = std::max(2U, std::thread::hardware_concurrency());
+
+    for (uint64_t i = 0; i < KEYS; i += 2)
+        ASSERT_TRUE(insert(i));
+
+    // Mostly reads, with one write in sixteen operations.
+    vector<thread> workers;
+    auto           start = Clock::now();
+    for (size_t t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            uint64_t key = t;
+            for (size_t i = 0; i < OPS; i++) {
+                key        = key * 6364136223846793005ULL + 1442695040888963407ULL;
+                uint64_t k = (key >> 20) % KEYS;
+                if (i % 16 == 0) {
+                    if (!insert(k))
+                        remove(k);
+                } else {
+                    find(k);
+                }
+            }
+        });
+    }
+    for (auto& w : workers)
+        w.join();
+    auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    double rate = static_cast<double>(threads * OPS) / elapsed;
+    std::printf("%zu threads: %.2f Mops/s\n", threads, rate / 1e6);
+    RecordProperty("ops_per_second", static_cast<int>(rate));
+    EXPECT_LE(size(), KEYS);
+}
+
+} // namespace cht
+} // namespace test
+} // namespace a3
@@ -0,0 +1,137 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <a3/ht.h>
+
+#include "hash/highwayhash.h"
+
+namespace a3 {
+namespace test {
+namespace highwayhash {
+
+// From highwayhash/highwayhash_test.cc. Every implementation must reproduce them exactly, or tables
+// keyed with the same hash key would disagree across machines.
+static constexpr uint64_t KEY[4] = { 0x0706050403020100ULL, 0x0F0E0D0C0B0A0908ULL,
+                                     0x1716151413121110ULL, 0x1F1E1D1C1B1A1918ULL };
+
+static constexpr uint64_t EXPECTED[65] = {
+    0x907A56DE22C26E53ULL, 0x7EAB43AAC7CDDD78ULL, 0xB8D0569AB0B53D62ULL,
+    0x5C6BEFAB8A463D80ULL, 0xF205A46893007EDAULL, 0x2B8A1668E4A94541ULL,
+    0xBD4CCC325BEFCA6FULL, 0x4D02AE1738F59482ULL, 0xE1205108E55F3171ULL,
+    0x32D2644EC77A1584ULL, 0xF6E10ACDB103A90BULL, 0xC3BBF4615B415C15ULL,
+    0x243CC2040063FA9CULL, 0xA89A58CE65E641FFULL, 0x24B031A348455A23ULL,
+    0x40793F86A449F33BULL, 0xCFAB3489F97EB832ULL, 0x19FE67D2C8C5C0E2ULL,
+    0x04DD90A69C565CC2ULL, 0x75D9518E2371C504ULL, 0x38AD9B1141D3DD16ULL,
+    0x0264432CCD8A70E0ULL, 0xA9DB5A6288683390ULL, 0xD7B05492003F028CULL,
+    0x205F615AEA59E51EULL, 0xEEE0C89621052884ULL, 0x1BFC1A93A7284F4FULL,
+    0x512175B5B70DA91DULL, 0xF71F8976A0A2C639ULL, 0xAE093FEF1F84E3E7ULL,
+    0x22CA92B01161860FULL, 0x9FC7007CCF035A68ULL, 0xA0C964D9ECD580FCULL,
+    0x2C90F73CA03181FCULL, 0x185CF84E5691EB9EULL, 0x4FC1F5EF2752AA9BULL,
+    0xF5B7391A5E0A33EBULL, 0xB9B84B83B4E96C9CULL, 0x5E42FE712A5CD9B4ULL,
+    0xA150F2F90C3F97DCULL, 0x7FA522D75E2D637DULL, 0x181AD0CC0DFFD32BULL,
+    0x3889ED981E854028ULL, 0xFB4297E8C586EE2DULL, 0x6D064A45BB28059CULL,
+    0x90563609B3EC860CULL, 0x7AA4FCE94097C666ULL, 0x1326BAC06B911E08ULL,
+    0xB926168D2B154F34ULL, 0x9919848945B1948DULL, 0xA2A98FC534825EBEULL,
+    0xE9809095213EF0B6ULL, 0x582E5483707BC0E9ULL, 0x086E9414A88A6AF5ULL,
+    0xEE86B98D20F6743DULL, 0xF89B7FF609B1C0A7ULL, 0x4C7D9CC19E22C3E8ULL,
+    0x9A97005024562A6FULL, 0x5DD41CF423E6EBEFULL, 0xDF13609C0468E227ULL,
+    0x6E0DA4F64188155AULL, 0xB755BA4B50D7D4A1ULL, 0x887A3484647479BDULL,
+    0xAB8EEBE9BF2139A0ULL, 0x75542C5D4CD2A6FFULL,
+};
+
+TEST(HighwayHashTest, reference_vectors) {
+    uint8_t data[65];
+    for (size_t i = 0; i < sizeof(data); i++)
+        data[i] = static_cast<uint8_t>(i);
+
+    for (size_t size = 0; size < sizeof(data); size++)
+        EXPECT_EQ(HighwayHash64(data, size, KEY), EXPECTED[size]) << "Size " << size << ".";
+}
+
+TEST(HighwayHashTest, unaligned) {
+    uint8_t data[300];
+    uint8_t shifted[sizeof(data) + 7];
+    for (size_t i = 0; i < sizeof(data); i++)
+        data[i] = static_cast<uint8_t>(i * 7 + 3);
+
+    for (size_t offset = 1; offset < 8; offset++) {
+        memcpy(&shifted[offset], data, sizeof(data));
+        for (size_t size = 0; size <= sizeof(data); size += 13)
+            EXPECT_EQ(HighwayHash64(&shifted[offset], size, KEY), HighwayHash64(data, size, KEY));
+    }
+}
+
+struct Impl {
+    char const* name;
+    A3HhImpl    hash;
+};
+
+// The implementations built into the library which this CPU can run.
+static std::vector<Impl> supported_impls() {
+    std::vector<Impl> all = {
+        { "portable", a3_hh_portable },
+#ifdef A3_HH_SSE41
+        { "sse41", a3_hh_sse41 },
+#endif
+#ifdef A3_HH_AVX2
+        { "avx2", a3_hh_avx2 },
+#endif
+#ifdef A3_HH_NEON
+        { "neon", a3_hh_neon },
+#endif
+    };
+
+    std::vector<Impl> ret;
+    for (auto const& impl : all) {
+        if (a3_hh_supported(impl.hash))
+            ret.push_back(impl);
+        else
+            ::testing::Test::RecordProperty(std::string("unsupported_") + impl.name, "skipped");
+    }
+    return ret;
+}
+
+TEST(HighwayHashTest, reference_vectors_each_impl) {
+    uint8_t data[65];
+    for (size_t i = 0; i < sizeof(data); i++)
+        data[i] = static_cast<uint8_t>(i);
+
+    for (auto const& impl : supported_impls()) {
+        SCOPED_TRACE(impl.name);
+        for (size_t size = 0; size < sizeof(data); size++)
+            EXPECT_EQ(impl.hash(data, size, KEY), EXPECTED[size]) << "Size " << size << ".";
+    }
+}
+
+TEST(HighwayHashTest, impls_match_portable) {
+    constexpr size_t MAX_SIZE = 1000;
+
+    std::mt19937_64                       rng(11);
+    std::uniform_int_distribution<size_t> size_of(0, MAX_SIZE);
+    std::vector<uint8_t>                  buffer(MAX_SIZE + 8);
+    auto                                  impls = supported_impls();
+
+    for (size_t round = 0; round < 2000; round++) {
+        uint64_t key[4] = { rng(), rng(), rng(), rng() };
+        for (auto& byte : buffer)
+            byte = static_cast<uint8_t>(rng());
+        size_t         size   = size_of(rng);
+        uint8_t const* data   = &buffer[round % 8];
+        uint64_t       expect = a3_hh_portable(data, size, key);
+
+        for (auto const& impl : impls) {
+            ASSERT_EQ(impl.hash(data, size, key), expect)
+                << impl.name << ", size " << size << ", offset " << round % 8 << ".";
+        }
+    }
+}
+
+} // namespace highwayhash
+} // namespace test
+} // namespace a3
@@ -0,0 +1,150 @@
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <a3/hs.h>
+#include <a3/ht.h>
+#include <a3/str.h>
+
+static int8_t u64_cmp(uint64_t lhs, uint64_t rhs) { return lhs < rhs ? -1 : lhs > rhs; }
+
+A3_HS_DEFINE_STRUCTS(uint64_t)
+A3_HS_DECLARE_METHODS(uint64_t)
+A3_HS_DEFINE_METHODS_POW2_HASHER(uint64_t, A3_HT_HASH_INT, u64_cmp)
+
+A3_HS_DEFINE_STRUCTS(A3CString)
+A3_HS_DECLARE_METHODS(A3CString)
+A3_HS_DEFINE_METHODS(A3CString, a3_string_cptr, a3_string_len, a3_string_cmp)
+
+namespace a3 {
+namespace test {
+namespace hs {
+
+using std::set;
+using std::vector;
+
+class HSTest : public ::testing::Test {
+protected:
+    A3_HS(uint64_t) a {}; // NOLINT(misc-non-private-member-variables-in-classes)
+    A3_HS(uint64_t) b {}; // NOLINT(misc-non-private-member-variables-in-classes)
+
+    void SetUp() override {
+        uint64_t key[A3_HT_HASH_KEY_SIZE] = { 1, 2, 3, 4 };
+        A3_HS_INIT(uint64_t)(&a, reinterpret_cast<uint8_t*>(key), A3_HT_ALLOW_GROWTH);
+        A3_HS_INIT(uint64_t)(&b, A3_HT_HASH_KEY(&a), A3_HT_ALLOW_GROWTH);
+    }
+    void TearDown() override {
+        A3_HS_DESTROY(uint64_t)(&a);
+        A3_HS_DESTROY(uint64_t)(&b);
+    }
+
+    static set<uint64_t> contents(A3_HS(uint64_t) * s) {
+        set<uint64_t> ret;
+        A3_HS_FOR_EACH (uint64_t, s, k) {
+            ret.insert(*k);
+        }
+        EXPECT_EQ(ret.size(), A3_HS_SIZE(uint64_t)(s));
+        return ret;
+    }
+};
+
+TEST_F(HSTest, entry_has_no_value) {
+    EXPECT_EQ(sizeof(A3_HS_ENTRY(uint64_t)), sizeof(uint64_t) * 2);
+}
+
+TEST_F(HSTest, insert_contains_remove) {
+    EXPECT_FALSE(A3_HS_CONTAINS(uint64_t)(&a, 5));
+    EXPECT_TRUE(A3_HS_INSERT(uint64_t)(&a, 5));
+    EXPECT_FALSE(A3_HS_INSERT(uint64_t)(&a, 5));
+    EXPECT_TRUE(A3_HS_CONTAINS(uint64_t)(&a, 5));
+    EXPECT_EQ(A3_HS_SIZE(uint64_t)(&a), 1ULL);
+
+    EXPECT_TRUE(A3_HS_REMOVE(uint64_t)(&a, 5));
+    EXPECT_FALSE(A3_HS_REMOVE(uint64_t)(&a, 5));
+    EXPECT_FALSE(A3_HS_CONTAINS(uint64_t)(&a, 5));
+    EXPECT_EQ(A3_HS_SIZE(uint64_t)(&a), 0ULL);
+
+    for (uint64_t i = 0; i < 10000; i++)
+        ASSERT_TRUE(A3_HS_INSERT(uint64_t)(&a, i * 7));
+    for (uint64_t i = 0; i < 70000; i++)
+        EXPECT_EQ(A3_HS_CONTAINS(uint64_t)(&a, i), i % 7 == 0);
+}
+
+TEST_F(HSTest, set_operations) {
+    set<uint64_t> expected_a;
+    set<uint64_t> expected_b;
+    for (uint64_t i = 0; i < 3000; i++) {
+        A3_HS_INSERT(uint64_t)(&a, i * 2);
+        expected_a.insert(i * 2);
+        A3_HS_INSERT(uint64_t)(&b, i * 3);
+        expected_b.insert(i * 3);
+    }
+
+    A3_HS(uint64_t) c {};
+    A3_HS_INIT(uint64_t)(&c, A3_HT_HASH_KEY(&a), A3_HT_ALLOW_GROWTH);
+    A3_HS_UNION(uint64_t)(&c, &a);
+    EXPECT_EQ(contents(&c), expected_a);
+
+    A3_HS_INTERSECT(uint64_t)(&c, &b);
+    set<uint64_t> expected;
+    for (auto k : expected_a)
+        if (expected_b.count(k))
+            expected.insert(k);
+    EXPECT_EQ(contents(&c), expected);
+
+    A3_HS_UNION(uint64_t)(&c, &b);
+    EXPECT_EQ(contents(&c), expected_b);
+
+    // Both directions of the difference, which walk different sets.
+    A3_HS_DIFFERENCE(uint64_t)(&c, &a);
+    expected.clear();
+    for (auto k : expected_b)
+        if (!expected_a.count(k))
+            expected.insert(k);
+    EXPECT_EQ(contents(&c), expected);
+
+    A3_HS_DIFFERENCE(uint64_t)(&a, &c);
+    EXPECT_EQ(contents(&a), expected_a);
+    A3_HS_INSERT(uint64_t)(&c, 4);
+    A3_HS_DIFFERENCE(uint64_t)(&a, &c);
+    expected_a.erase(4);
+    EXPECT_EQ(contents(&a), expected_a);
+
+    A3_HS_DIFFERENCE(uint64_t)(&c, &c);
+    EXPECT_EQ(A3_HS_SIZE(uint64_t)(&c), 0ULL);
+    A3_HS_DESTROY(uint64_t)(&c);
+}
+
+TEST(HSStringTest, different_hash_keys) {
+    A3_HS(A3CString) a;
+    A3_HS(A3CString) b;
+    A3_HS_INIT(A3CString)(&a, A3_HT_NO_HASH_KEY, A3_HT_ALLOW_GROWTH);
+    A3_HS_INIT(A3CString)(&b, A3_HT_NO_HASH_KEY, A3_HT_ALLOW_GROWTH);
+
+    vector<A3String> keys;
+    for (size_t i = 0; i < 1000; i++) {
+        keys.push_back(a3_string_itoa(i));
+        A3_HS_INSERT(A3CString)(i < 600 ? &a : &b, A3_S_CONST(keys.back()));
+        if (i >= 400 && i < 600)
+            A3_HS_INSERT(A3CString)(&b, A3_S_CONST(keys.back()));
+    }
+
+    A3_HS_INTERSECT(A3CString)(&a, &b);
+    EXPECT_EQ(A3_HS_SIZE(A3CString)(&a), 200ULL);
+    A3_HS_UNION(A3CString)(&a, &b);
+    EXPECT_EQ(A3_HS_SIZE(A3CString)(&a), 600ULL);
+    for (size_t i = 0; i < keys.size(); i++)
+        EXPECT_EQ(A3_HS_CONTAINS(A3CString)(&a, A3_S_CONST(keys[i])), i >= 400);
+
+    A3_HS_DESTROY(A3CString)(&a);
+    A3_HS_DESTROY(A3CString)(&b);
+    for (auto& key : keys)
+        a3_string_free(&key);
+}
+
+} // namespace hs
+} // namespace test
+} // namespace a3
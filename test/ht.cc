@@ -1,11 +1,16 @@
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <a3/alloc.h>
 #include <a3/ht.h>
 #include <a3/str.h>
 #include <a3/util.h>
@@ -13,11 +18,151 @@
 
 #include <gmock/gmock-more-matchers.h>
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 A3_HT_DEFINE_STRUCTS(A3CString, A3CString)
 
 A3_HT_DECLARE_METHODS(A3CString, A3CString)
 A3_HT_DEFINE_METHODS(A3CString, A3CString, a3_string_cptr, a3_string_len, a3_string_cmp)
 
+// Alternative layouts need distinct type names.
+typedef A3CString SwissCString;
+
+A3_HT_DEFINE_STRUCTS_SWISS(A3CString, SwissCString)
+
+A3_HT_DECLARE_METHODS(A3CString, SwissCString)
+A3_HT_DEFINE_METHODS_SWISS(A3CString, SwissCString, a3_string_cptr, a3_string_len, a3_string_cmp)
+
+typedef A3CString Pow2CString;
+
+A3_HT_DEFINE_STRUCTS(A3CString, Pow2CString)
+
+A3_HT_DECLARE_METHODS(A3CString, Pow2CString)
+A3_HT_DEFINE_METHODS_POW2(A3CString, Pow2CString, a3_string_cptr, a3_string_len, a3_string_cmp)
+
+typedef A3CString IncCString;
+
+A3_HT_DEFINE_STRUCTS_INCREMENTAL(A3CString, IncCString)
+
+A3_HT_DECLARE_METHODS(A3CString, IncCString)
+A3_HT_DEFINE_METHODS_INCREMENTAL(A3CString, IncCString, a3_string_cptr, a3_string_len,
+                                 a3_string_cmp)
+
+typedef A3CString SplitCString;
+
+A3_HT_DEFINE_STRUCTS_SPLIT(A3CString, SplitCString)
+
+A3_HT_DECLARE_METHODS(A3CString, SplitCString)
+A3_HT_DEFINE_METHODS_SPLIT(A3CString, SplitCString, a3_string_cptr, a3_string_len, a3_string_cmp)
+
+typedef A3CString FastCString;
+
+A3_HT_DEFINE_STRUCTS(A3CString, FastCString)
+
+A3_HT_DECLARE_METHODS(A3CString, FastCString)
+A3_HT_DEFINE_METHODS_HASHER(A3CString, FastCString, A3_HT_HASH_STRING, a3_string_cmp)
+
+typedef A3CString CompactCString;
+
+A3_HT_DEFINE_STRUCTS_COMPACT(A3CString, CompactCString, 32)
+
+A3_HT_DECLARE_METHODS(A3CString, CompactCString)
+A3_HT_DEFINE_METHODS_COMPACT(A3CString, CompactCString, a3_string_cptr, a3_string_len,
+                             a3_string_cmp)
+
+typedef A3CString Compact16CString;
+
+A3_HT_DEFINE_STRUCTS_COMPACT(A3CString, Compact16CString, 16)
+
+A3_HT_DECLARE_METHODS(A3CString, Compact16CString)
+A3_HT_DEFINE_METHODS_COMPACT_HASHER(A3CString, Compact16CString, A3_HT_HASH_STRING, a3_string_cmp)
+
+typedef A3CString OrderedCString;
+
+A3_HT_DEFINE_STRUCTS_ORDERED(A3CString, OrderedCString)
+
+A3_HT_DECLARE_METHODS(A3CString, OrderedCString)
+A3_HT_DEFINE_METHODS_ORDERED(A3CString, OrderedCString, a3_string_cptr, a3_string_len,
+                             a3_string_cmp)
+
+// Every layout can be frozen.
+#define HT_FROZEN(V)                                                                               \
+    A3_HT_DEFINE_STRUCTS_FROZEN(A3CString, V)                                                      \
+    A3_HT_DECLARE_METHODS_FROZEN(A3CString, V)                                                     \
+    A3_HT_DEFINE_METHODS_FROZEN(A3CString, V, a3_string_cmp)
+
+HT_FROZEN(A3CString)
+HT_FROZEN(SwissCString)
+HT_FROZEN(Pow2CString)
+HT_FROZEN(IncCString)
+HT_FROZEN(SplitCString)
+HT_FROZEN(FastCString)
+HT_FROZEN(CompactCString)
+HT_FROZEN(Compact16CString)
+HT_FROZEN(OrderedCString)
+
+static int8_t u64_cmp(uint64_t lhs, uint64_t rhs) { return lhs < rhs ? -1 : lhs > rhs; }
+
+A3_HT_DEFINE_STRUCTS(uint64_t, uint64_t)
+
+A3_HT_DECLARE_METHODS(uint64_t, uint64_t)
+A3_HT_DEFINE_METHODS_POW2_HASHER(uint64_t, uint64_t, A3_HT_HASH_INT, u64_cmp)
+
+// Compact tables over small keys, where the narrower fields pay off. The hashers deliberately
+// degrade the fingerprint and the home slot respectively.
+#define U32_SAME_TAG(TABLE, KEY)  (A3_HT_HASH_INT(TABLE, KEY) & 0xFFFFFFFFFFFFULL)
+#define U32_CLUSTERED(TABLE, KEY) (A3_HT_HASH_INT(TABLE, KEY) << 9)
+
+static int8_t u32_cmp(uint32_t lhs, uint32_t rhs) { return lhs < rhs ? -1 : lhs > rhs; }
+
+A3_HT_DEFINE_STRUCTS(uint32_t, uint32_t)
+
+typedef uint32_t SameTagU32;
+
+A3_HT_DEFINE_STRUCTS_COMPACT(uint32_t, SameTagU32, 16)
+
+A3_HT_DECLARE_METHODS(uint32_t, SameTagU32)
+A3_HT_DEFINE_METHODS_COMPACT_HASHER(uint32_t, SameTagU32, U32_SAME_TAG, u32_cmp)
+
+typedef uint32_t ClusteredU32;
+
+A3_HT_DEFINE_STRUCTS_COMPACT(uint32_t, ClusteredU32, 16)
+
+A3_HT_DECLARE_METHODS(uint32_t, ClusteredU32)
+A3_HT_DEFINE_METHODS_COMPACT_HASHER(uint32_t, ClusteredU32, U32_CLUSTERED, u32_cmp)
+
+// Hashers which pile every key into a quarter of the slots of a large table: at the start of a
+// table with any capacity, or at the end of one with a power-of-two capacity. Clusters then cross
+// from one thread's range of slots into the next when the table is built in parallel, and wrap.
+#define U64_CLUSTERED(TABLE, KEY) ((A3_HT_HASH_INT(TABLE, KEY) & 0x3FFFULL) + 1)
+#define U64_WRAPPED(TABLE, KEY)   (~(A3_HT_HASH_INT(TABLE, KEY) & 0x3FFFULL))
+
+typedef uint64_t ClusteredU64;
+
+A3_HT_DEFINE_STRUCTS(uint64_t, ClusteredU64)
+
+A3_HT_DECLARE_METHODS(uint64_t, ClusteredU64)
+A3_HT_DEFINE_METHODS_HASHER(uint64_t, ClusteredU64, U64_CLUSTERED, u64_cmp)
+
+typedef uint64_t WrappedU64;
+
+A3_HT_DEFINE_STRUCTS(uint64_t, WrappedU64)
+
+A3_HT_DECLARE_METHODS(uint64_t, WrappedU64)
+A3_HT_DEFINE_METHODS_POW2_HASHER(uint64_t, WrappedU64, U64_WRAPPED, u64_cmp)
+
+struct BigValue {
+    uint64_t words[16];
+};
+
+A3_HT_DEFINE_STRUCTS_SPLIT(A3CString, BigValue)
+
+A3_HT_DECLARE_METHODS(A3CString, BigValue)
+A3_HT_DEFINE_METHODS_SPLIT(A3CString, BigValue, a3_string_cptr, a3_string_len, a3_string_cmp)
+
 namespace a3 {
 namespace test {
 namespace ht {
@@ -231,6 +376,1192 @@ TEST_F(HTTest, nested_for_each) {
         a3_string_free(&entry.second);
 }
 
+// Wrap the methods of each layout so that the same tests can be run against all of them.
+#define HT_LAYOUT(NAME, V)                                                                         \
+    struct NAME {                                                                                  \
+        using Table = A3_HT(A3CString, V);                                                         \
+                                                                                                   \
+        static constexpr auto init          = A3_HT_INIT(A3CString, V);                            \
+        static constexpr auto destroy       = A3_HT_DESTROY(A3CString, V);                         \
+        static constexpr auto resize        = A3_HT_RESIZE(A3CString, V);                          \
+        static constexpr auto insert        = A3_HT_INSERT(A3CString, V);                          \
+        static constexpr auto find          = A3_HT_FIND(A3CString, V);                            \
+        static constexpr auto remove        = A3_HT_DELETE(A3CString, V);                          \
+        static constexpr auto size          = A3_HT_SIZE(A3CString, V);                            \
+        static constexpr auto set_dup_cb    = A3_HT_SET_DUPLICATE_CB(A3CString, V);                \
+        static constexpr auto find_batch    = A3_HT_FIND_BATCH(A3CString, V);                      \
+        static constexpr auto insert_batch  = A3_HT_INSERT_BATCH(A3CString, V);                    \
+        static constexpr auto hash          = A3_HT_HASH(A3CString, V);                            \
+        static constexpr auto find_hashed   = A3_HT_FIND_HASHED(A3CString, V);                     \
+        static constexpr auto insert_hashed = A3_HT_INSERT_HASHED(A3CString, V);                   \
+        static constexpr auto delete_hashed = A3_HT_DELETE_HASHED(A3CString, V);                   \
+        static constexpr auto init_with_cap = A3_HT_INIT_WITH_CAPACITY(A3CString, V);              \
+        static constexpr auto reserve       = A3_HT_RESERVE(A3CString, V);                         \
+        static constexpr auto shrink        = A3_HT_SHRINK_TO_FIT(A3CString, V);                   \
+        static constexpr auto save          = A3_HT_SAVE(A3CString, V);                            \
+        static constexpr auto map           = A3_HT_MAP(A3CString, V);                             \
+        static constexpr auto stats         = A3_HT_STATS(A3CString, V);                           \
+        static constexpr auto clear         = A3_HT_CLEAR(A3CString, V);                           \
+        static constexpr auto retain        = A3_HT_RETAIN(A3CString, V);                          \
+        static constexpr auto drain         = A3_HT_DRAIN(A3CString, V);                           \
+        static constexpr auto merge         = A3_HT_MERGE(A3CString, V);                           \
+        static constexpr auto build         = A3_HT_BUILD_PARALLEL(A3CString, V);                  \
+                                                                                                   \
+        using Frozen = A3_HT_FROZEN(A3CString, V);                                                 \
+                                                                                                   \
+        static constexpr auto freeze         = A3_HT_FREEZE(A3CString, V);                         \
+        static constexpr auto frozen_find    = A3_HT_FROZEN_FIND(A3CString, V);                    \
+        static constexpr auto frozen_size    = A3_HT_FROZEN_SIZE(A3CString, V);                    \
+        static constexpr auto frozen_destroy = A3_HT_FROZEN_DESTROY(A3CString, V);                 \
+                                                                                                   \
+        template <typename F>                                                                      \
+        static void for_each(Table* table, F f) {                                                  \
+            A3_HT_FOR_EACH (A3CString, V, table, k, v) {                                           \
+                f(*k, *v);                                                                         \
+            }                                                                                      \
+        }                                                                                          \
+    }
+
+HT_LAYOUT(RobinHood, A3CString);
+HT_LAYOUT(Swiss, SwissCString);
+HT_LAYOUT(Pow2, Pow2CString);
+HT_LAYOUT(Incremental, IncCString);
+HT_LAYOUT(Split, SplitCString);
+HT_LAYOUT(FastHash, FastCString);
+HT_LAYOUT(Compact, CompactCString);
+HT_LAYOUT(Compact16, Compact16CString);
+HT_LAYOUT(Ordered, OrderedCString);
+
+template <typename L>
+class HTLayoutTest : public Test {
+    A3_PINNED(HTLayoutTest);
+
+protected:
+    typename L::Table table {}; // NOLINT(misc-non-private-member-variables-in-classes)
+
+    HTLayoutTest() { L::init(&table, A3_HT_NO_HASH_KEY, A3_HT_ALLOW_GROWTH); }
+    ~HTLayoutTest() { L::destroy(&table); }
+};
+
+using HTLayouts =
+    Types<RobinHood, Swiss, Pow2, Incremental, Split, FastHash, Compact, Compact16, Ordered>;
+TYPED_TEST_SUITE(HTLayoutTest, HTLayouts);
+
+TYPED_TEST(HTLayoutTest, insert_find_delete) {
+    using L = TypeParam;
+
+    EXPECT_TRUE(L::insert(&this->table, A3_CS("A key"), A3_CS("A value")));
+    EXPECT_EQ(L::size(&this->table), 1ULL);
+    auto* value = L::find(&this->table, A3_CS("A key"));
+    ASSERT_TRUE(value);
+    EXPECT_EQ(a3_string_cmp(*value, A3_CS("A value")), 0);
+    EXPECT_FALSE(L::find(&this->table, A3_CS("Another key")));
+
+    EXPECT_FALSE(L::insert(&this->table, A3_CS("A key"), A3_CS("Another value")));
+    EXPECT_EQ(L::size(&this->table), 1ULL);
+    EXPECT_EQ(a3_string_cmp(*L::find(&this->table, A3_CS("A key")), A3_CS("A value")), 0);
+
+    EXPECT_TRUE(L::remove(&this->table, A3_CS("A key")));
+    EXPECT_FALSE(L::remove(&this->table, A3_CS("A key")));
+    EXPECT_EQ(L::size(&this->table), 0ULL);
+    EXPECT_FALSE(L::find(&this->table, A3_CS("A key")));
+}
+
+TYPED_TEST(HTLayoutTest, grow_and_shrink) {
+    using L = TypeParam;
+
+    vector<A3String> keys;
+    for (size_t i = 0; i < 2000; i++) {
+        keys.push_back(a3_string_itoa(i));
+        ASSERT_TRUE(L::insert(&this->table, A3_S_CONST(keys.back()), A3_S_CONST(keys.back())));
+    }
+    EXPECT_EQ(L::size(&this->table), keys.size());
+
+    // NOLINTNEXTLINE(concurrency-mt-unsafe, cert-msc30-c, cert-msc50-cpp)
+    srand(1);
+    while (!keys.empty()) {
+        // NOLINTNEXTLINE(concurrency-mt-unsafe, cert-msc30-c, cert-msc50-cpp)
+        auto key = keys.begin() + rand() % static_cast<int>(keys.size());
+        ASSERT_TRUE(L::remove(&this->table, A3_S_CONST(*key)));
+        EXPECT_FALSE(L::find(&this->table, A3_S_CONST(*key)));
+        a3_string_free(&*key);
+        keys.erase(key);
+
+        if (keys.size() % 97 == 0) {
+            for (auto& k : keys) {
+                auto* value = L::find(&this->table, A3_S_CONST(k));
+                ASSERT_TRUE(value);
+                EXPECT_EQ(a3_string_cmp(*value, A3_S_CONST(k)), 0);
+            }
+        }
+    }
+
+    EXPECT_EQ(L::size(&this->table), 0ULL);
+}
+
+TYPED_TEST(HTLayoutTest, fixed_size) {
+    using L                   = TypeParam;
+    constexpr size_t TEST_CAP = 512;
+
+    L::resize(&this->table, TEST_CAP);
+    this->table.can_grow = false;
+    size_t cap           = this->table.cap;
+
+    vector<A3String> keys;
+    for (size_t i = 0; i < cap; i++)
+        keys.push_back(a3_string_itoa(i));
+
+    for (size_t round = 0; round < 50; round++) {
+        for (auto& key : keys) {
+            ASSERT_TRUE(L::insert(&this->table, A3_S_CONST(key), A3_S_CONST(key)));
+            ASSERT_TRUE(L::find(&this->table, A3_S_CONST(key)));
+        }
+        EXPECT_EQ(L::size(&this->table), cap);
+        EXPECT_EQ(this->table.cap, cap);
+
+        for (auto& key : keys)
+            ASSERT_TRUE(L::remove(&this->table, A3_S_CONST(key)));
+        EXPECT_EQ(L::size(&this->table), 0ULL);
+    }
+
+    for (auto& key : keys)
+        a3_string_free(&key);
+}
+
+TYPED_TEST(HTLayoutTest, reserve) {
+    using L                = TypeParam;
+    constexpr size_t COUNT = 5000;
+
+    L::reserve(&this->table, COUNT);
+    size_t cap = this->table.cap;
+    EXPECT_GE(cap, COUNT);
+
+    // Reserving less than the current capacity does nothing.
+    L::reserve(&this->table, 10);
+    EXPECT_EQ(this->table.cap, cap);
+
+    vector<A3String> keys;
+    for (size_t i = 0; i < COUNT; i++) {
+        keys.push_back(a3_string_itoa(i));
+        ASSERT_TRUE(L::insert(&this->table, A3_S_CONST(keys.back()), A3_S_CONST(keys.back())));
+    }
+    EXPECT_EQ(this->table.cap, cap);
+
+    typename L::Table other {};
+    L::init_with_cap(&other, A3_HT_NO_HASH_KEY, A3_HT_FORBID_GROWTH, COUNT);
+    for (auto& key : keys)
+        EXPECT_TRUE(L::insert(&other, A3_S_CONST(key), A3_S_CONST(key)));
+    EXPECT_EQ(L::size(&other), COUNT);
+    L::destroy(&other);
+
+    for (auto& key : keys)
+        a3_string_free(&key);
+}
+
+TYPED_TEST(HTLayoutTest, shrink_to_fit) {
+    using L                = TypeParam;
+    constexpr size_t COUNT = 10000;
+
+    vector<A3String> keys;
+    for (size_t i = 0; i < COUNT; i++) {
+        keys.push_back(a3_string_itoa(i));
+        ASSERT_TRUE(L::insert(&this->table, A3_S_CONST(keys.back()), A3_S_CONST(keys.back())));
+    }
+    size_t cap = this->table.cap;
+
+    for (size_t i = 0; i < COUNT; i++) {
+        if (i % 100 == 0)
+            continue;
+        ASSERT_TRUE(L::remove(&this->table, A3_S_CONST(keys[i])));
+    }
+
+    L::shrink(&this->table);
+    EXPECT_LT(this->table.cap, cap / 16);
+    EXPECT_EQ(L::size(&this->table), COUNT / 100);
+    for (size_t i = 0; i < COUNT; i++)
+        EXPECT_EQ(L::find(&this->table, A3_S_CONST(keys[i])) != nullptr, i % 100 == 0);
+
+    // The table still grows normally afterwards.
+    for (size_t i = 0; i < COUNT; i++) {
+        if (i % 100 == 0)
+            continue;
+        ASSERT_TRUE(L::insert(&this->table, A3_S_CONST(keys[i]), A3_S_CONST(keys[i])));
+    }
+    EXPECT_EQ(L::size(&this->table), COUNT);
+
+    for (auto& key : keys)
+        a3_string_free(&key);
+}
+
+TYPED_TEST(HTLayoutTest, duplicate_combine) {
+    using L = TypeParam;
+
+    L::set_dup_cb(&this->table, combine_val);
+    EXPECT_TRUE(L::insert(&this->table, A3_CS("key"), A3_CS("val1")));
+    EXPECT_TRUE(L::insert(&this->table, A3_CS("key"), A3_CS("val2")));
+    EXPECT_EQ(L::size(&this->table), 1ULL);
+
+    A3CString* combined_value = L::find(&this->table, A3_CS("key"));
+    EXPECT_EQ(a3_string_cmp(*combined_value, A3_CS("val1, val2")), 0);
+    a3_string_free(reinterpret_cast<A3String*>(combined_value));
+}
+
+TYPED_TEST(HTLayoutTest, for_each) {
+    using L = TypeParam;
+
+    std::unordered_map<A3CString, A3String> strings;
+    for (unsigned i = 1; i <= 300; i++) {
+        A3String str = a3_string_clone(a3_cstring_from(std::to_string(i).data()));
+        strings.insert({ str, str });
+        L::insert(&this->table, str, str);
+    }
+    for (unsigned i = 1; i <= 300; i += 3)
+        L::remove(&this->table, a3_cstring_from(std::to_string(i).data()));
+
+    size_t count = 0;
+    L::for_each(&this->table, [&](A3CString k, A3CString v) {
+        auto entry = strings.find(k);
+        ASSERT_THAT(entry, Ne(strings.end()));
+        EXPECT_EQ(a3_string_cmp(k, v), 0);
+        count++;
+    });
+    EXPECT_EQ(count, L::size(&this->table));
+    EXPECT_EQ(count, 200ULL);
+
+    for (auto& entry : strings)
+        a3_string_free(&entry.second);
+}
+
+TYPED_TEST(HTLayoutTest, batch) {
+    using L = TypeParam;
+
+    // Enough entries to span several batches and to force growth partway through.
+    vector<A3CString> keys;
+    for (size_t i = 0; i < 1000; i++)
+        keys.push_back(A3_S_CONST(a3_string_itoa(i)));
+    keys.push_back(keys[0]);
+
+    EXPECT_EQ(L::insert_batch(&this->table, keys.data(), keys.data(), keys.size()),
+              keys.size() - 1);
+    EXPECT_EQ(L::size(&this->table), keys.size() - 1);
+
+    // Every other key is missing.
+    vector<A3CString> lookups;
+    for (size_t i = 0; i < keys.size() - 1; i++) {
+        lookups.push_back(keys[i]);
+        lookups.push_back(A3_CS("missing"));
+    }
+    vector<A3CString*> out(lookups.size());
+    L::find_batch(&this->table, lookups.data(), lookups.size(), out.data());
+    for (size_t i = 0; i < lookups.size(); i++) {
+        if (i % 2) {
+            EXPECT_FALSE(out[i]);
+            continue;
+        }
+        ASSERT_TRUE(out[i]);
+        EXPECT_EQ(a3_string_cmp(*out[i], lookups[i]), 0);
+    }
+
+    L::find_batch(&this->table, nullptr, 0, nullptr);
+
+    keys.pop_back();
+    for (auto& key : keys) {
+        A3String tmp = A3_CS_MUT(key);
+        a3_string_free(&tmp);
+    }
+}
+
+TYPED_TEST(HTLayoutTest, hashed) {
+    using L = TypeParam;
+
+    typename L::Table other;
+    L::init(&other, A3_HT_HASH_KEY(&this->table), A3_HT_ALLOW_GROWTH);
+
+    vector<A3String> keys;
+    for (size_t i = 0; i < 500; i++)
+        keys.push_back(a3_string_itoa(i));
+
+    // One hash per key serves both tables.
+    for (auto& key : keys) {
+        uint64_t hash = L::hash(&this->table, A3_S_CONST(key));
+        EXPECT_EQ(hash, L::hash(&other, A3_S_CONST(key)));
+        ASSERT_TRUE(L::insert_hashed(&this->table, hash, A3_S_CONST(key), A3_S_CONST(key)));
+        ASSERT_TRUE(L::insert_hashed(&other, hash, A3_S_CONST(key), A3_CS("other")));
+    }
+
+    for (auto& key : keys) {
+        uint64_t hash  = L::hash(&this->table, A3_S_CONST(key));
+        auto*    value = L::find_hashed(&this->table, hash, A3_S_CONST(key));
+        ASSERT_TRUE(value);
+        EXPECT_EQ(a3_string_cmp(*value, A3_S_CONST(key)), 0);
+        EXPECT_EQ(value, L::find(&this->table, A3_S_CONST(key)));
+
+        value = L::find_hashed(&other, hash, A3_S_CONST(key));
+        ASSERT_TRUE(value);
+        EXPECT_EQ(a3_string_cmp(*value, A3_CS("other")), 0);
+    }
+
+    for (size_t i = 0; i < keys.size(); i += 2) {
+        uint64_t hash = L::hash(&this->table, A3_S_CONST(keys[i]));
+        EXPECT_TRUE(L::delete_hashed(&this->table, hash, A3_S_CONST(keys[i])));
+        EXPECT_FALSE(L::delete_hashed(&this->table, hash, A3_S_CONST(keys[i])));
+    }
+    for (size_t i = 0; i < keys.size(); i++) {
+        EXPECT_EQ(L::find(&this->table, A3_S_CONST(keys[i])) != nullptr, i % 2 == 1);
+        EXPECT_TRUE(L::find(&other, A3_S_CONST(keys[i])));
+    }
+
+    L::destroy(&other);
+    for (auto& key : keys)
+        a3_string_free(&key);
+}
+
+TYPED_TEST(HTLayoutTest, stats) {
+    using L = TypeParam;
+
+    A3HTStats stats;
+    L::stats(&this->table, &stats);
+    EXPECT_EQ(stats.size, 0ULL);
+    EXPECT_EQ(stats.max_displacement, 0ULL);
+
+    vector<A3String> keys;
+    for (size_t i = 0; i < 5000; i++) {
+        keys.push_back(a3_string_itoa(i));
+        ASSERT_TRUE(L::insert(&this->table, A3_S_CONST(keys.back()), A3_S_CONST(keys.back())));
+    }
+    for (auto& key : keys)
+        ASSERT_TRUE(L::find(&this->table, A3_S_CONST(key)));
+
+    L::stats(&this->table, &stats);
+    EXPECT_EQ(stats.size, keys.size());
+    EXPECT_EQ(stats.cap, this->table.cap);
+    EXPECT_DOUBLE_EQ(stats.load, static_cast<double>(stats.size) / static_cast<double>(stats.cap));
+    EXPECT_LE(stats.mean_displacement, static_cast<double>(stats.max_displacement));
+
+    size_t total = 0;
+    size_t last  = 0;
+    for (size_t i = 0; i < A3_HT_STATS_BUCKETS; i++) {
+        total += stats.histogram[i];
+        if (stats.histogram[i])
+            last = i;
+    }
+    EXPECT_EQ(total, keys.size());
+    EXPECT_EQ(last, std::min(stats.max_displacement, size_t { A3_HT_STATS_BUCKETS - 1 }));
+
+#ifdef PROFILE
+    EXPECT_GT(stats.counters.resizes, 0ULL);
+    EXPECT_GE(stats.counters.probes, 2 * keys.size());
+    EXPECT_GE(stats.counters.probe_steps, stats.counters.probes);
+#else
+    EXPECT_EQ(stats.counters.probes, 0ULL);
+#endif
+
+    for (auto& key : keys)
+        a3_string_free(&key);
+}
+
+#ifndef _WIN32
+// Map the contents of a file copy-on-write, as a table would be opened at startup.
+static void* map_file(FILE* file, size_t* len) {
+    *len = static_cast<size_t>(lseek(fileno(file), 0, SEEK_END));
+    void* ret = mmap(nullptr, *len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(file), 0);
+    return ret == MAP_FAILED ? nullptr : ret;
+}
+
+// Keep the entries whose value is "keep".
+static bool keep_marked(void* ctx, A3CString* key, A3CString* value) {
+    (void)key;
+    ++*static_cast<size_t*>(ctx);
+    return a3_string_cmp(*value, A3_CS("keep")) == 0;
+}
+
+static void count_drained(void* ctx, A3CString* key, A3CString* value) {
+    EXPECT_EQ(a3_string_cmp(*key, *value), 0);
+    ++*static_cast<size_t*>(ctx);
+}
+
+TYPED_TEST(HTLayoutTest, clear) {
+    using L = TypeParam;
+
+    vector<A3String> keys;
+    for (size_t i = 0; i < 1000; i++) {
+        keys.push_back(a3_string_itoa(i));
+        ASSERT_TRUE(L::insert(&this->table, A3_S_CONST(keys.back()), A3_S_CONST(keys.back())));
+    }
+    size_t cap = this->table.cap;
+
+    L::clear(&this->table);
+    EXPECT_EQ(L::size(&this->table), 0ULL);
+    EXPECT_EQ(this->table.cap, cap);
+    size_t count = 0;
+    L::for_each(&this->table, [&](A3CString, A3CString) { count++; });
+    EXPECT_EQ(count, 0ULL);
+
+    for (auto& key : keys) {
+        EXPECT_FALSE(L::find(&this->table, A3_S_CONST(key)));
+        ASSERT_TRUE(L::insert(&this->table, A3_S_CONST(key), A3_S_CONST(key)));
+    }
+    EXPECT_EQ(L::size(&this->table), keys.size());
+
+    for (auto& key : keys)
+        a3_string_free(&key);
+}
+
+TYPED_TEST(HTLayoutTest, retain) {
+    using L = TypeParam;
+
+    // Fill a table to capacity as well as a growable one, so that runs of entries wrap around.
+    for (bool full : { false, true }) {
+        if (full) {
+            L::resize(&this->table, 512);
+            this->table.can_grow = false;
+        }
+        size_t n = full ? this->table.cap : 2000;
+
+        vector<A3String> keys;
+        for (size_t i = 0; i < n; i++) {
+            keys.push_back(a3_string_itoa(i));
+            ASSERT_TRUE(L::insert(&this->table, A3_S_CONST(keys.back()),
+                                  i % 3 ? A3_CS("drop") : A3_CS("keep")));
+        }
+
+        size_t visited = 0;
+        size_t removed = L::retain(&this->table, keep_marked, &visited);
+        EXPECT_EQ(visited, n);
+        EXPECT_EQ(removed, n - (n + 2) / 3);
+        EXPECT_EQ(L::size(&this->table), (n + 2) / 3);
+
+        for (size_t i = 0; i < n; i++) {
+            auto* value = L::find(&this->table, A3_S_CONST(keys[i]));
+            if (i % 3) {
+                EXPECT_FALSE(value);
+                continue;
+            }
+            ASSERT_TRUE(value);
+            EXPECT_EQ(a3_string_cmp(*value, A3_CS("keep")), 0);
+        }
+
+        // The table is still consistent for further modification.
+        for (size_t i = 0; i < n; i++) {
+            if (i % 3)
+                ASSERT_TRUE(L::insert(&this->table, A3_S_CONST(keys[i]), A3_CS("drop")));
+            else
+                ASSERT_TRUE(L::remove(&this->table, A3_S_CONST(keys[i])));
+        }
+        EXPECT_EQ(L::size(&this->table), n - (n + 2) / 3);
+
+        L::clear(&this->table);
+        for (auto& key : keys)
+            a3_string_free(&key);
+    }
+}
+
+TYPED_TEST(HTLayoutTest, drain) {
+    using L = TypeParam;
+
+    vector<A3String> keys;
+    for (size_t i = 0; i < 500; i++) {
+        keys.push_back(a3_string_itoa(i));
+        ASSERT_TRUE(L::insert(&this->table, A3_S_CONST(keys.back()), A3_S_CONST(keys.back())));
+    }
+
+    size_t drained = 0;
+    L::drain(&this->table, count_drained, &drained);
+    EXPECT_EQ(drained, keys.size());
+    EXPECT_EQ(L::size(&this->table), 0ULL);
+    EXPECT_FALSE(L::find(&this->table, A3_S_CONST(keys[0])));
+
+    for (auto& key : keys)
+        a3_string_free(&key);
+}
+
+TYPED_TEST(HTLayoutTest, merge) {
+    using L = TypeParam;
+
+    vector<A3String> keys;
+    for (size_t i = 0; i < 3000; i++)
+        keys.push_back(a3_string_itoa(i));
+    for (size_t i = 0; i < 2000; i++)
+        ASSERT_TRUE(L::insert(&this->table, A3_S_CONST(keys[i]), A3_CS("dst")));
+
+    // One source shares the destination's hash key, and one does not.
+    for (bool same_key : { true, false }) {
+        typename L::Table src {};
+        L::init(&src, same_key ? A3_HT_HASH_KEY(&this->table) : A3_HT_NO_HASH_KEY,
+                A3_HT_ALLOW_GROWTH);
+        size_t begin = same_key ? 1000 : 1500;
+        for (size_t i = begin; i < begin + 1500; i++)
+            ASSERT_TRUE(L::insert(&src, A3_S_CONST(keys[i]), A3_CS("src")));
+
+        size_t size  = L::size(&this->table);
+        size_t added = L::merge(&this->table, &src);
+        EXPECT_EQ(added, begin + 1500 - size);
+        EXPECT_EQ(L::size(&this->table), begin + 1500);
+        EXPECT_EQ(L::size(&src), 1500ULL);
+        for (size_t i = 0; i < begin + 1500; i++) {
+            auto* value = L::find(&this->table, A3_S_CONST(keys[i]));
+            ASSERT_TRUE(value);
+            EXPECT_EQ(a3_string_cmp(*value, i < 2000 ? A3_CS("dst") : A3_CS("src")), 0);
+        }
+
+        L::destroy(&src);
+    }
+
+    EXPECT_EQ(L::merge(&this->table, &this->table), 0ULL);
+
+    for (auto& key : keys)
+        a3_string_free(&key);
+}
+
+TYPED_TEST(HTLayoutTest, build_parallel) {
+    using L = TypeParam;
+
+    // Enough keys for four threads, some of them repeated with a different value.
+    vector<A3String> strings;
+    for (size_t i = 0; i < 4 * A3_HT_PARALLEL_MIN; i++)
+        strings.push_back(a3_string_itoa(i));
+    vector<A3CString> keys;
+    vector<A3CString> values;
+    for (size_t i = 0; i < strings.size(); i++) {
+        keys.push_back(A3_S_CONST(strings[i]));
+        values.push_back(A3_CS("first"));
+        if (i % 5 == 0) {
+            keys.push_back(A3_S_CONST(strings[i / 2]));
+            values.push_back(A3_CS("again"));
+        }
+    }
+
+    typename L::Table sequential {};
+    L::init(&sequential, A3_HT_HASH_KEY(&this->table), A3_HT_ALLOW_GROWTH);
+    L::reserve(&sequential, keys.size());
+    EXPECT_EQ(L::insert_batch(&sequential, keys.data(), values.data(), keys.size()),
+              strings.size());
+
+    EXPECT_EQ(L::build(&this->table, keys.data(), values.data(), keys.size(), 4), strings.size());
+    EXPECT_EQ(L::size(&this->table), strings.size());
+
+    // Entries which share a home slot may be in a different order, so compare by lookup.
+    size_t seen = 0;
+    L::for_each(&this->table, [&](A3CString key, A3CString value) {
+        A3CString* expected = L::find(&sequential, key);
+        ASSERT_TRUE(expected);
+        EXPECT_EQ(a3_string_cmp(value, *expected), 0);
+        EXPECT_EQ(a3_string_cmp(value, A3_CS("first")), 0);
+        seen++;
+    });
+    EXPECT_EQ(seen, strings.size());
+
+    // Too few keys to split, and a table which is not empty.
+    EXPECT_EQ(L::build(&this->table, keys.data(), values.data(), 10, 4), 0ULL);
+
+    L::destroy(&sequential);
+    for (auto& string : strings)
+        a3_string_free(&string);
+}
+
+TYPED_TEST(HTLayoutTest, freeze) {
+    using L = TypeParam;
+
+    vector<A3String> keys;
+    for (size_t i = 0; i < 3000; i++) {
+        keys.push_back(a3_string_itoa(i));
+        ASSERT_TRUE(L::insert(&this->table, A3_S_CONST(keys[i]), A3_S_CONST(keys[i])));
+    }
+    for (size_t i = 0; i < keys.size(); i += 3)
+        ASSERT_TRUE(L::remove(&this->table, A3_S_CONST(keys[i])));
+    size_t size = L::size(&this->table);
+
+    typename L::Frozen frozen;
+    L::freeze(&frozen, &this->table);
+    EXPECT_EQ(L::frozen_size(&frozen), size);
+
+    // Lookups from several threads at once, with no synchronization.
+    vector<std::thread> threads;
+    for (size_t t = 0; t < 4; t++) {
+        threads.emplace_back([&] {
+            for (size_t i = 0; i < keys.size(); i++) {
+                auto const* value = L::frozen_find(&frozen, A3_S_CONST(keys[i]));
+                if (i % 3 == 0) {
+                    EXPECT_FALSE(value);
+                    continue;
+                }
+                ASSERT_TRUE(value);
+                EXPECT_EQ(a3_string_cmp(*value, A3_S_CONST(keys[i])), 0);
+            }
+            EXPECT_FALSE(L::frozen_find(&frozen, A3_CS("missing")));
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    L::frozen_destroy(&frozen);
+
+    // Frozen tables may also be empty. The table was destroyed, so it is set up again.
+    L::init(&this->table, A3_HT_NO_HASH_KEY, A3_HT_ALLOW_GROWTH);
+    L::freeze(&frozen, &this->table);
+    EXPECT_EQ(L::frozen_size(&frozen), 0ULL);
+    EXPECT_FALSE(L::frozen_find(&frozen, A3_CS("missing")));
+    L::frozen_destroy(&frozen);
+    L::init(&this->table, A3_HT_NO_HASH_KEY, A3_HT_ALLOW_GROWTH);
+
+    for (auto& key : keys)
+        a3_string_free(&key);
+}
+
+TYPED_TEST(HTLayoutTest, mapped_arrays) {
+    using L = TypeParam;
+
+    // Map every array, so that each allocation and release in the layout goes through the mapping.
+    L::destroy(&this->table);
+    A3AllocPolicy prev = a3_alloc_policy();
+    a3_alloc_policy_set(A3AllocPolicy { .map_threshold = 1, .huge_pages = true, .populate = true });
+    L::init(&this->table, A3_HT_NO_HASH_KEY, A3_HT_ALLOW_GROWTH);
+
+    vector<A3String> keys;
+    for (size_t i = 0; i < 3000; i++) {
+        keys.push_back(a3_string_itoa(i));
+        ASSERT_TRUE(L::insert(&this->table, A3_S_CONST(keys[i]), A3_S_CONST(keys[i])));
+    }
+    for (size_t i = 0; i < keys.size(); i += 2)
+        ASSERT_TRUE(L::remove(&this->table, A3_S_CONST(keys[i])));
+    L::shrink(&this->table);
+    for (size_t i = 0; i < keys.size(); i++)
+        EXPECT_EQ(L::find(&this->table, A3_S_CONST(keys[i])) != nullptr, i % 2 == 1);
+
+    typename L::Frozen frozen;
+    L::freeze(&frozen, &this->table);
+    EXPECT_EQ(L::frozen_size(&frozen), keys.size() / 2);
+    EXPECT_TRUE(L::frozen_find(&frozen, A3_S_CONST(keys[1])));
+    L::frozen_destroy(&frozen);
+
+    a3_alloc_policy_set(prev);
+    L::init(&this->table, A3_HT_NO_HASH_KEY, A3_HT_ALLOW_GROWTH);
+
+    for (auto& key : keys)
+        a3_string_free(&key);
+}
+
+TYPED_TEST(HTLayoutTest, snapshot) {
+    using L = TypeParam;
+
+    // String keys are not plain data, but the strings they point to outlive the mapping here.
+    vector<A3String> keys;
+    for (size_t i = 0; i < 3000; i++) {
+        keys.push_back(a3_string_itoa(i));
+        ASSERT_TRUE(L::insert(&this->table, A3_S_CONST(keys.back()), A3_S_CONST(keys.back())));
+    }
+    for (size_t i = 0; i < keys.size(); i += 3)
+        ASSERT_TRUE(L::remove(&this->table, A3_S_CONST(keys[i])));
+
+    FILE* file = tmpfile();
+    ASSERT_TRUE(file);
+    ASSERT_TRUE(L::save(&this->table, fileno(file)));
+
+    size_t len = 0;
+    void*  ptr = map_file(file, &len);
+    ASSERT_TRUE(ptr);
+
+    typename L::Table mapped {};
+    ASSERT_TRUE(L::map(&mapped, ptr, len));
+    EXPECT_EQ(L::size(&mapped), L::size(&this->table));
+    EXPECT_EQ(mapped.cap, this->table.cap);
+    for (size_t i = 0; i < keys.size(); i++) {
+        auto* value = L::find(&mapped, A3_S_CONST(keys[i]));
+        ASSERT_EQ(value != nullptr, i % 3 != 0);
+        if (!value)
+            continue;
+        EXPECT_EQ(a3_string_cmp(*value, A3_S_CONST(keys[i])), 0);
+    }
+
+    // A copy-on-write mapping can be modified in place, and moves to the heap once it grows.
+    EXPECT_TRUE(L::insert(&mapped, A3_S_CONST(keys[0]), A3_S_CONST(keys[0])));
+    EXPECT_TRUE(L::remove(&mapped, A3_S_CONST(keys[1])));
+    L::reserve(&mapped, mapped.cap * 2);
+    munmap(ptr, len);
+    for (size_t i = 0; i < keys.size(); i++)
+        EXPECT_EQ(L::find(&mapped, A3_S_CONST(keys[i])) != nullptr, i == 0 || (i != 1 && i % 3));
+
+    L::destroy(&mapped);
+    fclose(file);
+    for (auto& key : keys)
+        a3_string_free(&key);
+}
+
+TEST(HTSnapshotTest, rejects_mismatch) {
+    A3_HT(uint64_t, uint64_t) table;
+    A3_HT_INIT(uint64_t, uint64_t)(&table, A3_HT_NO_HASH_KEY, A3_HT_ALLOW_GROWTH);
+    for (uint64_t i = 0; i < 1000; i++)
+        ASSERT_TRUE(A3_HT_INSERT(uint64_t, uint64_t)(&table, i, i));
+
+    FILE* file = tmpfile();
+    ASSERT_TRUE(file);
+    ASSERT_TRUE(A3_HT_SAVE(uint64_t, uint64_t)(&table, fileno(file)));
+    size_t len = 0;
+    auto*  ptr = static_cast<uint8_t*>(map_file(file, &len));
+    ASSERT_TRUE(ptr);
+
+    // A table with a different layout or entry type must not open the snapshot.
+    A3_HT(A3CString, Pow2CString) other {};
+    EXPECT_FALSE(A3_HT_MAP(A3CString, Pow2CString)(&other, ptr, len));
+
+    A3_HT(uint64_t, uint64_t) mapped {};
+    EXPECT_FALSE(A3_HT_MAP(uint64_t, uint64_t)(&mapped, ptr, len - 1));
+    ptr[0] ^= 1;
+    EXPECT_FALSE(A3_HT_MAP(uint64_t, uint64_t)(&mapped, ptr, len));
+    ptr[0] ^= 1;
+
+    ASSERT_TRUE(A3_HT_MAP(uint64_t, uint64_t)(&mapped, ptr, len));
+    for (uint64_t i = 0; i < 1000; i++) {
+        auto* value = A3_HT_FIND(uint64_t, uint64_t)(&mapped, i);
+        ASSERT_TRUE(value);
+        EXPECT_EQ(*value, i);
+    }
+
+    munmap(ptr, len);
+    fclose(file);
+    A3_HT_DESTROY(uint64_t, uint64_t)(&table);
+}
+#endif
+
+TEST(HTHashTest, int_keys) {
+    A3_HT(uint64_t, uint64_t) table;
+    A3_HT_INIT(uint64_t, uint64_t)(&table, A3_HT_NO_HASH_KEY, A3_HT_ALLOW_GROWTH);
+
+    // Sequential and strided keys are the usual worst cases for a weak mix with a masked index.
+    for (uint64_t i = 0; i < 4096; i++)
+        ASSERT_TRUE(A3_HT_INSERT(uint64_t, uint64_t)(&table, i << 12, i));
+    for (uint64_t i = 0; i < 4096; i++) {
+        auto* value = A3_HT_FIND(uint64_t, uint64_t)(&table, i << 12);
+        ASSERT_TRUE(value);
+        EXPECT_EQ(*value, i);
+    }
+    EXPECT_FALSE(A3_HT_FIND(uint64_t, uint64_t)(&table, 1));
+
+    A3_HT_DESTROY(uint64_t, uint64_t)(&table);
+}
+
+TEST(HTHashTest, string_hash) {
+    uint64_t key[A3_HT_HASH_KEY_SIZE]   = { 1, 2, 3, 4 };
+    uint64_t other[A3_HT_HASH_KEY_SIZE] = { 5, 2, 3, 4 };
+
+    // Every length takes a slightly different path, and each byte should affect the result.
+    uint8_t          buf[64] = { 0 };
+    vector<uint64_t> hashes;
+    for (size_t len = 0; len <= sizeof(buf); len++) {
+        hashes.push_back(a3_ht_hash_bytes(key, buf, len));
+        for (size_t i = 0; i < len; i++) {
+            buf[i] = 1;
+            hashes.push_back(a3_ht_hash_bytes(key, buf, len));
+            buf[i] = 0;
+        }
+        EXPECT_NE(a3_ht_hash_bytes(key, buf, len), a3_ht_hash_bytes(other, buf, len));
+    }
+    std::sort(hashes.begin(), hashes.end());
+    EXPECT_EQ(std::adjacent_find(hashes.begin(), hashes.end()), hashes.end());
+
+    EXPECT_EQ(a3_ht_hash_int(key, 42), a3_ht_hash_int(key, 42));
+    EXPECT_NE(a3_ht_hash_int(key, 42), a3_ht_hash_int(other, 42));
+}
+
+static bool add_val(uint64_t* current_value, uint64_t new_value) {
+    *current_value += new_value;
+    return true;
+}
+
+// Build the same keys, with repeats, in parallel and in order, and check that every slot holds an
+// entry with the same home, and every key the same value. Capacities of power-of-two tables are
+// also powers of two, so the home slot is the hash modulo the capacity in every layout.
+#define HT_PARALLEL_TEST(NAME, V)                                                                  \
+    TEST(HTParallelTest, NAME) {                                                                   \
+        vector<uint64_t> keys;                                                                     \
+        vector<uint64_t> values;                                                                   \
+        for (uint64_t i = 0; i < 5 * A3_HT_PARALLEL_MIN; i++) {                                    \
+            keys.push_back(i * 7919);                                                              \
+            values.push_back(i);                                                                   \
+            if (i % 3 == 0) {                                                                      \
+                keys.push_back(i / 3 * 7919);                                                      \
+                values.push_back(1000000 + i);                                                     \
+            }                                                                                      \
+        }                                                                                          \
+                                                                                                   \
+        A3_HT(uint64_t, V) sequential;                                                             \
+        A3_HT(uint64_t, V) parallel;                                                               \
+        A3_HT_INIT(uint64_t, V)(&sequential, A3_HT_NO_HASH_KEY, A3_HT_ALLOW_GROWTH);               \
+        A3_HT_INIT(uint64_t, V)(&parallel, A3_HT_HASH_KEY(&sequential), A3_HT_ALLOW_GROWTH);       \
+        A3_HT_SET_DUPLICATE_CB(uint64_t, V)(&sequential, add_val);                                 \
+        A3_HT_SET_DUPLICATE_CB(uint64_t, V)(&parallel, add_val);                                   \
+                                                                                                   \
+        A3_HT_RESERVE(uint64_t, V)(&sequential, keys.size());                                      \
+        EXPECT_EQ(A3_HT_INSERT_BATCH(uint64_t, V)(&sequential, keys.data(), values.data(),         \
+                                                  keys.size()),                                    \
+                  keys.size());                                                                    \
+        EXPECT_EQ(A3_HT_BUILD_PARALLEL(uint64_t, V)(&parallel, keys.data(), values.data(),         \
+                                                    keys.size(), 4),                               \
+                  keys.size());                                                                    \
+                                                                                                   \
+        ASSERT_EQ(parallel.cap, sequential.cap);                                                   \
+        EXPECT_EQ(parallel.size, sequential.size);                                                 \
+        for (size_t i = 0; i < parallel.cap; i++) {                                                \
+            EXPECT_EQ(!parallel.entries[i].hash, !sequential.entries[i].hash);                     \
+            EXPECT_EQ(parallel.entries[i].hash % parallel.cap,                                     \
+                      sequential.entries[i].hash % sequential.cap);                                \
+        }                                                                                          \
+        for (uint64_t key : keys) {                                                                \
+            uint64_t* value = A3_HT_FIND(uint64_t, V)(&parallel, key);                             \
+            ASSERT_TRUE(value);                                                                    \
+            EXPECT_EQ(*value, *A3_HT_FIND(uint64_t, V)(&sequential, key));                         \
+        }                                                                                          \
+                                                                                                   \
+        A3_HT_DESTROY(uint64_t, V)(&sequential);                                                   \
+        A3_HT_DESTROY(uint64_t, V)(&parallel);                                                     \
+    }
+
+HT_PARALLEL_TEST(spread, uint64_t)
+HT_PARALLEL_TEST(clustered, ClusteredU64)
+HT_PARALLEL_TEST(wrapped, WrappedU64)
+
+TEST(HTPow2Test, capacity_is_power_of_two) {
+    A3_HT(A3CString, Pow2CString) table;
+    A3_HT_INIT(A3CString, Pow2CString)(&table, A3_HT_NO_HASH_KEY, A3_HT_ALLOW_GROWTH);
+    EXPECT_EQ(table.cap & (table.cap - 1), 0ULL);
+
+    A3_HT_RESIZE(A3CString, Pow2CString)(&table, 1000);
+    EXPECT_EQ(table.cap, 1024ULL);
+
+    vector<A3String> keys;
+    for (size_t i = 0; i < 5000; i++) {
+        keys.push_back(a3_string_itoa(i));
+        A3_HT_INSERT(A3CString, Pow2CString)(&table, A3_S_CONST(keys.back()), A3_CS("value"));
+    }
+    EXPECT_EQ(table.cap & (table.cap - 1), 0ULL);
+    for (auto& key : keys) {
+        EXPECT_TRUE(A3_HT_FIND(A3CString, Pow2CString)(&table, A3_S_CONST(key)));
+        a3_string_free(&key);
+    }
+
+    A3_HT_DESTROY(A3CString, Pow2CString)(&table);
+}
+
+// Each compact slot costs its entry, a fingerprint and a displacement byte.
+#define SLOT_SIZE(K, V) (sizeof(A3_HT_ENTRY(K, V)) + sizeof(A3_HT_TAG(K, V)) + 1)
+
+TEST(HTCompactTest, entries_shrink) {
+    EXPECT_LT(SLOT_SIZE(uint32_t, SameTagU32), sizeof(A3_HT_ENTRY(uint32_t, uint32_t)));
+    EXPECT_LT(SLOT_SIZE(A3CString, Compact16CString), sizeof(A3_HT_ENTRY(A3CString, FastCString)));
+    EXPECT_LT(SLOT_SIZE(A3CString, CompactCString), sizeof(A3_HT_ENTRY(A3CString, FastCString)));
+}
+
+TEST(HTCompactTest, colliding_fingerprints) {
+    A3_HT(uint32_t, SameTagU32) table;
+    A3_HT_INIT(uint32_t, SameTagU32)(&table, A3_HT_NO_HASH_KEY, A3_HT_ALLOW_GROWTH);
+
+    for (uint32_t i = 0; i < 10000; i++)
+        ASSERT_TRUE(A3_HT_INSERT(uint32_t, SameTagU32)(&table, i, i * 2));
+    for (uint32_t i = 0; i < 10000; i += 2)
+        ASSERT_TRUE(A3_HT_DELETE(uint32_t, SameTagU32)(&table, i));
+    for (uint32_t i = 0; i < 12000; i++) {
+        uint32_t* value = A3_HT_FIND(uint32_t, SameTagU32)(&table, i);
+        if (i % 2 == 0 || i >= 10000) {
+            EXPECT_FALSE(value);
+            continue;
+        }
+        ASSERT_TRUE(value);
+        EXPECT_EQ(*value, i * 2);
+    }
+    EXPECT_EQ(A3_HT_SIZE(uint32_t, SameTagU32)(&table), 5000ULL);
+
+    A3_HT_DESTROY(uint32_t, SameTagU32)(&table);
+}
+
+TEST(HTCompactTest, displacement_overflow_grows) {
+    A3_HT(uint32_t, ClusteredU32) table;
+    A3_HT_INIT_WITH_CAPACITY(uint32_t, ClusteredU32)(&table, A3_HT_NO_HASH_KEY,
+                                                     A3_HT_ALLOW_GROWTH, 300);
+    ASSERT_EQ(table.cap, 512ULL);
+
+    // Every key has the same home until the table exceeds 512 slots.
+    for (uint32_t i = 0; i < 300; i++)
+        ASSERT_TRUE(A3_HT_INSERT(uint32_t, ClusteredU32)(&table, i, i));
+    EXPECT_GE(table.cap, 1024ULL);
+    for (uint32_t i = 0; i < 300; i++) {
+        uint32_t* value = A3_HT_FIND(uint32_t, ClusteredU32)(&table, i);
+        ASSERT_TRUE(value);
+        EXPECT_EQ(*value, i);
+    }
+
+    A3HTStats stats;
+    A3_HT_STATS(uint32_t, ClusteredU32)(&table, &stats);
+    EXPECT_LT(stats.max_displacement, UINT8_MAX);
+
+    A3_HT_DESTROY(uint32_t, ClusteredU32)(&table);
+}
+
+TEST(HTCompactTest, displacement_overflow_fails_without_growth) {
+    A3_HT(uint32_t, ClusteredU32) table;
+    A3_HT_INIT_WITH_CAPACITY(uint32_t, ClusteredU32)(&table, A3_HT_NO_HASH_KEY,
+                                                     A3_HT_FORBID_GROWTH, 300);
+    ASSERT_EQ(table.cap, 512ULL);
+
+    // Every key has the same home, so the 255th would be displaced too far.
+    for (uint32_t i = 0; i < UINT8_MAX - 1; i++)
+        ASSERT_TRUE(A3_HT_INSERT(uint32_t, ClusteredU32)(&table, i, i));
+    EXPECT_FALSE(A3_HT_INSERT(uint32_t, ClusteredU32)(&table, UINT8_MAX - 1, 0));
+    EXPECT_FALSE(A3_HT_INSERT(uint32_t, ClusteredU32)(&table, 1000, 0));
+    EXPECT_EQ(table.cap, 512ULL);
+    EXPECT_EQ(A3_HT_SIZE(uint32_t, ClusteredU32)(&table), UINT8_MAX - 1ULL);
+    EXPECT_FALSE(A3_HT_FIND(uint32_t, ClusteredU32)(&table, UINT8_MAX - 1));
+    for (uint32_t i = 0; i < UINT8_MAX - 1; i++) {
+        uint32_t* value = A3_HT_FIND(uint32_t, ClusteredU32)(&table, i);
+        ASSERT_TRUE(value);
+        EXPECT_EQ(*value, i);
+    }
+
+    // Making room lets the insert through.
+    ASSERT_TRUE(A3_HT_DELETE(uint32_t, ClusteredU32)(&table, 7));
+    EXPECT_TRUE(A3_HT_INSERT(uint32_t, ClusteredU32)(&table, UINT8_MAX - 1, 0));
+
+    A3_HT_DESTROY(uint32_t, ClusteredU32)(&table);
+}
+
+static bool replace_val(A3CString* current_value, A3CString new_value) {
+    *current_value = new_value;
+    return true;
+}
+
+TEST(HTOrderedTest, insertion_order) {
+    A3_HT(A3CString, OrderedCString) table;
+    A3_HT_INIT(A3CString, OrderedCString)(&table, A3_HT_NO_HASH_KEY, A3_HT_ALLOW_GROWTH);
+
+    vector<A3String> keys;
+    for (size_t i = 0; i < 1000; i++) {
+        keys.push_back(a3_string_itoa(i));
+        ASSERT_TRUE(A3_HT_INSERT(A3CString, OrderedCString)(&table, A3_S_CONST(keys.back()),
+                                                            A3_S_CONST(keys.back())));
+    }
+
+    // Drop every key not divisible by 3, then reinsert the first few, which moves them to the end.
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (i % 3 == 0)
+            continue;
+        ASSERT_TRUE(A3_HT_DELETE(A3CString, OrderedCString)(&table, A3_S_CONST(keys[i])));
+    }
+    for (size_t i = 1; i < 10; i += 3)
+        ASSERT_TRUE(A3_HT_INSERT(A3CString, OrderedCString)(&table, A3_S_CONST(keys[i]),
+                                                            A3_S_CONST(keys[i])));
+
+    vector<size_t> expected;
+    for (size_t i = 0; i < keys.size(); i += 3)
+        expected.push_back(i);
+    for (size_t i = 1; i < 10; i += 3)
+        expected.push_back(i);
+
+    size_t i = 0;
+    A3_HT_FOR_EACH (A3CString, OrderedCString, &table, k, v) {
+        ASSERT_LT(i, expected.size());
+        EXPECT_EQ(a3_string_cmp(*k, A3_S_CONST(keys[expected[i]])), 0);
+        EXPECT_EQ(a3_string_cmp(*k, *v), 0);
+        i++;
+    }
+    EXPECT_EQ(i, expected.size());
+
+    A3_HT_DESTROY(A3CString, OrderedCString)(&table);
+    for (auto& key : keys)
+        a3_string_free(&key);
+}
+
+TEST(HTOrderedTest, duplicates_keep_position) {
+    A3_HT(A3CString, OrderedCString) table;
+    A3_HT_INIT(A3CString, OrderedCString)(&table, A3_HT_NO_HASH_KEY, A3_HT_ALLOW_GROWTH);
+    A3_HT_SET_DUPLICATE_CB(A3CString, OrderedCString)(&table, replace_val);
+
+    A3CString keys[] = { A3_CS("first"), A3_CS("second"), A3_CS("third") };
+    for (auto key : keys)
+        ASSERT_TRUE(A3_HT_INSERT(A3CString, OrderedCString)(&table, key, key));
+    ASSERT_TRUE(A3_HT_INSERT(A3CString, OrderedCString)(&table, A3_CS("first"), A3_CS("new")));
+
+    size_t i = 0;
+    A3_HT_FOR_EACH (A3CString, OrderedCString, &table, k, v) {
+        ASSERT_LT(i, 3ULL);
+        EXPECT_EQ(a3_string_cmp(*k, keys[i]), 0);
+        EXPECT_EQ(a3_string_cmp(*v, i == 0 ? A3_CS("new") : keys[i]), 0);
+        i++;
+    }
+    EXPECT_EQ(i, 3ULL);
+
+    A3_HT_DESTROY(A3CString, OrderedCString)(&table);
+}
+
+TEST(HTOrderedTest, iteration_follows_size) {
+    A3_HT(A3CString, OrderedCString) table;
+    A3_HT_INIT(A3CString, OrderedCString)(&table, A3_HT_NO_HASH_KEY, A3_HT_ALLOW_GROWTH);
+
+    vector<A3String> keys;
+    for (size_t i = 0; i < 10000; i++) {
+        keys.push_back(a3_string_itoa(i));
+        ASSERT_TRUE(A3_HT_INSERT(A3CString, OrderedCString)(&table, A3_S_CONST(keys.back()),
+                                                            A3_S_CONST(keys.back())));
+    }
+    size_t cap = table.cap;
+
+    // The holes left by deletions never outnumber the remaining entries, however large the table.
+    for (size_t i = 0; i + 10 < keys.size(); i++) {
+        ASSERT_TRUE(A3_HT_DELETE(A3CString, OrderedCString)(&table, A3_S_CONST(keys[i])));
+        ASSERT_LE(table.used, 2 * table.size);
+    }
+    EXPECT_EQ(table.cap, cap);
+    EXPECT_EQ(table.size, 10ULL);
+
+    for (size_t i = keys.size() - 10; i < keys.size(); i++) {
+        auto* value = A3_HT_FIND(A3CString, OrderedCString)(&table, A3_S_CONST(keys[i]));
+        ASSERT_TRUE(value);
+        EXPECT_EQ(a3_string_cmp(*value, A3_S_CONST(keys[i])), 0);
+    }
+
+    A3_HT_DESTROY(A3CString, OrderedCString)(&table);
+    for (auto& key : keys)
+        a3_string_free(&key);
+}
+
+TEST(HTSplitTest, large_values) {
+    A3_HT(A3CString, BigValue) table;
+    A3_HT_INIT(A3CString, BigValue)(&table, A3_HT_NO_HASH_KEY, A3_HT_ALLOW_GROWTH);
+
+    // Entries hold only the key and hash.
+    EXPECT_EQ(sizeof(A3_HT_ENTRY(A3CString, BigValue)), sizeof(A3CString) + sizeof(uint64_t));
+
+    vector<A3String> keys;
+    for (uint64_t i = 0; i < 1000; i++) {
+        keys.push_back(a3_string_itoa(i));
+        BigValue value {};
+        for (auto& word : value.words)
+            word = i;
+        ASSERT_TRUE(A3_HT_INSERT(A3CString, BigValue)(&table, A3_S_CONST(keys.back()), value));
+    }
+
+    for (uint64_t i = 0; i < keys.size(); i++) {
+        BigValue* value = A3_HT_FIND(A3CString, BigValue)(&table, A3_S_CONST(keys[i]));
+        ASSERT_TRUE(value);
+        EXPECT_GE(value, table.values);
+        EXPECT_LT(value, table.values + table.cap);
+        for (auto word : value->words)
+            EXPECT_EQ(word, i);
+    }
+
+    for (uint64_t i = 0; i < keys.size(); i += 2)
+        ASSERT_TRUE(A3_HT_DELETE(A3CString, BigValue)(&table, A3_S_CONST(keys[i])));
+
+    size_t count = 0;
+    A3_HT_FOR_EACH (A3CString, BigValue, &table, k, v) {
+        auto* value = A3_HT_FIND(A3CString, BigValue)(&table, *k);
+        EXPECT_EQ(value, v);
+        EXPECT_EQ(v->words[0] % 2, 1ULL);
+        count++;
+    }
+    EXPECT_EQ(count, keys.size() / 2);
+
+    A3_HT_DESTROY(A3CString, BigValue)(&table);
+    for (auto& key : keys)
+        a3_string_free(&key);
+}
+
+TEST(HTIncrementalTest, migrates_gradually) {
+    A3_HT(A3CString, IncCString) table;
+    A3_HT_INIT(A3CString, IncCString)(&table, A3_HT_NO_HASH_KEY, A3_HT_ALLOW_GROWTH);
+
+    vector<A3String> keys;
+    auto             insert = [&]() {
+        keys.push_back(a3_string_itoa(keys.size()));
+        return A3_HT_INSERT(A3CString, IncCString)(&table, A3_S_CONST(keys.back()),
+                                                   A3_S_CONST(keys.back()));
+    };
+
+    // Fill until the table starts to grow past a size which takes many operations to migrate.
+    while (!table.old_entries || table.old_cap < 1024)
+        ASSERT_TRUE(insert());
+    size_t old_cap = table.old_cap;
+    EXPECT_GT(table.cap, old_cap);
+    EXPECT_LT(table.migrated, old_cap);
+
+    // Insertions and deletions during the migration must see entries in both arrays.
+    ASSERT_TRUE(insert());
+    EXPECT_TRUE(A3_HT_DELETE(A3CString, IncCString)(&table, A3_S_CONST(keys[0])));
+    EXPECT_FALSE(A3_HT_FIND(A3CString, IncCString)(&table, A3_S_CONST(keys[0])));
+    EXPECT_FALSE(A3_HT_INSERT(A3CString, IncCString)(&table, A3_S_CONST(keys[1]), A3_CS("dup")));
+    EXPECT_EQ(table.size, keys.size() - 1);
+
+    // Each operation moves only a bounded number of slots.
+    EXPECT_TRUE(table.old_entries);
+    EXPECT_LE(table.migrated, 5 * A3_HT_MIGRATE_STEP);
+
+    // Lookups move nothing, so every pointer they return stays valid until the next insertion.
+    size_t             migrated = table.migrated;
+    vector<A3CString*> values;
+    for (size_t i = 1; i < keys.size(); i++) {
+        auto* value = A3_HT_FIND(A3CString, IncCString)(&table, A3_S_CONST(keys[i]));
+        ASSERT_TRUE(value);
+        values.push_back(value);
+    }
+    EXPECT_EQ(table.migrated, migrated);
+    EXPECT_TRUE(table.old_entries);
+    for (size_t i = 1; i < keys.size(); i++) {
+        EXPECT_EQ(a3_string_cmp(*values[i - 1], A3_S_CONST(keys[i])), 0);
+    }
+
+    // Iteration covers both arrays without finishing the migration.
+    size_t count = 0;
+    A3_HT_FOR_EACH (A3CString, IncCString, &table, k, v) {
+        EXPECT_EQ(a3_string_cmp(*k, *v), 0);
+        count++;
+    }
+    EXPECT_TRUE(table.old_entries);
+    EXPECT_EQ(table.migrated, migrated);
+    EXPECT_EQ(count, table.size);
+
+    A3HTStats stats;
+    A3_HT_STATS(A3CString, IncCString)(&table, &stats);
+    EXPECT_TRUE(table.old_entries);
+    EXPECT_EQ(stats.size, table.size);
+
+    A3_HT_DESTROY(A3CString, IncCString)(&table);
+    for (auto& key : keys)
+        a3_string_free(&key);
+}
+
+TEST(HTIncrementalTest, retain_during_migration) {
+    A3_HT(A3CString, IncCString) table;
+    A3_HT_INIT(A3CString, IncCString)(&table, A3_HT_NO_HASH_KEY, A3_HT_ALLOW_GROWTH);
+
+    vector<A3String> keys;
+    while (!table.old_entries || table.old_cap < 1024) {
+        A3CString value = keys.size() % 2 == 0 ? A3_CS("keep") : A3_CS("drop");
+        keys.push_back(a3_string_itoa(keys.size()));
+        ASSERT_TRUE(A3_HT_INSERT(A3CString, IncCString)(&table, A3_S_CONST(keys.back()), value));
+    }
+    size_t migrated = table.migrated;
+
+    size_t visited = 0;
+    EXPECT_EQ(A3_HT_RETAIN(A3CString, IncCString)(&table, keep_marked, &visited), keys.size() / 2);
+    EXPECT_EQ(visited, keys.size());
+    EXPECT_TRUE(table.old_entries);
+    EXPECT_EQ(table.migrated, migrated);
+    EXPECT_EQ(table.size, keys.size() - keys.size() / 2);
+    for (size_t i = 0; i < keys.size(); i++) {
+        EXPECT_EQ(A3_HT_FIND(A3CString, IncCString)(&table, A3_S_CONST(keys[i])) != nullptr,
+                  i % 2 == 0);
+    }
+
+    // Growing again finishes migrating the repaired old array first.
+    A3_HT_RESERVE(A3CString, IncCString)(&table, table.cap * 2);
+    for (size_t i = 0; i < keys.size(); i++) {
+        EXPECT_EQ(A3_HT_FIND(A3CString, IncCString)(&table, A3_S_CONST(keys[i])) != nullptr,
+                  i % 2 == 0);
+    }
+
+    A3_HT_DESTROY(A3CString, IncCString)(&table);
+    for (auto& key : keys)
+        a3_string_free(&key);
+}
+
 } // namespace ht
 } // namespace test
 } // namespace a3
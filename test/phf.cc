@@ -0,0 +1,111 @@
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <a3/phf.h>
+#include <a3/phf.hh>
+#include <a3/str.h>
+
+#include "phf_headers.h"
+
+namespace a3 {
+namespace test {
+namespace phf {
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+static constexpr auto METHODS = a3::make_perfect_hash(
+    { "GET", "HEAD", "POST", "PUT", "DELETE", "CONNECT", "OPTIONS", "TRACE" });
+
+static_assert(METHODS.find("GET") == 0);
+static_assert(METHODS.find("TRACE") == 7);
+static_assert(METHODS.find("PATCH") == -1);
+static_assert(!METHODS.contains("get"));
+
+TEST(PerfectHashTest, finds_every_key) {
+    for (size_t i = 0; i < METHODS.size(); i++) {
+        EXPECT_EQ(METHODS.find(METHODS.keys[i]), static_cast<A3_SSIZE_T>(i));
+        EXPECT_EQ(METHODS.find(A3CString { reinterpret_cast<uint8_t const*>(METHODS.keys[i].data()),
+                                           METHODS.keys[i].size() }),
+                  static_cast<A3_SSIZE_T>(i));
+    }
+}
+
+TEST(PerfectHashTest, rejects_others) {
+    EXPECT_EQ(METHODS.find(A3_CS("GETS")), -1);
+    EXPECT_EQ(METHODS.find(A3_CS("GE")), -1);
+    EXPECT_EQ(METHODS.find(A3_CS("")), -1);
+    EXPECT_EQ(METHODS.find(A3_CS("post")), -1);
+    EXPECT_EQ(METHODS.find(A3_CS_NULL), -1);
+}
+
+TEST(PerfectHashTest, single_key) {
+    static constexpr auto ONE = a3::make_perfect_hash({ "" });
+    static_assert(ONE.find("") == 0);
+    EXPECT_EQ(ONE.find(A3_CS("a")), -1);
+}
+
+TEST(PerfectHashTest, generated_header) {
+    EXPECT_EQ(a3_phf_find(&phf_headers, A3_CS("Accept")), 0);
+    EXPECT_EQ(a3_phf_find(&phf_headers, A3_CS("WWW-Authenticate")), 36);
+    for (size_t i = 0; i <= phf_headers.mask; i++) {
+        if (phf_headers.slots[i] == A3_PHF_EMPTY)
+            continue;
+        EXPECT_EQ(a3_phf_find(&phf_headers, phf_headers.keys[phf_headers.slots[i]]),
+                  static_cast<A3_SSIZE_T>(phf_headers.slots[i]));
+    }
+
+    EXPECT_EQ(a3_phf_find(&phf_headers, A3_CS("accept")), -1);
+    EXPECT_EQ(a3_phf_find(&phf_headers, A3_CS("Accept-")), -1);
+    EXPECT_EQ(a3_phf_find(&phf_headers, A3_CS("X-Forwarded-For")), -1);
+}
+
+TEST(PerfectHashTest, large_keyset) {
+    vector<string> strings;
+    for (size_t i = 0; i < 20000; i++)
+        strings.push_back("key-" + std::to_string(i * 7919));
+    vector<string_view> keys(strings.begin(), strings.end());
+
+    uint64_t         seed = 0;
+    vector<uint32_t> disp(detail::phf_buckets(keys.size()));
+    vector<uint32_t> slots(detail::phf_cap(keys.size()));
+    vector<uint64_t> hashes(keys.size());
+    vector<uint32_t> order(keys.size());
+    vector<uint32_t> starts(disp.size() + 1);
+    ASSERT_EQ(detail::phf_build(keys, seed, disp, slots, hashes, order, starts),
+              detail::PhfStatus::Ok);
+
+    vector<A3CString> c_keys;
+    for (auto key : keys)
+        c_keys.push_back({ reinterpret_cast<uint8_t const*>(key.data()), key.size() });
+    A3Phf table { seed,         static_cast<uint32_t>(disp.size()),
+                  static_cast<uint32_t>(slots.size() - 1),
+                  disp.data(),  slots.data(),
+                  c_keys.data() };
+
+    for (size_t i = 0; i < c_keys.size(); i++)
+        EXPECT_EQ(a3_phf_find(&table, c_keys[i]), static_cast<A3_SSIZE_T>(i));
+    EXPECT_EQ(a3_phf_find(&table, A3_CS("key-1")), -1);
+}
+
+TEST(PerfectHashTest, duplicate_keys) {
+    vector<string_view> keys { "a", "b", "a" };
+    uint64_t            seed = 0;
+    vector<uint32_t>    disp(detail::phf_buckets(keys.size()));
+    vector<uint32_t>    slots(detail::phf_cap(keys.size()));
+    vector<uint64_t>    hashes(keys.size());
+    vector<uint32_t>    order(keys.size());
+    vector<uint32_t>    starts(disp.size() + 1);
+    EXPECT_EQ(detail::phf_build(keys, seed, disp, slots, hashes, order, starts),
+              detail::PhfStatus::Duplicate);
+}
+
+} // namespace phf
+} // namespace test
+} // namespace a3
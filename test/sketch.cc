@@ -0,0 +1,83 @@
+#include <cstddef>
+#include <cstdint>
+#include <random>
+
+#include <gtest/gtest.h>
+
+#include <a3/sketch.h>
+
+namespace a3 {
+namespace test {
+namespace sketch {
+
+constexpr size_t CAPACITY = 1024;
+
+class SketchTest : public ::testing::Test {
+protected:
+    A3Sketch* sketch { nullptr }; // NOLINT(misc-non-private-member-variables-in-classes)
+
+    void SetUp() override { sketch = a3_sketch_new(CAPACITY); }
+    void TearDown() override { a3_sketch_free(sketch); }
+};
+
+static uint64_t hash_of(uint64_t i) { return (i + 1) * 0x9E3779B97F4A7C15ULL; }
+
+TEST_F(SketchTest, small) {
+    // Four-bit counters, rounded up to a power of two.
+    EXPECT_GE(a3_sketch_bytes(sketch), CAPACITY * A3_SKETCH_COUNTERS / 2);
+    EXPECT_LE(a3_sketch_bytes(sketch), CAPACITY * A3_SKETCH_COUNTERS);
+}
+
+TEST_F(SketchTest, counts) {
+    EXPECT_EQ(a3_sketch_estimate(sketch, hash_of(0)), 0);
+    for (uint8_t i = 1; i <= 10; i++) {
+        a3_sketch_increment(sketch, hash_of(0));
+        EXPECT_EQ(a3_sketch_estimate(sketch, hash_of(0)), i);
+    }
+}
+
+TEST_F(SketchTest, saturates) {
+    for (size_t i = 0; i < A3_SKETCH_MAX * 2; i++)
+        a3_sketch_increment(sketch, hash_of(0));
+    EXPECT_EQ(a3_sketch_estimate(sketch, hash_of(0)), A3_SKETCH_MAX);
+}
+
+TEST_F(SketchTest, never_underestimates) {
+    constexpr size_t ITEMS = CAPACITY / 4;
+
+    // Fewer than the sample size, so nothing has been halved yet.
+    std::mt19937_64 rng(3);
+    size_t          counts[ITEMS] = {};
+    for (size_t i = 0; i < CAPACITY * 4; i++) {
+        size_t item = rng() % ITEMS;
+        counts[item]++;
+        a3_sketch_increment(sketch, hash_of(item));
+    }
+
+    size_t exact = 0;
+    for (size_t i = 0; i < ITEMS; i++) {
+        size_t expected = counts[i] < A3_SKETCH_MAX ? counts[i] : A3_SKETCH_MAX;
+        EXPECT_GE(a3_sketch_estimate(sketch, hash_of(i)), expected);
+        exact += a3_sketch_estimate(sketch, hash_of(i)) == expected;
+    }
+    EXPECT_GT(exact, ITEMS * 9 / 10);
+}
+
+TEST_F(SketchTest, ages) {
+    for (size_t i = 0; i < 12; i++)
+        a3_sketch_increment(sketch, hash_of(0));
+
+    // Once ten times the capacity have been recorded, every count is halved.
+    size_t recorded = 12;
+    while (a3_sketch_estimate(sketch, hash_of(0)) >= 12) {
+        a3_sketch_increment(sketch, hash_of(recorded++));
+        ASSERT_LT(recorded, CAPACITY * 20);
+    }
+    EXPECT_GE(recorded, CAPACITY * 10);
+    EXPECT_GE(a3_sketch_estimate(sketch, hash_of(0)), 6);
+    EXPECT_LE(a3_sketch_estimate(sketch, hash_of(0)), 7);
+}
+
+} // namespace sketch
+} // namespace test
+} // namespace a3
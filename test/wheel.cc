@@ -0,0 +1,139 @@
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <a3/wheel.h>
+
+namespace a3 {
+namespace test {
+namespace wheel {
+
+using std::vector;
+
+struct Fired {
+    uint64_t id;
+    uint64_t deadline;
+    uint64_t at;
+};
+
+class WheelTest : public ::testing::Test {
+protected:
+    static constexpr uint64_t START = 1000;
+
+    A3TimerWheel* wheel { nullptr }; // NOLINT(misc-non-private-member-variables-in-classes)
+    vector<Fired> fired;             // NOLINT(misc-non-private-member-variables-in-classes)
+
+    void SetUp() override { wheel = a3_wheel_new(START); }
+    void TearDown() override { a3_wheel_free(wheel); }
+
+    static void record(void* ctx, A3Timer timer) {
+        auto* self = static_cast<WheelTest*>(ctx);
+        self->fired.push_back({ timer.id, timer.deadline, a3_wheel_now(self->wheel) });
+    }
+
+    void advance(uint64_t now) { a3_wheel_advance(wheel, now, record, this); }
+};
+
+TEST_F(WheelTest, fires_at_deadline) {
+    vector<uint64_t> delays = { 1, 2, 63, 64, 65, 127, 4095, 4096, 4097, 262143, 262144, 300000,
+                                (1ULL << 24) - 1, 1ULL << 24, (1ULL << 24) + 5, 3ULL << 24 };
+    for (uint64_t delay : delays)
+        a3_wheel_schedule(wheel, delay, START + delay);
+    EXPECT_EQ(a3_wheel_count(wheel), delays.size());
+
+    advance(START + delays.back());
+    ASSERT_EQ(fired.size(), delays.size());
+    for (size_t i = 0; i < delays.size(); i++) {
+        EXPECT_EQ(fired[i].id, delays[i]);
+        EXPECT_EQ(fired[i].at, START + delays[i]);
+    }
+    EXPECT_EQ(a3_wheel_count(wheel), 0ULL);
+}
+
+TEST_F(WheelTest, past_deadline_fires_next_tick) {
+    a3_wheel_schedule(wheel, 1, START - 10);
+    a3_wheel_schedule(wheel, 2, START);
+
+    advance(START);
+    EXPECT_TRUE(fired.empty());
+    advance(START + 1);
+    ASSERT_EQ(fired.size(), 2ULL);
+    EXPECT_EQ(fired[0].at, START + 1);
+    EXPECT_EQ(fired[1].at, START + 1);
+}
+
+TEST_F(WheelTest, random_deadlines) {
+    constexpr size_t   COUNT = 20000;
+    constexpr uint64_t SPAN  = 1ULL << 20;
+
+    std::mt19937_64                         rng(7);
+    std::uniform_int_distribution<uint64_t> delay(1, SPAN);
+    std::uniform_int_distribution<uint64_t> step(1, 5000);
+
+    vector<uint64_t> deadlines(COUNT);
+    for (size_t i = 0; i < COUNT; i++) {
+        deadlines[i] = START + delay(rng);
+        a3_wheel_schedule(wheel, i, deadlines[i]);
+    }
+
+    // Advance in uneven steps, which must not change when anything fires.
+    for (uint64_t now = START; now < START + SPAN;) {
+        now += step(rng);
+        advance(now);
+        for (auto const& f : fired) {
+            ASSERT_LE(f.deadline, now);
+        }
+    }
+
+    ASSERT_EQ(fired.size(), COUNT);
+    vector<bool> seen(COUNT);
+    for (size_t i = 0; i < fired.size(); i++) {
+        EXPECT_EQ(fired[i].deadline, deadlines[fired[i].id]);
+        EXPECT_EQ(fired[i].at, fired[i].deadline);
+        EXPECT_FALSE(seen[fired[i].id]);
+        seen[fired[i].id] = true;
+        if (i) {
+            EXPECT_LE(fired[i - 1].deadline, fired[i].deadline);
+        }
+    }
+}
+
+TEST_F(WheelTest, empty_wheel_jumps) {
+    advance(START + (1ULL << 40));
+    EXPECT_EQ(a3_wheel_now(wheel), START + (1ULL << 40));
+
+    a3_wheel_schedule(wheel, 1, START + (1ULL << 40) + 100);
+    advance(START + (1ULL << 40) + 100);
+    ASSERT_EQ(fired.size(), 1ULL);
+    EXPECT_EQ(fired[0].at, START + (1ULL << 40) + 100);
+}
+
+TEST_F(WheelTest, clear) {
+    for (uint64_t i = 1; i <= 100; i++)
+        a3_wheel_schedule(wheel, i, START + i * 100);
+    a3_wheel_clear(wheel);
+    EXPECT_EQ(a3_wheel_count(wheel), 0ULL);
+
+    advance(START + 100000);
+    EXPECT_TRUE(fired.empty());
+}
+
+static void reschedule(void* ctx, A3Timer timer) {
+    auto* wheel = static_cast<A3TimerWheel*>(ctx);
+    if (timer.id)
+        a3_wheel_schedule(wheel, timer.id - 1, timer.deadline + 100);
+}
+
+TEST_F(WheelTest, callback_schedules) {
+    a3_wheel_schedule(wheel, 10, START + 1);
+
+    a3_wheel_advance(wheel, START + 1 + 10 * 100, reschedule, wheel);
+    EXPECT_EQ(a3_wheel_count(wheel), 0ULL);
+}
+
+} // namespace wheel
+} // namespace test
+} // namespace a3
@@ -0,0 +1,148 @@
+/*
+ * PHF_GEN -- Generate C perfect hash tables.
+ *
+ * Copyright (c) 2020-2021, Alex O'Brien <3541@3541.website>
+ *
+ * This file is licensed under the BSD 3-clause license. See the LICENSE file in
+ * the project root for details.
+ */
+
+/*
+ * Usage: a3_phf_gen INPUT OUTPUT [NAME]
+ *
+ * Read keys from INPUT, one per line, and write a header to OUTPUT defining `static A3Phf const
+ * NAME`, for use with a3_phf_find. Blank lines are ignored. NAME defaults to the base name of
+ * INPUT.
+ */
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <a3/phf.hh>
+
+static std::string name_for(std::string_view path) {
+    size_t slash = path.find_last_of("/\\");
+    if (slash != std::string_view::npos)
+        path.remove_prefix(slash + 1);
+    path = path.substr(0, path.find('.'));
+
+    std::string ret { path };
+    for (char& c : ret) {
+        if (!std::isalnum(static_cast<unsigned char>(c)))
+            c = '_';
+    }
+    if (ret.empty() || std::isdigit(static_cast<unsigned char>(ret[0])))
+        ret.insert(0, "phf_");
+    return ret;
+}
+
+static void write_literal(FILE* out, std::string_view key) {
+    std::fputc('"', out);
+    for (char c : key) {
+        auto byte = static_cast<unsigned char>(c);
+        if (byte == '"' || byte == '\\' || byte == '?' || !std::isprint(byte))
+            std::fprintf(out, "\\%03o", byte);
+        else
+            std::fputc(byte, out);
+    }
+    std::fputc('"', out);
+}
+
+static void write_words(FILE* out, char const* name, char const* what,
+                        std::vector<uint32_t> const& words) {
+    std::fprintf(out, "static uint32_t const %s_%s[] = {", name, what);
+    for (size_t i = 0; i < words.size(); i++)
+        std::fprintf(out, "%s%luU,", i % 8 ? " " : "\n    ", static_cast<unsigned long>(words[i]));
+    std::fprintf(out, "\n};\n\n");
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3 || argc > 4) {
+        std::fprintf(stderr, "Usage: %s INPUT OUTPUT [NAME]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    FILE* in = std::fopen(argv[1], "rb");
+    if (!in) {
+        std::perror(argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    std::string contents;
+    char        buf[4096];
+    size_t      read = 0;
+    while ((read = std::fread(buf, 1, sizeof(buf), in)) > 0)
+        contents.append(buf, read);
+    std::fclose(in);
+
+    std::vector<std::string_view> keys;
+    std::string_view              rest { contents };
+    while (!rest.empty()) {
+        size_t           eol  = rest.find('\n');
+        std::string_view line = rest.substr(0, eol);
+        rest.remove_prefix(eol == std::string_view::npos ? rest.size() : eol + 1);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        if (!line.empty())
+            keys.push_back(line);
+    }
+    if (keys.empty()) {
+        std::fprintf(stderr, "%s: No keys.\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t              seed = 0;
+    std::vector<uint32_t> disp(a3::detail::phf_buckets(keys.size()));
+    std::vector<uint32_t> slots(a3::detail::phf_cap(keys.size()));
+    std::vector<uint64_t> hashes(keys.size());
+    std::vector<uint32_t> order(keys.size());
+    std::vector<uint32_t> starts(disp.size() + 1);
+    switch (a3::detail::phf_build(keys, seed, disp, slots, hashes, order, starts)) {
+    case a3::detail::PhfStatus::Ok:
+        break;
+    case a3::detail::PhfStatus::Duplicate:
+        std::fprintf(stderr, "%s: Duplicate keys.\n", argv[1]);
+        return EXIT_FAILURE;
+    case a3::detail::PhfStatus::Failed:
+        std::fprintf(stderr, "%s: No seed gives a perfect hash.\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    std::string name = argc > 3 ? argv[3] : name_for(argv[1]);
+    FILE*       out  = std::fopen(argv[2], "wb");
+    if (!out) {
+        std::perror(argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    std::fprintf(out, "/* Generated by a3_phf_gen from %s. Do not edit. */\n\n", argv[1]);
+    std::fprintf(out, "#pragma once\n\n#include <a3/phf.h>\n\n");
+    std::fprintf(out, "static A3CString const %s_keys[] = {\n", name.c_str());
+    for (auto key : keys) {
+        std::fprintf(out, "    { (uint8_t const*)");
+        write_literal(out, key);
+        std::fprintf(out, ", %lu },\n", static_cast<unsigned long>(key.size()));
+    }
+    std::fprintf(out, "};\n\n");
+    write_words(out, name.c_str(), "disp", disp);
+    write_words(out, name.c_str(), "slots", slots);
+    std::fprintf(out,
+                 "static A3Phf const %s = {\n    0x%016llXULL, %luU, %luU, %s_disp, %s_slots, "
+                 "%s_keys,\n};\n",
+                 name.c_str(), static_cast<unsigned long long>(seed),
+                 static_cast<unsigned long>(disp.size()),
+                 static_cast<unsigned long>(slots.size() - 1), name.c_str(), name.c_str(),
+                 name.c_str());
+
+    if (std::fclose(out) != 0) {
+        std::perror(argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}